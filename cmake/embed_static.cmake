@@ -0,0 +1,120 @@
+# Embeds every file of a folder into a C source file, for the server to serve from memory.
+# Run in script mode:
+#   cmake -DSTATIC_DIR=<folder> -DOUTPUT_DIR=<folder> [-DBROTLI_EXECUTABLE=<brotli>] [-DMAX_AGE=<seconds>] -P embed_static.cmake
+#
+# Writes static_assets.c and static_assets.h into OUTPUT_DIR. Each file is stored as it is and gzip compressed,
+# and brotli compressed too if BROTLI_EXECUTABLE is given. Each copy gets a strong ETag made from the SHA-256
+# of the file, with the encoding appended for the compressed ones, as they are different representations
+
+get_filename_component(STATIC_DIR "${STATIC_DIR}" ABSOLUTE)
+get_filename_component(OUTPUT_DIR "${OUTPUT_DIR}" ABSOLUTE)
+if(NOT DEFINED MAX_AGE)
+    set(MAX_AGE 604800)
+endif()
+
+# Turns a file into the lines of a C array initializer
+function(embed_bytes file out_var)
+    file(READ "${file}" hex HEX)
+    # 32 bytes per line
+    string(REGEX REPLACE "(................................................................)" "\\1\n" hex "${hex}")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," hex "${hex}")
+    set(${out_var} "${hex}" PARENT_SCOPE)
+endfunction()
+
+file(GLOB files LIST_DIRECTORIES false RELATIVE "${STATIC_DIR}" "${STATIC_DIR}/*")
+list(SORT files)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}/compressed")
+
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(name IN LISTS files)
+    set(path "${STATIC_DIR}/${name}")
+    file(SHA256 "${path}" hash)
+    string(SUBSTRING "${hash}" 0 20 hash)
+
+    get_filename_component(extension "${name}" LAST_EXT)
+    string(TOLOWER "${extension}" extension)
+    if(extension STREQUAL ".html")
+        set(type "text/html")
+    elseif(extension STREQUAL ".js")
+        set(type "text/javascript")
+    elseif(extension STREQUAL ".css")
+        set(type "text/css")
+    elseif(extension STREQUAL ".json")
+        set(type "application/json")
+    elseif(extension STREQUAL ".svg")
+        set(type "image/svg+xml")
+    elseif(extension STREQUAL ".png")
+        set(type "image/png")
+    else()
+        set(type "application/octet-stream")
+    endif()
+
+    # Pages name the other files, so browsers check them every time to pick up new versions of those
+    if(extension STREQUAL ".html")
+        set(age 0)
+    else()
+        set(age ${MAX_AGE})
+    endif()
+
+    file(SIZE "${path}" size)
+    embed_bytes("${path}" bytes)
+    string(APPEND arrays "// ${name}\nstatic const unsigned char static_asset_${index}[] = {\n${bytes}};\n\n")
+    set(bodies "static_asset_${index}")
+    set(lengths "${size}")
+    set(etags "\"\\\"${hash}\\\"\"")
+
+    set(gzip_file "${OUTPUT_DIR}/compressed/${name}.gz")
+    file(ARCHIVE_CREATE OUTPUT "${gzip_file}" PATHS "${path}" FORMAT raw COMPRESSION GZip COMPRESSION_LEVEL 9)
+    file(SIZE "${gzip_file}" gzip_size)
+    embed_bytes("${gzip_file}" bytes)
+    string(APPEND arrays "static const unsigned char static_asset_${index}_gzip[] = {\n${bytes}};\n\n")
+    string(APPEND bodies ", static_asset_${index}_gzip")
+    string(APPEND lengths ", ${gzip_size}")
+    string(APPEND etags ", \"\\\"${hash}-gzip\\\"\"")
+
+    if(BROTLI_EXECUTABLE)
+        set(brotli_file "${OUTPUT_DIR}/compressed/${name}.br")
+        execute_process(COMMAND "${BROTLI_EXECUTABLE}" --best --force --output=${brotli_file} "${path}" RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Failed to compress ${name} with brotli")
+        endif()
+        file(SIZE "${brotli_file}" brotli_size)
+        embed_bytes("${brotli_file}" bytes)
+        string(APPEND arrays "static const unsigned char static_asset_${index}_br[] = {\n${bytes}};\n\n")
+        string(APPEND bodies ", static_asset_${index}_br")
+        string(APPEND lengths ", ${brotli_size}")
+        string(APPEND etags ", \"\\\"${hash}-br\\\"\"")
+    else()
+        string(APPEND bodies ", NULL")
+        string(APPEND lengths ", 0")
+        string(APPEND etags ", NULL")
+    endif()
+
+    string(APPEND table "\t{\"/${name}\", \"${type}\", ${age}, {${bodies}}, {${lengths}}, {${etags}}},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE "${OUTPUT_DIR}/static_assets.h"
+"#pragma once
+
+#include <http/http.h>
+
+// Files of the static folder, embedded by cmake/embed_static.cmake
+extern const http_static_asset STATIC_ASSETS[];
+extern const int STATIC_ASSET_COUNT;
+")
+
+file(WRITE "${OUTPUT_DIR}/static_assets.c"
+"// Generated by cmake/embed_static.cmake from the static folder. Do not edit
+
+#include \"static_assets.h\"
+
+#include <stddef.h>
+
+${arrays}const http_static_asset STATIC_ASSETS[] = {
+${table}};
+
+const int STATIC_ASSET_COUNT = ${index};
+")
@@ -0,0 +1,20 @@
+n = 100000
+dim composite(n)
+
+count = 0
+i = 2
+while i < n + 1 then
+    if composite(i) = 0 then
+        count = count + 1
+        if i < n / i + 1 then
+            j = i * i
+            while j < n + 1 then
+                composite(j) = 1
+                j = j + i
+            end
+        end
+    end
+    i = i + 1
+end
+
+print("Primes up to", n, ":", count)
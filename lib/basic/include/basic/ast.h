@@ -58,6 +58,18 @@ typedef union
 	Literal literal;
 	// For ALU operation
 	ASTOperator op;
+
+	// For a program sequence that is not parsed yet: its tokens, up to the ending ELSE/END
+	struct
+	{
+		int from;
+		int to;
+	} token_range;
+
+	// For an array value, only found at runtime
+	struct _basic_array *array;
+	// For a dictionary value, only found at runtime
+	struct _basic_dict *dict;
 } ASTData;
 
 typedef enum
@@ -66,7 +78,9 @@ typedef enum
 	DTYPE_STR,
 	DTYPE_NUM,
 	DTYPE_FLT,
-	DTYPE_SYMB
+	DTYPE_SYMB,
+	DTYPE_ARRAY,
+	DTYPE_DICT
 } ASTDType;
 
 typedef struct
@@ -79,6 +93,8 @@ typedef enum
 {
 	AST_NONE,
 	AST_PROGRAM_SEQUENCE,
+	// Program sequence whose statements are parsed when it first runs
+	AST_DEFERRED_SEQUENCE,
 
 	// Operation
 	AST_KEYWORD,
@@ -92,6 +108,11 @@ typedef enum
 
 	// Call to function
 	AST_FUNC_CALL,
+	// Call to a user-defined function, found when the call first runs
+	AST_USER_CALL,
+
+	// Line number at the start of a statement, which GOTO can jump to
+	AST_LABEL,
 } ASTNodeType;
 
 typedef struct _ast_node
@@ -101,11 +122,26 @@ typedef struct _ast_node
 
 	struct _ast_node *next;
 	struct _ast_node *child;
+
+	// Index resolved ahead of running, -1 if there is none. For a variable, or the array/dictionary of a
+	// function call, the local variable slot in the call frame of its function. For a FUNCTION definition,
+	// how many slots its frame has. For a user-defined function call, the function it calls. For a GOTO, the
+	// jump table entry of its line
+	int slot;
 } ASTNode;
 
 // Void data
 extern ASTNodeData ASTVOID;
 
+// How floats are converted to strings
+typedef enum
+{
+	// Shortest form that reads back as the same value, such as "0.1"
+	AST_FLOAT_SHORTEST,
+	// Six decimal places, such as "0.100000", like earlier versions
+	AST_FLOAT_FIXED
+} ASTFloatFormat;
+
 void ast_display_level(ASTNode *node, int level);
 
 // Public functions
@@ -113,8 +149,11 @@ ASTNode *ast_create_node();
 void ast_append_child(ASTNode *parent, ASTNode *node);
 void ast_delete_node(ASTNode *node);
 void ast_delete_children_cascade(ASTNode *root);
+ASTNode *ast_unwrap_expression(ASTNode *node);
 void ast_display(ASTNode *node);
+void ast_set_float_format(ASTFloatFormat format);
 void ast_data_as_string(ASTNodeData ast_data, char *buffer);
+void ast_concat_as_string(ASTNodeData a, ASTNodeData b, char *result);
 int ast_data_to_int(ASTNodeData ast_data);
 float ast_data_to_flt(ASTNodeData ast_data);
 ASTOperatorType ast_get_operator_type(ASTOperator op);
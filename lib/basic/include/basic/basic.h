@@ -18,3 +18,7 @@
 #include "basic_lexer.h"
 #include "basic_parser.h"
 #include "basic_runner.h"
+#include "basic_array.h"
+#include "basic_dict.h"
+#include "basic_incremental.h"
+#include "basic_parallel.h"
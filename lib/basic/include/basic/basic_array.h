@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ast.h"
+
+#include <stddef.h>
+
+/* Arrays created with DIM */
+
+// Most dimensions an array can have
+#define BASIC_ARRAY_MAX_DIMS 4
+// Most elements an array can have in total
+#define BASIC_ARRAY_MAX_LENGTH (1 << 24)
+
+// How the elements are stored. Arrays start as integers, and move to floats, then to
+// boxed values, the first time an element of another type is stored
+typedef enum
+{
+	ARRAY_STORAGE_INT,
+	ARRAY_STORAGE_FLT,
+	// Any value, such as strings
+	ARRAY_STORAGE_BOXED
+} BASICArrayStorage;
+
+typedef struct _basic_array
+{
+	BASICArrayStorage storage;
+	int dim_count;
+	// Number of elements along each dimension
+	int dims[BASIC_ARRAY_MAX_DIMS];
+	size_t length;
+	// Number of variables holding this array
+	int references;
+	union
+	{
+		int *ints;
+		float *flts;
+		ASTNodeData *boxed;
+	} data;
+} BASICArray;
+
+/**
+ * Create an array of zeros with indices from 0 up to and including `bounds[i]` along each of
+ * the `dim_count` dimensions, as in "DIM a(10)" having 11 elements. The array has no references.
+ * Returns NULL if the size is not allowed or the memory could not be allocated.
+ */
+BASICArray *basic_array_create(const int *bounds, int dim_count);
+
+void basic_array_retain(BASICArray *array);
+// Frees the array when the last reference is released
+void basic_array_release(BASICArray *array);
+
+ASTNodeData basic_array_get(BASICArray *array, size_t index);
+
+/**
+ * Store `value` at `index`, changing the storage first if it can't hold the value.
+ * Returns 0 on success, 1 if the storage could not be changed for lack of memory,
+ * or 2 if the value can't be stored in an array.
+ */
+int basic_array_set(BASICArray *array, size_t index, ASTNodeData value);
+
+// Change integer storage to floats. Returns 1 if the memory could not be allocated
+int basic_array_to_float(BASICArray *array);
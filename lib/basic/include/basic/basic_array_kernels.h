@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+
+/* Bulk operations over the unboxed elements of an array */
+
+// Instruction sets the kernels can be built with, from the slowest
+typedef enum
+{
+	ARRAY_KERNELS_SCALAR,
+	ARRAY_KERNELS_SSE2,
+	ARRAY_KERNELS_AVX2
+} BASICArrayKernelLevel;
+
+// Integer kernels wrap around on overflow, like the interpreter's own integer arithmetic.
+// Float sums are added in a different order than a loop would, so the last bits may differ
+typedef struct
+{
+	BASICArrayKernelLevel level;
+
+	int (*sum_int)(const int *a, size_t length);
+	float (*sum_flt)(const float *a, size_t length);
+	int (*dot_int)(const int *a, const int *b, size_t length);
+	float (*dot_flt)(const float *a, const float *b, size_t length);
+	float (*dot_int_flt)(const int *a, const float *b, size_t length);
+
+	// a[i] = a[i] * k
+	void (*scale_int)(int *a, int k, size_t length);
+	void (*scale_flt)(float *a, float k, size_t length);
+	// a[i] = a[i] + k
+	void (*offset_int)(int *a, int k, size_t length);
+	void (*offset_flt)(float *a, float k, size_t length);
+	// a[i] = a[i] + b[i]
+	void (*add_int)(int *a, const int *b, size_t length);
+	void (*add_flt)(float *a, const float *b, size_t length);
+	void (*add_flt_int)(float *a, const int *b, size_t length);
+
+	// Stores the same 32 bits in every element, for both integers and floats
+	void (*fill)(void *a, const void *value, size_t length);
+
+	int (*max_int)(const int *a, size_t length);
+	float (*max_flt)(const float *a, size_t length);
+	int (*min_int)(const int *a, size_t length);
+	float (*min_flt)(const float *a, size_t length);
+} BASICArrayKernels;
+
+/**
+ * The kernels for the best instruction set this CPU supports. The CPU is checked on the first call.
+ */
+const BASICArrayKernels *basic_array_kernels();
+
+/**
+ * The kernels for the given instruction set, or NULL if it wasn't built in or this CPU doesn't support it.
+ */
+const BASICArrayKernels *basic_array_kernels_for(BASICArrayKernelLevel level);
+
+const char *basic_array_kernel_name(BASICArrayKernelLevel level);
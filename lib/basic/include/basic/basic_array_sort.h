@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ast.h"
+#include "basic_array.h"
+
+#include <stddef.h>
+
+/* Sorting arrays in place */
+
+// Arrays shorter than this are sorted by insertion, as counting passes cost more than they save
+#define BASIC_SORT_INSERTION_MAX 48
+
+/**
+ * Sort the elements of an array in place, in ascending or descending order.
+ * Integer and float arrays use an LSD radix sort, which is always stable. Boxed arrays use an
+ * introsort, or a merge sort if `stable` is set so that equal elements keep their order.
+ * Returns 0 on success, or 1 if the scratch memory could not be allocated.
+ */
+int basic_array_sort(BASICArray *array, int descending, int stable);
+
+/**
+ * LSD radix sorts over 8 bits per pass, skipping passes where every key has the same byte.
+ * `scratch` must hold `length` elements.
+ */
+void basic_sort_radix_int(int *a, int *scratch, size_t length, int descending);
+void basic_sort_radix_flt(float *a, float *scratch, size_t length, int descending);
+
+/**
+ * Order of two boxed values: numbers by value, before strings in byte order, before anything else.
+ * Returns a negative number, zero or a positive number like strcmp.
+ */
+int basic_sort_compare(const ASTNodeData *a, const ASTNodeData *b);
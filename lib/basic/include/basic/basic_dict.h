@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ast.h"
+
+#include <data_structures/hashmap.h>
+#include <data_structures/interner.h>
+
+/* Dictionaries created with DICT() */
+
+typedef enum
+{
+	DICT_OK,
+	DICT_NOT_FOUND,
+	DICT_NO_MEMORY,
+	// Keys can only be numbers or strings
+	DICT_BAD_KEY,
+	// Values can't be arrays or dictionaries
+	DICT_BAD_VALUE
+} BASICDictResult;
+
+typedef struct _basic_dict
+{
+	// Keys are the value type in the high 32 bits, and the integer, the float bits or the
+	// interned string id in the low 32 bits. Values are ASTNodeData
+	HashMap map;
+	// Where string keys are interned, shared by every dictionary of a runtime
+	StringInterner *strings;
+	// Number of variables holding this dictionary
+	int references;
+} BASICDict;
+
+/**
+ * Create an empty dictionary with no references. String keys are interned in `strings`, which
+ * must outlive the dictionary.
+ */
+BASICDict *basic_dict_create(StringInterner *strings);
+
+void basic_dict_retain(BASICDict *dict);
+// Frees the dictionary when the last reference is released
+void basic_dict_release(BASICDict *dict);
+
+BASICDictResult basic_dict_get(BASICDict *dict, ASTNodeData key, ASTNodeData *value);
+BASICDictResult basic_dict_set(BASICDict *dict, ASTNodeData key, ASTNodeData value);
+BASICDictResult basic_dict_remove(BASICDict *dict, ASTNodeData key);
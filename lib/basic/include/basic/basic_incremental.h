@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ast.h"
+#include "basic_token.h"
+#include "basic_program.h"
+
+#include <stddef.h>
+
+/* Incremental front end, for re-checking a program after small edits */
+
+// Error code of a unit with an IF/WHILE block or parenthesis that is not closed before the end of the program
+#define BASIC_INCREMENTAL_UNCLOSED -2
+
+/**
+ * Top-level statement of the program: a run of tokens ending with a newline
+ * that is not inside any IF/WHILE block or function call parenthesis.
+ * Each unit owns its tokens and the top-level AST nodes parsed from them, so an
+ * edit only needs to re-lex and re-parse the units it touches.
+ */
+typedef struct
+{
+	// Offset of the first character of the unit in the program source
+	size_t char_start;
+	// Tokens of this unit only, without a TOKEN_END
+	BASICTokenParseList tokens;
+	// Address the unit was lexed at, to convert token positions to offsets later
+	char *lex_base;
+
+	// Top-level nodes produced by this unit, which are linked into the program sequence
+	ASTNode *first_node;
+	ASTNode *last_node;
+
+	// Number of END keywords and ')' without an opening IF/WHILE or '(' in this unit
+	int excess_closers;
+
+	// Syntax error of this unit, if any
+	int error;
+	size_t error_offset;
+} BASICStatementUnit;
+
+typedef struct
+{
+	BASICProgram *program;
+	// Program source owned by this object
+	char *source;
+	size_t source_length;
+	size_t source_capacity;
+
+	BASICStatementUnit *units;
+	int unit_count;
+	int unit_capacity;
+} BASICIncrementalProgram;
+
+// Error found while checking the program
+typedef struct
+{
+	size_t offset;
+	int line;
+	int column;
+	char message[128];
+} BASICDiagnostic;
+
+BASICIncrementalProgram *basic_incremental_create(const char *source, size_t source_length);
+void basic_incremental_destroy(BASICIncrementalProgram *inc);
+
+/**
+ * Apply an edit to the program source: `removed_length` characters at `offset` are replaced
+ * by `inserted_length` characters of `inserted`. Only the statements touched by the edit are
+ * lexed and parsed again, the AST of all other statements is reused.
+ * Returns the number of syntax errors in the program after the edit, or -1 if the edit is invalid.
+ */
+int basic_incremental_edit(BASICIncrementalProgram *inc, size_t offset, size_t removed_length, const char *inserted, size_t inserted_length);
+
+/**
+ * Copy up to `max_count` diagnostics of the current program into `diagnostics`, in source order.
+ * Returns the total number of diagnostics.
+ */
+int basic_incremental_get_diagnostics(BASICIncrementalProgram *inc, BASICDiagnostic *diagnostics, int max_count);
@@ -4,3 +4,11 @@
 
 // Lexer
 int basic_tokenize(BASICProgram *program);
+int basic_tokenize_range(BASICTokenParseList *parse_list, char *from, char *end);
+void basic_clear_tokens(BASICTokenParseList *parse_list);
+void basic_token_set_error(BASICTokenParseList *parse_list, char *position, const char *format, ...);
+void program_whereis(const char *program, const char *current_position, int *line, int *column);
+
+// Type suffixes of variable names
+int basic_lexer_is_type_suffix(const char *at, const char *end);
+ASTDType basic_name_type(const char *name);
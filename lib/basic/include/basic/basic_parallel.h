@@ -0,0 +1,29 @@
+#pragma once
+
+#include "basic_program.h"
+
+#include <stddef.h>
+
+/* Parallel front end, for lexing and parsing large programs on multiple cores */
+
+// Sources smaller than this are lexed and parsed on the calling thread only
+#define BASIC_PARALLEL_MIN_SOURCE (256 * 1024)
+
+// Number of chunks per thread, so that threads finishing early can take more work
+#define BASIC_PARALLEL_CHUNKS_PER_THREAD 4
+
+/**
+ * Finds offsets in `source` where a top-level statement begins: right after a newline that is
+ * outside any string, IF/WHILE block or parenthesis. Up to `max_splits` offsets are chosen,
+ * roughly `source_length / (max_splits + 1)` bytes apart. Returns the number of offsets found.
+ */
+int basic_parallel_find_splits(const char *source, size_t source_length, size_t *splits, int max_splits);
+
+/**
+ * Lex and parse the program. Sources of at least BASIC_PARALLEL_MIN_SOURCE bytes are split at
+ * top-level statement boundaries: the chunks are lexed, then parsed, by up to `thread_count`
+ * threads (0 to use one per core), and the results are joined in order. The token list and AST
+ * are the same as with basic_tokenize followed by basic_parse_to_ast.
+ * Returns 0 on success, 1 if lexing failed, or the parser error code.
+ */
+int basic_parallel_compile(BASICProgram *program, int thread_count);
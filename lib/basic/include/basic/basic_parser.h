@@ -19,8 +19,19 @@ extern char PARSE_WS_CHAR[];
 #define KEYWORD_IDX_ELSE 3
 #define KEYWORD_IDX_END 4
 #define KEYWORD_IDX_GOTO 5
+#define KEYWORD_IDX_DIM 6
+#define KEYWORD_IDX_FUNCTION 7
+#define KEYWORD_IDX_RETURN 8
+#define KEYWORD_IDX_FOR 9
+#define KEYWORD_IDX_TO 10
+#define KEYWORD_IDX_STEP 11
+#define KEYWORD_IDX_NEXT 12
 
 // Parser
+int basic_token_keyword_index(BASICToken *token);
+int basic_keyword_opens_block(int keyword_index);
+int basic_keyword_closes_block(int keyword_index);
+void basic_parse_error(BASICTokenParseList *parse_list, int token_idx, const char *format, ...);
 int basic_parse_form_expression(BASICTokenParseList *parse_list, ASTNode *root, int parse_from, int parse_to, int *parse_new_pos);
 int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, int parse_from, int parse_to, int *parse_new_pos);
 
@@ -28,3 +39,22 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 int basic_parse_to_ast_between_onlyexpr(BASICTokenParseList *parse_list, ASTNode *root, int from, int to);
 int basic_parse_to_ast_between(BASICTokenParseList *parse_list, ASTNode *root, int from, int to);
 int basic_parse_to_ast(BASICProgram *program);
+
+// Lazily parsed block bodies
+int basic_parse_skip_body(BASICTokenParseList *parse_list, int from, int to, int *next_ptr);
+int basic_parse_block_body(BASICTokenParseList *parse_list, ASTNode *body, int from, int to, int level, int *next_ptr);
+int basic_parse_deferred(BASICTokenParseList *parse_list, ASTNode *body);
+int basic_parse_deferred_all(BASICTokenParseList *parse_list, ASTNode *node);
+// Parses every block body that was deferred, so that syntax errors in code that never runs are still found
+int basic_parse_validate(BASICProgram *program);
+
+// Types known from the program text
+ASTDType basic_parse_static_type(ASTNode *node);
+void basic_parse_type_operation(ASTNode *operation);
+
+// Line numbers and GOTO
+int basic_parse_is_line_number(BASICTokenParseList *parse_list, int idx);
+int basic_parse_is_line_label(BASICTokenParseList *parse_list, int idx, int to);
+
+// User-defined functions
+int basic_parse_assign_slots(BASICTokenParseList *parse_list, ASTNode *function_node, int token_idx);
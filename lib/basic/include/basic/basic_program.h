@@ -3,6 +3,8 @@
 #include "ast.h"
 #include "basic_token.h"
 
+#include <stddef.h>
+
 /* Basic Program */
 
 typedef struct
@@ -10,10 +12,32 @@ typedef struct
 	char *program_source;
 	BASICTokenParseList program_tokens;
 	ASTNode *program_sequence;
-	// Map between line number and which instruction to execute on that line. For non-linear control flow
-	// BASICLineNode program_line_instruction;
+	// Line numbers that GOTO jumps to are AST_LABEL nodes. The runtime matches them with their GOTOs when it starts
 } BASICProgram;
 
+// Node of a flattened (position-independent) program. Links are indices into the node array, -1 for none
+typedef struct
+{
+	ASTNodeType type;
+	ASTNodeData data;
+	int next;
+	int child;
+	int slot;
+} BASICFlatNode;
+
+// Header of a flattened program, followed by `node_count` BASICFlatNode entries
+typedef struct
+{
+	unsigned int magic;
+	int node_count;
+} BASICFlatProgram;
+
+#define BASIC_FLAT_PROGRAM_MAGIC 0x42415332
+
 BASICProgram *basic_create_program();
 void basic_clear_program(BASICProgram *program);
 void basic_destroy_program(BASICProgram *program);
+
+// Compiled program serialization
+void *basic_program_flatten(BASICProgram *program, size_t *flat_size);
+int basic_program_load_flat(BASICProgram *program, const void *flat, size_t flat_size);
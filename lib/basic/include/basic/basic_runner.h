@@ -2,8 +2,11 @@
 
 #include "ast.h"
 #include "basic_program.h"
+#include "basic_array.h"
+#include "basic_dict.h"
 
 #include <data_structures/stack.h>
+#include <basic_system_interface/system.h>
 
 /* BASIC interpreter */
 
@@ -21,6 +24,39 @@ typedef struct
 	StringLiteral name;
 } BASICVariable;
 
+// Statements run between checks of the flush interval of buffered program output
+#define BASIC_OUTPUT_POLL_STATEMENTS 1024
+
+// How deeply calls to user-defined functions can nest before the program is stopped, unless the runtime sets its own limit
+#define BASIC_MAX_CALL_DEPTH 1000
+
+// Call frame of a user-defined function
+typedef struct
+{
+	// The FUNCTION being run
+	ASTNode *definition;
+	// Where its local variables start in the runtime's slots
+	int base;
+} BASICFrame;
+
+// Statement with a line number that GOTO can jump to, found when the program starts
+typedef struct
+{
+	int line;
+	// The line number node in front of the statement
+	ASTNode *statement;
+	// Sequence whose statement loop runs the line: the program, a FUNCTION body or a FOR loop body
+	ASTNode *context;
+	// How many IF/ELSE/WHILE bodies the line is inside of within its context. Each of them has one entry on the
+	// block stack while the line runs
+	int depth;
+	// Only GOTOs that are in the same FUNCTION (NULL if none), and inside the block that has the line, can jump
+	// to it. Blocks are numbered in the order they are walked, and the line's block has the numbers first to last
+	ASTNode *function;
+	int first;
+	int last;
+} BASICLabel;
+
 typedef struct
 {
 	BASICProgram *program;
@@ -28,6 +64,50 @@ typedef struct
 	BASICVariable *variables;
 	int var_count;
 	StackNode *traverse_stack;
+	// Entries on the block stack, so that a GOTO knows how many to pop
+	int traverse_depth;
+	// Sequence passed to the running statement loop, which tells if a GOTO target is run by it
+	ASTNode *context;
+	// Where the program prints to: stdout, flushed after every line, unless the sink or policy is changed
+	SystemOutput *output;
+	// Statements run since the output was last checked for its flush interval
+	int output_poll_count;
+	// Generator for RANDOM and IRANDOM, seeded from the system unless SEED is called
+	SystemRandom random;
+	// String keys of every dictionary, interned once per runtime
+	StringInterner strings;
+	// Reference to the dictionary made by the latest DICT() call, so it is freed even if it is never assigned
+	BASICDict *last_dict;
+
+	// User-defined functions of the running program. Calls refer to them by index
+	ASTNode **functions;
+	int function_count;
+	int function_capacity;
+	// Local variables of every running function call, one frame after another. They grow as needed and are
+	// reused by later calls, so calls don't allocate
+	ASTNodeData *slots;
+	int slot_count;
+	int slot_capacity;
+	BASICFrame *frames;
+	int call_depth;
+	int frame_capacity;
+	// Calls nested deeper than this stop the program. Defaults to BASIC_MAX_CALL_DEPTH
+	int max_call_depth;
+	// Set by RETURN until the call it returns from ends, along with the value it returns
+	int returning;
+	ASTNodeData return_value;
+	// References to arrays and dictionaries returned by functions, kept until the statement that called them is done
+	ASTNodeData *temporaries;
+	int temporary_count;
+	int temporary_capacity;
+
+	// Jump table of the running program, sorted by line number. GOTOs refer to their line by index
+	BASICLabel *labels;
+	int label_count;
+	int label_capacity;
+	// Set by a GOTO out of a FOR loop body to the line it jumps to, -1 otherwise. The loops stop until the statement
+	// loop that runs the line is reached
+	int jump;
 } BASICRuntime;
 
 typedef ASTNodeData (*basic_function)(BASICRuntime *runtime, ASTNode *args);
@@ -40,16 +120,58 @@ void basic_free_runtime(BASICRuntime *runtime);
 
 ASTNodeData basic_evaluate_node(BASICRuntime *runtime, ASTNode *node);
 ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc);
+ASTNodeData basic_execute_statements(BASICRuntime *runtime, ASTNode *pc);
+void basic_execute_block(BASICRuntime *runtime, ASTNode *body);
 
 /* Private functions */
 
+basic_function basic_decode_function(char fn_name[]);
 BASICVariable *basic_find_variable(BASICRuntime *runtime, char var_name[]);
+ASTNodeData *basic_find_value(BASICRuntime *runtime, ASTNode *node);
 ASTNodeData basic_get_variable(BASICRuntime *runtime, char var_name[]);
 void basic_set_variable(BASICRuntime *runtime, char var_name[], ASTNodeData value);
+void basic_value_retain(ASTNodeData value);
+void basic_value_release(ASTNodeData value);
 void basic_var_assignment(BASICRuntime *runtime, ASTNode *args);
+void basic_operation_error(BASICRuntime *runtime, int error);
 void basic_init_constants(BASICRuntime *runtime);
+void basic_runtime_flush_log(void *output);
 KeywordAction basic_evaluate_keyword_block(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
+int basic_prepare_sequence(BASICRuntime *runtime, ASTNode *sequence);
+
+// Typed variables and expressions
+int basic_declare_value(BASICRuntime *runtime, const char *name, ASTNodeData *value);
+ASTNodeData *basic_typed_variable(BASICRuntime *runtime, ASTNode *variable, ASTDType type);
+int basic_evaluate_int(BASICRuntime *runtime, ASTNode *node);
+float basic_evaluate_flt(BASICRuntime *runtime, ASTNode *node);
+ASTNodeData basic_evaluate_typed(BASICRuntime *runtime, ASTNode *node, ASTDType type);
+
+// Array elements
+BASICArray *basic_locate_array_element(BASICRuntime *runtime, ASTNode *indexing, size_t *index);
+ASTNodeData basic_get_array_element(BASICRuntime *runtime, ASTNode *indexing);
+void basic_set_array_element(BASICRuntime *runtime, ASTNode *indexing, ASTNodeData value);
+
+// Dictionary elements
+ASTNodeData basic_get_dict_element(BASICRuntime *runtime, ASTNode *indexing);
+void basic_set_dict_element(BASICRuntime *runtime, ASTNode *indexing, ASTNodeData value);
+int basic_dict_error(BASICRuntime *runtime, BASICDictResult result, const char *name);
+
+// User-defined functions
+int basic_register_functions(BASICRuntime *runtime, ASTNode *sequence);
+int basic_find_function(BASICRuntime *runtime, const char *name);
+ASTNodeData basic_call_function(BASICRuntime *runtime, ASTNode *call);
+ASTNodeData basic_get_local(BASICRuntime *runtime, ASTNode *variable);
+void basic_set_local(BASICRuntime *runtime, ASTNode *variable, ASTNodeData value);
+void basic_release_temporaries(BASICRuntime *runtime, int keep);
+
+// GOTO
+int basic_register_labels(BASICRuntime *runtime, ASTNode *sequence);
+void basic_jump_unwind(BASICRuntime *runtime, int depth);
 
 // Keyword handlers
 KeywordAction basic_eval_kw_if(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
 KeywordAction basic_eval_kw_while(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
+KeywordAction basic_eval_kw_for(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
+KeywordAction basic_eval_kw_dim(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
+KeywordAction basic_eval_kw_return(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
+KeywordAction basic_eval_kw_goto(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc);
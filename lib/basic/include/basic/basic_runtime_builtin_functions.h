@@ -11,3 +11,17 @@ ASTNodeData basic_fn_toint(BASICRuntime *runtime, ASTNode *arg);
 ASTNodeData basic_fn_toflt(BASICRuntime *runtime, ASTNode *arg);
 ASTNodeData basic_fn_rand(BASICRuntime *runtime, ASTNode *arg);
 ASTNodeData basic_fn_irand(BASICRuntime *runtime, ASTNode *arg);
+ASTNodeData basic_fn_seed(BASICRuntime *runtime, ASTNode *arg);
+
+// Bulk operations on arrays of numbers
+ASTNodeData basic_fn_sum(BASICRuntime *runtime, ASTNode *arg);
+ASTNodeData basic_fn_dot(BASICRuntime *runtime, ASTNode *args);
+ASTNodeData basic_fn_scale(BASICRuntime *runtime, ASTNode *args);
+ASTNodeData basic_fn_add(BASICRuntime *runtime, ASTNode *args);
+ASTNodeData basic_fn_fill(BASICRuntime *runtime, ASTNode *args);
+ASTNodeData basic_fn_sort(BASICRuntime *runtime, ASTNode *args);
+
+// Dictionaries
+ASTNodeData basic_fn_dict(BASICRuntime *runtime, ASTNode *arg);
+ASTNodeData basic_fn_has(BASICRuntime *runtime, ASTNode *args);
+ASTNodeData basic_fn_remove(BASICRuntime *runtime, ASTNode *args);
@@ -22,13 +22,31 @@ typedef struct
 	char *token_at;
 } BASICToken;
 
+// What the statements being parsed belong to, which decides where FUNCTION and RETURN are allowed
+typedef enum
+{
+	PARSE_SCOPE_PROGRAM,
+	// Body of an IF/ELSE/WHILE parsed on its own after the rest of the program
+	PARSE_SCOPE_BLOCK,
+	PARSE_SCOPE_FUNCTION
+} BASICParseScope;
+
 // Structure with all the stuff needed to convert a BASIC program to an AST
 typedef struct
 {
 	// List of tokens
 	BASICToken *tokens;
 	int tokens_length;
+	int tokens_capacity;
 	// Stack for knowning current scope
+
+	// Only find where IF/WHILE bodies end instead of parsing them. They are parsed when they first run
+	int lazy_bodies;
+	BASICParseScope scope;
+
+	// Where the first lexer/parser error was found (NULL if none), and what it was
+	char *error_at;
+	char error_message[128];
 } BASICTokenParseList;
 
 const char *_cvt_whitespace_to_escape_code(char character);
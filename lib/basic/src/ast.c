@@ -1,6 +1,7 @@
 
 #include "basic/ast.h"
 #include <utility/utils.h>
+#include <utility/format/format.h>
 
 // Standard libraries
 #include <stdio.h>
@@ -12,6 +13,14 @@ ASTNodeData ASTVOID = {
 	.token_type = DTYPE_NONE
 };
 
+// How floats are converted to strings, set for each thread
+THREAD_LOCAL ASTFloatFormat ast_float_format = AST_FLOAT_SHORTEST;
+
+void ast_set_float_format(ASTFloatFormat format)
+{
+	ast_float_format = format;
+}
+
 ASTNode *ast_create_node()
 {
 	ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
@@ -23,6 +32,7 @@ ASTNode *ast_create_node()
 	node->type = AST_NONE;
 	node->next = NULL;
 	node->child = NULL;
+	node->slot = -1;
 	return node;
 }
 
@@ -43,6 +53,14 @@ void ast_append_child(ASTNode *parent, ASTNode *node)
 	}
 }
 
+// Skips expression nodes that only wrap a single node, such as the ones around a function call
+ASTNode *ast_unwrap_expression(ASTNode *node)
+{
+	while (node->type == AST_EXPRESSION && node->child != NULL && node->child->next == NULL)
+		node = node->child;
+	return node;
+}
+
 void ast_delete_node(ASTNode *node)
 {
 	if (node == NULL)
@@ -87,12 +105,21 @@ void ast_display_level(ASTNode *node, int level)
 		case AST_PROGRAM_SEQUENCE:
 			printf("Program sequence");
 			break;
+		case AST_DEFERRED_SEQUENCE:
+			printf("Deferred program sequence (tokens %d to %d)", ptr->data.token.token_range.from, ptr->data.token.token_range.to);
+			break;
 		case AST_FUNC_CALL:
 			printf("Function %s", ptr->data.token.kw);
 			break;
+		case AST_USER_CALL:
+			printf("User function %s", ptr->data.token.kw);
+			break;
 		case AST_KEYWORD:
 			printf("Keyword %s", ptr->data.token.kw);
 			break;
+		case AST_LABEL:
+			printf("Line %d", ptr->data.token.literal.num);
+			break;
 		case AST_CONDITION:
 			printf("Condition");
 			break;
@@ -100,6 +127,12 @@ void ast_display_level(ASTNode *node, int level)
 			printf("Variable\n");
 			print_level_space(level + 1);
 			printf("Name: %s", ptr->data.token.variable_name);
+			if (ptr->slot >= 0)
+			{
+				printf("\n");
+				print_level_space(level + 1);
+				printf("Local slot: %d", ptr->slot);
+			}
 			break;
 		case AST_EXPRESSION:
 			printf("Expression");
@@ -197,17 +230,42 @@ void ast_data_as_string(ASTNodeData ast_data, char *buffer)
 		strcpy(buffer, ast_data.token.literal.str);
 		break;
 	case DTYPE_NUM:
-		sprintf(buffer, "%d", ast_data.token.literal.num);
+		format_int(ast_data.token.literal.num, buffer);
 		break;
 	case DTYPE_FLT:
-		sprintf(buffer, "%f", ast_data.token.literal.flt);
+		if (ast_float_format == AST_FLOAT_FIXED)
+			format_float_fixed(ast_data.token.literal.flt, buffer);
+		else
+			format_float_shortest(ast_data.token.literal.flt, buffer);
 		break;
 	case DTYPE_NONE:
 		strcpy(buffer, "void");
 		break;
+	case DTYPE_ARRAY:
+		strcpy(buffer, "array");
+		break;
+	case DTYPE_DICT:
+		strcpy(buffer, "dict");
+		break;
+	default:
+		buffer[0] = '\0';
 	}
 }
 
+// Joins the string forms of 'a' and 'b' into 'result', cut short to fit a string literal
+void ast_concat_as_string(ASTNodeData a, ASTNodeData b, char *result)
+{
+	char a_str[MAX(sizeof(StringLiteral), FORMAT_BUFFER_SIZE)], b_str[MAX(sizeof(StringLiteral), FORMAT_BUFFER_SIZE)];
+	ast_data_as_string(a, a_str);
+	ast_data_as_string(b, b_str);
+
+	size_t a_length = MIN(strlen(a_str), sizeof(StringLiteral) - 1);
+	size_t b_length = MIN(strlen(b_str), sizeof(StringLiteral) - 1 - a_length);
+	memcpy(result, a_str, a_length);
+	memcpy(result + a_length, b_str, b_length);
+	result[a_length + b_length] = '\0';
+}
+
 int ast_data_to_int(ASTNodeData ast_data)
 {
 	switch (ast_data.token_type)
@@ -352,7 +410,7 @@ int ast_evaluate_binary(ASTOperator op, ASTNodeData a, ASTNodeData b, ASTNodeDat
 			else if (b.token_type == DTYPE_STR)
 			{
 				// INT + STR -> concatenated STR (string representation of int)
-				sprintf(result->token.literal.str, "%d%s", a.token.literal.num, b.token.literal.str);
+				ast_concat_as_string(a, b, result->token.literal.str);
 				result->token_type = DTYPE_STR;
 			}
 			else
@@ -375,7 +433,7 @@ int ast_evaluate_binary(ASTOperator op, ASTNodeData a, ASTNodeData b, ASTNodeDat
 			else if (b.token_type == DTYPE_STR)
 			{
 				// STR + FLOAT -> concatenated STR (string representation of float)
-				sprintf(result->token.literal.str, "%f%s", a.token.literal.flt, b.token.literal.str);
+				ast_concat_as_string(a, b, result->token.literal.str);
 				result->token_type = DTYPE_STR;
 			}
 			else
@@ -385,20 +443,19 @@ int ast_evaluate_binary(ASTOperator op, ASTNodeData a, ASTNodeData b, ASTNodeDat
 			if (b.token_type == DTYPE_STR)
 			{
 				// STR + STR -> concatenated STR
-				strcpy(result->token.literal.str, a.token.literal.str);
-				strcat(result->token.literal.str, b.token.literal.str);
+				ast_concat_as_string(a, b, result->token.literal.str);
 				result->token_type = DTYPE_STR;
 			}
 			else if (b.token_type == DTYPE_NUM)
 			{
 				// STR + INT -> concatenated STR (string representation of int)
-				sprintf(result->token.literal.str, "%s%d", a.token.literal.str, b.token.literal.num);
+				ast_concat_as_string(a, b, result->token.literal.str);
 				result->token_type = DTYPE_STR;
 			}
 			else if (b.token_type == DTYPE_FLT)
 			{
 				// STR + FLOAT -> concatenated STR (string representation of float)
-				sprintf(result->token.literal.str, "%s%f", a.token.literal.str, b.token.literal.flt);
+				ast_concat_as_string(a, b, result->token.literal.str);
 				result->token_type = DTYPE_STR;
 			}
 			else
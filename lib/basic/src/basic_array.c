@@ -0,0 +1,130 @@
+#include "basic/basic_array.h"
+
+// Standard libraries
+#include <stdlib.h>
+#include <string.h>
+
+BASICArray *basic_array_create(const int *bounds, int dim_count)
+{
+	size_t length = 1;
+	if (dim_count < 1 || dim_count > BASIC_ARRAY_MAX_DIMS)
+		return NULL;
+	for (int i = 0; i < dim_count; i++)
+	{
+		if (bounds[i] < 0 || bounds[i] >= BASIC_ARRAY_MAX_LENGTH)
+			return NULL;
+		length *= (size_t)bounds[i] + 1;
+		if (length > BASIC_ARRAY_MAX_LENGTH)
+			return NULL;
+	}
+
+	BASICArray *array = (BASICArray *)malloc(sizeof(BASICArray));
+	if (array == NULL)
+		return NULL;
+	array->data.ints = (int *)calloc(length, sizeof(int));
+	if (array->data.ints == NULL)
+	{
+		free(array);
+		return NULL;
+	}
+
+	array->storage = ARRAY_STORAGE_INT;
+	array->dim_count = dim_count;
+	for (int i = 0; i < dim_count; i++)
+		array->dims[i] = bounds[i] + 1;
+	array->length = length;
+	array->references = 0;
+	return array;
+}
+
+void basic_array_retain(BASICArray *array)
+{
+	array->references++;
+}
+
+void basic_array_release(BASICArray *array)
+{
+	if (--array->references > 0)
+		return;
+	// All storage types share the same pointer
+	free(array->data.ints);
+	free(array);
+}
+
+ASTNodeData basic_array_get(BASICArray *array, size_t index)
+{
+	ASTNodeData value;
+	switch (array->storage)
+	{
+	case ARRAY_STORAGE_INT:
+		value.token_type = DTYPE_NUM;
+		value.token.literal.num = array->data.ints[index];
+		break;
+	case ARRAY_STORAGE_FLT:
+		value.token_type = DTYPE_FLT;
+		value.token.literal.flt = array->data.flts[index];
+		break;
+	default:
+		value = array->data.boxed[index];
+	}
+	return value;
+}
+
+// Move integer elements to floats
+int basic_array_to_float(BASICArray *array)
+{
+	float *flts = (float *)malloc(sizeof(float) * array->length);
+	if (flts == NULL)
+		return 1;
+	for (size_t i = 0; i < array->length; i++)
+		flts[i] = (float)array->data.ints[i];
+	free(array->data.ints);
+	array->data.flts = flts;
+	array->storage = ARRAY_STORAGE_FLT;
+	return 0;
+}
+
+// Move number elements to boxed values
+int basic_array_to_boxed(BASICArray *array)
+{
+	ASTNodeData *boxed = (ASTNodeData *)malloc(sizeof(ASTNodeData) * array->length);
+	if (boxed == NULL)
+		return 1;
+	for (size_t i = 0; i < array->length; i++)
+		boxed[i] = basic_array_get(array, i);
+	free(array->data.ints);
+	array->data.boxed = boxed;
+	array->storage = ARRAY_STORAGE_BOXED;
+	return 0;
+}
+
+int basic_array_set(BASICArray *array, size_t index, ASTNodeData value)
+{
+	switch (value.token_type)
+	{
+	case DTYPE_NUM:
+		if (array->storage == ARRAY_STORAGE_INT)
+			array->data.ints[index] = value.token.literal.num;
+		else if (array->storage == ARRAY_STORAGE_FLT)
+			array->data.flts[index] = (float)value.token.literal.num;
+		else
+			array->data.boxed[index] = value;
+		return 0;
+	case DTYPE_FLT:
+		if (array->storage == ARRAY_STORAGE_INT && basic_array_to_float(array) != 0)
+			return 1;
+		if (array->storage == ARRAY_STORAGE_FLT)
+			array->data.flts[index] = value.token.literal.flt;
+		else
+			array->data.boxed[index] = value;
+		return 0;
+	case DTYPE_STR:
+		if (array->storage != ARRAY_STORAGE_BOXED && basic_array_to_boxed(array) != 0)
+			return 1;
+		array->data.boxed[index] = value;
+		return 0;
+	default:
+		// Arrays can't hold other arrays, or nothing
+		return 2;
+	}
+}
@@ -0,0 +1,719 @@
+#include "basic/basic_array_kernels.h"
+
+// Standard libraries
+#include <stdint.h>
+#include <string.h>
+
+// The vector kernels need GCC or Clang on x86, the rest get the scalar kernels
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ARRAY_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(ARRAY_KERNELS_X86) && defined(__SSE2__)
+#define ARRAY_KERNELS_HAVE_SSE2
+#endif
+
+#ifdef ARRAY_KERNELS_X86
+#define ARRAY_KERNELS_HAVE_AVX2
+#define AVX2_KERNEL __attribute__((target("avx2")))
+#endif
+
+/* SCALAR */
+
+// Integer arithmetic is done unsigned, so that overflow wraps instead of being undefined
+
+int array_sum_int_scalar(const int *a, size_t length)
+{
+	unsigned int sum = 0;
+	for (size_t i = 0; i < length; i++)
+		sum += (unsigned int)a[i];
+	return (int)sum;
+}
+
+float array_sum_flt_scalar(const float *a, size_t length)
+{
+	float sum = 0;
+	for (size_t i = 0; i < length; i++)
+		sum += a[i];
+	return sum;
+}
+
+int array_dot_int_scalar(const int *a, const int *b, size_t length)
+{
+	unsigned int sum = 0;
+	for (size_t i = 0; i < length; i++)
+		sum += (unsigned int)a[i] * (unsigned int)b[i];
+	return (int)sum;
+}
+
+float array_dot_flt_scalar(const float *a, const float *b, size_t length)
+{
+	float sum = 0;
+	for (size_t i = 0; i < length; i++)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+float array_dot_int_flt_scalar(const int *a, const float *b, size_t length)
+{
+	float sum = 0;
+	for (size_t i = 0; i < length; i++)
+		sum += (float)a[i] * b[i];
+	return sum;
+}
+
+void array_scale_int_scalar(int *a, int k, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] = (int)((unsigned int)a[i] * (unsigned int)k);
+}
+
+void array_scale_flt_scalar(float *a, float k, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] *= k;
+}
+
+void array_offset_int_scalar(int *a, int k, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] = (int)((unsigned int)a[i] + (unsigned int)k);
+}
+
+void array_offset_flt_scalar(float *a, float k, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] += k;
+}
+
+void array_add_int_scalar(int *a, const int *b, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] = (int)((unsigned int)a[i] + (unsigned int)b[i]);
+}
+
+void array_add_flt_scalar(float *a, const float *b, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] += b[i];
+}
+
+void array_add_flt_int_scalar(float *a, const int *b, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		a[i] += (float)b[i];
+}
+
+void array_fill_scalar(void *a, const void *value, size_t length)
+{
+	uint32_t bits, *elements = (uint32_t *)a;
+	memcpy(&bits, value, sizeof(bits));
+	for (size_t i = 0; i < length; i++)
+		elements[i] = bits;
+}
+
+int array_max_int_scalar(const int *a, size_t length)
+{
+	int max = a[0];
+	for (size_t i = 1; i < length; i++)
+		if (a[i] > max)
+			max = a[i];
+	return max;
+}
+
+float array_max_flt_scalar(const float *a, size_t length)
+{
+	float max = a[0];
+	for (size_t i = 1; i < length; i++)
+		if (a[i] > max)
+			max = a[i];
+	return max;
+}
+
+int array_min_int_scalar(const int *a, size_t length)
+{
+	int min = a[0];
+	for (size_t i = 1; i < length; i++)
+		if (a[i] < min)
+			min = a[i];
+	return min;
+}
+
+float array_min_flt_scalar(const float *a, size_t length)
+{
+	float min = a[0];
+	for (size_t i = 1; i < length; i++)
+		if (a[i] < min)
+			min = a[i];
+	return min;
+}
+
+const BASICArrayKernels ARRAY_KERNELS_SCALAR_TABLE = {
+	ARRAY_KERNELS_SCALAR,
+	array_sum_int_scalar,
+	array_sum_flt_scalar,
+	array_dot_int_scalar,
+	array_dot_flt_scalar,
+	array_dot_int_flt_scalar,
+	array_scale_int_scalar,
+	array_scale_flt_scalar,
+	array_offset_int_scalar,
+	array_offset_flt_scalar,
+	array_add_int_scalar,
+	array_add_flt_scalar,
+	array_add_flt_int_scalar,
+	array_fill_scalar,
+	array_max_int_scalar,
+	array_max_flt_scalar,
+	array_min_int_scalar,
+	array_min_flt_scalar,
+};
+
+/* SSE2 */
+
+// Each kernel handles 4 elements at a time, and leaves the remainder to the scalar kernel
+
+#ifdef ARRAY_KERNELS_HAVE_SSE2
+
+int array_hsum_epi32_sse2(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+float array_hsum_ps_sse2(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(v);
+}
+
+// SSE2 has no 32-bit integer multiply, so multiply the even and odd lanes separately
+__m128i array_mullo_epi32_sse2(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+int array_sum_int_sse2(const int *a, size_t length)
+{
+	__m128i sum = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		sum = _mm_add_epi32(sum, _mm_loadu_si128((const __m128i *)(a + i)));
+	return (int)((unsigned int)array_hsum_epi32_sse2(sum) + (unsigned int)array_sum_int_scalar(a + i, length - i));
+}
+
+float array_sum_flt_sse2(const float *a, size_t length)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_loadu_ps(a + i));
+		sum1 = _mm_add_ps(sum1, _mm_loadu_ps(a + i + 4));
+	}
+	return array_hsum_ps_sse2(_mm_add_ps(sum0, sum1)) + array_sum_flt_scalar(a + i, length - i);
+}
+
+int array_dot_int_sse2(const int *a, const int *b, size_t length)
+{
+	__m128i sum = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		sum = _mm_add_epi32(sum, array_mullo_epi32_sse2(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+	return (int)((unsigned int)array_hsum_epi32_sse2(sum) + (unsigned int)array_dot_int_scalar(a + i, b + i, length - i));
+}
+
+float array_dot_flt_sse2(const float *a, const float *b, size_t length)
+{
+	__m128 sum = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	return array_hsum_ps_sse2(sum) + array_dot_flt_scalar(a + i, b + i, length - i);
+}
+
+float array_dot_int_flt_sse2(const int *a, const float *b, size_t length)
+{
+	__m128 sum = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(a + i))), _mm_loadu_ps(b + i)));
+	return array_hsum_ps_sse2(sum) + array_dot_int_flt_scalar(a + i, b + i, length - i);
+}
+
+void array_scale_int_sse2(int *a, int k, size_t length)
+{
+	__m128i factor = _mm_set1_epi32(k);
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_si128((__m128i *)(a + i), array_mullo_epi32_sse2(_mm_loadu_si128((const __m128i *)(a + i)), factor));
+	array_scale_int_scalar(a + i, k, length - i);
+}
+
+void array_scale_flt_sse2(float *a, float k, size_t length)
+{
+	__m128 factor = _mm_set1_ps(k);
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_ps(a + i, _mm_mul_ps(_mm_loadu_ps(a + i), factor));
+	array_scale_flt_scalar(a + i, k, length - i);
+}
+
+void array_offset_int_sse2(int *a, int k, size_t length)
+{
+	__m128i offset = _mm_set1_epi32(k);
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_si128((__m128i *)(a + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(a + i)), offset));
+	array_offset_int_scalar(a + i, k, length - i);
+}
+
+void array_offset_flt_sse2(float *a, float k, size_t length)
+{
+	__m128 offset = _mm_set1_ps(k);
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), offset));
+	array_offset_flt_scalar(a + i, k, length - i);
+}
+
+void array_add_int_sse2(int *a, const int *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_si128((__m128i *)(a + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+	array_add_int_scalar(a + i, b + i, length - i);
+}
+
+void array_add_flt_sse2(float *a, const float *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	array_add_flt_scalar(a + i, b + i, length - i);
+}
+
+void array_add_flt_int_sse2(float *a, const int *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(b + i)))));
+	array_add_flt_int_scalar(a + i, b + i, length - i);
+}
+
+void array_fill_sse2(void *a, const void *value, size_t length)
+{
+	int bits, *elements = (int *)a;
+	memcpy(&bits, value, sizeof(bits));
+	__m128i pattern = _mm_set1_epi32(bits);
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_si128((__m128i *)(elements + i), pattern);
+	array_fill_scalar(elements + i, value, length - i);
+}
+
+// SSE2 has no 32-bit integer min/max, so select with a comparison mask
+__m128i array_select_epi32_sse2(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+int array_max_int_sse2(const int *a, size_t length)
+{
+	if (length < 4)
+		return array_max_int_scalar(a, length);
+	__m128i max = _mm_loadu_si128((const __m128i *)a);
+	size_t i = 4;
+	for (; i + 4 <= length; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+		max = array_select_epi32_sse2(_mm_cmpgt_epi32(v, max), v, max);
+	}
+	int lanes[4];
+	_mm_storeu_si128((__m128i *)lanes, max);
+	int result = array_max_int_scalar(lanes, 4);
+	if (i < length)
+	{
+		int rest = array_max_int_scalar(a + i, length - i);
+		result = rest > result ? rest : result;
+	}
+	return result;
+}
+
+int array_min_int_sse2(const int *a, size_t length)
+{
+	if (length < 4)
+		return array_min_int_scalar(a, length);
+	__m128i min = _mm_loadu_si128((const __m128i *)a);
+	size_t i = 4;
+	for (; i + 4 <= length; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+		min = array_select_epi32_sse2(_mm_cmplt_epi32(v, min), v, min);
+	}
+	int lanes[4];
+	_mm_storeu_si128((__m128i *)lanes, min);
+	int result = array_min_int_scalar(lanes, 4);
+	if (i < length)
+	{
+		int rest = array_min_int_scalar(a + i, length - i);
+		result = rest < result ? rest : result;
+	}
+	return result;
+}
+
+float array_max_flt_sse2(const float *a, size_t length)
+{
+	if (length < 4)
+		return array_max_flt_scalar(a, length);
+	__m128 max = _mm_loadu_ps(a);
+	size_t i = 4;
+	for (; i + 4 <= length; i += 4)
+		max = _mm_max_ps(max, _mm_loadu_ps(a + i));
+	float lanes[4];
+	_mm_storeu_ps(lanes, max);
+	float result = array_max_flt_scalar(lanes, 4);
+	if (i < length)
+	{
+		float rest = array_max_flt_scalar(a + i, length - i);
+		result = rest > result ? rest : result;
+	}
+	return result;
+}
+
+float array_min_flt_sse2(const float *a, size_t length)
+{
+	if (length < 4)
+		return array_min_flt_scalar(a, length);
+	__m128 min = _mm_loadu_ps(a);
+	size_t i = 4;
+	for (; i + 4 <= length; i += 4)
+		min = _mm_min_ps(min, _mm_loadu_ps(a + i));
+	float lanes[4];
+	_mm_storeu_ps(lanes, min);
+	float result = array_min_flt_scalar(lanes, 4);
+	if (i < length)
+	{
+		float rest = array_min_flt_scalar(a + i, length - i);
+		result = rest < result ? rest : result;
+	}
+	return result;
+}
+
+const BASICArrayKernels ARRAY_KERNELS_SSE2_TABLE = {
+	ARRAY_KERNELS_SSE2,
+	array_sum_int_sse2,
+	array_sum_flt_sse2,
+	array_dot_int_sse2,
+	array_dot_flt_sse2,
+	array_dot_int_flt_sse2,
+	array_scale_int_sse2,
+	array_scale_flt_sse2,
+	array_offset_int_sse2,
+	array_offset_flt_sse2,
+	array_add_int_sse2,
+	array_add_flt_sse2,
+	array_add_flt_int_sse2,
+	array_fill_sse2,
+	array_max_int_sse2,
+	array_max_flt_sse2,
+	array_min_int_sse2,
+	array_min_flt_sse2,
+};
+
+#endif
+
+/* AVX2 */
+
+// Each kernel handles 8 elements at a time. They are compiled for AVX2 on their own, so the rest
+// of the library still runs on CPUs without it
+
+#ifdef ARRAY_KERNELS_HAVE_AVX2
+
+AVX2_KERNEL int array_hsum_epi32_avx2(__m256i v)
+{
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(half);
+}
+
+AVX2_KERNEL float array_hsum_ps_avx2(__m256 v)
+{
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(half);
+}
+
+AVX2_KERNEL int array_sum_int_avx2(const int *a, size_t length)
+{
+	__m256i sum = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		sum = _mm256_add_epi32(sum, _mm256_loadu_si256((const __m256i *)(a + i)));
+	return (int)((unsigned int)array_hsum_epi32_avx2(sum) + (unsigned int)array_sum_int_scalar(a + i, length - i));
+}
+
+AVX2_KERNEL float array_sum_flt_avx2(const float *a, size_t length)
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16)
+	{
+		sum0 = _mm256_add_ps(sum0, _mm256_loadu_ps(a + i));
+		sum1 = _mm256_add_ps(sum1, _mm256_loadu_ps(a + i + 8));
+	}
+	return array_hsum_ps_avx2(_mm256_add_ps(sum0, sum1)) + array_sum_flt_scalar(a + i, length - i);
+}
+
+AVX2_KERNEL int array_dot_int_avx2(const int *a, const int *b, size_t length)
+{
+	__m256i sum = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+	return (int)((unsigned int)array_hsum_epi32_avx2(sum) + (unsigned int)array_dot_int_scalar(a + i, b + i, length - i));
+}
+
+AVX2_KERNEL float array_dot_flt_avx2(const float *a, const float *b, size_t length)
+{
+	__m256 sum = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	return array_hsum_ps_avx2(sum) + array_dot_flt_scalar(a + i, b + i, length - i);
+}
+
+AVX2_KERNEL float array_dot_int_flt_avx2(const int *a, const float *b, size_t length)
+{
+	__m256 sum = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(a + i))), _mm256_loadu_ps(b + i)));
+	return array_hsum_ps_avx2(sum) + array_dot_int_flt_scalar(a + i, b + i, length - i);
+}
+
+AVX2_KERNEL void array_scale_int_avx2(int *a, int k, size_t length)
+{
+	__m256i factor = _mm256_set1_epi32(k);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_si256((__m256i *)(a + i), _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), factor));
+	array_scale_int_scalar(a + i, k, length - i);
+}
+
+AVX2_KERNEL void array_scale_flt_avx2(float *a, float k, size_t length)
+{
+	__m256 factor = _mm256_set1_ps(k);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), factor));
+	array_scale_flt_scalar(a + i, k, length - i);
+}
+
+AVX2_KERNEL void array_offset_int_avx2(int *a, int k, size_t length)
+{
+	__m256i offset = _mm256_set1_epi32(k);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_si256((__m256i *)(a + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), offset));
+	array_offset_int_scalar(a + i, k, length - i);
+}
+
+AVX2_KERNEL void array_offset_flt_avx2(float *a, float k, size_t length)
+{
+	__m256 offset = _mm256_set1_ps(k);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), offset));
+	array_offset_flt_scalar(a + i, k, length - i);
+}
+
+AVX2_KERNEL void array_add_int_avx2(int *a, const int *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_si256((__m256i *)(a + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+	array_add_int_scalar(a + i, b + i, length - i);
+}
+
+AVX2_KERNEL void array_add_flt_avx2(float *a, const float *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	array_add_flt_scalar(a + i, b + i, length - i);
+}
+
+AVX2_KERNEL void array_add_flt_int_avx2(float *a, const int *b, size_t length)
+{
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(b + i)))));
+	array_add_flt_int_scalar(a + i, b + i, length - i);
+}
+
+AVX2_KERNEL void array_fill_avx2(void *a, const void *value, size_t length)
+{
+	int bits, *elements = (int *)a;
+	memcpy(&bits, value, sizeof(bits));
+	__m256i pattern = _mm256_set1_epi32(bits);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_si256((__m256i *)(elements + i), pattern);
+	array_fill_scalar(elements + i, value, length - i);
+}
+
+AVX2_KERNEL int array_max_int_avx2(const int *a, size_t length)
+{
+	if (length < 8)
+		return array_max_int_scalar(a, length);
+	__m256i max = _mm256_loadu_si256((const __m256i *)a);
+	size_t i = 8;
+	for (; i + 8 <= length; i += 8)
+		max = _mm256_max_epi32(max, _mm256_loadu_si256((const __m256i *)(a + i)));
+	int lanes[8];
+	_mm256_storeu_si256((__m256i *)lanes, max);
+	int result = array_max_int_scalar(lanes, 8);
+	if (i < length)
+	{
+		int rest = array_max_int_scalar(a + i, length - i);
+		result = rest > result ? rest : result;
+	}
+	return result;
+}
+
+AVX2_KERNEL int array_min_int_avx2(const int *a, size_t length)
+{
+	if (length < 8)
+		return array_min_int_scalar(a, length);
+	__m256i min = _mm256_loadu_si256((const __m256i *)a);
+	size_t i = 8;
+	for (; i + 8 <= length; i += 8)
+		min = _mm256_min_epi32(min, _mm256_loadu_si256((const __m256i *)(a + i)));
+	int lanes[8];
+	_mm256_storeu_si256((__m256i *)lanes, min);
+	int result = array_min_int_scalar(lanes, 8);
+	if (i < length)
+	{
+		int rest = array_min_int_scalar(a + i, length - i);
+		result = rest < result ? rest : result;
+	}
+	return result;
+}
+
+AVX2_KERNEL float array_max_flt_avx2(const float *a, size_t length)
+{
+	if (length < 8)
+		return array_max_flt_scalar(a, length);
+	__m256 max = _mm256_loadu_ps(a);
+	size_t i = 8;
+	for (; i + 8 <= length; i += 8)
+		max = _mm256_max_ps(max, _mm256_loadu_ps(a + i));
+	float lanes[8];
+	_mm256_storeu_ps(lanes, max);
+	float result = array_max_flt_scalar(lanes, 8);
+	if (i < length)
+	{
+		float rest = array_max_flt_scalar(a + i, length - i);
+		result = rest > result ? rest : result;
+	}
+	return result;
+}
+
+AVX2_KERNEL float array_min_flt_avx2(const float *a, size_t length)
+{
+	if (length < 8)
+		return array_min_flt_scalar(a, length);
+	__m256 min = _mm256_loadu_ps(a);
+	size_t i = 8;
+	for (; i + 8 <= length; i += 8)
+		min = _mm256_min_ps(min, _mm256_loadu_ps(a + i));
+	float lanes[8];
+	_mm256_storeu_ps(lanes, min);
+	float result = array_min_flt_scalar(lanes, 8);
+	if (i < length)
+	{
+		float rest = array_min_flt_scalar(a + i, length - i);
+		result = rest < result ? rest : result;
+	}
+	return result;
+}
+
+const BASICArrayKernels ARRAY_KERNELS_AVX2_TABLE = {
+	ARRAY_KERNELS_AVX2,
+	array_sum_int_avx2,
+	array_sum_flt_avx2,
+	array_dot_int_avx2,
+	array_dot_flt_avx2,
+	array_dot_int_flt_avx2,
+	array_scale_int_avx2,
+	array_scale_flt_avx2,
+	array_offset_int_avx2,
+	array_offset_flt_avx2,
+	array_add_int_avx2,
+	array_add_flt_avx2,
+	array_add_flt_int_avx2,
+	array_fill_avx2,
+	array_max_int_avx2,
+	array_max_flt_avx2,
+	array_min_int_avx2,
+	array_min_flt_avx2,
+};
+
+#endif
+
+/* DISPATCH */
+
+const BASICArrayKernels *basic_array_kernels_for(BASICArrayKernelLevel level)
+{
+	switch (level)
+	{
+	case ARRAY_KERNELS_SCALAR:
+		return &ARRAY_KERNELS_SCALAR_TABLE;
+#ifdef ARRAY_KERNELS_HAVE_SSE2
+	case ARRAY_KERNELS_SSE2:
+		return &ARRAY_KERNELS_SSE2_TABLE;
+#endif
+#ifdef ARRAY_KERNELS_HAVE_AVX2
+	case ARRAY_KERNELS_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? &ARRAY_KERNELS_AVX2_TABLE : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+const BASICArrayKernels *basic_array_kernels()
+{
+	// Every thread picks the same table, so there is no harm if more than one does it
+	static const BASICArrayKernels *selected = NULL;
+	if (selected == NULL)
+	{
+		const BASICArrayKernels *best = NULL;
+		for (int level = ARRAY_KERNELS_AVX2; best == NULL; level--)
+			best = basic_array_kernels_for((BASICArrayKernelLevel)level);
+		selected = best;
+	}
+	return selected;
+}
+
+const char *basic_array_kernel_name(BASICArrayKernelLevel level)
+{
+	switch (level)
+	{
+	case ARRAY_KERNELS_SSE2:
+		return "SSE2";
+	case ARRAY_KERNELS_AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,313 @@
+#include "basic/basic_array_sort.h"
+
+// Standard libraries
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* RADIX SORT */
+
+// Keys are the element bits changed so that unsigned order is the element order, and
+// inverted for descending order. Equal keys keep their order in every pass
+
+uint32_t basic_sort_int_key(uint32_t bits)
+{
+	return bits ^ 0x80000000u;
+}
+
+// Negative floats have all their bits flipped, positive floats only the sign
+uint32_t basic_sort_flt_key(uint32_t bits)
+{
+	return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+// Sorts 32-bit elements by key. Returns 1 if the result ended in scratch instead of a
+int basic_sort_radix_bits(uint32_t *a, uint32_t *scratch, size_t length, uint32_t (*key_of)(uint32_t), uint32_t invert)
+{
+	size_t counts[4][256];
+	memset(counts, 0, sizeof(counts));
+
+	// Count all four bytes in one read of the array
+	for (size_t i = 0; i < length; i++)
+	{
+		uint32_t key = key_of(a[i]) ^ invert;
+		counts[0][key & 0xFF]++;
+		counts[1][(key >> 8) & 0xFF]++;
+		counts[2][(key >> 16) & 0xFF]++;
+		counts[3][key >> 24]++;
+	}
+
+	uint32_t *from = a, *to = scratch;
+	for (int pass = 0; pass < 4; pass++)
+	{
+		size_t *count = counts[pass];
+		int shift = pass * 8;
+
+		// Every key has the same byte here, so this pass would not move anything
+		if (count[(key_of(from[0]) ^ invert) >> shift & 0xFF] == length)
+			continue;
+
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			size_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < length; i++)
+		{
+			uint32_t value = from[i];
+			to[count[(key_of(value) ^ invert) >> shift & 0xFF]++] = value;
+		}
+
+		uint32_t *swap = from;
+		from = to;
+		to = swap;
+	}
+	return from != a;
+}
+
+void basic_sort_insertion_bits(uint32_t *a, size_t length, uint32_t (*key_of)(uint32_t), uint32_t invert)
+{
+	for (size_t i = 1; i < length; i++)
+	{
+		uint32_t value = a[i], key = key_of(value) ^ invert;
+		size_t j = i;
+		for (; j > 0 && (key_of(a[j - 1]) ^ invert) > key; j--)
+			a[j] = a[j - 1];
+		a[j] = value;
+	}
+}
+
+void basic_sort_radix(uint32_t *a, uint32_t *scratch, size_t length, uint32_t (*key_of)(uint32_t), int descending)
+{
+	uint32_t invert = descending ? 0xFFFFFFFFu : 0;
+	if (length < BASIC_SORT_INSERTION_MAX)
+		basic_sort_insertion_bits(a, length, key_of, invert);
+	else if (basic_sort_radix_bits(a, scratch, length, key_of, invert))
+		memcpy(a, scratch, sizeof(uint32_t) * length);
+}
+
+void basic_sort_radix_int(int *a, int *scratch, size_t length, int descending)
+{
+	basic_sort_radix((uint32_t *)a, (uint32_t *)scratch, length, basic_sort_int_key, descending);
+}
+
+void basic_sort_radix_flt(float *a, float *scratch, size_t length, int descending)
+{
+	basic_sort_radix((uint32_t *)a, (uint32_t *)scratch, length, basic_sort_flt_key, descending);
+}
+
+/* COMPARISON SORTS */
+
+// Boxed values are large, so the comparison sorts move pointers to them, and the values
+// are put in order once at the end
+
+int basic_sort_rank(const ASTNodeData *value)
+{
+	switch (value->token_type)
+	{
+	case DTYPE_NUM:
+	case DTYPE_FLT:
+		return 0;
+	case DTYPE_STR:
+		return 1;
+	default:
+		return 2;
+	}
+}
+
+int basic_sort_compare(const ASTNodeData *a, const ASTNodeData *b)
+{
+	int rank_a = basic_sort_rank(a), rank_b = basic_sort_rank(b);
+	if (rank_a != rank_b)
+		return rank_a - rank_b;
+
+	if (rank_a == 0)
+	{
+		if (a->token_type == DTYPE_NUM && b->token_type == DTYPE_NUM)
+			return (a->token.literal.num > b->token.literal.num) - (a->token.literal.num < b->token.literal.num);
+		double x = a->token_type == DTYPE_NUM ? a->token.literal.num : a->token.literal.flt;
+		double y = b->token_type == DTYPE_NUM ? b->token.literal.num : b->token.literal.flt;
+		return (x > y) - (x < y);
+	}
+	if (rank_a == 1)
+		return strcmp(a->token.literal.str, b->token.literal.str);
+	return 0;
+}
+
+// True if a goes after b in the requested order
+int basic_sort_after(const ASTNodeData *a, const ASTNodeData *b, int descending)
+{
+	int order = basic_sort_compare(a, b);
+	return descending ? order < 0 : order > 0;
+}
+
+void basic_sort_insertion_boxed(const ASTNodeData **a, size_t length, int descending)
+{
+	for (size_t i = 1; i < length; i++)
+	{
+		const ASTNodeData *value = a[i];
+		size_t j = i;
+		for (; j > 0 && basic_sort_after(a[j - 1], value, descending); j--)
+			a[j] = a[j - 1];
+		a[j] = value;
+	}
+}
+
+void basic_sort_sift_down(const ASTNodeData **a, size_t root, size_t length, int descending)
+{
+	while (2 * root + 1 < length)
+	{
+		size_t child = 2 * root + 1;
+		if (child + 1 < length && basic_sort_after(a[child + 1], a[child], descending))
+			child++;
+		if (!basic_sort_after(a[child], a[root], descending))
+			return;
+		const ASTNodeData *swap = a[root];
+		a[root] = a[child];
+		a[child] = swap;
+		root = child;
+	}
+}
+
+void basic_sort_heap_boxed(const ASTNodeData **a, size_t length, int descending)
+{
+	for (size_t i = length / 2; i-- > 0;)
+		basic_sort_sift_down(a, i, length, descending);
+	for (size_t end = length - 1; end > 0; end--)
+	{
+		const ASTNodeData *swap = a[0];
+		a[0] = a[end];
+		a[end] = swap;
+		basic_sort_sift_down(a, 0, end, descending);
+	}
+}
+
+// Quicksort with a median of three pivot, switching to heapsort when the recursion gets
+// too deep so that the worst case stays O(n log n)
+void basic_sort_intro_boxed(const ASTNodeData **a, size_t length, int depth_limit, int descending)
+{
+	while (length > 16)
+	{
+		if (depth_limit-- == 0)
+		{
+			basic_sort_heap_boxed(a, length, descending);
+			return;
+		}
+
+		const ASTNodeData *first = a[0], *middle = a[length / 2], *last = a[length - 1], *pivot;
+		if (basic_sort_after(middle, first, descending))
+			pivot = basic_sort_after(last, middle, descending) ? middle : (basic_sort_after(last, first, descending) ? last : first);
+		else
+			pivot = basic_sort_after(last, first, descending) ? first : (basic_sort_after(last, middle, descending) ? last : middle);
+
+		// Hoare partition around the pivot value
+		size_t i = 0, j = length - 1;
+		while (1)
+		{
+			while (basic_sort_after(pivot, a[i], descending))
+				i++;
+			while (basic_sort_after(a[j], pivot, descending))
+				j--;
+			if (i >= j)
+				break;
+			const ASTNodeData *swap = a[i];
+			a[i++] = a[j];
+			a[j--] = swap;
+		}
+
+		// Recurse into the smaller side and loop on the larger one
+		size_t left = j + 1;
+		if (left < length - left)
+		{
+			basic_sort_intro_boxed(a, left, depth_limit, descending);
+			a += left;
+			length -= left;
+		}
+		else
+		{
+			basic_sort_intro_boxed(a + left, length - left, depth_limit, descending);
+			length = left;
+		}
+	}
+	basic_sort_insertion_boxed(a, length, descending);
+}
+
+// Bottom-up merge sort, taking from the left run on ties so that equal values keep their order
+void basic_sort_merge_boxed(const ASTNodeData **a, const ASTNodeData **scratch, size_t length, int descending)
+{
+	const size_t run = 16;
+	for (size_t start = 0; start < length; start += run)
+		basic_sort_insertion_boxed(a + start, length - start < run ? length - start : run, descending);
+
+	const ASTNodeData **from = a, **to = scratch;
+	for (size_t width = run; width < length; width *= 2)
+	{
+		for (size_t start = 0; start < length; start += 2 * width)
+		{
+			size_t mid = start + width < length ? start + width : length;
+			size_t end = start + 2 * width < length ? start + 2 * width : length;
+			size_t i = start, j = mid, k = start;
+			while (i < mid && j < end)
+				to[k++] = basic_sort_after(from[i], from[j], descending) ? from[j++] : from[i++];
+			while (i < mid)
+				to[k++] = from[i++];
+			while (j < end)
+				to[k++] = from[j++];
+		}
+		const ASTNodeData **swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != a)
+		memcpy(a, from, sizeof(*a) * length);
+}
+
+int basic_sort_boxed(ASTNodeData *values, size_t length, int descending, int stable)
+{
+	const ASTNodeData **order = (const ASTNodeData **)malloc(sizeof(*order) * length * (stable ? 2 : 1));
+	ASTNodeData *sorted = (ASTNodeData *)malloc(sizeof(ASTNodeData) * length);
+	if (order == NULL || sorted == NULL)
+	{
+		free(order);
+		free(sorted);
+		return 1;
+	}
+
+	for (size_t i = 0; i < length; i++)
+		order[i] = &values[i];
+
+	if (stable)
+		basic_sort_merge_boxed(order, order + length, length, descending);
+	else
+	{
+		int depth_limit = 0;
+		for (size_t n = length; n > 1; n >>= 1)
+			depth_limit += 2;
+		basic_sort_intro_boxed(order, length, depth_limit, descending);
+	}
+
+	for (size_t i = 0; i < length; i++)
+		sorted[i] = *order[i];
+	memcpy(values, sorted, sizeof(ASTNodeData) * length);
+	free(order);
+	free(sorted);
+	return 0;
+}
+
+int basic_array_sort(BASICArray *array, int descending, int stable)
+{
+	if (array->storage == ARRAY_STORAGE_BOXED)
+		return basic_sort_boxed(array->data.boxed, array->length, descending, stable);
+
+	void *scratch = NULL;
+	if (array->length >= BASIC_SORT_INSERTION_MAX && (scratch = malloc(sizeof(int) * array->length)) == NULL)
+		return 1;
+	if (array->storage == ARRAY_STORAGE_INT)
+		basic_sort_radix_int(array->data.ints, (int *)scratch, array->length, descending);
+	else
+		basic_sort_radix_flt(array->data.flts, (float *)scratch, array->length, descending);
+	free(scratch);
+	return 0;
+}
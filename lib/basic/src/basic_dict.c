@@ -0,0 +1,98 @@
+#include "basic/basic_dict.h"
+
+// Standard libraries
+#include <stdlib.h>
+#include <string.h>
+
+BASICDict *basic_dict_create(StringInterner *strings)
+{
+	BASICDict *dict = (BASICDict *)malloc(sizeof(BASICDict));
+	if (dict == NULL)
+		return NULL;
+	hashmap_init(&dict->map, sizeof(ASTNodeData), NULL);
+	dict->strings = strings;
+	dict->references = 0;
+	return dict;
+}
+
+void basic_dict_retain(BASICDict *dict)
+{
+	dict->references++;
+}
+
+void basic_dict_release(BASICDict *dict)
+{
+	if (--dict->references > 0)
+		return;
+	hashmap_free(&dict->map);
+	free(dict);
+}
+
+// Packs a key into a map key and finds its hash. A string seen before keeps the hash it was
+// interned with, so only the interner's lookup reads its characters
+BASICDictResult basic_dict_key(BASICDict *dict, ASTNodeData key, uint64_t *map_key, uint64_t *hash)
+{
+	uint32_t low;
+	switch (key.token_type)
+	{
+	case DTYPE_NUM:
+		low = (uint32_t)key.token.literal.num;
+		break;
+	case DTYPE_FLT:
+		memcpy(&low, &key.token.literal.flt, sizeof(low));
+		break;
+	case DTYPE_STR:
+	{
+		long id = interner_intern(dict->strings, key.token.literal.str);
+		if (id < 0)
+			return DICT_NO_MEMORY;
+		*map_key = (uint64_t)DTYPE_STR << 32 | (uint32_t)id;
+		*hash = interner_hash(dict->strings, (uint32_t)id);
+		return DICT_OK;
+	}
+	default:
+		return DICT_BAD_KEY;
+	}
+	*map_key = (uint64_t)key.token_type << 32 | low;
+	*hash = hashmap_hash_u64(*map_key);
+	return DICT_OK;
+}
+
+BASICDictResult basic_dict_get(BASICDict *dict, ASTNodeData key, ASTNodeData *value)
+{
+	uint64_t map_key, hash;
+	BASICDictResult result = basic_dict_key(dict, key, &map_key, &hash);
+	if (result != DICT_OK)
+		return result;
+	ASTNodeData *stored = (ASTNodeData *)hashmap_find(&dict->map, map_key, hash);
+	if (stored == NULL)
+		return DICT_NOT_FOUND;
+	if (value != NULL)
+		*value = *stored;
+	return DICT_OK;
+}
+
+BASICDictResult basic_dict_set(BASICDict *dict, ASTNodeData key, ASTNodeData value)
+{
+	// Containers can't be stored, so that a dictionary never holds a reference to itself
+	if (value.token_type != DTYPE_NUM && value.token_type != DTYPE_FLT && value.token_type != DTYPE_STR)
+		return DICT_BAD_VALUE;
+	uint64_t map_key, hash;
+	BASICDictResult result = basic_dict_key(dict, key, &map_key, &hash);
+	if (result != DICT_OK)
+		return result;
+	ASTNodeData *stored = (ASTNodeData *)hashmap_insert(&dict->map, map_key, hash, NULL);
+	if (stored == NULL)
+		return DICT_NO_MEMORY;
+	*stored = value;
+	return DICT_OK;
+}
+
+BASICDictResult basic_dict_remove(BASICDict *dict, ASTNodeData key)
+{
+	uint64_t map_key, hash;
+	BASICDictResult result = basic_dict_key(dict, key, &map_key, &hash);
+	if (result != DICT_OK)
+		return result;
+	return hashmap_remove(&dict->map, map_key, hash) ? DICT_OK : DICT_NOT_FOUND;
+}
@@ -0,0 +1,430 @@
+#include "basic/basic.h"
+
+#include <utility/utils.h>
+#include <utility/logging/logging.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* INCREMENTAL FRONT END */
+
+// Deletes the top-level nodes of a unit, along with all their children
+void basic_incremental_free_unit(BASICStatementUnit *unit)
+{
+	ASTNode *node = unit->first_node;
+	while (node != NULL)
+	{
+		ASTNode *next = node->next;
+		ast_delete_children_cascade(node);
+		ast_delete_node(node);
+		if (node == unit->last_node)
+			break;
+		node = next;
+	}
+	unit->first_node = unit->last_node = NULL;
+	basic_clear_tokens(&unit->tokens);
+}
+
+// Parses the tokens of a unit into its own list of top-level nodes
+void basic_incremental_parse_unit(BASICStatementUnit *unit)
+{
+	ASTNode root;
+	root.type = AST_PROGRAM_SEQUENCE;
+	root.data = ASTVOID;
+	root.next = root.child = NULL;
+
+	unit->first_node = unit->last_node = NULL;
+
+	// A lexer error was already recorded for this unit
+	if (unit->error == 0)
+		unit->error = basic_parse_to_ast_between_level(&unit->tokens, &root, 0, unit->tokens.tokens_length - 1, 0, 1, NULL);
+
+	if (unit->error != 0)
+	{
+		// Statements with errors do not contribute to the program
+		ast_delete_children_cascade(&root);
+		if (unit->tokens.error_at != NULL)
+			unit->error_offset = (size_t)((uintptr_t)unit->tokens.error_at - (uintptr_t)unit->lex_base);
+		else
+			unit->error_offset = 0;
+		return;
+	}
+
+	unit->first_node = root.child;
+	for (ASTNode *node = root.child; node != NULL; node = node->next)
+		unit->last_node = node;
+}
+
+// Copies tokens [from, to) of the scanned region into a new unit
+int basic_incremental_make_unit(BASICStatementUnit *unit, BASICTokenParseList *region, int from, int to, char *unit_start, char *unit_end)
+{
+	unit->char_start = 0;
+	unit->lex_base = unit_start;
+	unit->first_node = unit->last_node = NULL;
+	unit->error = 0;
+	unit->error_offset = 0;
+	unit->excess_closers = 0;
+	unit->tokens.tokens = NULL;
+	unit->tokens.tokens_length = 0;
+	unit->tokens.tokens_capacity = 0;
+	unit->tokens.lazy_bodies = 0;
+	unit->tokens.scope = PARSE_SCOPE_PROGRAM;
+	unit->tokens.error_at = NULL;
+	unit->tokens.error_message[0] = '\0';
+
+	// One extra token for the end marker
+	int count = to - from;
+	unit->tokens.tokens = (BASICToken *)malloc(sizeof(BASICToken) * (count + 1));
+	if (unit->tokens.tokens == NULL)
+		return 1;
+	memcpy(unit->tokens.tokens, region->tokens + from, sizeof(BASICToken) * count);
+	unit->tokens.tokens[count].token_type = TOKEN_END;
+	unit->tokens.tokens[count].token[0] = '\0';
+	unit->tokens.tokens[count].token_at = unit_end;
+	unit->tokens.tokens_length = unit->tokens.tokens_capacity = count + 1;
+	return 0;
+}
+
+// Returns the index of the last unit starting at or before the given offset
+int basic_incremental_find_unit(BASICIncrementalProgram *inc, size_t offset)
+{
+	int low = 0, high = inc->unit_count - 1, found = 0;
+	while (low <= high)
+	{
+		int mid = (low + high) / 2;
+		if (inc->units[mid].char_start <= offset)
+		{
+			found = mid;
+			low = mid + 1;
+		}
+		else
+			high = mid - 1;
+	}
+	return found;
+}
+
+// Relinks the program sequence around units [first, end)
+void basic_incremental_link_units(BASICIncrementalProgram *inc, int first, int end)
+{
+	ASTNode *prev = NULL, *next = NULL;
+	for (int i = first - 1; i >= 0 && prev == NULL; i--)
+		prev = inc->units[i].last_node;
+	for (int i = end; i < inc->unit_count && next == NULL; i++)
+		next = inc->units[i].first_node;
+
+	for (int i = first; i < end; i++)
+	{
+		BASICStatementUnit *unit = &inc->units[i];
+		if (unit->first_node == NULL)
+			continue;
+		if (prev != NULL)
+			prev->next = unit->first_node;
+		else
+			inc->program->program_sequence->child = unit->first_node;
+		prev = unit->last_node;
+	}
+
+	if (prev != NULL)
+		prev->next = next;
+	else
+		inc->program->program_sequence->child = next;
+}
+
+// Re-lexes and re-parses the source starting at 'region_start', replacing units [first, end).
+// The region grows over the following units until it ends on a statement boundary
+int basic_incremental_reparse(BASICIncrementalProgram *inc, int first, int end, size_t region_start)
+{
+	BASICTokenParseList region;
+	size_t region_end;
+	int lex_error, last_boundary, grow = 1, unclosed = 0;
+	char *source = inc->source;
+
+	region.tokens = NULL;
+	region.tokens_length = region.tokens_capacity = 0;
+	region.lazy_bodies = 0;
+	region.scope = PARSE_SCOPE_PROGRAM;
+	region.error_at = NULL;
+	region.error_message[0] = '\0';
+
+	while (1)
+	{
+		region_end = end < inc->unit_count ? inc->units[end].char_start : inc->source_length;
+
+		basic_clear_tokens(&region);
+		lex_error = basic_tokenize_range(&region, source + region_start, source + region_end);
+
+		// Find the last newline that is outside of any block or parenthesis
+		int depth = 0, paren = 0;
+		last_boundary = -1;
+		for (int i = 0; i < region.tokens_length; i++)
+		{
+			BASICToken *tok = &region.tokens[i];
+			int kw = basic_token_keyword_index(tok);
+			if (basic_keyword_opens_block(kw))
+				depth++;
+			else if (basic_keyword_closes_block(kw))
+				depth = MAX(0, depth - 1);
+			else if (tok->token_type == TOKEN_SEPARATOR)
+				paren = tok->token[0] == '(' ? paren + 1 : MAX(0, paren - 1);
+			else if (tok->token_type == TOKEN_WHITESPACE && tok->token[0] == '\n' && depth == 0 && paren == 0)
+				last_boundary = i;
+		}
+
+		// The region must end right after a statement boundary, unless it reaches the end of the program
+		int tail_start = last_boundary >= 0 ? (int)(region.tokens[last_boundary].token_at + 1 - source) : (int)region_start;
+		if ((size_t)tail_start == region_end || end == inc->unit_count)
+			break;
+
+		if (!lex_error && (depth > 0 || paren > 0))
+		{
+			// Each following statement is closed on its own, so only one with an unpaired END or ')'
+			// can close the open block or parenthesis. Without one, the block stays open until the end
+			// of the program: keep the following statements as they are and only report the open block
+			int closer = end;
+			while (closer < inc->unit_count && inc->units[closer].excess_closers == 0)
+				closer++;
+			if (closer == inc->unit_count)
+			{
+				unclosed = 1;
+				break;
+			}
+			end = closer + 1;
+		}
+		else
+		{
+			// Grow geometrically, so an unterminated string costs one pass over the rest of the program
+			end = MIN(end + grow, inc->unit_count);
+			grow *= 2;
+		}
+	}
+
+	// Split the region into units
+	BASICStatementUnit *new_units = NULL;
+	int new_count = 0, unit_first_token = 0, opener = -1, paren_opener = -1, excess_closers = 0;
+	size_t unit_char_start = region_start;
+	int depth = 0, paren = 0;
+	new_units = (BASICStatementUnit *)malloc(sizeof(BASICStatementUnit) * (region.tokens_length + 1));
+	if (new_units == NULL)
+	{
+		basic_clear_tokens(&region);
+		return 1;
+	}
+
+	for (int i = 0; i < region.tokens_length; i++)
+	{
+		BASICToken *tok = &region.tokens[i];
+		int kw = basic_token_keyword_index(tok);
+		// Remember where the outermost open block or parenthesis of the statement starts
+		if (depth == 0 && paren == 0)
+			opener = -1;
+		if (basic_keyword_opens_block(kw))
+			depth++;
+		else if (basic_keyword_closes_block(kw))
+		{
+			excess_closers += depth == 0;
+			depth = MAX(0, depth - 1);
+		}
+		else if (tok->token_type == TOKEN_SEPARATOR)
+		{
+			excess_closers += tok->token[0] == ')' && paren == 0;
+			// and where the outermost open parenthesis starts, which may be inside the block
+			if (tok->token[0] == '(' && paren == 0)
+				paren_opener = i;
+			paren = tok->token[0] == '(' ? paren + 1 : MAX(0, paren - 1);
+		}
+		else if (tok->token_type == TOKEN_WHITESPACE && tok->token[0] == '\n' && depth == 0 && paren == 0)
+		{
+			size_t unit_char_end = (size_t)(tok->token_at + 1 - source);
+			basic_incremental_make_unit(&new_units[new_count], &region, unit_first_token, i + 1, source + unit_char_start, source + unit_char_end);
+			new_units[new_count].char_start = unit_char_start;
+			new_units[new_count++].excess_closers = excess_closers;
+			unit_first_token = i + 1;
+			unit_char_start = unit_char_end;
+			excess_closers = 0;
+		}
+		if (opener < 0 && (depth > 0 || paren > 0))
+			opener = i;
+	}
+
+	// Whatever is left is a statement that does not end on a boundary
+	if (unit_char_start < region_end || lex_error)
+	{
+		BASICStatementUnit *unit = &new_units[new_count++];
+		basic_incremental_make_unit(unit, &region, unit_first_token, region.tokens_length, source + unit_char_start, source + region_end);
+		unit->char_start = unit_char_start;
+		unit->excess_closers = excess_closers;
+		if (lex_error)
+		{
+			unit->error = 1;
+			unit->tokens.error_at = region.error_at;
+			strcpy(unit->tokens.error_message, region.error_message);
+		}
+		else if (unclosed || ((depth > 0 || paren > 0) && region_end == inc->source_length))
+		{
+			// A block or parenthesis left open until the end of the program can never parse,
+			// so don't spend time building the AST of everything after it
+			unit->error = BASIC_INCREMENTAL_UNCLOSED;
+			if (depth > 0)
+				basic_token_set_error(&unit->tokens, opener >= 0 ? region.tokens[opener].token_at : source + unit_char_start,
+									  "End of program reached inside a block, without encountering the \"END\" or \"NEXT\" that ends it");
+			else
+				basic_token_set_error(&unit->tokens, paren_opener >= 0 ? region.tokens[paren_opener].token_at : source + unit_char_start,
+									  "Parenthesis is not closed before the end of the program");
+		}
+	}
+	basic_clear_tokens(&region);
+
+	// Replace the old units of the region with the new ones
+	for (int i = first; i < end; i++)
+		basic_incremental_free_unit(&inc->units[i]);
+
+	int total = inc->unit_count - (end - first) + new_count;
+	if (total > inc->unit_capacity)
+	{
+		int new_capacity = MAX(total, inc->unit_capacity * 2);
+		BASICStatementUnit *units = (BASICStatementUnit *)realloc(inc->units, sizeof(BASICStatementUnit) * new_capacity);
+		if (units == NULL)
+		{
+			free(new_units);
+			return 1;
+		}
+		inc->units = units;
+		inc->unit_capacity = new_capacity;
+	}
+	memmove(inc->units + first + new_count, inc->units + end, sizeof(BASICStatementUnit) * (inc->unit_count - end));
+	memcpy(inc->units + first, new_units, sizeof(BASICStatementUnit) * new_count);
+	inc->unit_count = total;
+	free(new_units);
+
+	for (int i = first; i < first + new_count; i++)
+		basic_incremental_parse_unit(&inc->units[i]);
+	basic_incremental_link_units(inc, first, first + new_count);
+
+	return 0;
+}
+
+int basic_incremental_count_errors(BASICIncrementalProgram *inc)
+{
+	int errors = 0;
+	for (int i = 0; i < inc->unit_count; i++)
+		if (inc->units[i].error != 0)
+			errors++;
+	return errors;
+}
+
+/* Public functions */
+
+// Creates an incrementally updatable program from the given source
+BASICIncrementalProgram *basic_incremental_create(const char *source, size_t source_length)
+{
+	BASICIncrementalProgram *inc = (BASICIncrementalProgram *)malloc(sizeof(BASICIncrementalProgram));
+	if (inc == NULL)
+	{
+		fprintf(stderr, "Failed to create an incremental program object\n");
+		return NULL;
+	}
+
+	inc->program = basic_create_program();
+	inc->source_capacity = source_length + 1;
+	inc->source = (char *)malloc(inc->source_capacity);
+	if (inc->program == NULL || inc->source == NULL)
+	{
+		if (inc->program != NULL)
+			basic_destroy_program(inc->program);
+		free(inc->source);
+		free(inc);
+		return NULL;
+	}
+	memcpy(inc->source, source, source_length);
+	inc->source[source_length] = '\0';
+	inc->source_length = source_length;
+	inc->program->program_source = inc->source;
+	inc->units = NULL;
+	inc->unit_count = 0;
+	inc->unit_capacity = 0;
+
+	basic_incremental_reparse(inc, 0, 0, 0);
+	return inc;
+}
+
+void basic_incremental_destroy(BASICIncrementalProgram *inc)
+{
+	if (inc == NULL)
+		return;
+	for (int i = 0; i < inc->unit_count; i++)
+		basic_incremental_free_unit(&inc->units[i]);
+	free(inc->units);
+
+	// The nodes were already deleted with their units
+	inc->program->program_sequence->child = NULL;
+	basic_destroy_program(inc->program);
+	free(inc->source);
+	free(inc);
+}
+
+int basic_incremental_edit(BASICIncrementalProgram *inc, size_t offset, size_t removed_length, const char *inserted, size_t inserted_length)
+{
+	if (offset > inc->source_length || removed_length > inc->source_length - offset)
+		return -1;
+
+	// Units touched by the edit
+	int first = basic_incremental_find_unit(inc, offset);
+	int end = basic_incremental_find_unit(inc, offset + removed_length);
+	if (end < inc->unit_count && (inc->units[end].char_start < offset + removed_length || end == first))
+		end++;
+	// Text after an unclosed block may close it, so such a block is parsed again with the edit
+	for (int i = first - 1; i >= 0; i--)
+		if (inc->units[i].error == BASIC_INCREMENTAL_UNCLOSED)
+			first = i;
+	size_t region_start = inc->unit_count > 0 ? inc->units[first].char_start : 0;
+
+	// Apply the edit to the source text
+	size_t new_length = inc->source_length - removed_length + inserted_length;
+	if (new_length + 1 > inc->source_capacity)
+	{
+		size_t new_capacity = MAX(new_length + 1, inc->source_capacity * 2);
+		char *new_source = (char *)realloc(inc->source, new_capacity);
+		if (new_source == NULL)
+			return -1;
+		inc->source = new_source;
+		inc->source_capacity = new_capacity;
+		inc->program->program_source = new_source;
+	}
+	memmove(inc->source + offset + inserted_length, inc->source + offset + removed_length, inc->source_length - offset - removed_length + 1);
+	memcpy(inc->source + offset, inserted, inserted_length);
+	inc->source_length = new_length;
+
+	// Statements after the edit only move
+	for (int i = end; i < inc->unit_count; i++)
+		inc->units[i].char_start = inc->units[i].char_start - removed_length + inserted_length;
+
+	if (basic_incremental_reparse(inc, first, end, region_start) != 0)
+		return -1;
+
+	return basic_incremental_count_errors(inc);
+}
+
+int basic_incremental_get_diagnostics(BASICIncrementalProgram *inc, BASICDiagnostic *diagnostics, int max_count)
+{
+	int count = 0;
+	for (int i = 0; i < inc->unit_count; i++)
+	{
+		BASICStatementUnit *unit = &inc->units[i];
+		if (unit->error == 0)
+			continue;
+		if (count < max_count)
+		{
+			BASICDiagnostic *diag = &diagnostics[count];
+			diag->offset = unit->char_start + unit->error_offset;
+			program_whereis(inc->source, inc->source + diag->offset, &diag->line, &diag->column);
+			if (unit->tokens.error_message[0] != '\0')
+				strcpy(diag->message, unit->tokens.error_message);
+			else
+				sprintf(diag->message, "Syntax error (code %d)", unit->error);
+		}
+		count++;
+	}
+	return count;
+}
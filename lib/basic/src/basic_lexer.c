@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
 
 /* BASIC TOKENIZER / LEXER */
 
@@ -16,8 +17,8 @@
 
 // Keywords
 // Make sure to update the KEYWORD_IDX_* entry in basic_parser.h
-char *PARSE_KEYWORDS[] = {"WHILE", "IF", "THEN", "ELSE", "END", "GOTO", NULL};
-int PARSE_KW_COUNT = 6;
+char *PARSE_KEYWORDS[] = {"WHILE", "IF", "THEN", "ELSE", "END", "GOTO", "DIM", "FUNCTION", "RETURN", "FOR", "TO", "STEP", "NEXT", NULL};
+int PARSE_KW_COUNT = 13;
 
 // Booleans: 0, 1
 char *PARSE_BOOLEAN[] = {"FALSE", "TRUE"};
@@ -32,6 +33,9 @@ char PARSE_SEPARATOR[] = {'(', ')'};
 // <newline> is a separator of program statements
 char PARSE_WS_CHAR[] = {' ', '\t', '\n', ',', ';'};
 
+// Type suffixes of variable names: integer, float, string
+char PARSE_TYPE_SUFFIX[] = {'%', '!', '$'};
+
 const char *_cvt_whitespace_to_escape_code(char character)
 {
 	switch (character)
@@ -53,30 +57,36 @@ const char *_cvt_whitespace_to_escape_code(char character)
 // Function to insert new token into the token array
 void basic_insert_token(BASICTokenParseList *parse_list, BASICToken tok)
 {
-	int new_token_size = parse_list->tokens_length + 1;
 	if (parse_list->tokens == NULL)
 	{
 		// In case of garbage value
 		parse_list->tokens_length = 0;
-		new_token_size = 1;
-
-		parse_list->tokens = (BASICToken *)malloc(sizeof(BASICToken) * new_token_size);
+		parse_list->tokens_capacity = 0;
 	}
-	else
-		parse_list->tokens = (BASICToken *)realloc(parse_list->tokens, sizeof(BASICToken) * new_token_size);
 
-	if (parse_list->tokens == NULL)
+	// Grow the array geometrically so that lexing stays linear in the program size
+	if (parse_list->tokens_length >= parse_list->tokens_capacity)
 	{
-		lprintf("LEXER", LOGTYPE_DEBUG, "Memory allocation failed");
-		return;
+		int new_capacity = MAX(16, parse_list->tokens_capacity * 2);
+		BASICToken *new_tokens = (BASICToken *)realloc(parse_list->tokens, sizeof(BASICToken) * new_capacity);
+		if (new_tokens == NULL)
+		{
+			lprintf("LEXER", LOGTYPE_DEBUG, "Memory allocation failed");
+			return;
+		}
+		parse_list->tokens = new_tokens;
+		parse_list->tokens_capacity = new_capacity;
 	}
 
 	memcpy(&(parse_list->tokens[parse_list->tokens_length]), &tok, sizeof(BASICToken));
-	parse_list->tokens_length = new_token_size;
+	parse_list->tokens_length++;
 }
 
 void basic_clear_tokens(BASICTokenParseList *parse_list)
 {
+	parse_list->error_at = NULL;
+	parse_list->error_message[0] = '\0';
+
 	if (parse_list->tokens == NULL)
 	{
 		return;
@@ -85,6 +95,19 @@ void basic_clear_tokens(BASICTokenParseList *parse_list)
 	free(parse_list->tokens);
 	parse_list->tokens = NULL;
 	parse_list->tokens_length = 0;
+	parse_list->tokens_capacity = 0;
+}
+
+// Remembers the first error found in the token list, with where it was found
+void basic_token_set_error(BASICTokenParseList *parse_list, char *position, const char *format, ...)
+{
+	if (parse_list->error_at != NULL)
+		return;
+	va_list args;
+	va_start(args, format);
+	vsnprintf(parse_list->error_message, sizeof(parse_list->error_message), format, args);
+	va_end(args);
+	parse_list->error_at = position;
 }
 
 // Returns 1 if given symbol is present in the given list of symbols
@@ -116,22 +139,100 @@ int token_is_bool(char *token)
 	return (strcasecmp(PARSE_BOOLEAN[0], token) == 0 || strcasecmp(PARSE_BOOLEAN[1], token) == 0);
 }
 
-// Gives line number and character position in the given program string
-void program_whereis(char *program, char *current_position, char *buffer)
+// Gives line number and character position (both starting from 1) in the given program string
+void program_whereis(const char *program, const char *current_position, int *line, int *column)
 {
+	const char *line_start = program;
+	*line = 1;
+	for (const char *ptr = program; ptr < current_position && *ptr != '\0'; ptr++)
+	{
+		if (*ptr == '\n')
+		{
+			(*line)++;
+			line_start = ptr + 1;
+		}
+	}
+	*column = (int)(current_position - line_start) + 1;
+}
+
+// Whether the character right after an identifier is its type suffix. '%' and '!' are also operators, so they
+// are only a suffix when no operand follows them: "i% = a% THEN" has two, while "a%b" and "a% -1" are still a modulo.
+// "x!=" is always an operator
+int basic_lexer_is_type_suffix(const char *at, const char *end)
+{
+	if (!token_char_contains(PARSE_TYPE_SUFFIX, sizeof(PARSE_TYPE_SUFFIX), *at))
+		return 0;
+	if (*at == '$')
+		return 1;
+	const char *next = at + 1;
+	if (*at == '!' && next < end && *next == '=')
+		return 0;
+	while (next < end && (*next == ' ' || *next == '\t'))
+		next++;
+	if (next >= end)
+		return 1;
+	if (*next == '-')
+		return !(next + 1 < end && (isdigit(next[1]) || next[1] == '.'));
+	if (isalpha(*next) || *next == '_')
+	{
+		// A keyword such as THEN is not an operand
+		StringLiteral word;
+		int length = 0;
+		while (next < end && (isalnum(*next) || *next == '_') && length < (int)sizeof(word) - 1)
+			word[length++] = *next++;
+		word[length] = '\0';
+		return token_is_kw(word);
+	}
+	return !(isdigit(*next) || *next == '(' || *next == '"' || *next == '.');
+}
+
+// Type of the values a variable holds, given by the suffix of its name. DTYPE_NONE if it has none and can hold anything
+ASTDType basic_name_type(const char *name)
+{
+	size_t length = strlen(name);
+	switch (length > 0 ? name[length - 1] : '\0')
+	{
+	case '%':
+		return DTYPE_NUM;
+	case '!':
+		return DTYPE_FLT;
+	case '$':
+		return DTYPE_STR;
+	default:
+		return DTYPE_NONE;
+	}
 }
 
 // Converts words/symbols to tokens. Also called "Lexer"
 int basic_tokenize(BASICProgram *program)
 {
 	BASICTokenParseList *parse_list = &(program->program_tokens);
-	char *tok_ptr, *tok_start;
-	StringLiteral buffer = {0};
-	int tok_len = 0;
+	char *end = program->program_source + strlen(program->program_source);
 
 	basic_clear_tokens(parse_list);
 
-	for (tok_ptr = program->program_source; *tok_ptr != '\0'; tok_ptr++)
+	if (basic_tokenize_range(parse_list, program->program_source, end) != 0)
+		return 1;
+
+	BASICToken tk_end;
+	tk_end.token_type = TOKEN_END;
+	tk_end.token[0] = '\0';
+	tk_end.token_at = end;
+	basic_insert_token(parse_list, tk_end);
+	lprintf("LEXER", LOGTYPE_DEBUG, "End of program\n");
+
+	lprintf("LEXER", LOGTYPE_DEBUG, "Finished tokenization of program\n");
+
+	return 0;
+}
+
+// Converts the characters between 'from' and 'end' to tokens, appending them to the token list.
+// Does not add a TOKEN_END at the end
+int basic_tokenize_range(BASICTokenParseList *parse_list, char *from, char *end)
+{
+	char *tok_ptr, *tok_start;
+
+	for (tok_ptr = from; tok_ptr < end; tok_ptr++)
 	{
 		// Check for digit
 		if (isdigit(*tok_ptr))
@@ -140,10 +241,10 @@ int basic_tokenize(BASICProgram *program)
 			// Beginning of a number
 			tok_start = tok_ptr;
 			// Check if number is negative
-			if (*(tok_start - 1) == '-')
+			if (tok_start > from && *(tok_start - 1) == '-')
 				tok_start--;
 			// Keep searching till we run out of digits
-			while ((isdigit(*tok_ptr) || *tok_ptr == '.') && *tok_ptr != '\0')
+			while (tok_ptr < end && (isdigit(*tok_ptr) || *tok_ptr == '.'))
 				tok_ptr++;
 			// Copy the digits to a buffer
 			int num_size = MIN(tok_ptr - tok_start, sizeof(StringLiteral) - 1);
@@ -162,7 +263,7 @@ int basic_tokenize(BASICProgram *program)
 		if (token_char_contains(PARSE_OPERATORS, sizeof(PARSE_OPERATORS), *tok_ptr))
 		{
 			// Skip if this is a negative number sign
-			if (*tok_ptr == '-' && isdigit(*(tok_ptr + 1)))
+			if (*tok_ptr == '-' && tok_ptr + 1 < end && isdigit(*(tok_ptr + 1)))
 				continue;
 			BASICToken tk_op;
 			tk_op.token[0] = *tok_ptr;
@@ -193,7 +294,7 @@ int basic_tokenize(BASICProgram *program)
 			{
 				BASICToken tk_identifier;
 				tok_start = tok_ptr;
-				while ((isalpha(*tok_ptr) || *tok_ptr == '_' || isdigit(*tok_ptr)) && *tok_ptr != '\0')
+				while (tok_ptr < end && (isalpha(*tok_ptr) || *tok_ptr == '_' || isdigit(*tok_ptr)))
 					tok_ptr++;
 				// Copy the name to a buffer
 				int id_size = MIN(tok_ptr - tok_start, sizeof(StringLiteral) - 1);
@@ -219,7 +320,13 @@ int basic_tokenize(BASICProgram *program)
 				}
 				else
 				{
-					// It is an identifier
+					// It is an identifier, which may end with a type suffix
+					if (tok_ptr + 1 < end && basic_lexer_is_type_suffix(tok_ptr + 1, end) && id_size < (int)sizeof(StringLiteral) - 1)
+					{
+						tok_ptr++;
+						tk_identifier.token[id_size] = *tok_ptr;
+						tk_identifier.token[id_size + 1] = '\0';
+					}
 					tk_identifier.token_type = TOKEN_IDENTIFIER;
 					basic_insert_token(parse_list, tk_identifier);
 					lprintf("LEXER", LOGTYPE_DEBUG, "Found identifier \"%s\"\n", tk_identifier.token);
@@ -234,12 +341,13 @@ int basic_tokenize(BASICProgram *program)
 				BASICToken tk_str;
 				// Start string the next character from double-quote
 				tok_start = ++tok_ptr;
-				while (*tok_ptr != '"' && *tok_ptr != '\0')
+				while (tok_ptr < end && *tok_ptr != '"')
 					tok_ptr++;
 
-				if (*tok_ptr == '\0')
+				if (tok_ptr >= end)
 				{
 					lprintf("LEXER", LOGTYPE_ERROR, "Error! String literal is not terminated!\n");
+					basic_token_set_error(parse_list, tok_start - 1, "String literal is not terminated");
 					return 1;
 				}
 
@@ -269,14 +377,5 @@ int basic_tokenize(BASICProgram *program)
 		}
 	}
 
-	BASICToken tk_end;
-	tk_end.token_type = TOKEN_END;
-	tk_end.token[0] = '\0';
-	tk_end.token_at = tok_ptr;
-	basic_insert_token(parse_list, tk_end);
-	lprintf("LEXER", LOGTYPE_DEBUG, "End of program\n");
-
-	lprintf("LEXER", LOGTYPE_DEBUG, "Finished tokenization of program\n");
-
 	return 0;
 }
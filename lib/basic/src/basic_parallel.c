@@ -0,0 +1,355 @@
+#include "basic/basic.h"
+
+#include <utility/utils.h>
+#include <utility/logging/logging.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* PARALLEL FRONT END */
+
+typedef struct _basic_parallel_work BASICParallelWork;
+typedef void (*basic_parallel_job)(BASICParallelWork *work, int chunk);
+
+// State shared by the threads compiling one program
+struct _basic_parallel_work
+{
+	BASICProgram *program;
+	int chunk_count;
+	// Chunk i covers the source between chunk_start[i] and chunk_start[i + 1]
+	char **chunk_start;
+
+	// Lexer output of each chunk
+	BASICTokenParseList *chunk_tokens;
+	int *lex_result;
+	// Index of the first token of each chunk in the joined token list, plus the total at the end
+	int *token_start;
+
+	// Parser output of each chunk. Each chunk parses with its own copy of the joined token list,
+	// so that errors are recorded per chunk
+	ASTNode *chunk_roots;
+	BASICTokenParseList *chunk_parse_lists;
+	int *parse_result;
+
+	// Logger settings of the calling thread, which the other threads use too
+	LogState log_state;
+
+	// Next chunk to be taken by a thread
+	basic_parallel_job job;
+	int next_chunk;
+#ifdef __linux__
+	pthread_mutex_t lock;
+#endif
+};
+
+// +1 if the word opens an IF/WHILE/FOR/FUNCTION block, -1 if it is an END or NEXT, 0 otherwise
+int basic_parallel_block_delta(const char *word, size_t length)
+{
+	for (int kw = 0; kw < PARSE_KW_COUNT; kw++)
+	{
+		if (length != strlen(PARSE_KEYWORDS[kw]) || strncasecmp(word, PARSE_KEYWORDS[kw], length) != 0)
+			continue;
+		if (basic_keyword_opens_block(kw))
+			return 1;
+		if (basic_keyword_closes_block(kw))
+			return -1;
+	}
+	return 0;
+}
+
+// Character-level scan that steps over words, numbers and strings the same way as the lexer
+int basic_parallel_find_splits(const char *source, size_t source_length, size_t *splits, int max_splits)
+{
+	int count = 0, depth = 0, paren = 0;
+	size_t spacing = source_length / (max_splits + 1), i = 0;
+
+	while (i < source_length && count < max_splits)
+	{
+		char c = source[i];
+		if (isdigit(c))
+		{
+			while (i < source_length && (isdigit(source[i]) || source[i] == '.'))
+				i++;
+			continue;
+		}
+		if (isalpha(c) || c == '_')
+		{
+			size_t word_start = i;
+			while (i < source_length && (isalpha(source[i]) || source[i] == '_' || isdigit(source[i])))
+				i++;
+			depth = MAX(0, depth + basic_parallel_block_delta(source + word_start, i - word_start));
+			continue;
+		}
+		if (c == '"')
+		{
+			// Skip to the closing quote. An unterminated string leaves no more boundaries
+			i++;
+			while (i < source_length && source[i] != '"')
+				i++;
+			i++;
+			continue;
+		}
+
+		if (c == '(')
+			paren++;
+		else if (c == ')')
+			paren = MAX(0, paren - 1);
+		else if (c == '\n' && depth == 0 && paren == 0 && i + 1 >= spacing * (count + 1) && i + 1 < source_length)
+			splits[count++] = i + 1;
+		i++;
+	}
+
+	return count;
+}
+
+void basic_parallel_lex_chunk(BASICParallelWork *work, int chunk)
+{
+	work->lex_result[chunk] = basic_tokenize_range(&work->chunk_tokens[chunk], work->chunk_start[chunk], work->chunk_start[chunk + 1]);
+}
+
+void basic_parallel_parse_chunk(BASICParallelWork *work, int chunk)
+{
+	BASICTokenParseList *parse_list = &work->chunk_parse_lists[chunk];
+	ASTNode *root = &work->chunk_roots[chunk];
+
+	*parse_list = work->program->program_tokens;
+	parse_list->error_at = NULL;
+	parse_list->error_message[0] = '\0';
+
+	root->type = AST_PROGRAM_SEQUENCE;
+	root->data = ASTVOID;
+	root->next = root->child = NULL;
+
+	work->parse_result[chunk] = basic_parse_to_ast_between(parse_list, root, work->token_start[chunk], work->token_start[chunk + 1]);
+}
+
+// Takes chunks until there are none left
+void *basic_parallel_worker(void *arg)
+{
+	BASICParallelWork *work = (BASICParallelWork *)arg;
+	while (1)
+	{
+		int chunk;
+#ifdef __linux__
+		pthread_mutex_lock(&work->lock);
+		chunk = work->next_chunk++;
+		pthread_mutex_unlock(&work->lock);
+#else
+		chunk = work->next_chunk++;
+#endif
+		if (chunk >= work->chunk_count)
+			break;
+		work->job(work, chunk);
+	}
+	return NULL;
+}
+
+#ifdef __linux__
+// Start of the other threads, which log like the calling thread
+void *basic_parallel_helper(void *arg)
+{
+	set_log_state(((BASICParallelWork *)arg)->log_state);
+	return basic_parallel_worker(arg);
+}
+#endif
+
+// Runs the job on every chunk, using the calling thread and up to thread_count - 1 more
+void basic_parallel_run(BASICParallelWork *work, int thread_count, basic_parallel_job job)
+{
+	work->job = job;
+	work->next_chunk = 0;
+	// Program output buffered by the calling thread is only flushed by that thread
+	work->log_state = get_log_state();
+	work->log_state.flush_hook = NULL;
+
+#ifdef __linux__
+	pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * thread_count);
+	int started = 0;
+	if (threads != NULL)
+	{
+		while (started < thread_count - 1 && pthread_create(&threads[started], NULL, basic_parallel_helper, work) == 0)
+			started++;
+	}
+	basic_parallel_worker(work);
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+#else
+	basic_parallel_worker(work);
+#endif
+}
+
+int basic_parallel_core_count()
+{
+#ifdef __linux__
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (int)cores : 1;
+#else
+	return 1;
+#endif
+}
+
+void basic_parallel_free_work(BASICParallelWork *work)
+{
+	if (work->chunk_tokens != NULL)
+		for (int i = 0; i < work->chunk_count; i++)
+			basic_clear_tokens(&work->chunk_tokens[i]);
+	free(work->chunk_start);
+	free(work->chunk_tokens);
+	free(work->lex_result);
+	free(work->token_start);
+	free(work->chunk_roots);
+	free(work->chunk_parse_lists);
+	free(work->parse_result);
+#ifdef __linux__
+	pthread_mutex_destroy(&work->lock);
+#endif
+}
+
+// Joins the chunk token lists into the program token list, ending it with a TOKEN_END like basic_tokenize
+int basic_parallel_join_tokens(BASICParallelWork *work, char *source_end)
+{
+	BASICTokenParseList *parse_list = &work->program->program_tokens;
+	int total = 0;
+	for (int i = 0; i < work->chunk_count; i++)
+	{
+		work->token_start[i] = total;
+		total += work->chunk_tokens[i].tokens_length;
+	}
+
+	parse_list->tokens = (BASICToken *)malloc(sizeof(BASICToken) * (total + 1));
+	if (parse_list->tokens == NULL)
+		return 1;
+	for (int i = 0; i < work->chunk_count; i++)
+		if (work->chunk_tokens[i].tokens_length > 0)
+			memcpy(parse_list->tokens + work->token_start[i], work->chunk_tokens[i].tokens, sizeof(BASICToken) * work->chunk_tokens[i].tokens_length);
+
+	BASICToken *tk_end = &parse_list->tokens[total];
+	tk_end->token_type = TOKEN_END;
+	tk_end->token[0] = '\0';
+	tk_end->token_at = source_end;
+	parse_list->tokens_length = parse_list->tokens_capacity = total + 1;
+
+	// The last chunk also parses the end token
+	work->token_start[work->chunk_count] = total + 1;
+	return 0;
+}
+
+// Appends the statements of each chunk to the program sequence, in order
+void basic_parallel_join_trees(BASICParallelWork *work)
+{
+	ASTNode *last = work->program->program_sequence->child;
+	while (last != NULL && last->next != NULL)
+		last = last->next;
+
+	for (int i = 0; i < work->chunk_count; i++)
+	{
+		ASTNode *first = work->chunk_roots[i].child;
+		if (first == NULL)
+			continue;
+		if (last == NULL)
+			work->program->program_sequence->child = first;
+		else
+			last->next = first;
+		for (last = first; last->next != NULL; last = last->next)
+			;
+	}
+}
+
+int basic_parallel_compile(BASICProgram *program, int thread_count)
+{
+	size_t source_length = strlen(program->program_source);
+	char *source_end = program->program_source + source_length;
+	BASICTokenParseList *parse_list = &program->program_tokens;
+
+	if (thread_count <= 0)
+		thread_count = basic_parallel_core_count();
+
+	// Small programs are not worth the threads
+	if (source_length < BASIC_PARALLEL_MIN_SOURCE || thread_count < 2)
+	{
+		if (basic_tokenize(program) != 0)
+			return 1;
+		return basic_parse_to_ast(program);
+	}
+
+	BASICParallelWork work;
+	memset(&work, 0, sizeof(work));
+	work.program = program;
+#ifdef __linux__
+	pthread_mutex_init(&work.lock, NULL);
+#endif
+
+	int max_chunks = thread_count * BASIC_PARALLEL_CHUNKS_PER_THREAD;
+	size_t *splits = (size_t *)malloc(sizeof(size_t) * max_chunks);
+	work.chunk_start = (char **)malloc(sizeof(char *) * (max_chunks + 1));
+	if (splits == NULL || work.chunk_start == NULL)
+	{
+		free(splits);
+		basic_parallel_free_work(&work);
+		return 1;
+	}
+
+	int split_count = basic_parallel_find_splits(program->program_source, source_length, splits, max_chunks - 1);
+	work.chunk_count = split_count + 1;
+	work.chunk_start[0] = program->program_source;
+	for (int i = 0; i < split_count; i++)
+		work.chunk_start[i + 1] = program->program_source + splits[i];
+	work.chunk_start[work.chunk_count] = source_end;
+	free(splits);
+
+	work.chunk_tokens = (BASICTokenParseList *)calloc(work.chunk_count, sizeof(BASICTokenParseList));
+	work.lex_result = (int *)calloc(work.chunk_count, sizeof(int));
+	work.token_start = (int *)calloc(work.chunk_count + 1, sizeof(int));
+	work.chunk_roots = (ASTNode *)calloc(work.chunk_count, sizeof(ASTNode));
+	work.chunk_parse_lists = (BASICTokenParseList *)calloc(work.chunk_count, sizeof(BASICTokenParseList));
+	work.parse_result = (int *)calloc(work.chunk_count, sizeof(int));
+	if (work.chunk_tokens == NULL || work.lex_result == NULL || work.token_start == NULL || work.chunk_roots == NULL || work.chunk_parse_lists == NULL || work.parse_result == NULL)
+	{
+		basic_parallel_free_work(&work);
+		return 1;
+	}
+
+	lprintf("AST", LOGTYPE_DEBUG, "Compiling %zu bytes in %d chunks on %d threads\n", source_length, work.chunk_count, thread_count);
+
+	// Lex the chunks. The first error in source order is the one the serial lexer would stop at
+	basic_clear_tokens(parse_list);
+	basic_parallel_run(&work, thread_count, basic_parallel_lex_chunk);
+	for (int i = 0; i < work.chunk_count; i++)
+	{
+		if (work.lex_result[i] != 0)
+		{
+			basic_token_set_error(parse_list, work.chunk_tokens[i].error_at, "%s", work.chunk_tokens[i].error_message);
+			basic_parallel_free_work(&work);
+			return 1;
+		}
+	}
+
+	if (basic_parallel_join_tokens(&work, source_end) != 0)
+	{
+		basic_parallel_free_work(&work);
+		return 1;
+	}
+
+	// Parse the chunks, then join the statements even on error so that they are freed with the program
+	basic_parallel_run(&work, thread_count, basic_parallel_parse_chunk);
+	basic_parallel_join_trees(&work);
+
+	int ret_code = 0;
+	for (int i = 0; i < work.chunk_count && ret_code == 0; i++)
+	{
+		ret_code = work.parse_result[i];
+		if (ret_code != 0 && work.chunk_parse_lists[i].error_at != NULL)
+			basic_token_set_error(parse_list, work.chunk_parse_lists[i].error_at, "%s", work.chunk_parse_lists[i].error_message);
+	}
+
+	basic_parallel_free_work(&work);
+	return ret_code;
+}
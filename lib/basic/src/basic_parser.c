@@ -8,9 +8,52 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
 
 /* BASIC PARSER */
 
+// Logs a syntax error, and remembers it along with the token where it was found
+void basic_parse_error(BASICTokenParseList *parse_list, int token_idx, const char *format, ...)
+{
+	char message[sizeof(parse_list->error_message)];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	lprintf("AST", LOGTYPE_ERROR, "Error: %s\n", message);
+
+	if (parse_list->tokens_length > 0)
+	{
+		token_idx = MAX(0, MIN(token_idx, parse_list->tokens_length - 1));
+		basic_token_set_error(parse_list, parse_list->tokens[token_idx].token_at, "%s", message);
+	}
+}
+
+// Returns the index of the keyword in PARSE_KEYWORDS if the token is a keyword, -1 otherwise
+int basic_token_keyword_index(BASICToken *token)
+{
+	if (token->token_type != TOKEN_KEYWORD)
+		return -1;
+	for (int i = 0; i < PARSE_KW_COUNT; i++)
+		if (strcasecmp(PARSE_KEYWORDS[i], token->token) == 0)
+			return i;
+	return -1;
+}
+
+// Returns 1 if the keyword starts a block that ends with END
+int basic_keyword_opens_block(int keyword_index)
+{
+	return keyword_index == KEYWORD_IDX_IF || keyword_index == KEYWORD_IDX_WHILE || keyword_index == KEYWORD_IDX_FOR || keyword_index == KEYWORD_IDX_FUNCTION;
+}
+
+// Returns 1 if the keyword ends a block: END, or NEXT for a FOR loop
+int basic_keyword_closes_block(int keyword_index)
+{
+	return keyword_index == KEYWORD_IDX_END || keyword_index == KEYWORD_IDX_NEXT;
+}
+
 int basic_parse_id_is_fn_call(BASICToken *tokens, int idx, int len)
 {
 	return (tokens[idx].token_type == TOKEN_IDENTIFIER && idx < len - 1 && tokens[idx + 1].token_type == TOKEN_SEPARATOR && tokens[idx + 1].token[0] == '(');
@@ -37,6 +80,53 @@ int basic_parse_to_ast_between_onlyexpr(BASICTokenParseList *parse_list, ASTNode
 	return basic_parse_to_ast_between_level(parse_list, root, from, to, 0, 0, NULL);
 }
 
+// Finds the ELSE, END or NEXT that ends the block body starting at 'from', stepping over nested blocks without parsing them.
+// Like basic_parse_to_ast_between_level, returns 1 for END, 2 for ELSE and 3 for NEXT, with the position of that keyword in next_ptr
+int basic_parse_skip_body(BASICTokenParseList *parse_list, int from, int to, int *next_ptr)
+{
+	int depth = 0;
+	for (int i = from; i < to; i++)
+	{
+		int kw = basic_token_keyword_index(&parse_list->tokens[i]);
+		if (basic_keyword_opens_block(kw))
+			depth++;
+		else if (basic_keyword_closes_block(kw) && depth-- == 0)
+		{
+			*next_ptr = i;
+			return kw == KEYWORD_IDX_NEXT ? 3 : 1;
+		}
+		else if (kw == KEYWORD_IDX_ELSE && depth == 0)
+		{
+			*next_ptr = i;
+			return 2;
+		}
+	}
+
+	basic_parse_error(parse_list, to, "End of program reached inside a block, without encountering the \"%s\" or \"%s\" that ends it", PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_NEXT]);
+	return -2;
+}
+
+// Parses the body of an IF/ELSE/WHILE/FOR block into 'body'. In lazy mode, the body only records its tokens
+int basic_parse_block_body(BASICTokenParseList *parse_list, ASTNode *body, int from, int to, int level, int *next_ptr)
+{
+	if (!parse_list->lazy_bodies)
+		return basic_parse_to_ast_between_level(parse_list, body, from, to, level, 1, next_ptr);
+
+	int ret = basic_parse_skip_body(parse_list, from, to, next_ptr);
+	// GOTO targets are found when the program starts, so a body that has a GOTO can't wait until it runs
+	for (int i = from; ret > 0 && i < *next_ptr; i++)
+		if (basic_token_keyword_index(&parse_list->tokens[i]) == KEYWORD_IDX_GOTO)
+			return basic_parse_to_ast_between_level(parse_list, body, from, to, level, 1, next_ptr);
+	if (ret > 0)
+	{
+		body->type = AST_DEFERRED_SEQUENCE;
+		body->data.token_type = DTYPE_NONE;
+		body->data.token.token_range.from = from;
+		body->data.token.token_range.to = *next_ptr;
+	}
+	return ret;
+}
+
 int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *root, int from, int to, int level, int allow_keyword, int *next_ptr)
 {
 	int cb_ret;
@@ -44,9 +134,22 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 	{
 		switch (parse_list->tokens[i].token_type)
 		{
+		// Line number of the statement after it
+		case TOKEN_NUM:
+			if (allow_keyword && basic_parse_is_line_label(parse_list, i, to))
+			{
+				ASTNode *label_node = ast_create_node();
+				label_node->type = AST_LABEL;
+				label_node->data.token_type = DTYPE_NUM;
+				label_node->data.token.literal.num = atoi(parse_list->tokens[i].token);
+				ast_append_child(root, label_node);
+				lprintf("AST", LOGTYPE_DEBUG, "Parse line number %d\n", label_node->data.token.literal.num);
+				break;
+			}
+			// fall through
+
 		// Part of an expression
 		case TOKEN_IDENTIFIER:
-		case TOKEN_NUM:
 		case TOKEN_STRING:
 		case TOKEN_SEPARATOR:
 		case TOKEN_BOOL:
@@ -100,17 +203,22 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 					int next_level = level + 1;
 					lprintf("AST", LOGTYPE_DEBUG, "Parse program statements at scope level %d\n", next_level);
 					int next_pos = -1;
-					int ret = basic_parse_to_ast_between_level(parse_list, if_true_node, i, to, next_level, 1, &next_pos);
+					int ret = basic_parse_block_body(parse_list, if_true_node, i, to, next_level, &next_pos);
 					if (ret >= 0 && next_pos >= 0)
 					{
 						// Set token position to the next instruction returned
 						i = next_pos;
+						if (ret == 3)
+						{
+							basic_parse_error(parse_list, i, "%s clause must end with \"%s\", not \"%s\"", PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_NEXT]);
+							return -3;
+						}
 						if (ret == 2)
 						{
 							// Else route exists. Go to next symbol to find the program sequence within the else clause body
 							i++;
 							lprintf("AST", LOGTYPE_DEBUG, "Parse program statements for %s at scope level %d\n", PARSE_KEYWORDS[KEYWORD_IDX_ELSE], next_level);
-							ret = basic_parse_to_ast_between_level(parse_list, if_false_node, i, to, next_level, 1, &next_pos);
+							ret = basic_parse_block_body(parse_list, if_false_node, i, to, next_level, &next_pos);
 							// We basically do the same check again, for one last time
 							if (ret >= 0 && next_pos >= 0)
 							{
@@ -118,9 +226,19 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 								if (ret == 2)
 								{
 									// This time, if another else is found at the same level, throw an error
-									lprintf("AST", LOGTYPE_ERROR, "Error: %s clause cannot have more than one %s statements.\n", PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_ELSE]);
+									basic_parse_error(parse_list, i, "%s clause cannot have more than one %s statements.", PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_ELSE]);
 									return -3;
 								}
+								if (ret == 3)
+								{
+									basic_parse_error(parse_list, i, "%s clause must end with \"%s\", not \"%s\"", PARSE_KEYWORDS[KEYWORD_IDX_ELSE], PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_NEXT]);
+									return -3;
+								}
+							}
+							else
+							{
+								lprintf("AST", LOGTYPE_ERROR, "An error (code %d) occurred while parsing %s clause\n", ret, PARSE_KEYWORDS[KEYWORD_IDX_ELSE]);
+								return ret;
 							}
 						}
 					}
@@ -132,7 +250,7 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 				}
 				else
 				{
-					lprintf("AST", LOGTYPE_ERROR, "Error: Expected a \"%s\" keyword after specifying expression\n", PARSE_KEYWORDS[KEYWORD_IDX_THEN]);
+					basic_parse_error(parse_list, i, "Expected a \"%s\" keyword after specifying expression", PARSE_KEYWORDS[KEYWORD_IDX_THEN]);
 					return -2;
 				}
 			}
@@ -171,7 +289,7 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 					int next_level = level + 1;
 					lprintf("AST", LOGTYPE_DEBUG, "Parse program statements at scope level %d\n", next_level);
 					int next_pos = -1;
-					int ret = basic_parse_to_ast_between_level(parse_list, while_true_node, i, to, next_level, 1, &next_pos);
+					int ret = basic_parse_block_body(parse_list, while_true_node, i, to, next_level, &next_pos);
 					if (ret >= 0 && next_pos >= 0)
 					{
 						// Set token position to the next instruction returned
@@ -179,7 +297,12 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 						// Make sure the While statement doesn't have an Else part
 						if (ret == 2)
 						{
-							lprintf("AST", LOGTYPE_ERROR, "Error: %s clause cannot have an %s statement.\n", PARSE_KEYWORDS[KEYWORD_IDX_WHILE], PARSE_KEYWORDS[KEYWORD_IDX_ELSE]);
+							basic_parse_error(parse_list, i, "%s clause cannot have an %s statement.", PARSE_KEYWORDS[KEYWORD_IDX_WHILE], PARSE_KEYWORDS[KEYWORD_IDX_ELSE]);
+							return -3;
+						}
+						if (ret == 3)
+						{
+							basic_parse_error(parse_list, i, "%s clause must end with \"%s\", not \"%s\"", PARSE_KEYWORDS[KEYWORD_IDX_WHILE], PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_NEXT]);
 							return -3;
 						}
 					}
@@ -191,10 +314,245 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 				}
 				else
 				{
-					lprintf("AST", LOGTYPE_ERROR, "Error: Expected a \"%s\" keyword after specifying expression\n", PARSE_KEYWORDS[KEYWORD_IDX_THEN]);
+					basic_parse_error(parse_list, i, "Expected a \"%s\" keyword after specifying expression", PARSE_KEYWORDS[KEYWORD_IDX_THEN]);
 					return -2;
 				}
 			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_FOR]) == 0)
+			{
+				// "FOR" loop. Has the assignment of the start value to the loop variable, the end value, the step
+				// and a program sequence to execute for each value, till "NEXT"
+				int for_at = i;
+				ASTNode *for_node = ast_create_node();
+				for_node->type = AST_KEYWORD;
+				for_node->data.token_type = DTYPE_SYMB;
+				strcpy(for_node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
+				ast_append_child(root, for_node);
+
+				i++;
+				lprintf("AST", LOGTYPE_DEBUG, "Parse %s loop variable assignment\n", PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
+				cb_ret = basic_parse_form_expression(parse_list, for_node, i, to, &i);
+				if (cb_ret != 0)
+					return cb_ret;
+
+				// The assignment must be just "variable = start"
+				ASTNode *assignment = for_node->child;
+				if (assignment != NULL && assignment->next == NULL)
+					assignment = ast_unwrap_expression(assignment);
+				if (assignment == NULL || assignment->next != NULL || assignment->type != AST_OPERATION || assignment->data.token.op != OP_ASSIGN || assignment->child == NULL || ast_unwrap_expression(assignment->child)->type != AST_VARIABLE)
+				{
+					basic_parse_error(parse_list, for_at, "Expected a variable and its start value after \"%s\", such as \"%s i = 1 %s 10\"", PARSE_KEYWORDS[KEYWORD_IDX_FOR], PARSE_KEYWORDS[KEYWORD_IDX_FOR], PARSE_KEYWORDS[KEYWORD_IDX_TO]);
+					return -1;
+				}
+				char *loop_variable = ast_unwrap_expression(assignment->child)->data.token.variable_name;
+
+				basic_token_seek_immediate(parse_list, &i, to);
+				if (i >= to || basic_token_keyword_index(&parse_list->tokens[i]) != KEYWORD_IDX_TO)
+				{
+					basic_parse_error(parse_list, i, "Expected a \"%s\" keyword after the start value of the %s loop", PARSE_KEYWORDS[KEYWORD_IDX_TO], PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
+					return -2;
+				}
+				i++;
+				cb_ret = basic_parse_form_expression(parse_list, for_node, i, to, &i);
+				if (cb_ret != 0)
+					return cb_ret;
+
+				// Optional "STEP", which is 1 if not given
+				int step_at = i;
+				basic_token_seek_immediate(parse_list, &step_at, to);
+				if (step_at < to && basic_token_keyword_index(&parse_list->tokens[step_at]) == KEYWORD_IDX_STEP)
+				{
+					i = step_at + 1;
+					cb_ret = basic_parse_form_expression(parse_list, for_node, i, to, &i);
+					if (cb_ret != 0)
+						return cb_ret;
+				}
+				else
+				{
+					ASTNode *step_node = ast_create_node();
+					step_node->type = AST_IMMEDIATE;
+					step_node->data.token_type = DTYPE_NUM;
+					step_node->data.token.literal.num = 1;
+					ast_append_child(for_node, step_node);
+				}
+
+				ASTNode *for_body_node = ast_create_node();
+				for_body_node->type = AST_PROGRAM_SEQUENCE;
+				for_body_node->data = ASTVOID;
+				ast_append_child(for_node, for_body_node);
+
+				int next_level = level + 1;
+				lprintf("AST", LOGTYPE_DEBUG, "Parse program statements at scope level %d\n", next_level);
+				int next_pos = -1;
+				int ret = basic_parse_block_body(parse_list, for_body_node, i, to, next_level, &next_pos);
+				if (ret < 0 || next_pos < 0)
+				{
+					lprintf("AST", LOGTYPE_ERROR, "An error (code %d) occurred while parsing %s loop\n", ret, PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
+					return ret;
+				}
+				i = next_pos;
+				if (ret != 3)
+				{
+					basic_parse_error(parse_list, i, "%s loop must end with \"%s\", not \"%s\"", PARSE_KEYWORDS[KEYWORD_IDX_FOR], PARSE_KEYWORDS[KEYWORD_IDX_NEXT], parse_list->tokens[i].token);
+					return -3;
+				}
+
+				// "NEXT" may repeat the loop variable, which must then be the one of this loop
+				int name_at = i + 1;
+				while (name_at < to && parse_list->tokens[name_at].token_type == TOKEN_WHITESPACE && (parse_list->tokens[name_at].token[0] == ' ' || parse_list->tokens[name_at].token[0] == '\t'))
+					name_at++;
+				if (name_at < to && parse_list->tokens[name_at].token_type == TOKEN_IDENTIFIER)
+				{
+					if (strcmp(parse_list->tokens[name_at].token, loop_variable) != 0)
+					{
+						basic_parse_error(parse_list, name_at, "\"%s %s\" does not match \"%s %s\"", PARSE_KEYWORDS[KEYWORD_IDX_NEXT], parse_list->tokens[name_at].token, PARSE_KEYWORDS[KEYWORD_IDX_FOR], loop_variable);
+						return -3;
+					}
+					i = name_at;
+				}
+			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_DIM]) == 0)
+			{
+				// "DIM" statement. Has the array name with its upper bounds, written like a function call
+				int dim_at = i;
+				ASTNode *dim_node = ast_create_node();
+				dim_node->type = AST_KEYWORD;
+				dim_node->data.token_type = DTYPE_SYMB;
+				strcpy(dim_node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_DIM]);
+				ast_append_child(root, dim_node);
+
+				i++;
+				lprintf("AST", LOGTYPE_DEBUG, "Parse %s array declaration\n", PARSE_KEYWORDS[KEYWORD_IDX_DIM]);
+				cb_ret = basic_parse_form_expression(parse_list, dim_node, i, to, &i);
+				if (cb_ret != 0)
+					return cb_ret;
+
+				// The expression must be just "name(bounds...)"
+				ASTNode *declaration = dim_node->child;
+				if (declaration != NULL && declaration->next == NULL)
+					declaration = ast_unwrap_expression(declaration);
+				if (declaration == NULL || declaration->next != NULL || declaration->type != AST_FUNC_CALL || declaration->child == NULL)
+				{
+					basic_parse_error(parse_list, dim_at, "Expected an array name and its size after \"%s\", such as \"%s a(10)\"", PARSE_KEYWORDS[KEYWORD_IDX_DIM], PARSE_KEYWORDS[KEYWORD_IDX_DIM]);
+					return -1;
+				}
+			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]) == 0)
+			{
+				// "FUNCTION" definition. Has the function name with its parameters, written like a call, and a body till "END"
+				int function_at = i;
+				if (level > 0 || !allow_keyword || parse_list->scope != PARSE_SCOPE_PROGRAM)
+				{
+					basic_parse_error(parse_list, i, "%s can only be defined at the top level of the program", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+					return -1;
+				}
+				ASTNode *function_node = ast_create_node();
+				function_node->type = AST_KEYWORD;
+				function_node->data.token_type = DTYPE_SYMB;
+				strcpy(function_node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+				ast_append_child(root, function_node);
+
+				i++;
+				lprintf("AST", LOGTYPE_DEBUG, "Parse %s declaration\n", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+				cb_ret = basic_parse_form_expression(parse_list, function_node, i, to, &i);
+				if (cb_ret != 0)
+					return cb_ret;
+
+				// The expression must be just "name(parameters...)"
+				ASTNode *declaration = function_node->child;
+				if (declaration != NULL && declaration->next == NULL)
+					declaration = ast_unwrap_expression(declaration);
+				if (declaration == NULL || declaration->next != NULL || declaration->type != AST_FUNC_CALL)
+				{
+					basic_parse_error(parse_list, function_at, "Expected a function name and its parameters after \"%s\", such as \"%s f(x)\"", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+					return -1;
+				}
+				if (basic_decode_function(declaration->data.token.kw) != NULL)
+				{
+					basic_parse_error(parse_list, function_at, "%s is a built-in function and can't be redefined", declaration->data.token.kw);
+					return -1;
+				}
+
+				// The body is parsed right away even in lazy mode, as its local variables are all found before it runs
+				ASTNode *body_node = ast_create_node();
+				body_node->type = AST_PROGRAM_SEQUENCE;
+				body_node->data = ASTVOID;
+				ast_append_child(function_node, body_node);
+
+				BASICParseScope scope = parse_list->scope;
+				int lazy_bodies = parse_list->lazy_bodies;
+				parse_list->scope = PARSE_SCOPE_FUNCTION;
+				parse_list->lazy_bodies = 0;
+				int next_pos = -1;
+				int ret = basic_parse_to_ast_between_level(parse_list, body_node, i, to, level + 1, 1, &next_pos);
+				parse_list->scope = scope;
+				parse_list->lazy_bodies = lazy_bodies;
+				if (ret < 0 || next_pos < 0)
+				{
+					lprintf("AST", LOGTYPE_ERROR, "An error (code %d) occurred while parsing %s %s\n", ret, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], declaration->data.token.kw);
+					return ret;
+				}
+				i = next_pos;
+				if (ret == 2 || ret == 3)
+				{
+					basic_parse_error(parse_list, i, "Found an unexpected \"%s\" in %s %s", parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], declaration->data.token.kw);
+					return -3;
+				}
+
+				ret = basic_parse_assign_slots(parse_list, function_node, function_at);
+				if (ret != 0)
+					return ret;
+			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_RETURN]) == 0)
+			{
+				// "RETURN" statement, with an optional value for the caller
+				if (parse_list->scope != PARSE_SCOPE_FUNCTION)
+				{
+					basic_parse_error(parse_list, i, "Found \"%s\" outside of a %s", PARSE_KEYWORDS[KEYWORD_IDX_RETURN], PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+					return -1;
+				}
+				ASTNode *return_node = ast_create_node();
+				return_node->type = AST_KEYWORD;
+				return_node->data.token_type = DTYPE_SYMB;
+				strcpy(return_node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_RETURN]);
+				ast_append_child(root, return_node);
+
+				// The value is on the same line, before any ";" or END
+				int value_at = i + 1;
+				while (value_at < to && parse_list->tokens[value_at].token_type == TOKEN_WHITESPACE && parse_list->tokens[value_at].token[0] != '\n' && parse_list->tokens[value_at].token[0] != ';')
+					value_at++;
+				if (value_at < to && parse_list->tokens[value_at].token_type != TOKEN_WHITESPACE && parse_list->tokens[value_at].token_type != TOKEN_KEYWORD && parse_list->tokens[value_at].token_type != TOKEN_END)
+				{
+					lprintf("AST", LOGTYPE_DEBUG, "Parse %s value expression\n", PARSE_KEYWORDS[KEYWORD_IDX_RETURN]);
+					cb_ret = basic_parse_form_expression(parse_list, return_node, value_at, to, &i);
+					if (cb_ret != 0)
+						return cb_ret;
+				}
+			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_GOTO]) == 0)
+			{
+				// "GOTO" statement, with the line number to jump to on the same line
+				int line_at = i + 1;
+				while (line_at < to && parse_list->tokens[line_at].token_type == TOKEN_WHITESPACE && parse_list->tokens[line_at].token[0] != '\n')
+					line_at++;
+				if (line_at >= to || !basic_parse_is_line_number(parse_list, line_at))
+				{
+					basic_parse_error(parse_list, i, "Expected a line number after \"%s\", such as \"%s 10\"", PARSE_KEYWORDS[KEYWORD_IDX_GOTO], PARSE_KEYWORDS[KEYWORD_IDX_GOTO]);
+					return -1;
+				}
+				ASTNode *goto_node = ast_create_node();
+				goto_node->type = AST_KEYWORD;
+				goto_node->data.token_type = DTYPE_SYMB;
+				strcpy(goto_node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_GOTO]);
+				ast_append_child(root, goto_node);
+
+				ASTNode *line_node = ast_create_node();
+				line_node->type = AST_IMMEDIATE;
+				line_node->data.token_type = DTYPE_NUM;
+				line_node->data.token.literal.num = atoi(parse_list->tokens[line_at].token);
+				ast_append_child(goto_node, line_node);
+				i = line_at;
+			}
 			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_ELSE]) == 0)
 			{
 				// Else clause for a matching IF clause
@@ -208,7 +566,23 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 				}
 				else
 				{
-					lprintf("AST", LOGTYPE_ERROR, "Error: Found an unexpected \"%s\" without corresponding %s clause\n", PARSE_KEYWORDS[KEYWORD_IDX_ELSE], PARSE_KEYWORDS[KEYWORD_IDX_IF]);
+					basic_parse_error(parse_list, i, "Found an unexpected \"%s\" without corresponding %s clause", PARSE_KEYWORDS[KEYWORD_IDX_ELSE], PARSE_KEYWORDS[KEYWORD_IDX_IF]);
+					return -1;
+				}
+			}
+			else if (strcasecmp(parse_list->tokens[i].token, PARSE_KEYWORDS[KEYWORD_IDX_NEXT]) == 0)
+			{
+				// "NEXT" keyword, the end of a FOR loop body
+				if (level > 0)
+				{
+					lprintf("AST", LOGTYPE_DEBUG, "End of program statements at scope level %d\n", level);
+					*next_ptr = i;
+					// Return 3 so the FOR loop knows its body ended with NEXT
+					return 3;
+				}
+				else
+				{
+					basic_parse_error(parse_list, i, "Found an unexpected \"%s\" without corresponding %s loop", PARSE_KEYWORDS[KEYWORD_IDX_NEXT], PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
 					return -1;
 				}
 			}
@@ -227,7 +601,7 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 				}
 				else
 				{
-					lprintf("AST", LOGTYPE_ERROR, "Error: Found an unexpected \"%s\" without corresponding %s/%s/%s clause\n", PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_ELSE], PARSE_KEYWORDS[KEYWORD_IDX_WHILE]);
+					basic_parse_error(parse_list, i, "Found an unexpected \"%s\" without corresponding %s/%s/%s clause", PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_ELSE], PARSE_KEYWORDS[KEYWORD_IDX_WHILE]);
 					return -1;
 				}
 			}
@@ -238,7 +612,7 @@ int basic_parse_to_ast_between_level(BASICTokenParseList *parse_list, ASTNode *r
 
 	if (level > 0)
 	{
-		lprintf("AST", LOGTYPE_ERROR, "Error: End of program reached inside %s/%s clause, without encountering \"%s\"\n", PARSE_KEYWORDS[KEYWORD_IDX_IF], PARSE_KEYWORDS[KEYWORD_IDX_WHILE], PARSE_KEYWORDS[KEYWORD_IDX_END]);
+		basic_parse_error(parse_list, to, "End of program reached inside a block, without encountering the \"%s\" or \"%s\" that ends it", PARSE_KEYWORDS[KEYWORD_IDX_END], PARSE_KEYWORDS[KEYWORD_IDX_NEXT]);
 		return -2;
 	}
 
@@ -258,6 +632,223 @@ int basic_parse_to_ast(BASICProgram *program)
 	return ret_code;
 }
 
+// Parses the statements of a deferred block body, which then becomes a normal program sequence
+int basic_parse_deferred(BASICTokenParseList *parse_list, ASTNode *body)
+{
+	if (body->type != AST_DEFERRED_SEQUENCE)
+		return 0;
+
+	int from = body->data.token.token_range.from, to = body->data.token.token_range.to;
+	lprintf("AST", LOGTYPE_DEBUG, "Parsing deferred program statements between tokens %d and %d\n", from, to);
+	// The range stops before the ELSE/END of the block, so it is parsed like a whole program, but not at its top
+	BASICParseScope scope = parse_list->scope;
+	parse_list->scope = PARSE_SCOPE_BLOCK;
+	int ret_code = basic_parse_to_ast_between(parse_list, body, from, to);
+	parse_list->scope = scope;
+	if (ret_code != 0)
+	{
+		ast_delete_children_cascade(body);
+		body->child = NULL;
+		return ret_code;
+	}
+
+	body->type = AST_PROGRAM_SEQUENCE;
+	body->data = ASTVOID;
+	return 0;
+}
+
+// Parses all deferred block bodies in the node list and below it
+int basic_parse_deferred_all(BASICTokenParseList *parse_list, ASTNode *node)
+{
+	for (; node != NULL; node = node->next)
+	{
+		int ret_code = basic_parse_deferred(parse_list, node);
+		if (ret_code == 0)
+			ret_code = basic_parse_deferred_all(parse_list, node->child);
+		if (ret_code != 0)
+			return ret_code;
+	}
+	return 0;
+}
+
+int basic_parse_validate(BASICProgram *program)
+{
+	return basic_parse_deferred_all(&(program->program_tokens), program->program_sequence);
+}
+
+/* Static types */
+
+// Type that every value of the node has, known from the program text: a literal, a variable with a type suffix,
+// or an operation marked by basic_parse_type_operation. DTYPE_NONE if it is only known when the node runs
+ASTDType basic_parse_static_type(ASTNode *node)
+{
+	switch (node->type)
+	{
+	case AST_IMMEDIATE:
+		return node->data.token_type;
+	case AST_VARIABLE:
+		return basic_name_type(node->data.token.variable_name);
+	case AST_EXPRESSION:
+	case AST_CONDITION:
+		return node->child == NULL ? DTYPE_NONE : basic_parse_static_type(node->child);
+	case AST_OPERATION:
+		if (node->data.token_type != DTYPE_NUM && node->data.token_type != DTYPE_FLT)
+			return DTYPE_NONE;
+		// Comparisons give 0 or 1 whatever they compare
+		if (node->data.token.op == OP_EQ || node->data.token.op == OP_LT || node->data.token.op == OP_GT)
+			return DTYPE_NUM;
+		return node->data.token_type;
+	default:
+		return DTYPE_NONE;
+	}
+}
+
+// An operation whose operands are both integers or both floats from the program text is marked with that type,
+// which the runner then computes without checking the operands. Others, and assignments, keep DTYPE_SYMB
+void basic_parse_type_operation(ASTNode *operation)
+{
+	ASTOperator op = operation->data.token.op;
+	if (op == OP_ASSIGN || operation->child == NULL || operation->child->next == NULL)
+		return;
+	ASTDType type = basic_parse_static_type(operation->child);
+	if (type != basic_parse_static_type(operation->child->next))
+		return;
+	// Floats have no remainder, which stays an error when it runs
+	if (type == DTYPE_NUM || (type == DTYPE_FLT && op != OP_MOD))
+		operation->data.token_type = type;
+}
+
+/* Line numbers */
+
+// Whole number without a sign, which can be a line number
+int basic_parse_is_line_number(BASICTokenParseList *parse_list, int idx)
+{
+	BASICToken *token = &parse_list->tokens[idx];
+	return token->token_type == TOKEN_NUM && isdigit(token->token[0]) && !string_is_float(token->token);
+}
+
+// A line number is a whole number at the start of a line, followed by a statement on the same line.
+// A number alone on its line stays an expression, so the REPL still shows its value
+int basic_parse_is_line_label(BASICTokenParseList *parse_list, int idx, int to)
+{
+	if (!basic_parse_is_line_number(parse_list, idx))
+		return 0;
+
+	for (int i = idx - 1; i >= 0 && parse_list->tokens[i].token[0] != '\n'; i--)
+		if (parse_list->tokens[i].token_type != TOKEN_WHITESPACE)
+			return 0;
+
+	int statement_at = idx + 1;
+	while (statement_at < to && parse_list->tokens[statement_at].token_type == TOKEN_WHITESPACE && parse_list->tokens[statement_at].token[0] != '\n')
+		statement_at++;
+	return statement_at < to && (parse_list->tokens[statement_at].token_type == TOKEN_IDENTIFIER || parse_list->tokens[statement_at].token_type == TOKEN_KEYWORD);
+}
+
+/* Local variables of user-defined functions */
+
+// Names of the local variables of the function being parsed, in slot order
+typedef struct
+{
+	char **names;
+	int count;
+	int capacity;
+} BASICLocalNames;
+
+int basic_parse_find_local(BASICLocalNames *locals, const char *name)
+{
+	for (int i = 0; i < locals->count; i++)
+		if (strcmp(locals->names[i], name) == 0)
+			return i;
+	return -1;
+}
+
+int basic_parse_add_local(BASICLocalNames *locals, char *name)
+{
+	if (locals->count == locals->capacity)
+	{
+		int capacity = locals->capacity == 0 ? 8 : locals->capacity * 2;
+		char **names = (char **)realloc(locals->names, sizeof(char *) * capacity);
+		if (names == NULL)
+			return 1;
+		locals->names = names;
+		locals->capacity = capacity;
+	}
+	locals->names[locals->count++] = name;
+	return 0;
+}
+
+// Every variable assigned anywhere in the body is local to the function
+int basic_parse_collect_locals(ASTNode *node, BASICLocalNames *locals)
+{
+	for (; node != NULL; node = node->next)
+	{
+		if (node->type == AST_OPERATION && node->data.token.op == OP_ASSIGN && node->child != NULL)
+		{
+			ASTNode *target = ast_unwrap_expression(node->child);
+			if (target->type == AST_VARIABLE && basic_parse_find_local(locals, target->data.token.variable_name) < 0 && basic_parse_add_local(locals, target->data.token.variable_name) != 0)
+				return 1;
+		}
+		if (basic_parse_collect_locals(node->child, locals) != 0)
+			return 1;
+	}
+	return 0;
+}
+
+// Gives each use of a local variable, or of a local array/dictionary, the slot of that variable
+void basic_parse_resolve_locals(ASTNode *node, BASICLocalNames *locals)
+{
+	for (; node != NULL; node = node->next)
+	{
+		if (node->type == AST_VARIABLE)
+			node->slot = basic_parse_find_local(locals, node->data.token.variable_name);
+		else if (node->type == AST_FUNC_CALL)
+			node->slot = basic_parse_find_local(locals, node->data.token.kw);
+		basic_parse_resolve_locals(node->child, locals);
+	}
+}
+
+// Numbers the parameters and local variables of a FUNCTION, which are then kept in slots of its call frame
+// instead of being looked up by name. Parameters come first, in order. Other variables are global
+int basic_parse_assign_slots(BASICTokenParseList *parse_list, ASTNode *function_node, int token_idx)
+{
+	ASTNode *declaration = ast_unwrap_expression(function_node->child);
+	ASTNode *body = function_node->child->next;
+	BASICLocalNames locals = {NULL, 0, 0};
+	int ret_code = 0;
+
+	for (ASTNode *param = declaration->child; param != NULL && ret_code == 0; param = param->next)
+	{
+		ASTNode *name = ast_unwrap_expression(param);
+		if (name->type != AST_VARIABLE)
+		{
+			basic_parse_error(parse_list, token_idx, "Parameters of %s %s must be variable names", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], declaration->data.token.kw);
+			ret_code = -1;
+		}
+		else if (basic_parse_find_local(&locals, name->data.token.variable_name) >= 0)
+		{
+			basic_parse_error(parse_list, token_idx, "Parameter %s of %s %s is given more than once", name->data.token.variable_name, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], declaration->data.token.kw);
+			ret_code = -1;
+		}
+		else if (basic_parse_add_local(&locals, name->data.token.variable_name) != 0)
+			ret_code = -1;
+	}
+
+	if (ret_code == 0 && basic_parse_collect_locals(body->child, &locals) != 0)
+		ret_code = -1;
+	if (ret_code == 0)
+	{
+		basic_parse_resolve_locals(declaration->child, &locals);
+		basic_parse_resolve_locals(body->child, &locals);
+		function_node->slot = locals.count;
+		lprintf("AST", LOGTYPE_DEBUG, "%s %s has %d local variable(s)\n", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], declaration->data.token.kw, locals.count);
+	}
+	else if (parse_list->error_at == NULL)
+		basic_parse_error(parse_list, token_idx, "Failed to allocate memory for the local variables of %s", declaration->data.token.kw);
+
+	free(locals.names);
+	return ret_code;
+}
+
 void basic_parse_pushtok(StackNode **top, ASTNode *tok)
 {
 	StackNode *opr_tok = stack_create_node();
@@ -293,7 +884,7 @@ ASTNode *basic_parse_dequeuetok(Queue *queue)
 	return p_tok;
 }
 
-int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
+int basic_expr_make_tree(BASICTokenParseList *parse_list, int expr_start, Queue *infix_queue, ASTNode *root)
 {
 	// Pull elements from the infix expression and convert it to a tree
 	StackNode *operator_stack = NULL, *operand_stack = NULL;
@@ -353,6 +944,13 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 		}
 	}
 
+	// An opening bracket that was never closed is left on the stack
+	if (operator_stack != NULL)
+	{
+		basic_parse_error(parse_list, expr_start, "Unexpectedly found unpaired parenthesis in expression");
+		return 1;
+	}
+
 	// Convert postfix expression to a tree
 	while ((nxttok = basic_parse_dequeuetok(&postfix_queue)) != NULL)
 	{
@@ -361,7 +959,7 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 			// Final sequence should not contain any parenthesis
 			if (nxttok->data.token.op == OP_OPEN_PAREN || nxttok->data.token.op == OP_CLOSE_PAREN)
 			{
-				lprintf("AST", LOGTYPE_ERROR, "Error: Unexpectedly found unpaired parenthesis in expression\n");
+				basic_parse_error(parse_list, expr_start, "Unexpectedly found unpaired parenthesis in expression");
 				return 1;
 			}
 			else
@@ -373,7 +971,7 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 					op1 = basic_parse_poptok(&operand_stack);
 					if (op1 == NULL)
 					{
-						lprintf("AST", LOGTYPE_ERROR, "Error: Operator expected 1 operand, but none found\n");
+						basic_parse_error(parse_list, expr_start, "Operator expected 1 operand, but none found");
 						return 1;
 					}
 
@@ -390,12 +988,12 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 					op2 = basic_parse_poptok(&operand_stack);
 					if (op1 == NULL)
 					{
-						lprintf("AST", LOGTYPE_ERROR, "Error: Operator expected 2 operands, but none found\n");
+						basic_parse_error(parse_list, expr_start, "Operator expected 2 operands, but none found");
 						return 1;
 					}
 					if (op2 == NULL)
 					{
-						lprintf("AST", LOGTYPE_ERROR, "Error: Operator expected 2 operands, but 1 found\n");
+						basic_parse_error(parse_list, expr_start, "Operator expected 2 operands, but 1 found");
 						return 1;
 					}
 
@@ -403,6 +1001,7 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 					// Since these were in the stack, they are in opposite order
 					ast_append_child(nxttok, op2);
 					ast_append_child(nxttok, op1);
+					basic_parse_type_operation(nxttok);
 
 					// Push back this operator
 					basic_parse_pushtok(&operand_stack, nxttok);
@@ -416,7 +1015,7 @@ int basic_expr_make_tree(Queue *infix_queue, ASTNode *root)
 	poptok = basic_parse_poptok(&operand_stack);
 	if (poptok == NULL)
 	{
-		lprintf("AST", LOGTYPE_ERROR, "Error evaluating the expression: Too many outputs in stack\n");
+		basic_parse_error(parse_list, expr_start, "Could not evaluate the expression: Too many outputs in stack");
 		return 1;
 	}
 
@@ -535,7 +1134,8 @@ int basic_parse_form_expression(BASICTokenParseList *parse_list, ASTNode *root,
 				operator_node->type = AST_EXPRESSION;
 				operator_node->data.token_type = DTYPE_SYMB;
 				operator_node->data = ASTVOID;
-				basic_parse_form_function(parse_list, operator_node, *parser_idx, parse_to, parser_idx);
+				if (basic_parse_form_function(parse_list, operator_node, *parser_idx, parse_to, parser_idx) != 0)
+					return 1;
 			}
 			else
 			{
@@ -547,14 +1147,19 @@ int basic_parse_form_expression(BASICTokenParseList *parse_list, ASTNode *root,
 			break;
 
 		case TOKEN_KEYWORD:
-			if (strcasecmp(expr[*parser_idx].token, PARSE_KEYWORDS[KEYWORD_IDX_THEN]) == 0 || strcasecmp(expr[*parser_idx].token, PARSE_KEYWORDS[KEYWORD_IDX_END]) == 0)
+			switch (basic_token_keyword_index(&expr[*parser_idx]))
 			{
+			case KEYWORD_IDX_THEN:
+			case KEYWORD_IDX_END:
+			case KEYWORD_IDX_TO:
+			case KEYWORD_IDX_STEP:
+			case KEYWORD_IDX_NEXT:
 				lprintf("AST", LOGTYPE_DEBUG, "Parse expression termination identifier '%s'\n", expr[*parser_idx].token);
 				// goto, yuck! But it's needed to break from the for loop
 				goto ast_expr_done;
 			}
 
-			lprintf("AST", LOGTYPE_ERROR, "Error: Unexpected keyword '%s' found in expression.\n", expr[*parser_idx].token);
+			basic_parse_error(parse_list, *parser_idx, "Unexpected keyword '%s' found in expression.", expr[*parser_idx].token);
 			return 1;
 
 		case TOKEN_WHITESPACE:
@@ -579,9 +1184,7 @@ int basic_parse_form_expression(BASICTokenParseList *parse_list, ASTNode *root,
 	}
 
 ast_expr_done:
-	basic_expr_make_tree(&infix_queue, root);
-
-	return 0;
+	return basic_expr_make_tree(parse_list, parse_from, &infix_queue, root);
 }
 
 int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, int parse_from, int parse_to, int *parse_new_pos)
@@ -593,6 +1196,7 @@ int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, in
 	// Create a node to call a function
 	ASTNode *fn_call_node = ast_create_node();
 	fn_call_node->type = AST_FUNC_CALL;
+	fn_call_node->data.token_type = DTYPE_SYMB;
 	strcpy(fn_call_node->data.token.kw, func[*parse_new_pos].token);
 	ast_append_child(root, fn_call_node);
 
@@ -615,7 +1219,8 @@ int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, in
 					arg_end = *parse_new_pos;
 					lprintf("AST", LOGTYPE_DEBUG, "Function argument parse:\n");
 					lprintf("AST", LOGTYPE_DEBUG, "Trying to find expression between tokens %d and %d\n", arg_start, arg_end);
-					basic_parse_to_ast_between_onlyexpr(parse_list, fn_call_node, arg_start, arg_end);
+					if (basic_parse_to_ast_between_onlyexpr(parse_list, fn_call_node, arg_start, arg_end) != 0)
+						return -1;
 					lprintf("AST", LOGTYPE_DEBUG, "End of function call \"%s\"\n", fn_call_node->data.token.kw);
 					break;
 				}
@@ -627,7 +1232,8 @@ int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, in
 					arg_end = *parse_new_pos;
 					lprintf("AST", LOGTYPE_DEBUG, "Function argument parse:\n");
 					lprintf("AST", LOGTYPE_DEBUG, "Trying to find expression between tokens %d and %d\n", arg_start, arg_end);
-					basic_parse_to_ast_between_onlyexpr(parse_list, fn_call_node, arg_start, arg_end);
+					if (basic_parse_to_ast_between_onlyexpr(parse_list, fn_call_node, arg_start, arg_end) != 0)
+						return -1;
 					arg_start = (*parse_new_pos) + 1;
 					lprintf("AST", LOGTYPE_DEBUG, "Function argument parse done\n");
 				}
@@ -638,7 +1244,7 @@ int basic_parse_form_function(BASICTokenParseList *parse_list, ASTNode *root, in
 
 	if (arg_end == -1)
 	{
-		lprintf("AST", LOGTYPE_ERROR, "Error: Function argument list expected to end, but no ending ')' found\n");
+		basic_parse_error(parse_list, parse_from, "Function argument list expected to end, but no ending ')' found");
 		return -1;
 	}
 
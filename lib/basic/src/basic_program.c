@@ -3,6 +3,7 @@
 // Standard libraries
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 BASICProgram *basic_create_program()
 {
@@ -26,6 +27,11 @@ BASICProgram *basic_create_program()
 	program->program_source = NULL;
 	program->program_tokens.tokens = NULL;
 	program->program_tokens.tokens_length = 0;
+	program->program_tokens.tokens_capacity = 0;
+	program->program_tokens.lazy_bodies = 0;
+	program->program_tokens.scope = PARSE_SCOPE_PROGRAM;
+	program->program_tokens.error_at = NULL;
+	program->program_tokens.error_message[0] = '\0';
 	return program;
 }
 
@@ -49,3 +55,103 @@ void basic_destroy_program(BASICProgram *program)
 	// Finally delete the program object
 	free(program);
 }
+
+/* Compiled program serialization */
+
+// Counts the given node, its siblings and all of their children
+int basic_flat_count_nodes(ASTNode *node)
+{
+	int count = 0;
+	for (; node != NULL; node = node->next)
+		count += 1 + basic_flat_count_nodes(node->child);
+	return count;
+}
+
+// Writes the node and its siblings into the array starting at *pos. Returns index of the first node written
+int basic_flat_write_nodes(ASTNode *node, BASICFlatNode *nodes, int *pos)
+{
+	int first = -1, prev = -1;
+	for (; node != NULL; node = node->next)
+	{
+		int idx = (*pos)++;
+		nodes[idx].type = node->type;
+		nodes[idx].data = node->data;
+		nodes[idx].next = -1;
+		nodes[idx].slot = node->slot;
+		nodes[idx].child = basic_flat_write_nodes(node->child, nodes, pos);
+		if (prev >= 0)
+			nodes[prev].next = idx;
+		else
+			first = idx;
+		prev = idx;
+	}
+	return first;
+}
+
+// Builds the sibling list starting at flat node 'idx' and returns its first node
+ASTNode *basic_flat_read_nodes(const BASICFlatNode *nodes, int node_count, int idx)
+{
+	ASTNode *first = NULL, *prev = NULL;
+	for (; idx >= 0 && idx < node_count; idx = nodes[idx].next)
+	{
+		ASTNode *node = ast_create_node();
+		if (node == NULL)
+			break;
+		node->type = nodes[idx].type;
+		node->data = nodes[idx].data;
+		node->slot = nodes[idx].slot;
+		node->child = basic_flat_read_nodes(nodes, node_count, nodes[idx].child);
+		if (prev != NULL)
+			prev->next = node;
+		else
+			first = node;
+		prev = node;
+	}
+	return first;
+}
+
+// Serializes the program sequence into a single position-independent memory block.
+// The block is allocated with malloc() and must be freed by the caller
+void *basic_program_flatten(BASICProgram *program, size_t *flat_size)
+{
+	// A flattened program has no tokens, so block bodies can't be parsed later
+	if (basic_parse_validate(program) != 0)
+		return NULL;
+
+	int node_count = basic_flat_count_nodes(program->program_sequence->child);
+	size_t size = sizeof(BASICFlatProgram) + sizeof(BASICFlatNode) * node_count;
+	BASICFlatProgram *flat = (BASICFlatProgram *)malloc(size);
+	if (flat == NULL)
+	{
+		fprintf(stderr, "Failed to allocate %zu bytes to flatten the program\n", size);
+		return NULL;
+	}
+
+	int pos = 0;
+	flat->magic = BASIC_FLAT_PROGRAM_MAGIC;
+	flat->node_count = node_count;
+	basic_flat_write_nodes(program->program_sequence->child, (BASICFlatNode *)(flat + 1), &pos);
+
+	*flat_size = size;
+	return flat;
+}
+
+// Replaces the program sequence with the one stored in a flattened program. Returns 0 on success
+int basic_program_load_flat(BASICProgram *program, const void *flat, size_t flat_size)
+{
+	BASICFlatProgram header;
+	if (flat == NULL || flat_size < sizeof(BASICFlatProgram))
+		return 1;
+
+	// The block may come from shared memory with any alignment, so copy the header out
+	memcpy(&header, flat, sizeof(BASICFlatProgram));
+	if (header.magic != BASIC_FLAT_PROGRAM_MAGIC || header.node_count < 0)
+		return 1;
+	if (flat_size != sizeof(BASICFlatProgram) + sizeof(BASICFlatNode) * header.node_count)
+		return 1;
+
+	basic_clear_program(program);
+	if (header.node_count > 0)
+		program->program_sequence->child = basic_flat_read_nodes((const BASICFlatNode *)((const BASICFlatProgram *)flat + 1), header.node_count, 0);
+	return 0;
+}
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 
 // This code will directly interpret from the abstract syntax tree
 
@@ -26,6 +27,16 @@ BASICVariable *basic_find_variable(BASICRuntime *runtime, char var_name[])
 	return NULL;
 }
 
+// Where the value of the variable named by the node is kept: its slot if it is a local variable of the running
+// function, otherwise the global variable. NULL if there is no such variable. Only valid until the next call
+ASTNodeData *basic_find_value(BASICRuntime *runtime, ASTNode *node)
+{
+	if (node->slot >= 0)
+		return &(runtime->slots[runtime->frames[runtime->call_depth - 1].base + node->slot]);
+	BASICVariable *var = basic_find_variable(runtime, node->type == AST_VARIABLE ? node->data.token.variable_name : node->data.token.kw);
+	return var == NULL ? NULL : &(var->value);
+}
+
 ASTNodeData basic_get_variable(BASICRuntime *runtime, char var_name[])
 {
 	BASICVariable *var;
@@ -42,7 +53,12 @@ void basic_set_variable(BASICRuntime *runtime, char var_name[], ASTNodeData valu
 {
 	BASICVariable *var;
 	int new_size;
-	if ((var = basic_find_variable(runtime, var_name)) == NULL)
+	if (basic_declare_value(runtime, var_name, &value) != 0)
+		return;
+	basic_value_retain(value);
+	if ((var = basic_find_variable(runtime, var_name)) != NULL)
+		basic_value_release(var->value);
+	if (var == NULL)
 	{
 		if (runtime->variables == NULL && runtime->var_count == 0)
 		{
@@ -74,6 +90,23 @@ void basic_set_variable(BASICRuntime *runtime, char var_name[], ASTNodeData valu
 	memcpy(&(var->value), &value, sizeof(ASTNodeData));
 }
 
+// Arrays and dictionaries are shared by every variable they are assigned to
+void basic_value_retain(ASTNodeData value)
+{
+	if (value.token_type == DTYPE_ARRAY)
+		basic_array_retain(value.token.array);
+	else if (value.token_type == DTYPE_DICT)
+		basic_dict_retain(value.token.dict);
+}
+
+void basic_value_release(ASTNodeData value)
+{
+	if (value.token_type == DTYPE_ARRAY)
+		basic_array_release(value.token.array);
+	else if (value.token_type == DTYPE_DICT)
+		basic_dict_release(value.token.dict);
+}
+
 // Return a function pointer to a BASIC function if it exists
 basic_function basic_decode_function(char fn_name[])
 {
@@ -93,10 +126,53 @@ basic_function basic_decode_function(char fn_name[])
 		return basic_fn_rand;
 	if (strcasecmp(fn_name, "irandom") == 0)
 		return basic_fn_irand;
+	if (strcasecmp(fn_name, "seed") == 0)
+		return basic_fn_seed;
+	if (strcasecmp(fn_name, "sum") == 0)
+		return basic_fn_sum;
+	if (strcasecmp(fn_name, "dot") == 0)
+		return basic_fn_dot;
+	if (strcasecmp(fn_name, "scale") == 0)
+		return basic_fn_scale;
+	if (strcasecmp(fn_name, "add") == 0)
+		return basic_fn_add;
+	if (strcasecmp(fn_name, "fill") == 0)
+		return basic_fn_fill;
+	if (strcasecmp(fn_name, "sort") == 0)
+		return basic_fn_sort;
+	if (strcasecmp(fn_name, "dict") == 0)
+		return basic_fn_dict;
+	if (strcasecmp(fn_name, "has") == 0)
+		return basic_fn_has;
+	if (strcasecmp(fn_name, "remove") == 0)
+		return basic_fn_remove;
 
 	return (basic_function)0;
 }
 
+// Halts with the message for an error code of ast_evaluate_binary
+void basic_operation_error(BASICRuntime *runtime, int error)
+{
+	runtime->halt = 1;
+	const char *reason;
+	switch (error)
+	{
+	case 1:
+		reason = "Incompatible datatypes for operands";
+		break;
+	case 2:
+		reason = "Incorrect operand used for binary operation";
+		break;
+	case 3:
+		reason = "Division by zero";
+		break;
+	default:
+		reason = "Unknown error occurred";
+	}
+	// One call, so that the whole message goes to the log writer of the run
+	lprintf("EXEC", LOGTYPE_ERROR, "Error occurred evaluating an expression: %s\n", reason);
+}
+
 ASTNodeData basic_evaluate_operation(BASICRuntime *runtime, ASTNode *expression)
 {
 	ASTOperator op = expression->data.token.op;
@@ -126,25 +202,7 @@ ASTNodeData basic_evaluate_operation(BASICRuntime *runtime, ASTNode *expression)
 			operands[1] = basic_evaluate_node(runtime, operand_ptr->next);
 			int error = ast_evaluate_binary(op, operands[0], operands[1], &result);
 			if (error != 0)
-			{
-				runtime->halt = 1;
-				lprintf("EXEC", LOGTYPE_ERROR, "Error occurred evaluating an expression: ");
-				switch (error)
-				{
-				case 1:
-					printf("Incompatible datatypes for operands");
-					break;
-				case 2:
-					printf("Incorrect operand used for binary operation");
-					break;
-				case 3:
-					printf("Division by zero");
-					break;
-				default:
-					printf("Unknown error occurred");
-				}
-				printf("\n");
-			}
+				basic_operation_error(runtime, error);
 			break;
 		}
 	}
@@ -152,6 +210,164 @@ ASTNodeData basic_evaluate_operation(BASICRuntime *runtime, ASTNode *expression)
 	return result;
 }
 
+/* Typed expressions */
+
+// Nodes with a static type (see basic_parse_static_type) are computed here as plain numbers. Their operands
+// already have the type, so unlike ast_evaluate_binary nothing is checked, except for division by zero
+
+// Value of a variable with a type suffix. Only a variable that was never assigned lacks its type, and the usual
+// read reports that
+ASTNodeData *basic_typed_variable(BASICRuntime *runtime, ASTNode *variable, ASTDType type)
+{
+	ASTNodeData *value = basic_find_value(runtime, variable);
+	if (value != NULL && value->token_type == type)
+		return value;
+	basic_evaluate_node(runtime, variable);
+	runtime->halt = 1;
+	return NULL;
+}
+
+int basic_evaluate_int(BASICRuntime *runtime, ASTNode *node)
+{
+	switch (node->type)
+	{
+	case AST_IMMEDIATE:
+		return node->data.token.literal.num;
+	case AST_VARIABLE:
+	{
+		ASTNodeData *value = basic_typed_variable(runtime, node, DTYPE_NUM);
+		return value == NULL ? 0 : value->token.literal.num;
+	}
+	case AST_EXPRESSION:
+	case AST_CONDITION:
+		return basic_evaluate_int(runtime, node->child);
+	default:
+		break;
+	}
+
+	if (node->data.token_type == DTYPE_FLT)
+	{
+		// Comparison of floats
+		float a = basic_evaluate_flt(runtime, node->child), b = basic_evaluate_flt(runtime, node->child->next);
+		switch (node->data.token.op)
+		{
+		case OP_EQ:
+			return a == b;
+		case OP_LT:
+			return a < b;
+		default:
+			return a > b;
+		}
+	}
+
+	int a = basic_evaluate_int(runtime, node->child), b = basic_evaluate_int(runtime, node->child->next);
+	switch (node->data.token.op)
+	{
+	case OP_ADD:
+		return a + b;
+	case OP_SUB:
+		return a - b;
+	case OP_MUL:
+		return a * b;
+	case OP_DIV:
+	case OP_MOD:
+		if (b == 0)
+		{
+			if (!runtime->halt)
+				basic_operation_error(runtime, 3);
+			return 0;
+		}
+		return node->data.token.op == OP_DIV ? a / b : a % b;
+	case OP_EQ:
+		return a == b;
+	case OP_LT:
+		return a < b;
+	case OP_GT:
+		return a > b;
+	default:
+		return 0;
+	}
+}
+
+float basic_evaluate_flt(BASICRuntime *runtime, ASTNode *node)
+{
+	switch (node->type)
+	{
+	case AST_IMMEDIATE:
+		return node->data.token.literal.flt;
+	case AST_VARIABLE:
+	{
+		ASTNodeData *value = basic_typed_variable(runtime, node, DTYPE_FLT);
+		return value == NULL ? 0.0f : value->token.literal.flt;
+	}
+	case AST_EXPRESSION:
+	case AST_CONDITION:
+		return basic_evaluate_flt(runtime, node->child);
+	default:
+		break;
+	}
+
+	float a = basic_evaluate_flt(runtime, node->child), b = basic_evaluate_flt(runtime, node->child->next);
+	switch (node->data.token.op)
+	{
+	case OP_ADD:
+		return a + b;
+	case OP_SUB:
+		return a - b;
+	case OP_MUL:
+		return a * b;
+	case OP_DIV:
+		if (b == 0)
+		{
+			if (!runtime->halt)
+				basic_operation_error(runtime, 3);
+			return 0.0f;
+		}
+		return a / b;
+	default:
+		return 0.0f;
+	}
+}
+
+// Value of a node whose static type is an integer or a float
+ASTNodeData basic_evaluate_typed(BASICRuntime *runtime, ASTNode *node, ASTDType type)
+{
+	ASTNodeData result;
+	result.token_type = type;
+	if (type == DTYPE_NUM)
+		result.token.literal.num = basic_evaluate_int(runtime, node);
+	else
+		result.token.literal.flt = basic_evaluate_flt(runtime, node);
+	return runtime->halt ? ASTVOID : result;
+}
+
+// Converts a value stored in a variable with a type suffix to the type of the variable. Integers and floats
+// convert to each other. Returns 1 after halting if the value can't have the type
+int basic_declare_value(BASICRuntime *runtime, const char *name, ASTNodeData *value)
+{
+	ASTDType type = basic_name_type(name);
+	if (type == DTYPE_NONE || value->token_type == type)
+		return 0;
+	// Already stopped by an error while finding the value
+	if (runtime->halt)
+		return 1;
+	if (type == DTYPE_NUM && value->token_type == DTYPE_FLT)
+	{
+		value->token.literal.num = ast_data_to_int(*value);
+		value->token_type = DTYPE_NUM;
+		return 0;
+	}
+	if (type == DTYPE_FLT && value->token_type == DTYPE_NUM)
+	{
+		value->token.literal.flt = ast_data_to_flt(*value);
+		value->token_type = DTYPE_FLT;
+		return 0;
+	}
+	lprintf("EXEC", LOGTYPE_ERROR, "Error: Variable %s can only hold %s\n", name, type == DTYPE_NUM ? "integers" : (type == DTYPE_FLT ? "floats" : "strings"));
+	runtime->halt = 1;
+	return 1;
+}
+
 /* Public functions */
 
 ASTNodeData basic_evaluate_node(BASICRuntime *runtime, ASTNode *node)
@@ -164,19 +380,45 @@ ASTNodeData basic_evaluate_node(BASICRuntime *runtime, ASTNode *node)
 	case AST_IMMEDIATE:
 		return node->data;
 	case AST_VARIABLE:
+		if (node->slot >= 0)
+			return basic_get_local(runtime, node);
 		return basic_get_variable(runtime, node->data.token.variable_name);
+	case AST_USER_CALL:
+		return basic_call_function(runtime, node);
 	case AST_FUNC_CALL:
 	{
-		basic_function fn_call = basic_decode_function(node->data.token.kw);
+		// Local arrays and dictionaries hide functions with the same name
+		basic_function fn_call = node->slot >= 0 ? NULL : basic_decode_function(node->data.token.kw);
 		if (fn_call == NULL)
 		{
+			int function = node->slot >= 0 ? -1 : basic_find_function(runtime, node->data.token.kw);
+			if (function >= 0)
+			{
+				// Later runs of this call go straight to the function
+				node->type = AST_USER_CALL;
+				node->slot = function;
+				return basic_call_function(runtime, node);
+			}
+
+			// Not a function, but it may be an array or dictionary element
+			ASTNodeData *value = basic_find_value(runtime, node);
+			if (value != NULL && value->token_type == DTYPE_ARRAY)
+				return basic_get_array_element(runtime, node);
+			if (value != NULL && value->token_type == DTYPE_DICT)
+				return basic_get_dict_element(runtime, node);
 			lprintf("EXEC", LOGTYPE_DEBUG, "Unknown function %s tried to be called\n", node->data.token.kw);
 			return ASTVOID;
 		}
 		return fn_call(runtime, node->child);
 	}
 	case AST_OPERATION:
+	{
+		// Marked by the parser if its operands have a static type
+		ASTDType type = node->data.token_type;
+		if (type == DTYPE_NUM || type == DTYPE_FLT)
+			return basic_evaluate_typed(runtime, node, basic_parse_static_type(node));
 		return basic_evaluate_operation(runtime, node);
+	}
 	case AST_EXPRESSION:
 		// Expression within an expression requires another node to join them
 		return basic_evaluate_node(runtime, node->child);
@@ -189,8 +431,18 @@ ASTNodeData basic_evaluate_node(BASICRuntime *runtime, ASTNode *node)
 
 void basic_var_assignment(BASICRuntime *runtime, ASTNode *args)
 {
-	ASTNode *var_to_assign = args;
+	ASTNode *var_to_assign = ast_unwrap_expression(args);
 	ASTNode *val_to_assign = args->next;
+	if (var_to_assign->type == AST_FUNC_CALL && val_to_assign != NULL)
+	{
+		// Assignment to an array or dictionary element, "a(i) = value"
+		ASTNodeData *container = basic_find_value(runtime, var_to_assign);
+		if (container != NULL && container->token_type == DTYPE_DICT)
+			basic_set_dict_element(runtime, var_to_assign, basic_evaluate_node(runtime, val_to_assign));
+		else
+			basic_set_array_element(runtime, var_to_assign, basic_evaluate_node(runtime, val_to_assign));
+		return;
+	}
 	if (var_to_assign->type != AST_VARIABLE)
 	{
 		lprintf("EXEC", LOGTYPE_DEBUG, "Trying to assign expression to non-variable token\n");
@@ -205,20 +457,92 @@ void basic_var_assignment(BASICRuntime *runtime, ASTNode *args)
 		return;
 	}
 
+	// A typed variable that already has a value is given a value of its own type in place
+	ASTDType type = basic_parse_static_type(var_to_assign);
+	if ((type == DTYPE_NUM || type == DTYPE_FLT) && basic_parse_static_type(val_to_assign) == type)
+	{
+		// Typed expressions don't call functions or make variables, so the value stays where it is found
+		ASTNodeData *value = basic_find_value(runtime, var_to_assign);
+		if (value != NULL && value->token_type == type)
+		{
+			if (type == DTYPE_NUM)
+			{
+				int result = basic_evaluate_int(runtime, val_to_assign);
+				if (!runtime->halt)
+					value->token.literal.num = result;
+			}
+			else
+			{
+				float result = basic_evaluate_flt(runtime, val_to_assign);
+				if (!runtime->halt)
+					value->token.literal.flt = result;
+			}
+			return;
+		}
+	}
+
 	// Assign variable the evaluated result, LHS <- RHS
-	basic_set_variable(runtime, var_name, basic_evaluate_node(runtime, val_to_assign));
+	if (var_to_assign->slot >= 0)
+		basic_set_local(runtime, var_to_assign, basic_evaluate_node(runtime, val_to_assign));
+	else
+		basic_set_variable(runtime, var_name, basic_evaluate_node(runtime, val_to_assign));
 }
 
 // Executes a BASICProgram object (inside the runtime)
 ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
+{
+	if (runtime->call_depth == 0 && pc != NULL && pc->type == AST_PROGRAM_SEQUENCE)
+	{
+		// A whole program. Its functions can be called before the statement that defines them. A program that
+		// was stopped by an error may have left blocks on the stack
+		basic_release_temporaries(runtime, 0);
+		basic_jump_unwind(runtime, 0);
+		runtime->jump = -1;
+		if (basic_register_functions(runtime, pc) == 0)
+			basic_register_labels(runtime, pc);
+	}
+	return basic_execute_statements(runtime, pc);
+}
+
+// Runs a block body that is run from a keyword handler instead of the loop in basic_execute_statements,
+// with its own block stack, which RETURN or an error can leave with blocks still on it
+void basic_execute_block(BASICRuntime *runtime, ASTNode *body)
+{
+	StackNode *traverse_stack = runtime->traverse_stack;
+	int traverse_depth = runtime->traverse_depth;
+	int temporaries = runtime->temporary_count;
+	runtime->traverse_stack = NULL;
+	runtime->traverse_depth = 0;
+	basic_execute_statements(runtime, body);
+	basic_release_temporaries(runtime, temporaries);
+	basic_jump_unwind(runtime, 0);
+	runtime->traverse_stack = traverse_stack;
+	runtime->traverse_depth = traverse_depth;
+}
+
+ASTNodeData basic_execute_statements(BASICRuntime *runtime, ASTNode *pc)
 {
 	ASTNodeData result = ASTVOID;
 	// 'pc' is our "program counter"
 	// 'runtime' stores all variables and their values, and such data for running the program
+	int temporaries = runtime->temporary_count;
+	ASTNode *context = runtime->context;
+	runtime->context = pc;
 
-	// Executes the current sequence of instructions till end of list
-	while (!runtime->halt)
+	// Executes the current sequence of instructions till end of list, or till RETURN leaves the function
+	while (!runtime->halt && !runtime->returning)
 	{
+		if (runtime->jump >= 0)
+		{
+			// A GOTO left a FOR loop body. Jump if this loop runs its line, otherwise leave this one too
+			BASICLabel *label = &(runtime->labels[runtime->jump]);
+			if (label->context != runtime->context)
+				break;
+			runtime->jump = -1;
+			basic_jump_unwind(runtime, label->depth);
+			pc = label->statement;
+		}
+
 		ASTNode *current_pc = pc;
 
 		if (current_pc == NULL)
@@ -230,6 +554,7 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 			{
 				pc = (ASTNode *)nxt_pc_stk->data;
 				stack_delete_node(nxt_pc_stk);
+				runtime->traverse_depth--;
 				continue;
 			}
 		}
@@ -239,6 +564,16 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 			pc = pc->next;
 		}
 
+		// Values returned to the previous statement are no longer used
+		basic_release_temporaries(runtime, temporaries);
+
+		// Output waiting for its flush interval is sent even if the program prints nothing more for a while
+		if (runtime->output->length > 0 && ++runtime->output_poll_count >= BASIC_OUTPUT_POLL_STATEMENTS)
+		{
+			runtime->output_poll_count = 0;
+			system_output_poll(runtime->output);
+		}
+
 		switch (current_pc->type)
 		{
 		case AST_PROGRAM_SEQUENCE:
@@ -247,6 +582,7 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 			break;
 		// Function call which is not expecting a return value
 		case AST_FUNC_CALL:
+		case AST_USER_CALL:
 		// Expression directly given as a statement (eg. Variable assignment)
 		case AST_EXPRESSION:
 		case AST_OPERATION:
@@ -267,6 +603,7 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 				StackNode *ret_node = stack_create_node();
 				ret_node->data = (ASTNode *)pc;
 				stack_push(&(runtime->traverse_stack), ret_node);
+				runtime->traverse_depth++;
 				pc = next_pc;
 				break;
 			}
@@ -275,6 +612,7 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 				StackNode *ret_node = stack_create_node();
 				ret_node->data = (ASTNode *)current_pc;
 				stack_push(&(runtime->traverse_stack), ret_node);
+				runtime->traverse_depth++;
 				pc = next_pc;
 				break;
 			}
@@ -290,6 +628,7 @@ ASTNodeData basic_execute(BASICRuntime *runtime, ASTNode *pc)
 		}
 	}
 
+	runtime->context = context;
 	return result;
 }
 
@@ -308,6 +647,35 @@ BASICRuntime *basic_create_runtime(BASICProgram *program)
 	runtime->var_count = 0;
 	runtime->variables = NULL;
 	runtime->traverse_stack = NULL;
+	runtime->traverse_depth = 0;
+	runtime->context = NULL;
+	runtime->output = system_output_create(system_sink_file(stdout), SYSTEM_FLUSH_LINE);
+	if (runtime->output == NULL)
+	{
+		fprintf(stderr, "Failed to create the program output buffer\n");
+		free(runtime);
+		return NULL;
+	}
+	runtime->output_poll_count = 0;
+	// Log messages are printed after any program output before them
+	set_log_flush_hook(basic_runtime_flush_log, runtime->output);
+	system_random_seed_entropy(&runtime->random);
+	interner_init(&runtime->strings);
+	runtime->last_dict = NULL;
+	runtime->functions = NULL;
+	runtime->function_count = runtime->function_capacity = 0;
+	runtime->slots = NULL;
+	runtime->slot_count = runtime->slot_capacity = 0;
+	runtime->frames = NULL;
+	runtime->call_depth = runtime->frame_capacity = 0;
+	runtime->max_call_depth = BASIC_MAX_CALL_DEPTH;
+	runtime->returning = 0;
+	runtime->return_value = ASTVOID;
+	runtime->temporaries = NULL;
+	runtime->temporary_count = runtime->temporary_capacity = 0;
+	runtime->labels = NULL;
+	runtime->label_count = runtime->label_capacity = 0;
+	runtime->jump = -1;
 
 	basic_init_constants(runtime);
 
@@ -318,14 +686,38 @@ void basic_free_runtime(BASICRuntime *runtime)
 {
 	if (runtime != NULL)
 	{
+		for (int i = 0; i < runtime->var_count; i++)
+			basic_value_release(runtime->variables[i].value);
 		if (runtime->variables != NULL)
 			free(runtime->variables);
+		if (runtime->last_dict != NULL)
+			basic_dict_release(runtime->last_dict);
+		// Calls stopped by an error may have left locals behind
+		for (int i = 0; i < runtime->slot_count; i++)
+			basic_value_release(runtime->slots[i]);
+		basic_value_release(runtime->return_value);
+		basic_release_temporaries(runtime, 0);
+		free(runtime->slots);
+		free(runtime->frames);
+		free(runtime->temporaries);
+		free(runtime->functions);
+		free(runtime->labels);
+		basic_jump_unwind(runtime, 0);
+		// After the dictionaries, whose keys are in it
+		interner_free(&runtime->strings);
+		set_log_flush_hook(NULL, NULL);
+		system_output_destroy(runtime->output);
 		free(runtime);
 	}
 }
 
 /* Private functions */
 
+void basic_runtime_flush_log(void *output)
+{
+	system_output_flush((SystemOutput *)output);
+}
+
 void basic_init_constants(BASICRuntime *runtime)
 {
 	ASTNodeData pi_value;
@@ -338,6 +730,535 @@ void basic_init_constants(BASICRuntime *runtime)
 	basic_set_variable(runtime, "RANDOM_MAX", rand_max);
 }
 
+// Parses a lazily parsed block body the first time it runs
+int basic_prepare_sequence(BASICRuntime *runtime, ASTNode *sequence)
+{
+	if (sequence->type != AST_DEFERRED_SEQUENCE)
+		return 0;
+	if (basic_parse_deferred(&(runtime->program->program_tokens), sequence) != 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Syntax error found in a block body when it was run\n");
+		runtime->halt = 1;
+		return 1;
+	}
+	return 0;
+}
+
+/* Arrays */
+
+// Evaluates the indices of "name(i, j, ...)" and finds the element of the array variable 'name'.
+// Returns the array, or NULL after halting with an error
+BASICArray *basic_locate_array_element(BASICRuntime *runtime, ASTNode *indexing, size_t *index)
+{
+	int indices[BASIC_ARRAY_MAX_DIMS], index_count = 0;
+	char *name = indexing->data.token.kw;
+
+	// Evaluate the indices before finding the array, as evaluating them may change variables
+	for (ASTNode *arg = indexing->child; arg != NULL; arg = arg->next)
+	{
+		if (index_count == BASIC_ARRAY_MAX_DIMS)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Arrays can't have more than %d dimensions, but %s was given more indices\n", BASIC_ARRAY_MAX_DIMS, name);
+			runtime->halt = 1;
+			return NULL;
+		}
+		ASTNodeData index_value = basic_evaluate_node(runtime, arg);
+		if (runtime->halt)
+			return NULL;
+		if (index_value.token_type != DTYPE_NUM && index_value.token_type != DTYPE_FLT)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Index of array %s must be a number\n", name);
+			runtime->halt = 1;
+			return NULL;
+		}
+		indices[index_count++] = ast_data_to_int(index_value);
+	}
+
+	ASTNodeData *value = basic_find_value(runtime, indexing);
+	if (value == NULL || value->token_type != DTYPE_ARRAY)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s is not an array. Declare it first with %s %s(size)\n", name, PARSE_KEYWORDS[KEYWORD_IDX_DIM], name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	BASICArray *array = value->token.array;
+	if (index_count != array->dim_count)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Array %s has %d dimension(s), but %d index(es) were given\n", name, array->dim_count, index_count);
+		runtime->halt = 1;
+		return NULL;
+	}
+
+	// Elements are stored row by row
+	size_t offset = 0;
+	for (int i = 0; i < index_count; i++)
+	{
+		if (indices[i] < 0 || indices[i] >= array->dims[i])
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Index %d of array %s is out of bounds (0 to %d)\n", indices[i], name, array->dims[i] - 1);
+			runtime->halt = 1;
+			return NULL;
+		}
+		offset = offset * array->dims[i] + indices[i];
+	}
+	*index = offset;
+	return array;
+}
+
+ASTNodeData basic_get_array_element(BASICRuntime *runtime, ASTNode *indexing)
+{
+	size_t index;
+	BASICArray *array = basic_locate_array_element(runtime, indexing, &index);
+	if (array == NULL)
+		return ASTVOID;
+	return basic_array_get(array, index);
+}
+
+void basic_set_array_element(BASICRuntime *runtime, ASTNode *indexing, ASTNodeData value)
+{
+	size_t index;
+	if (runtime->halt)
+		return;
+	BASICArray *array = basic_locate_array_element(runtime, indexing, &index);
+	if (array == NULL)
+		return;
+	switch (basic_array_set(array, index, value))
+	{
+	case 1:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for the elements of array %s\n", indexing->data.token.kw);
+		runtime->halt = 1;
+		break;
+	case 2:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: This value can't be stored in array %s\n", indexing->data.token.kw);
+		runtime->halt = 1;
+		break;
+	}
+}
+
+/* Dictionaries */
+
+// Halts with a message for a failed dictionary operation. Returns 1 if it failed
+int basic_dict_error(BASICRuntime *runtime, BASICDictResult result, const char *name)
+{
+	switch (result)
+	{
+	case DICT_OK:
+		return 0;
+	case DICT_NOT_FOUND:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Key is not in dictionary %s. Check with HAS() first\n", name);
+		break;
+	case DICT_NO_MEMORY:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for dictionary %s\n", name);
+		break;
+	case DICT_BAD_KEY:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Keys of dictionary %s must be numbers or strings\n", name);
+		break;
+	case DICT_BAD_VALUE:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Arrays and dictionaries can't be stored in dictionary %s\n", name);
+		break;
+	}
+	runtime->halt = 1;
+	return 1;
+}
+
+// Evaluates the key of "name(key)" and finds the dictionary variable 'name'.
+// Returns the dictionary, or NULL after halting with an error
+BASICDict *basic_locate_dict_element(BASICRuntime *runtime, ASTNode *indexing, ASTNodeData *key)
+{
+	char *name = indexing->data.token.kw;
+	if (indexing->child == NULL || indexing->child->next != NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Dictionary %s takes exactly one key\n", name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	*key = basic_evaluate_node(runtime, indexing->child);
+	if (runtime->halt)
+		return NULL;
+
+	ASTNodeData *value = basic_find_value(runtime, indexing);
+	if (value == NULL || value->token_type != DTYPE_DICT)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s is no longer a dictionary\n", name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	return value->token.dict;
+}
+
+ASTNodeData basic_get_dict_element(BASICRuntime *runtime, ASTNode *indexing)
+{
+	ASTNodeData key, value;
+	BASICDict *dict = basic_locate_dict_element(runtime, indexing, &key);
+	if (dict == NULL || basic_dict_error(runtime, basic_dict_get(dict, key, &value), indexing->data.token.kw))
+		return ASTVOID;
+	return value;
+}
+
+void basic_set_dict_element(BASICRuntime *runtime, ASTNode *indexing, ASTNodeData value)
+{
+	ASTNodeData key;
+	if (runtime->halt)
+		return;
+	BASICDict *dict = basic_locate_dict_element(runtime, indexing, &key);
+	if (dict != NULL)
+		basic_dict_error(runtime, basic_dict_set(dict, key, value), indexing->data.token.kw);
+}
+
+/* User-defined functions */
+
+// Lists the FUNCTION definitions of the program. Returns 1 if a function is defined twice
+int basic_register_functions(BASICRuntime *runtime, ASTNode *sequence)
+{
+	runtime->function_count = 0;
+	for (ASTNode *node = sequence->child; node != NULL; node = node->next)
+	{
+		if (node->type != AST_KEYWORD || strcasecmp(node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]) != 0)
+			continue;
+		char *name = ast_unwrap_expression(node->child)->data.token.kw;
+		if (basic_find_function(runtime, name) >= 0)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: %s %s is defined more than once\n", PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION], name);
+			runtime->halt = 1;
+			return 1;
+		}
+		if (runtime->function_count == runtime->function_capacity)
+		{
+			int capacity = runtime->function_capacity == 0 ? 8 : runtime->function_capacity * 2;
+			ASTNode **functions = (ASTNode **)realloc(runtime->functions, sizeof(ASTNode *) * capacity);
+			if (functions == NULL)
+			{
+				lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for functions\n");
+				runtime->halt = 1;
+				return 1;
+			}
+			runtime->functions = functions;
+			runtime->function_capacity = capacity;
+		}
+		runtime->functions[runtime->function_count++] = node;
+	}
+	return 0;
+}
+
+// Index of the function with the given name, -1 if there is none. Names are not case sensitive, like built-in functions
+int basic_find_function(BASICRuntime *runtime, const char *name)
+{
+	for (int i = 0; i < runtime->function_count; i++)
+		if (strcasecmp(ast_unwrap_expression(runtime->functions[i]->child)->data.token.kw, name) == 0)
+			return i;
+	return -1;
+}
+
+// Makes room for one more frame with the given number of slots. Returns 1 if there is not enough memory
+int basic_reserve_frame(BASICRuntime *runtime, int slot_count)
+{
+	if (runtime->call_depth == runtime->frame_capacity)
+	{
+		int capacity = runtime->frame_capacity == 0 ? 64 : runtime->frame_capacity * 2;
+		BASICFrame *frames = (BASICFrame *)realloc(runtime->frames, sizeof(BASICFrame) * capacity);
+		if (frames == NULL)
+			return 1;
+		runtime->frames = frames;
+		runtime->frame_capacity = capacity;
+	}
+	if (runtime->slot_count + slot_count > runtime->slot_capacity)
+	{
+		int capacity = runtime->slot_capacity == 0 ? 256 : runtime->slot_capacity;
+		while (capacity < runtime->slot_count + slot_count)
+			capacity *= 2;
+		ASTNodeData *slots = (ASTNodeData *)realloc(runtime->slots, sizeof(ASTNodeData) * capacity);
+		if (slots == NULL)
+			return 1;
+		runtime->slots = slots;
+		runtime->slot_capacity = capacity;
+	}
+	return 0;
+}
+
+// Runs a user-defined function with the arguments of the call, and returns what it returned (void if nothing)
+ASTNodeData basic_call_function(BASICRuntime *runtime, ASTNode *call)
+{
+	ASTNode *definition = runtime->functions[call->slot];
+	ASTNode *declaration = ast_unwrap_expression(definition->child);
+	ASTNode *body = definition->child->next;
+	int slot_count = definition->slot;
+
+	if (runtime->call_depth >= runtime->max_call_depth)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Calls to %s are nested more than %d deep. Check that its recursion ends\n", declaration->data.token.kw, runtime->max_call_depth);
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	if (basic_reserve_frame(runtime, slot_count) != 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory to call %s\n", declaration->data.token.kw);
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+
+	// Take the frame's slots before evaluating the arguments into them, so calls made by the arguments
+	// get slots after these. The arguments still see the caller's frame
+	int base = runtime->slot_count;
+	runtime->slot_count += slot_count;
+	for (int i = base; i < runtime->slot_count; i++)
+		runtime->slots[i] = ASTVOID;
+
+	ASTNode *param = declaration->child, *arg = call->child;
+	int param_count = 0, arg_count = 0;
+	for (; arg != NULL && !runtime->halt; arg = arg->next, arg_count++)
+	{
+		ASTNodeData value = basic_evaluate_node(runtime, arg);
+		if (param == NULL || basic_declare_value(runtime, ast_unwrap_expression(param)->data.token.variable_name, &value) != 0)
+			continue;
+		basic_value_retain(value);
+		runtime->slots[base + param_count++] = value;
+		param = param->next;
+	}
+	for (; param != NULL; param = param->next)
+		param_count++;
+	if (arg_count != param_count && !runtime->halt)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s takes %d argument(s), but %d were given\n", declaration->data.token.kw, param_count, arg_count);
+		runtime->halt = 1;
+	}
+
+	if (!runtime->halt)
+	{
+		runtime->frames[runtime->call_depth].definition = definition;
+		runtime->frames[runtime->call_depth].base = base;
+		runtime->call_depth++;
+
+		basic_execute_block(runtime, body);
+		runtime->call_depth--;
+	}
+
+	ASTNodeData result = ASTVOID;
+	if (runtime->returning)
+	{
+		result = runtime->return_value;
+		runtime->return_value = ASTVOID;
+		runtime->returning = 0;
+	}
+	for (int i = base; i < base + slot_count; i++)
+		basic_value_release(runtime->slots[i]);
+	runtime->slot_count = base;
+
+	if (result.token_type == DTYPE_ARRAY || result.token_type == DTYPE_DICT)
+	{
+		// The reference RETURN took now belongs to the caller's statement
+		if (runtime->temporary_count == runtime->temporary_capacity)
+		{
+			int capacity = runtime->temporary_capacity == 0 ? 8 : runtime->temporary_capacity * 2;
+			ASTNodeData *temporaries = (ASTNodeData *)realloc(runtime->temporaries, sizeof(ASTNodeData) * capacity);
+			if (temporaries == NULL)
+			{
+				lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for the value returned by %s\n", declaration->data.token.kw);
+				basic_value_release(result);
+				runtime->halt = 1;
+				return ASTVOID;
+			}
+			runtime->temporaries = temporaries;
+			runtime->temporary_capacity = capacity;
+		}
+		runtime->temporaries[runtime->temporary_count++] = result;
+	}
+	return result;
+}
+
+ASTNodeData basic_get_local(BASICRuntime *runtime, ASTNode *variable)
+{
+	ASTNodeData value = runtime->slots[runtime->frames[runtime->call_depth - 1].base + variable->slot];
+	if (value.token_type == DTYPE_NONE)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Tried to read local variable %s before assigning it\n", variable->data.token.variable_name);
+		runtime->halt = 1;
+	}
+	return value;
+}
+
+void basic_set_local(BASICRuntime *runtime, ASTNode *variable, ASTNodeData value)
+{
+	// Evaluating the value may have moved the slots, so only find this one now
+	if (basic_declare_value(runtime, variable->data.token.variable_name, &value) != 0)
+		return;
+	ASTNodeData *local = &(runtime->slots[runtime->frames[runtime->call_depth - 1].base + variable->slot]);
+	basic_value_retain(value);
+	basic_value_release(*local);
+	*local = value;
+}
+
+// Releases the returned values above the first 'keep' ones
+void basic_release_temporaries(BASICRuntime *runtime, int keep)
+{
+	while (runtime->temporary_count > keep)
+		basic_value_release(runtime->temporaries[--runtime->temporary_count]);
+}
+
+/* GOTO */
+
+// GOTO found while walking the program, checked once all of its lines are known
+typedef struct
+{
+	ASTNode *node;
+	// Number of the GOTO in the walk, which is within the numbers of every block it is in
+	int position;
+	ASTNode *function;
+} BASICGotoSite;
+
+typedef struct
+{
+	int position;
+	BASICGotoSite *gotos;
+	int goto_count;
+	int goto_capacity;
+} BASICJumpWalk;
+
+int basic_add_label(BASICRuntime *runtime, BASICLabel label)
+{
+	if (runtime->label_count == runtime->label_capacity)
+	{
+		int capacity = runtime->label_capacity == 0 ? 16 : runtime->label_capacity * 2;
+		BASICLabel *labels = (BASICLabel *)realloc(runtime->labels, sizeof(BASICLabel) * capacity);
+		if (labels == NULL)
+			return 1;
+		runtime->labels = labels;
+		runtime->label_capacity = capacity;
+	}
+	runtime->labels[runtime->label_count++] = label;
+	return 0;
+}
+
+int basic_add_goto_site(BASICJumpWalk *walk, BASICGotoSite site)
+{
+	if (walk->goto_count == walk->goto_capacity)
+	{
+		int capacity = walk->goto_capacity == 0 ? 16 : walk->goto_capacity * 2;
+		BASICGotoSite *gotos = (BASICGotoSite *)realloc(walk->gotos, sizeof(BASICGotoSite) * capacity);
+		if (gotos == NULL)
+			return 1;
+		walk->gotos = gotos;
+		walk->goto_capacity = capacity;
+	}
+	walk->gotos[walk->goto_count++] = site;
+	return 0;
+}
+
+// Adds the line numbers of the block and the blocks in it to the jump table, and lists their GOTOs. Bodies that
+// are not parsed yet have no GOTO (the parser does not defer those), so no GOTO can reach their lines
+int basic_collect_labels(BASICRuntime *runtime, BASICJumpWalk *walk, ASTNode *block, ASTNode *context, ASTNode *function, int depth)
+{
+	int first = walk->position++, label_start = runtime->label_count;
+	for (ASTNode *node = block->child; node != NULL; node = node->next)
+	{
+		if (node->type == AST_LABEL)
+		{
+			BASICLabel label = {node->data.token.literal.num, node, context, depth, function, first, 0};
+			if (basic_add_label(runtime, label) != 0)
+				return 1;
+		}
+		else if (node->type == AST_KEYWORD && strcasecmp(node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_GOTO]) == 0)
+		{
+			BASICGotoSite site = {node, walk->position++, function};
+			if (basic_add_goto_site(walk, site) != 0)
+				return 1;
+		}
+		else if (node->type == AST_KEYWORD)
+		{
+			// FOR loops and functions run their bodies with a block stack of their own
+			int is_for = strcasecmp(node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FOR]) == 0;
+			int is_function = strcasecmp(node->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]) == 0;
+			for (ASTNode *body = node->child; body != NULL; body = body->next)
+			{
+				if (body->type != AST_PROGRAM_SEQUENCE)
+					continue;
+				int ret;
+				if (is_for || is_function)
+					ret = basic_collect_labels(runtime, walk, body, body, is_function ? node : function, 0);
+				else
+					ret = basic_collect_labels(runtime, walk, body, context, function, depth + 1);
+				if (ret != 0)
+					return ret;
+			}
+		}
+	}
+	for (int i = label_start; i < runtime->label_count; i++)
+		if (runtime->labels[i].first == first)
+			runtime->labels[i].last = walk->position;
+	return 0;
+}
+
+int basic_compare_labels(const void *a, const void *b)
+{
+	int x = ((const BASICLabel *)a)->line, y = ((const BASICLabel *)b)->line;
+	return (x > y) - (x < y);
+}
+
+// Builds the jump table of the program, and points each GOTO at the entry of its line. Returns 1 if a line
+// number is used twice, or a GOTO can't reach its line
+int basic_register_labels(BASICRuntime *runtime, ASTNode *sequence)
+{
+	BASICJumpWalk walk = {0, NULL, 0, 0};
+	int ret = 0;
+	runtime->label_count = 0;
+	if (basic_collect_labels(runtime, &walk, sequence, sequence, NULL, 0) != 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for the line numbers\n");
+		ret = 1;
+	}
+	else if (runtime->label_count > 1)
+		qsort(runtime->labels, runtime->label_count, sizeof(BASICLabel), basic_compare_labels);
+
+	for (int i = 1; ret == 0 && i < runtime->label_count; i++)
+	{
+		if (runtime->labels[i].line == runtime->labels[i - 1].line)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Line %d is given to more than one statement\n", runtime->labels[i].line);
+			ret = 1;
+		}
+	}
+
+	for (int i = 0; ret == 0 && i < walk.goto_count; i++)
+	{
+		BASICGotoSite *site = &(walk.gotos[i]);
+		BASICLabel key;
+		key.line = site->node->child->data.token.literal.num;
+		BASICLabel *label = runtime->label_count == 0 ? NULL : (BASICLabel *)bsearch(&key, runtime->labels, runtime->label_count, sizeof(BASICLabel), basic_compare_labels);
+		if (label == NULL)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: %s %d jumps to a line that is not in the program\n", PARSE_KEYWORDS[KEYWORD_IDX_GOTO], key.line);
+			ret = 1;
+		}
+		else if (label->function != site->function)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: %s %d can't jump into or out of a %s\n", PARSE_KEYWORDS[KEYWORD_IDX_GOTO], key.line, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]);
+			ret = 1;
+		}
+		else if (site->position < label->first || site->position >= label->last)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: %s %d can't jump into a block that it is not in\n", PARSE_KEYWORDS[KEYWORD_IDX_GOTO], key.line);
+			ret = 1;
+		}
+		else
+			site->node->slot = (int)(label - runtime->labels);
+	}
+
+	free(walk.gotos);
+	if (ret != 0)
+		runtime->halt = 1;
+	return ret;
+}
+
+// Leaves IF/ELSE/WHILE bodies until 'depth' entries are left on the block stack. The entries above a line's
+// depth belong to the bodies it is not in, so they are popped without looking at them
+void basic_jump_unwind(BASICRuntime *runtime, int depth)
+{
+	while (runtime->traverse_depth > depth)
+	{
+		stack_delete_node(stack_pop(&(runtime->traverse_stack)));
+		runtime->traverse_depth--;
+	}
+}
+
 /* Keyword evaluation */
 
 KeywordAction basic_evaluate_keyword_block(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc)
@@ -346,6 +1267,17 @@ KeywordAction basic_evaluate_keyword_block(BASICRuntime *runtime, ASTNode *pc, A
 		return basic_eval_kw_if(runtime, pc, nextpc);
 	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_WHILE]) == 0)
 		return basic_eval_kw_while(runtime, pc, nextpc);
+	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FOR]) == 0)
+		return basic_eval_kw_for(runtime, pc, nextpc);
+	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_DIM]) == 0)
+		return basic_eval_kw_dim(runtime, pc, nextpc);
+	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_RETURN]) == 0)
+		return basic_eval_kw_return(runtime, pc, nextpc);
+	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_GOTO]) == 0)
+		return basic_eval_kw_goto(runtime, pc, nextpc);
+	// Functions are registered when the program starts, so the definition itself does nothing
+	if (strcasecmp(pc->data.token.kw, PARSE_KEYWORDS[KEYWORD_IDX_FUNCTION]) == 0)
+		return KW_DO_NOTHING;
 	lprintf("EXEC", LOGTYPE_ERROR, "Found unknown keyword \"%s\"\n", pc->data.token.kw);
 	runtime->halt = 1;
 	return KW_DO_NOTHING;
@@ -390,7 +1322,7 @@ KeywordAction basic_eval_kw_if(BASICRuntime *runtime, ASTNode *pc, ASTNode **nex
 		return KW_DO_NOTHING;
 	}
 	ASTNode *false_path = true_path->next;
-	if (true_path->type != AST_PROGRAM_SEQUENCE)
+	if (true_path->type != AST_PROGRAM_SEQUENCE && true_path->type != AST_DEFERRED_SEQUENCE)
 	{
 		lprintf("EXEC-BUG", LOGTYPE_ERROR, "\"TRUE\" block needs to be of type Program Sequence\n");
 		runtime->halt = 1;
@@ -398,7 +1330,7 @@ KeywordAction basic_eval_kw_if(BASICRuntime *runtime, ASTNode *pc, ASTNode **nex
 	}
 	if (false_path != NULL)
 	{
-		if (false_path->type != AST_PROGRAM_SEQUENCE)
+		if (false_path->type != AST_PROGRAM_SEQUENCE && false_path->type != AST_DEFERRED_SEQUENCE)
 		{
 			lprintf("EXEC-BUG", LOGTYPE_ERROR, "\"FALSE\" block needs to be of type Program Sequence\n");
 			runtime->halt = 1;
@@ -413,11 +1345,15 @@ KeywordAction basic_eval_kw_if(BASICRuntime *runtime, ASTNode *pc, ASTNode **nex
 	// Who would've guessed evaulation of IF statements can be done with an IF statement
 	if (contition_val)
 	{
+		if (basic_prepare_sequence(runtime, true_path) != 0)
+			return KW_DO_NOTHING;
 		*nextpc = true_path;
 		return KW_JMP_AND_RET_NEXT;
 	}
 	else if (false_path != NULL)
 	{
+		if (basic_prepare_sequence(runtime, false_path) != 0)
+			return KW_DO_NOTHING;
 		*nextpc = false_path;
 		return KW_JMP_AND_RET_NEXT;
 	}
@@ -468,9 +1404,233 @@ KeywordAction basic_eval_kw_while(BASICRuntime *runtime, ASTNode *pc, ASTNode **
 	// Jump to body and then return back to condition check
 	if (contition_val)
 	{
+		if (basic_prepare_sequence(runtime, true_path) != 0)
+			return KW_DO_NOTHING;
 		*nextpc = true_path;
 		return KW_JMP_AND_RET_CURR;
 	}
 
 	return KW_DO_NOTHING;
 }
+
+// Where the loop variable is kept, found again after each run of the body as the body may move it
+ASTNodeData *basic_for_variable(BASICRuntime *runtime, ASTNode *variable, int index)
+{
+	if (variable->slot >= 0)
+		return &(runtime->slots[runtime->frames[runtime->call_depth - 1].base + variable->slot]);
+	return &(runtime->variables[index].value);
+}
+
+// Reads back the loop variable after the body ran, which may have changed it. Returns 1 after halting if it is no longer a number
+int basic_for_read_back(BASICRuntime *runtime, ASTNode *variable, ASTNodeData *value)
+{
+	if (value->token_type == DTYPE_NUM || value->token_type == DTYPE_FLT)
+		return 0;
+	lprintf("EXEC", LOGTYPE_ERROR, "Error: Variable %s of the %s loop must stay a number\n", variable->data.token.variable_name, PARSE_KEYWORDS[KEYWORD_IDX_FOR]);
+	runtime->halt = 1;
+	return 1;
+}
+
+KeywordAction basic_eval_kw_for(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc)
+{
+	/*
+		FOR loop contains the assignment of the start value to the loop variable, the end value,
+		the step, and a node to execute for each value
+			 _______________FOR_______________
+			|           |         |           |
+		Assignment     End      Step       Program
+		 /     \                           Sequence
+	 Variable  Start                       /  |  \
+										   ......
+	*/
+
+	ASTNode *assignment = ast_unwrap_expression(pc->child);
+	ASTNode *variable = ast_unwrap_expression(assignment->child);
+	ASTNode *end_node = pc->child->next, *step_node = end_node->next, *body = step_node->next;
+
+	// The bounds are evaluated once, before the loop starts
+	ASTNodeData start = basic_evaluate_node(runtime, assignment->child->next);
+	ASTNodeData end = basic_evaluate_node(runtime, end_node);
+	ASTNodeData step = basic_evaluate_node(runtime, step_node);
+	if (runtime->halt)
+		return KW_DO_NOTHING;
+	ASTNodeData *bounds[] = {&start, &end, &step};
+	for (int i = 0; i < 3; i++)
+	{
+		if (bounds[i]->token_type != DTYPE_NUM && bounds[i]->token_type != DTYPE_FLT)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Start, end and step of the %s loop over %s must be numbers\n", PARSE_KEYWORDS[KEYWORD_IDX_FOR], variable->data.token.variable_name);
+			runtime->halt = 1;
+			return KW_DO_NOTHING;
+		}
+	}
+	// The variable's type suffix decides how it counts
+	ASTDType type = basic_name_type(variable->data.token.variable_name);
+	for (int i = 0; i < 3 && type != DTYPE_NONE; i++)
+		if (basic_declare_value(runtime, variable->data.token.variable_name, bounds[i]) != 0)
+			return KW_DO_NOTHING;
+	if (ast_data_to_flt(step) == 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Step of the %s loop over %s can't be 0\n", PARSE_KEYWORDS[KEYWORD_IDX_FOR], variable->data.token.variable_name);
+		runtime->halt = 1;
+		return KW_DO_NOTHING;
+	}
+	if (basic_prepare_sequence(runtime, body) != 0)
+		return KW_DO_NOTHING;
+
+	// The loop variable is set once like an assignment, then only its number is written for each value
+	int index = -1;
+	if (variable->slot >= 0)
+		basic_set_local(runtime, variable, start);
+	else
+	{
+		basic_set_variable(runtime, variable->data.token.variable_name, start);
+		if (runtime->halt)
+			return KW_DO_NOTHING;
+		index = (int)(basic_find_variable(runtime, variable->data.token.variable_name) - runtime->variables);
+	}
+
+	ASTNodeData *value;
+	if (start.token_type == DTYPE_NUM && end.token_type == DTYPE_NUM && step.token_type == DTYPE_NUM)
+	{
+		// Counted in 64 bits so that stepping past the end never overflows
+		long long counter = start.token.literal.num, last = end.token.literal.num, increment = step.token.literal.num;
+		while (increment > 0 ? counter <= last : counter >= last)
+		{
+			basic_execute_block(runtime, body);
+			if (runtime->halt || runtime->returning || runtime->jump >= 0)
+				return KW_DO_NOTHING;
+			value = basic_for_variable(runtime, variable, index);
+			if (basic_for_read_back(runtime, variable, value))
+				return KW_DO_NOTHING;
+			counter = (value->token_type == DTYPE_NUM ? value->token.literal.num : (long long)value->token.literal.flt) + increment;
+			value->token_type = DTYPE_NUM;
+			value->token.literal.num = (int)(counter < INT_MIN ? INT_MIN : (counter > INT_MAX ? INT_MAX : counter));
+		}
+	}
+	else
+	{
+		float counter = ast_data_to_flt(start), last = ast_data_to_flt(end), increment = ast_data_to_flt(step);
+		value = basic_for_variable(runtime, variable, index);
+		value->token_type = DTYPE_FLT;
+		value->token.literal.flt = counter;
+		while (increment > 0 ? counter <= last : counter >= last)
+		{
+			basic_execute_block(runtime, body);
+			if (runtime->halt || runtime->returning || runtime->jump >= 0)
+				return KW_DO_NOTHING;
+			value = basic_for_variable(runtime, variable, index);
+			if (basic_for_read_back(runtime, variable, value))
+				return KW_DO_NOTHING;
+			counter = ast_data_to_flt(*value) + increment;
+			value->token_type = DTYPE_FLT;
+			value->token.literal.flt = counter;
+		}
+	}
+	return KW_DO_NOTHING;
+}
+
+KeywordAction basic_eval_kw_dim(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc)
+{
+	/*
+		DIM statement contains the array name and its upper bounds, like a function call
+			  DIM
+			   |
+			 Name
+			/  |  \
+		   Bounds...
+	*/
+
+	int bounds[BASIC_ARRAY_MAX_DIMS], dim_count = 0;
+	ASTNode *declaration = pc->child == NULL ? NULL : ast_unwrap_expression(pc->child);
+	if (declaration == NULL || declaration->type != AST_FUNC_CALL)
+	{
+		lprintf("EXEC-BUG", LOGTYPE_ERROR, "Array declaration was expected after %s\n", PARSE_KEYWORDS[KEYWORD_IDX_DIM]);
+		runtime->halt = 1;
+		return KW_DO_NOTHING;
+	}
+	char *name = declaration->data.token.kw;
+
+	for (ASTNode *arg = declaration->child; arg != NULL; arg = arg->next)
+	{
+		if (dim_count == BASIC_ARRAY_MAX_DIMS)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Arrays can't have more than %d dimensions\n", BASIC_ARRAY_MAX_DIMS);
+			runtime->halt = 1;
+			return KW_DO_NOTHING;
+		}
+		ASTNodeData value = basic_evaluate_node(runtime, arg);
+		if (runtime->halt)
+			return KW_DO_NOTHING;
+		if (value.token_type != DTYPE_NUM && value.token_type != DTYPE_FLT)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: Size of array %s must be a number\n", name);
+			runtime->halt = 1;
+			return KW_DO_NOTHING;
+		}
+		bounds[dim_count++] = ast_data_to_int(value);
+	}
+
+	BASICArray *array = basic_array_create(bounds, dim_count);
+	if (array == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Could not create array %s. Arrays can have up to %d elements, and no negative bounds\n", name, BASIC_ARRAY_MAX_LENGTH);
+		runtime->halt = 1;
+		return KW_DO_NOTHING;
+	}
+
+	ASTNodeData value;
+	value.token_type = DTYPE_ARRAY;
+	value.token.array = array;
+	basic_set_variable(runtime, name, value);
+	return KW_DO_NOTHING;
+}
+
+KeywordAction basic_eval_kw_return(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc)
+{
+	/*
+		RETURN statement contains the value to return, if there is one
+			RETURN
+			   |
+			 Value
+	*/
+
+	ASTNodeData value = pc->child == NULL ? ASTVOID : basic_evaluate_node(runtime, pc->child);
+	if (runtime->halt)
+		return KW_DO_NOTHING;
+
+	// Held until the call ends, after its locals are released
+	basic_value_retain(value);
+	basic_value_release(runtime->return_value);
+	runtime->return_value = value;
+	runtime->returning = 1;
+	return KW_DO_NOTHING;
+}
+
+KeywordAction basic_eval_kw_goto(BASICRuntime *runtime, ASTNode *pc, ASTNode **nextpc)
+{
+	/*
+		GOTO statement has the line number, whose jump table entry is in the slot of the GOTO
+			GOTO
+			 |
+			Line
+	*/
+
+	if (pc->slot < 0 || pc->slot >= runtime->label_count)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s %d was not found in the program when it started\n", PARSE_KEYWORDS[KEYWORD_IDX_GOTO], pc->child->data.token.literal.num);
+		runtime->halt = 1;
+		return KW_DO_NOTHING;
+	}
+
+	BASICLabel *label = &(runtime->labels[pc->slot]);
+	if (label->context != runtime->context)
+	{
+		// The line is outside of the FOR loop body being run. Each loop stops until the one that runs the line
+		runtime->jump = pc->slot;
+		return KW_DO_NOTHING;
+	}
+	basic_jump_unwind(runtime, label->depth);
+	*nextpc = label->statement;
+	return KW_JMP_ONLY;
+}
@@ -1,7 +1,10 @@
 #include <stddef.h>
+#include <string.h>
 
 #include "basic/basic.h"
 #include "basic/ast.h"
+#include "basic/basic_array_kernels.h"
+#include "basic/basic_array_sort.h"
 
 #include <utility/logging/logging.h>
 #include <basic_system_interface/system.h>
@@ -14,22 +17,54 @@ ASTNodeData basic_fn_print(BASICRuntime *runtime, ASTNode *args)
 	while (arg != NULL)
 	{
 		ASTNodeData value = basic_evaluate_node(runtime, arg);
+		// Stop at an error in the argument, before printing its value
+		if (runtime->halt)
+			return ASTVOID;
 		ast_data_as_string(value, temp);
-		system_tty_printf("%s", temp);
+		system_output_write(runtime->output, temp, strlen(temp));
 
 		arg = arg->next;
 		// Space separated arguments
 		if (arg != NULL)
-			system_tty_write(" ");
+			system_output_write(runtime->output, " ", 1);
 	}
-	system_tty_write("\n");
-	system_tty_flush_output();
+	system_output_end_line(runtime->output);
+	// Nobody is reading the output anymore, such as a client that disconnected
+	if (runtime->output->failed)
+		runtime->halt = 1;
 
 	// No return value
 	return ASTVOID;
 }
 
-// Function to find maximum value from given parameters
+// Largest or smallest element of an array, as a value
+ASTNodeData basic_array_extreme(BASICArray *array, int largest)
+{
+	const BASICArrayKernels *kernels = basic_array_kernels();
+	ASTNodeData ret_val = ASTVOID;
+	switch (array->storage)
+	{
+	case ARRAY_STORAGE_INT:
+		ret_val.token_type = DTYPE_NUM;
+		ret_val.token.literal.num = largest ? kernels->max_int(array->data.ints, array->length) : kernels->min_int(array->data.ints, array->length);
+		break;
+	case ARRAY_STORAGE_FLT:
+		ret_val.token_type = DTYPE_FLT;
+		ret_val.token.literal.flt = largest ? kernels->max_flt(array->data.flts, array->length) : kernels->min_flt(array->data.flts, array->length);
+		break;
+	default:
+		for (size_t i = 0; i < array->length; i++)
+		{
+			if (largest)
+				ast_get_greater(ret_val, array->data.boxed[i], &ret_val);
+			else
+				ast_get_lesser(ret_val, array->data.boxed[i], &ret_val);
+		}
+	}
+	return ret_val;
+}
+
+// Function to find maximum value from given parameters. An array counts as all of its elements
 ASTNodeData basic_fn_max(BASICRuntime *runtime, ASTNode *args)
 {
 	ASTNode *arg = args;
@@ -37,13 +72,15 @@ ASTNodeData basic_fn_max(BASICRuntime *runtime, ASTNode *args)
 	while (arg != NULL)
 	{
 		ASTNodeData value = basic_evaluate_node(runtime, arg);
+		if (value.token_type == DTYPE_ARRAY)
+			value = basic_array_extreme(value.token.array, 1);
 		ast_get_greater(ret_val, value, &ret_val);
 		arg = arg->next;
 	}
 	return ret_val;
 }
 
-// Function to find minimum value from given parameters
+// Function to find minimum value from given parameters. An array counts as all of its elements
 ASTNodeData basic_fn_min(BASICRuntime *runtime, ASTNode *args)
 {
 	ASTNode *arg = args;
@@ -51,6 +88,8 @@ ASTNodeData basic_fn_min(BASICRuntime *runtime, ASTNode *args)
 	while (arg != NULL)
 	{
 		ASTNodeData value = basic_evaluate_node(runtime, arg);
+		if (value.token_type == DTYPE_ARRAY)
+			value = basic_array_extreme(value.token.array, 0);
 		ast_get_lesser(ret_val, value, &ret_val);
 		arg = arg->next;
 	}
@@ -58,6 +97,235 @@ ASTNodeData basic_fn_min(BASICRuntime *runtime, ASTNode *args)
 	return ret_val;
 }
 
+// Evaluates an argument that must be an array of numbers. Halts and returns NULL if it isn't
+BASICArray *basic_fn_numeric_array_arg(BASICRuntime *runtime, ASTNode *arg, const char *fn_name)
+{
+	if (arg == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s expects an array, none found\n", fn_name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	ASTNodeData value = basic_evaluate_node(runtime, arg);
+	if (runtime->halt)
+		return NULL;
+	if (value.token_type != DTYPE_ARRAY || value.token.array->storage == ARRAY_STORAGE_BOXED)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s expects an array of numbers\n", fn_name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	return value.token.array;
+}
+
+// Evaluates an argument that must be a number. Halts and returns ASTVOID if it isn't
+ASTNodeData basic_fn_number_arg(BASICRuntime *runtime, ASTNode *arg, const char *fn_name)
+{
+	if (arg == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s expects a number, none found\n", fn_name);
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	ASTNodeData value = basic_evaluate_node(runtime, arg);
+	if (runtime->halt)
+		return ASTVOID;
+	if (value.token_type != DTYPE_NUM && value.token_type != DTYPE_FLT)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s expects a number\n", fn_name);
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	return value;
+}
+
+// Moves integer elements to floats before a float is stored in them
+int basic_fn_array_to_float(BASICRuntime *runtime, BASICArray *array)
+{
+	if (array->storage == ARRAY_STORAGE_INT && basic_array_to_float(array) != 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Not enough memory to store floats in the array\n");
+		runtime->halt = 1;
+		return 1;
+	}
+	return 0;
+}
+
+// Sum of all elements of an array
+ASTNodeData basic_fn_sum(BASICRuntime *runtime, ASTNode *arg)
+{
+	BASICArray *array = basic_fn_numeric_array_arg(runtime, arg, "SUM");
+	if (array == NULL)
+		return ASTVOID;
+
+	ASTNodeData ret_val;
+	if (array->storage == ARRAY_STORAGE_INT)
+	{
+		ret_val.token_type = DTYPE_NUM;
+		ret_val.token.literal.num = basic_array_kernels()->sum_int(array->data.ints, array->length);
+	}
+	else
+	{
+		ret_val.token_type = DTYPE_FLT;
+		ret_val.token.literal.flt = basic_array_kernels()->sum_flt(array->data.flts, array->length);
+	}
+	return ret_val;
+}
+
+// Sum of the products of the elements of two arrays of the same size
+ASTNodeData basic_fn_dot(BASICRuntime *runtime, ASTNode *args)
+{
+	BASICArray *a = basic_fn_numeric_array_arg(runtime, args, "DOT");
+	if (a == NULL)
+		return ASTVOID;
+	BASICArray *b = basic_fn_numeric_array_arg(runtime, args->next, "DOT");
+	if (b == NULL)
+		return ASTVOID;
+	if (a->length != b->length)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: DOT expects arrays of the same size, got %zu and %zu elements\n", a->length, b->length);
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+
+	const BASICArrayKernels *kernels = basic_array_kernels();
+	ASTNodeData ret_val;
+	ret_val.token_type = DTYPE_FLT;
+	if (a->storage == ARRAY_STORAGE_INT && b->storage == ARRAY_STORAGE_INT)
+	{
+		ret_val.token_type = DTYPE_NUM;
+		ret_val.token.literal.num = kernels->dot_int(a->data.ints, b->data.ints, a->length);
+	}
+	else if (a->storage == ARRAY_STORAGE_FLT && b->storage == ARRAY_STORAGE_FLT)
+		ret_val.token.literal.flt = kernels->dot_flt(a->data.flts, b->data.flts, a->length);
+	else if (a->storage == ARRAY_STORAGE_INT)
+		ret_val.token.literal.flt = kernels->dot_int_flt(a->data.ints, b->data.flts, a->length);
+	else
+		ret_val.token.literal.flt = kernels->dot_int_flt(b->data.ints, a->data.flts, a->length);
+	return ret_val;
+}
+
+// Multiply every element of an array by a number
+ASTNodeData basic_fn_scale(BASICRuntime *runtime, ASTNode *args)
+{
+	BASICArray *array = basic_fn_numeric_array_arg(runtime, args, "SCALE");
+	if (array == NULL)
+		return ASTVOID;
+	ASTNodeData factor = basic_fn_number_arg(runtime, args->next, "SCALE");
+	if (runtime->halt)
+		return ASTVOID;
+
+	if (factor.token_type == DTYPE_FLT && basic_fn_array_to_float(runtime, array) != 0)
+		return ASTVOID;
+	if (array->storage == ARRAY_STORAGE_INT)
+		basic_array_kernels()->scale_int(array->data.ints, factor.token.literal.num, array->length);
+	else
+		basic_array_kernels()->scale_flt(array->data.flts, ast_data_to_flt(factor), array->length);
+	return ASTVOID;
+}
+
+// Add a number, or the elements of another array of the same size, to every element of an array
+ASTNodeData basic_fn_add(BASICRuntime *runtime, ASTNode *args)
+{
+	BASICArray *array = basic_fn_numeric_array_arg(runtime, args, "ADD");
+	if (array == NULL)
+		return ASTVOID;
+	if (args->next == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: ADD expects a number or an array to add, none found\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	ASTNodeData value = basic_evaluate_node(runtime, args->next);
+	if (runtime->halt)
+		return ASTVOID;
+
+	const BASICArrayKernels *kernels = basic_array_kernels();
+	switch (value.token_type)
+	{
+	case DTYPE_NUM:
+		if (array->storage == ARRAY_STORAGE_INT)
+			kernels->offset_int(array->data.ints, value.token.literal.num, array->length);
+		else
+			kernels->offset_flt(array->data.flts, (float)value.token.literal.num, array->length);
+		break;
+	case DTYPE_FLT:
+		if (basic_fn_array_to_float(runtime, array) != 0)
+			return ASTVOID;
+		kernels->offset_flt(array->data.flts, value.token.literal.flt, array->length);
+		break;
+	case DTYPE_ARRAY:
+	{
+		BASICArray *other = value.token.array;
+		if (other->storage == ARRAY_STORAGE_BOXED || other->length != array->length)
+		{
+			lprintf("EXEC", LOGTYPE_ERROR, "Error: ADD expects an array of numbers of the same size\n");
+			runtime->halt = 1;
+			return ASTVOID;
+		}
+		if (other->storage == ARRAY_STORAGE_FLT && basic_fn_array_to_float(runtime, array) != 0)
+			return ASTVOID;
+		if (array->storage == ARRAY_STORAGE_INT)
+			kernels->add_int(array->data.ints, other->data.ints, array->length);
+		else if (other->storage == ARRAY_STORAGE_FLT)
+			kernels->add_flt(array->data.flts, other->data.flts, array->length);
+		else
+			kernels->add_flt_int(array->data.flts, other->data.ints, array->length);
+		break;
+	}
+	default:
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: ADD expects a number or an array to add\n");
+		runtime->halt = 1;
+	}
+	return ASTVOID;
+}
+
+// Set every element of an array to the same value
+ASTNodeData basic_fn_fill(BASICRuntime *runtime, ASTNode *args)
+{
+	ASTNodeData target = args == NULL ? ASTVOID : basic_evaluate_node(runtime, args);
+	if (runtime->halt)
+		return ASTVOID;
+	if (target.token_type != DTYPE_ARRAY || args->next == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: FILL expects an array and a value to fill it with\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	BASICArray *array = target.token.array;
+	ASTNodeData value = basic_evaluate_node(runtime, args->next);
+	if (runtime->halt)
+		return ASTVOID;
+
+	if (value.token_type == DTYPE_NUM && array->storage == ARRAY_STORAGE_FLT)
+	{
+		float as_flt = (float)value.token.literal.num;
+		basic_array_kernels()->fill(array->data.flts, &as_flt, array->length);
+	}
+	else if ((value.token_type == DTYPE_NUM || value.token_type == DTYPE_FLT) && array->storage != ARRAY_STORAGE_BOXED)
+	{
+		// Every element is overwritten, and floats are the same size as integers, so the storage
+		// can change type in place
+		if (value.token_type == DTYPE_FLT)
+			array->storage = ARRAY_STORAGE_FLT;
+		basic_array_kernels()->fill(array->data.ints, &value.token.literal, array->length);
+	}
+	else
+	{
+		for (size_t i = 0; i < array->length; i++)
+		{
+			int error = basic_array_set(array, i, value);
+			if (error != 0)
+			{
+				lprintf("EXEC", LOGTYPE_ERROR, error == 1 ? "Error: Not enough memory to fill the array\n" : "Error: Arrays can only be filled with numbers or strings\n");
+				runtime->halt = 1;
+				break;
+			}
+		}
+	}
+	return ASTVOID;
+}
+
 // Sleep for given number of seconds (can be fraction)
 ASTNodeData basic_fn_sleep(BASICRuntime *runtime, ASTNode *arg)
 {
@@ -68,6 +336,8 @@ ASTNodeData basic_fn_sleep(BASICRuntime *runtime, ASTNode *arg)
 	ASTNodeData value = basic_evaluate_node(runtime, arg);
 	// Convert to float
 	float sleep_seconds = ast_data_to_flt(value);
+	// Show everything printed so far while the program waits
+	system_output_flush(runtime->output);
 	system_sleep(sleep_seconds);
 	return (ASTNodeData){0, DTYPE_NUM};
 }
@@ -113,7 +383,7 @@ ASTNodeData basic_fn_rand(BASICRuntime *runtime, ASTNode *arg)
 		return ASTVOID;
 	}
 	ASTNodeData random;
-	random.token.literal.flt = system_random_float();
+	random.token.literal.flt = system_random_float(&runtime->random);
 	random.token_type = DTYPE_FLT;
 	return random;
 }
@@ -127,7 +397,134 @@ ASTNodeData basic_fn_irand(BASICRuntime *runtime, ASTNode *arg)
 		return ASTVOID;
 	}
 	ASTNodeData random;
-	random.token.literal.num = system_random_int();
+	random.token.literal.num = system_random_int(&runtime->random);
 	random.token_type = DTYPE_NUM;
 	return random;
 }
+
+// Seed the random number generator, so that the same seed gives the same numbers
+ASTNodeData basic_fn_seed(BASICRuntime *runtime, ASTNode *arg)
+{
+	if (arg == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Expected a seed value, none found\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	ASTNodeData value = basic_evaluate_node(runtime, arg);
+	system_random_seed(&runtime->random, (uint64_t)ast_data_to_int(value));
+	return ASTVOID;
+}
+
+// Sort an array in place. Optional arguments choose descending order, and a stable sort for
+// arrays holding strings. Arrays of numbers always sort stably
+ASTNodeData basic_fn_sort(BASICRuntime *runtime, ASTNode *args)
+{
+	ASTNodeData target = args == NULL ? ASTVOID : basic_evaluate_node(runtime, args);
+	if (runtime->halt)
+		return ASTVOID;
+	if (target.token_type != DTYPE_ARRAY)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: SORT expects an array\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+
+	int descending = 0, stable = 0;
+	if (args->next != NULL)
+	{
+		descending = ast_data_to_int(basic_evaluate_node(runtime, args->next)) != 0;
+		if (args->next->next != NULL)
+			stable = ast_data_to_int(basic_evaluate_node(runtime, args->next->next)) != 0;
+		if (runtime->halt)
+			return ASTVOID;
+	}
+
+	if (basic_array_sort(target.token.array, descending, stable) != 0)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Not enough memory to sort the array\n");
+		runtime->halt = 1;
+	}
+	return ASTVOID;
+}
+
+// Create an empty dictionary
+ASTNodeData basic_fn_dict(BASICRuntime *runtime, ASTNode *arg)
+{
+	if (arg != NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Function call does not expect any arguments\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+	BASICDict *dict = basic_dict_create(&runtime->strings);
+	if (dict == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: Failed to allocate memory for a dictionary\n");
+		runtime->halt = 1;
+		return ASTVOID;
+	}
+
+	// The runtime holds the newest dictionary until the next one, as it may never be assigned
+	basic_dict_retain(dict);
+	if (runtime->last_dict != NULL)
+		basic_dict_release(runtime->last_dict);
+	runtime->last_dict = dict;
+
+	ASTNodeData value;
+	value.token_type = DTYPE_DICT;
+	value.token.dict = dict;
+	return value;
+}
+
+// Evaluates the dictionary and key arguments of HAS and REMOVE. Returns NULL after halting if they are not given
+BASICDict *basic_fn_dict_key_args(BASICRuntime *runtime, ASTNode *args, ASTNodeData *key, const char *fn_name)
+{
+	ASTNodeData target = args == NULL ? ASTVOID : basic_evaluate_node(runtime, args);
+	if (runtime->halt)
+		return NULL;
+	if (target.token_type != DTYPE_DICT || args->next == NULL)
+	{
+		lprintf("EXEC", LOGTYPE_ERROR, "Error: %s expects a dictionary and a key\n", fn_name);
+		runtime->halt = 1;
+		return NULL;
+	}
+	*key = basic_evaluate_node(runtime, args->next);
+	if (runtime->halt)
+		return NULL;
+	return target.token.dict;
+}
+
+// TRUE if the dictionary has the key
+ASTNodeData basic_fn_has(BASICRuntime *runtime, ASTNode *args)
+{
+	ASTNodeData key;
+	BASICDict *dict = basic_fn_dict_key_args(runtime, args, &key, "HAS");
+	if (dict == NULL)
+		return ASTVOID;
+
+	BASICDictResult result = basic_dict_get(dict, key, NULL);
+	if (result != DICT_NOT_FOUND && basic_dict_error(runtime, result, "given to HAS"))
+		return ASTVOID;
+	ASTNodeData found;
+	found.token.literal.num = result == DICT_OK;
+	found.token_type = DTYPE_NUM;
+	return found;
+}
+
+// Remove a key from the dictionary. TRUE if it was there
+ASTNodeData basic_fn_remove(BASICRuntime *runtime, ASTNode *args)
+{
+	ASTNodeData key;
+	BASICDict *dict = basic_fn_dict_key_args(runtime, args, &key, "REMOVE");
+	if (dict == NULL)
+		return ASTVOID;
+
+	BASICDictResult result = basic_dict_remove(dict, key);
+	if (result != DICT_NOT_FOUND && basic_dict_error(runtime, result, "given to REMOVE"))
+		return ASTVOID;
+	ASTNodeData found;
+	found.token.literal.num = result == DICT_OK;
+	found.token_type = DTYPE_NUM;
+	return found;
+}
@@ -1,8 +1,154 @@
 #pragma once
 
-void system_sleep(unsigned long long us);
-int system_random_int();
-float system_random_float();
-void system_tty_write(const char *str);
-void system_tty_printf(const char *format, ...);
-void system_tty_flush_output();
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void system_sleep(float seconds);
+unsigned long long system_time_us();
+
+/* Output sinks */
+
+// Where buffered output is written out to
+typedef enum
+{
+	// A file descriptor, written with write()
+	SYSTEM_SINK_FD,
+	// A connected socket. A peer that went away fails the write instead of raising SIGPIPE
+	SYSTEM_SINK_SOCKET,
+	// A stdio stream, flushed after every write so it stays in order with anything else printed to it
+	SYSTEM_SINK_FILE,
+	// A memory buffer that grows to hold everything written to it
+	SYSTEM_SINK_MEMORY,
+	// A function given by the user
+	SYSTEM_SINK_CALLBACK
+} SystemSinkType;
+
+// Writes some of the 'length' bytes. Returns how many were written, or -1 if writing failed
+typedef long (*system_sink_write_fn)(void *context, const char *data, size_t length);
+
+typedef struct
+{
+	SystemSinkType type;
+	// SYSTEM_SINK_FD and SYSTEM_SINK_SOCKET
+	int fd;
+	// SYSTEM_SINK_FILE
+	FILE *file;
+	// SYSTEM_SINK_MEMORY. Not null-terminated
+	char *data;
+	size_t length, capacity;
+	// SYSTEM_SINK_CALLBACK
+	system_sink_write_fn write;
+	void *context;
+} SystemSink;
+
+SystemSink system_sink_fd(int fd);
+SystemSink system_sink_socket(int sock);
+SystemSink system_sink_file(FILE *file);
+SystemSink system_sink_memory();
+SystemSink system_sink_callback(system_sink_write_fn write, void *context);
+
+// Writes some of the data, like system_sink_write_fn
+long system_sink_write(SystemSink *sink, const char *data, size_t length);
+
+// Frees the data of a memory sink. The file descriptors and streams of other sinks are left open
+void system_sink_free(SystemSink *sink);
+
+/* Buffered program output */
+
+// When buffered output is written out
+typedef enum
+{
+	// After every line, like an unbuffered terminal
+	SYSTEM_FLUSH_LINE,
+	// Only when flush_size bytes are buffered
+	SYSTEM_FLUSH_SIZE,
+	// Once flush_interval_us passed since the last write, checked at the end of a line and by
+	// system_output_poll(), which the runner calls while the program runs
+	SYSTEM_FLUSH_INTERVAL,
+	// Only when the buffer is full, flushed explicitly or destroyed
+	SYSTEM_FLUSH_EXIT
+} SystemFlushPolicy;
+
+// Default buffer size, and the threshold for SYSTEM_FLUSH_SIZE
+#define SYSTEM_OUTPUT_BUFFER_SIZE 16384
+// Largest buffer for SYSTEM_FLUSH_EXIT, after which it is written out anyway
+#define SYSTEM_OUTPUT_MAX_BUFFER (1024 * 1024)
+// Default interval for SYSTEM_FLUSH_INTERVAL
+#define SYSTEM_OUTPUT_INTERVAL_US 50000
+
+typedef struct
+{
+	// Owned by the output, which frees it when it is destroyed or given another sink
+	SystemSink sink;
+	SystemFlushPolicy policy;
+	char *buffer;
+	size_t length, capacity;
+	size_t flush_size;
+	unsigned long long flush_interval_us, last_flush_us;
+	// Number of write calls made, for statistics
+	unsigned long write_calls;
+	// Set once a write fails, such as after a client disconnected. Output is dropped from then on
+	int failed;
+} SystemOutput;
+
+/**
+ * Create an output buffer written out to `sink` according to `policy`.
+ * Returns NULL if it could not be allocated.
+ */
+SystemOutput *system_output_create(SystemSink sink, SystemFlushPolicy policy);
+
+// Flushes the remaining output and frees the buffer
+void system_output_destroy(SystemOutput *output);
+
+/**
+ * Change the flush policy. `flush_size` is the buffer size, which is written out when full
+ * (SYSTEM_FLUSH_EXIT grows it instead, up to SYSTEM_OUTPUT_MAX_BUFFER), and `flush_interval_us`
+ * the interval for SYSTEM_FLUSH_INTERVAL. Pending output is flushed first.
+ */
+void system_output_set_policy(SystemOutput *output, SystemFlushPolicy policy, size_t flush_size, unsigned long long flush_interval_us);
+
+// Write to `sink` from now on, after flushing what was buffered to the old one and freeing it
+void system_output_set_sink(SystemOutput *output, SystemSink sink);
+
+void system_output_write(SystemOutput *output, const char *str, size_t length);
+
+// Ends the current line and writes out the buffer if the policy asks for it
+void system_output_end_line(SystemOutput *output);
+
+// Writes out the buffer if the policy is SYSTEM_FLUSH_INTERVAL and flush_interval_us passed since the last write
+void system_output_poll(SystemOutput *output);
+
+// Writes out everything buffered. Returns 0 on success, -1 if the write failed
+int system_output_flush(SystemOutput *output);
+
+// Terminal-style output of a program through its buffer
+void system_tty_write(SystemOutput *output, const char *str);
+void system_tty_printf(SystemOutput *output, const char *format, ...);
+void system_tty_flush_output(SystemOutput *output);
+
+/* Random numbers */
+
+// xoshiro256** generator state. Each runtime has its own
+typedef struct
+{
+	uint64_t state[4];
+} SystemRandom;
+
+// Seed the generator, giving the same sequence for the same seed
+void system_random_seed(SystemRandom *random, uint64_t seed);
+
+// Seed the generator from the operating system's entropy source, or the time if there is none
+void system_random_seed_entropy(SystemRandom *random);
+
+uint64_t system_random_next(SystemRandom *random);
+
+// Random integer from 0 to 2^31 - 1
+int system_random_int(SystemRandom *random);
+
+// Random float from 0 up to, but not including, 1
+float system_random_float(SystemRandom *random);
+
+// Fill 'values' with 'count' numbers, the same as calling the functions above that many times
+void system_random_fill_int(SystemRandom *random, int *values, size_t count);
+void system_random_fill_float(SystemRandom *random, float *values, size_t count);
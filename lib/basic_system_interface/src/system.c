@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "basic_system_interface/system.h"
 
 #ifdef __linux__
+#include <errno.h>
 #include <unistd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
 #elif defined(_WIN32) || defined(_WIN64)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -24,32 +31,385 @@ void system_sleep(float seconds)
 #endif
 }
 
-int system_random_int()
+/* Random numbers */
+
+// SplitMix64, to spread a seed over the generator state
+uint64_t system_splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+void system_random_seed(SystemRandom *random, uint64_t seed)
+{
+	for (int i = 0; i < 4; i++)
+		random->state[i] = system_splitmix64(&seed);
+}
+
+void system_random_seed_entropy(SystemRandom *random)
+{
+	uint64_t seed;
+#ifdef __linux__
+	if (getrandom(&seed, sizeof(seed), 0) == sizeof(seed))
+	{
+		system_random_seed(random, seed);
+		return;
+	}
+#endif
+	// Mix the time and the state's address, so runtimes created in the same instant differ
+	seed = system_time_us() ^ (uint64_t)time(NULL) << 20 ^ (uint64_t)(uintptr_t)random;
+	system_random_seed(random, seed);
+}
+
+uint64_t system_random_rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+uint64_t system_random_next(SystemRandom *random)
+{
+	uint64_t *s = random->state;
+	uint64_t result = system_random_rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = system_random_rotl(s[3], 45);
+
+	return result;
+}
+
+int system_random_int(SystemRandom *random)
+{
+	// Upper bits are the best ones
+	return (int)(system_random_next(random) >> 33);
+}
+
+float system_random_float(SystemRandom *random)
+{
+	// 24 random bits fill the float mantissa
+	return (float)(system_random_next(random) >> 40) * (1.0f / 16777216.0f);
+}
+
+void system_random_fill_int(SystemRandom *random, int *values, size_t count)
+{
+	// Work on a local copy of the state so that it stays in registers
+	SystemRandom local = *random;
+	for (size_t i = 0; i < count; i++)
+		values[i] = (int)(system_random_next(&local) >> 33);
+	*random = local;
+}
+
+void system_random_fill_float(SystemRandom *random, float *values, size_t count)
+{
+	SystemRandom local = *random;
+	for (size_t i = 0; i < count; i++)
+		values[i] = (float)(system_random_next(&local) >> 40) * (1.0f / 16777216.0f);
+	*random = local;
+}
+
+unsigned long long system_time_us()
+{
+#ifdef __linux__
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+#elif defined(_WIN32) || defined(_WIN64)
+	return GetTickCount64() * 1000ULL;
+#else
+	return (unsigned long long)clock() * 1000000ULL / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Output sinks */
+
+SystemSink system_sink_fd(int fd)
+{
+	SystemSink sink;
+	memset(&sink, 0, sizeof(sink));
+	sink.type = SYSTEM_SINK_FD;
+	sink.fd = fd;
+	return sink;
+}
+
+SystemSink system_sink_socket(int sock)
+{
+	SystemSink sink = system_sink_fd(sock);
+	sink.type = SYSTEM_SINK_SOCKET;
+	return sink;
+}
+
+SystemSink system_sink_file(FILE *file)
 {
-	// Generate a random number between 0 and RAND_MAX range
-	return rand();
+	SystemSink sink = system_sink_fd(-1);
+	sink.type = SYSTEM_SINK_FILE;
+	sink.file = file;
+	return sink;
 }
 
-float system_random_float()
+SystemSink system_sink_memory()
 {
-	// Generate a random number between 0 and 1
-	return ((float)rand()) / (float)RAND_MAX;
+	SystemSink sink = system_sink_fd(-1);
+	sink.type = SYSTEM_SINK_MEMORY;
+	return sink;
 }
 
-void system_tty_write(const char *str)
+SystemSink system_sink_callback(system_sink_write_fn write, void *context)
 {
-	fputs(str, stdout);
+	SystemSink sink = system_sink_fd(-1);
+	sink.type = SYSTEM_SINK_CALLBACK;
+	sink.write = write;
+	sink.context = context;
+	return sink;
 }
 
-void system_tty_printf(const char *format, ...)
+long system_sink_write(SystemSink *sink, const char *data, size_t length)
 {
+	switch (sink->type)
+	{
+	case SYSTEM_SINK_FD:
+	case SYSTEM_SINK_SOCKET:
+	{
+#ifdef __linux__
+		ssize_t count;
+		do
+		{
+			if (sink->type == SYSTEM_SINK_SOCKET)
+				count = send(sink->fd, data, length, MSG_NOSIGNAL);
+			else
+				count = write(sink->fd, data, length);
+		} while (count < 0 && errno == EINTR);
+		return count;
+#else
+		// Only streams are supported here
+		return -1;
+#endif
+	}
+	case SYSTEM_SINK_FILE:
+	{
+		size_t count = fwrite(data, 1, length, sink->file);
+		if (fflush(sink->file) != 0 || count == 0)
+			return -1;
+		return (long)count;
+	}
+	case SYSTEM_SINK_MEMORY:
+		if (sink->length + length > sink->capacity)
+		{
+			size_t capacity = sink->capacity > 0 ? sink->capacity : 4096;
+			while (capacity < sink->length + length)
+				capacity *= 2;
+			char *data = (char *)realloc(sink->data, capacity);
+			if (data == NULL)
+				return -1;
+			sink->data = data;
+			sink->capacity = capacity;
+		}
+		memcpy(sink->data + sink->length, data, length);
+		sink->length += length;
+		return (long)length;
+	case SYSTEM_SINK_CALLBACK:
+		return sink->write(sink->context, data, length);
+	}
+	return -1;
+}
+
+void system_sink_free(SystemSink *sink)
+{
+	if (sink->type == SYSTEM_SINK_MEMORY)
+	{
+		free(sink->data);
+		sink->data = NULL;
+		sink->length = sink->capacity = 0;
+	}
+}
+
+/* Buffered program output */
+
+SystemOutput *system_output_create(SystemSink sink, SystemFlushPolicy policy)
+{
+	SystemOutput *output = (SystemOutput *)malloc(sizeof(SystemOutput));
+	if (output == NULL)
+		return NULL;
+	output->buffer = (char *)malloc(SYSTEM_OUTPUT_BUFFER_SIZE);
+	if (output->buffer == NULL)
+	{
+		free(output);
+		return NULL;
+	}
+	output->sink = sink;
+	output->policy = policy;
+	output->length = 0;
+	output->capacity = SYSTEM_OUTPUT_BUFFER_SIZE;
+	output->flush_size = SYSTEM_OUTPUT_BUFFER_SIZE;
+	output->flush_interval_us = SYSTEM_OUTPUT_INTERVAL_US;
+	output->last_flush_us = system_time_us();
+	output->write_calls = 0;
+	output->failed = 0;
+	return output;
+}
+
+void system_output_destroy(SystemOutput *output)
+{
+	if (output == NULL)
+		return;
+	system_output_flush(output);
+	system_sink_free(&output->sink);
+	free(output->buffer);
+	free(output);
+}
+
+void system_output_set_policy(SystemOutput *output, SystemFlushPolicy policy, size_t flush_size, unsigned long long flush_interval_us)
+{
+	system_output_flush(output);
+	output->policy = policy;
+	output->flush_size = flush_size > 0 ? flush_size : SYSTEM_OUTPUT_BUFFER_SIZE;
+	output->flush_interval_us = flush_interval_us;
+
+	// The buffer is sized to the threshold. Keep the old one if it can't be resized
+	char *buffer = (char *)realloc(output->buffer, output->flush_size);
+	if (buffer != NULL)
+	{
+		output->buffer = buffer;
+		output->capacity = output->flush_size;
+	}
+}
+
+void system_output_set_sink(SystemOutput *output, SystemSink sink)
+{
+	system_output_flush(output);
+	system_sink_free(&output->sink);
+	output->sink = sink;
+	output->failed = 0;
+}
+
+int system_output_flush(SystemOutput *output)
+{
+	if (output->length == 0)
+		return output->failed ? -1 : 0;
+	// Nothing more is written once the other end is gone
+	if (output->failed)
+	{
+		output->length = 0;
+		return -1;
+	}
+
+	size_t written = 0;
+	int result = 0;
+	while (written < output->length)
+	{
+		long count = system_sink_write(&output->sink, output->buffer + written, output->length - written);
+		output->write_calls++;
+		if (count <= 0)
+		{
+			output->failed = 1;
+			result = -1;
+			break;
+		}
+		written += count;
+	}
+
+	output->length = 0;
+	output->last_flush_us = system_time_us();
+	return result;
+}
+
+void system_output_write(SystemOutput *output, const char *str, size_t length)
+{
+	if (output->length + length > output->capacity)
+	{
+		// Keep growing up to the largest buffer when only flushing at exit
+		size_t capacity = output->capacity;
+		if (output->policy == SYSTEM_FLUSH_EXIT)
+			while (capacity < output->length + length && capacity < SYSTEM_OUTPUT_MAX_BUFFER)
+				capacity *= 2;
+		char *buffer = capacity > output->capacity ? (char *)realloc(output->buffer, capacity) : NULL;
+		if (buffer != NULL)
+		{
+			output->buffer = buffer;
+			output->capacity = capacity;
+		}
+		if (output->length + length > output->capacity)
+			system_output_flush(output);
+	}
+
+	if (length > output->capacity)
+	{
+		// Too large to buffer, write it out directly
+		const char *buffer = output->buffer;
+		output->buffer = (char *)str;
+		output->length = length;
+		system_output_flush(output);
+		output->buffer = (char *)buffer;
+		return;
+	}
+
+	memcpy(output->buffer + output->length, str, length);
+	output->length += length;
+
+	if (output->policy == SYSTEM_FLUSH_SIZE && output->length >= output->flush_size)
+		system_output_flush(output);
+}
+
+void system_output_end_line(SystemOutput *output)
+{
+	system_output_write(output, "\n", 1);
+	switch (output->policy)
+	{
+	case SYSTEM_FLUSH_LINE:
+		system_output_flush(output);
+		break;
+	case SYSTEM_FLUSH_INTERVAL:
+		system_output_poll(output);
+		break;
+	default:
+		break;
+	}
+}
+
+void system_output_poll(SystemOutput *output)
+{
+	if (output->policy == SYSTEM_FLUSH_INTERVAL && output->length > 0 &&
+		system_time_us() - output->last_flush_us >= output->flush_interval_us)
+		system_output_flush(output);
+}
+
+void system_tty_write(SystemOutput *output, const char *str)
+{
+	system_output_write(output, str, strlen(str));
+}
+
+void system_tty_printf(SystemOutput *output, const char *format, ...)
+{
+	char buffer[256];
 	va_list args;
 	va_start(args, format);
-	vfprintf(stdout, format, args);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (length < 0)
+		return;
+	if ((size_t)length < sizeof(buffer))
+	{
+		system_output_write(output, buffer, length);
+		return;
+	}
+
+	// Too long for the stack buffer
+	char *text = (char *)malloc(length + 1);
+	if (text == NULL)
+		return;
+	va_start(args, format);
+	vsnprintf(text, length + 1, format, args);
 	va_end(args);
+	system_output_write(output, text, length);
+	free(text);
 }
 
-void system_tty_flush_output()
+void system_tty_flush_output(SystemOutput *output)
 {
-	fflush(stdout);
+	system_output_flush(output);
 }
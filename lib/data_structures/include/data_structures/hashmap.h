@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open addressing hash map with group probing */
+
+// Slots are looked at in groups of this many control bytes at a time
+#define HASHMAP_GROUP_WIDTH 16
+// Smallest number of slots of a map that holds anything
+#define HASHMAP_MIN_CAPACITY 16
+
+/**
+ * Compares a key stored in the map with a key being looked up. Maps without one compare
+ * the keys as integers.
+ */
+typedef int (*hashmap_key_equal)(uint64_t stored_key, uint64_t key);
+
+/**
+ * Each slot has a control byte: empty, deleted, or the low 7 bits of the hash of its key.
+ * A lookup compares a whole group of control bytes with those 7 bits at once, and only
+ * compares the keys of the slots that match. Entries keep the full hash of their key, so
+ * growing the map never hashes a key again.
+ */
+typedef struct
+{
+	// One byte per slot, followed by a copy of the first group so groups can be read past the end
+	uint8_t *ctrl;
+	// Entries of entry_size bytes: the key, its hash, then value_size bytes of value
+	uint8_t *entries;
+	size_t capacity;
+	size_t count;
+	// Deleted slots, which are only reused by insertions
+	size_t tombstones;
+	size_t value_size;
+	size_t entry_size;
+	hashmap_key_equal key_equal;
+} HashMap;
+
+/**
+ * Set up an empty map whose values are `value_size` bytes. Nothing is allocated until the first insertion.
+ */
+void hashmap_init(HashMap *map, size_t value_size, hashmap_key_equal key_equal);
+void hashmap_free(HashMap *map);
+
+/**
+ * Returns the value of the key, or NULL if it is not in the map.
+ */
+void *hashmap_find(const HashMap *map, uint64_t key, uint64_t hash);
+
+/**
+ * Returns the value of the key, adding the key with a zeroed value first if it is not in the map.
+ * `inserted` (if not NULL) is set to 1 if the key was added. Returns NULL if the map could not grow.
+ */
+void *hashmap_insert(HashMap *map, uint64_t key, uint64_t hash, int *inserted);
+
+/**
+ * Removes the key. Returns 1 if it was in the map, otherwise 0.
+ */
+int hashmap_remove(HashMap *map, uint64_t key, uint64_t hash);
+
+/**
+ * Steps through the entries in slot order. Start with `*position` at 0. Returns the value of the
+ * next entry and sets `key` (if not NULL), or NULL after the last one.
+ */
+void *hashmap_next(const HashMap *map, size_t *position, uint64_t *key);
+
+// Hashes with every bit depending on every input bit, as the control bytes use the low bits
+uint64_t hashmap_hash_u64(uint64_t value);
+uint64_t hashmap_hash_bytes(const void *data, size_t length);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "hashmap.h"
+
+#include <stdint.h>
+
+/* String interning */
+
+/**
+ * Keeps one copy of each string it is given, and numbers them in the order they were first seen.
+ * Equal strings get the same id, so they can be compared and hashed as integers afterwards.
+ */
+typedef struct
+{
+	// Keys are the stored copies, values are their ids
+	HashMap map;
+	// Stored copies and their hashes, by id
+	char **strings;
+	uint64_t *hashes;
+	uint32_t count;
+	uint32_t capacity;
+} StringInterner;
+
+void interner_init(StringInterner *interner);
+// Frees every stored copy
+void interner_free(StringInterner *interner);
+
+/**
+ * Returns the id of the string, storing a copy the first time it is seen, or -1 if the copy could not be allocated.
+ */
+long interner_intern(StringInterner *interner, const char *string);
+
+const char *interner_string(const StringInterner *interner, uint32_t id);
+// Hash of the string with this id, computed once when it was stored
+uint64_t interner_hash(const StringInterner *interner, uint32_t id);
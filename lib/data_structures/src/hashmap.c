@@ -0,0 +1,267 @@
+#include "data_structures/hashmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Groups of control bytes are compared 16 at a time with SSE2 where it is available
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+// Control bytes. Both free states have the high bit set, full slots hold 7 bits of the hash
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+
+// Offset of the value in an entry, after the key and hash
+#define ENTRY_HEADER_SIZE (2 * sizeof(uint64_t))
+
+uint64_t hashmap_hash_u64(uint64_t value)
+{
+	// splitmix64 finalizer
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ull;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+uint64_t hashmap_hash_bytes(const void *data, size_t length)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ length, word;
+	for (; length >= sizeof(word); bytes += sizeof(word), length -= sizeof(word))
+	{
+		memcpy(&word, bytes, sizeof(word));
+		hash = (hash ^ hashmap_hash_u64(word)) * 0x9E3779B97F4A7C15ull;
+	}
+	if (length > 0)
+	{
+		word = 0;
+		memcpy(&word, bytes, length);
+		hash = (hash ^ hashmap_hash_u64(word)) * 0x9E3779B97F4A7C15ull;
+	}
+	return hashmap_hash_u64(hash);
+}
+
+// Bit i is set if byte i of the group equals the given byte
+unsigned int hashmap_group_match(const uint8_t *group, uint8_t byte)
+{
+#ifdef HASHMAP_SSE2
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < HASHMAP_GROUP_WIDTH; i++)
+		mask |= (unsigned int)(group[i] == byte) << i;
+	return mask;
+#endif
+}
+
+// Bit i is set if slot i of the group is empty or deleted
+unsigned int hashmap_group_match_free(const uint8_t *group)
+{
+#ifdef HASHMAP_SSE2
+	return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < HASHMAP_GROUP_WIDTH; i++)
+		mask |= (unsigned int)(group[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+int hashmap_lowest_bit(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(mask);
+#else
+	int bit = 0;
+	while ((mask & 1) == 0)
+	{
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+uint8_t *hashmap_entry(const HashMap *map, size_t slot)
+{
+	return map->entries + slot * map->entry_size;
+}
+
+void hashmap_set_ctrl(HashMap *map, size_t slot, uint8_t ctrl)
+{
+	map->ctrl[slot] = ctrl;
+	// Keep the copy of the first group after the end in step
+	if (slot < HASHMAP_GROUP_WIDTH)
+		map->ctrl[map->capacity + slot] = ctrl;
+}
+
+// Groups are visited at triangular offsets, which reaches every slot as the capacity is a power of two
+
+// Slot holding the key, or capacity if it is not in the map
+size_t hashmap_find_slot(const HashMap *map, uint64_t key, uint64_t hash)
+{
+	if (map->capacity == 0)
+		return 0;
+
+	size_t mask = map->capacity - 1, pos = (size_t)(hash >> 7) & mask, step = 0;
+	uint8_t tag = (uint8_t)(hash & 0x7F);
+	while (1)
+	{
+		const uint8_t *group = map->ctrl + pos;
+		unsigned int match = hashmap_group_match(group, tag);
+		while (match != 0)
+		{
+			size_t slot = (pos + hashmap_lowest_bit(match)) & mask;
+			const uint8_t *entry = hashmap_entry(map, slot);
+			uint64_t stored_key, stored_hash;
+			memcpy(&stored_key, entry, sizeof(stored_key));
+			memcpy(&stored_hash, entry + sizeof(stored_key), sizeof(stored_hash));
+			if (stored_hash == hash && (map->key_equal != NULL ? map->key_equal(stored_key, key) : stored_key == key))
+				return slot;
+			match &= match - 1;
+		}
+		// A key is never placed past an empty slot of its probe sequence
+		if (hashmap_group_match(group, CTRL_EMPTY) != 0)
+			return map->capacity;
+		step += HASHMAP_GROUP_WIDTH;
+		pos = (pos + step) & mask;
+	}
+}
+
+// First empty or deleted slot along the probe sequence of the hash
+size_t hashmap_find_free_slot(const HashMap *map, uint64_t hash)
+{
+	size_t mask = map->capacity - 1, pos = (size_t)(hash >> 7) & mask, step = 0;
+	while (1)
+	{
+		unsigned int match = hashmap_group_match_free(map->ctrl + pos);
+		if (match != 0)
+			return (pos + hashmap_lowest_bit(match)) & mask;
+		step += HASHMAP_GROUP_WIDTH;
+		pos = (pos + step) & mask;
+	}
+}
+
+int hashmap_resize(HashMap *map, size_t capacity)
+{
+	HashMap resized = *map;
+	resized.capacity = capacity;
+	resized.count = resized.tombstones = 0;
+	resized.ctrl = (uint8_t *)malloc(capacity + HASHMAP_GROUP_WIDTH);
+	resized.entries = (uint8_t *)malloc(capacity * map->entry_size);
+	if (resized.ctrl == NULL || resized.entries == NULL)
+	{
+		free(resized.ctrl);
+		free(resized.entries);
+		return 1;
+	}
+	memset(resized.ctrl, CTRL_EMPTY, capacity + HASHMAP_GROUP_WIDTH);
+
+	// Move the entries using the hashes they were stored with
+	for (size_t slot = 0; slot < map->capacity; slot++)
+	{
+		if (map->ctrl[slot] & 0x80)
+			continue;
+		const uint8_t *entry = hashmap_entry(map, slot);
+		uint64_t hash;
+		memcpy(&hash, entry + sizeof(uint64_t), sizeof(hash));
+		size_t new_slot = hashmap_find_free_slot(&resized, hash);
+		hashmap_set_ctrl(&resized, new_slot, (uint8_t)(hash & 0x7F));
+		memcpy(hashmap_entry(&resized, new_slot), entry, map->entry_size);
+		resized.count++;
+	}
+
+	free(map->ctrl);
+	free(map->entries);
+	*map = resized;
+	return 0;
+}
+
+void hashmap_init(HashMap *map, size_t value_size, hashmap_key_equal key_equal)
+{
+	map->ctrl = NULL;
+	map->entries = NULL;
+	map->capacity = map->count = map->tombstones = 0;
+	map->value_size = value_size;
+	map->entry_size = ENTRY_HEADER_SIZE + ((value_size + 7) & ~(size_t)7);
+	map->key_equal = key_equal;
+}
+
+void hashmap_free(HashMap *map)
+{
+	free(map->ctrl);
+	free(map->entries);
+	hashmap_init(map, map->value_size, map->key_equal);
+}
+
+void *hashmap_find(const HashMap *map, uint64_t key, uint64_t hash)
+{
+	size_t slot = hashmap_find_slot(map, key, hash);
+	if (slot >= map->capacity)
+		return NULL;
+	return hashmap_entry(map, slot) + ENTRY_HEADER_SIZE;
+}
+
+void *hashmap_insert(HashMap *map, uint64_t key, uint64_t hash, int *inserted)
+{
+	size_t slot = hashmap_find_slot(map, key, hash);
+	if (inserted != NULL)
+		*inserted = 0;
+	if (slot < map->capacity)
+		return hashmap_entry(map, slot) + ENTRY_HEADER_SIZE;
+
+	// Keep at least 1/8 of the slots empty so lookups of missing keys stop early. If deleted
+	// slots are what fills the map, rehash at the same size to clear them
+	if ((map->count + map->tombstones + 1) * 8 > map->capacity * 7)
+	{
+		size_t capacity = map->capacity == 0 ? HASHMAP_MIN_CAPACITY : map->capacity;
+		if ((map->count + 1) * 16 > capacity * 7)
+			capacity *= 2;
+		if (hashmap_resize(map, capacity) != 0)
+			return NULL;
+	}
+
+	slot = hashmap_find_free_slot(map, hash);
+	if (map->ctrl[slot] == CTRL_DELETED)
+		map->tombstones--;
+	hashmap_set_ctrl(map, slot, (uint8_t)(hash & 0x7F));
+	map->count++;
+
+	uint8_t *entry = hashmap_entry(map, slot);
+	memcpy(entry, &key, sizeof(key));
+	memcpy(entry + sizeof(key), &hash, sizeof(hash));
+	memset(entry + ENTRY_HEADER_SIZE, 0, map->entry_size - ENTRY_HEADER_SIZE);
+	if (inserted != NULL)
+		*inserted = 1;
+	return entry + ENTRY_HEADER_SIZE;
+}
+
+int hashmap_remove(HashMap *map, uint64_t key, uint64_t hash)
+{
+	size_t slot = hashmap_find_slot(map, key, hash);
+	if (slot >= map->capacity)
+		return 0;
+	// The slot may be in the middle of another key's probe sequence, so it can't become empty
+	hashmap_set_ctrl(map, slot, CTRL_DELETED);
+	map->count--;
+	map->tombstones++;
+	return 1;
+}
+
+void *hashmap_next(const HashMap *map, size_t *position, uint64_t *key)
+{
+	for (; *position < map->capacity; (*position)++)
+	{
+		if (map->ctrl[*position] & 0x80)
+			continue;
+		uint8_t *entry = hashmap_entry(map, (*position)++);
+		if (key != NULL)
+			memcpy(key, entry, sizeof(*key));
+		return entry + ENTRY_HEADER_SIZE;
+	}
+	return NULL;
+}
@@ -0,0 +1,78 @@
+#include "data_structures/interner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Keys of the map are pointers to strings
+int interner_key_equal(uint64_t stored_key, uint64_t key)
+{
+	return strcmp((const char *)(uintptr_t)stored_key, (const char *)(uintptr_t)key) == 0;
+}
+
+void interner_init(StringInterner *interner)
+{
+	hashmap_init(&interner->map, sizeof(uint32_t), interner_key_equal);
+	interner->strings = NULL;
+	interner->hashes = NULL;
+	interner->count = interner->capacity = 0;
+}
+
+void interner_free(StringInterner *interner)
+{
+	for (uint32_t i = 0; i < interner->count; i++)
+		free(interner->strings[i]);
+	free(interner->strings);
+	free(interner->hashes);
+	hashmap_free(&interner->map);
+	interner_init(interner);
+}
+
+long interner_intern(StringInterner *interner, const char *string)
+{
+	size_t length = strlen(string);
+	uint64_t hash = hashmap_hash_bytes(string, length);
+	uint32_t *id = (uint32_t *)hashmap_find(&interner->map, (uint64_t)(uintptr_t)string, hash);
+	if (id != NULL)
+		return *id;
+
+	if (interner->count == interner->capacity)
+	{
+		uint32_t capacity = interner->capacity == 0 ? 16 : interner->capacity * 2;
+		char **strings = (char **)realloc(interner->strings, sizeof(char *) * capacity);
+		if (strings == NULL)
+			return -1;
+		interner->strings = strings;
+		uint64_t *hashes = (uint64_t *)realloc(interner->hashes, sizeof(uint64_t) * capacity);
+		if (hashes == NULL)
+			return -1;
+		interner->hashes = hashes;
+		interner->capacity = capacity;
+	}
+
+	char *copy = (char *)malloc(length + 1);
+	if (copy == NULL)
+		return -1;
+	memcpy(copy, string, length + 1);
+
+	// The copy is the key, as the string given may not last
+	id = (uint32_t *)hashmap_insert(&interner->map, (uint64_t)(uintptr_t)copy, hash, NULL);
+	if (id == NULL)
+	{
+		free(copy);
+		return -1;
+	}
+	*id = interner->count;
+	interner->strings[interner->count] = copy;
+	interner->hashes[interner->count] = hash;
+	return interner->count++;
+}
+
+const char *interner_string(const StringInterner *interner, uint32_t id)
+{
+	return interner->strings[id];
+}
+
+uint64_t interner_hash(const StringInterner *interner, uint32_t id)
+{
+	return interner->hashes[id];
+}
@@ -1,26 +1,51 @@
 #pragma once
 
-// Which request method was used
+#include "http/http_parser.h"
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+// Request bodies up to this size are received before the request is handled by http_respond_request()
+#define HTTP_MAX_BUFFERED_BODY (10 * 1048576)
+// Files kept open by http_respond_file() in each thread, to send them again without opening them
+#define HTTP_FILE_CACHE_SIZE 32
+
+// Content encodings of a response body
 typedef enum
 {
-	METHOD_UNKNOWN,
-	METHOD_GET,
-	METHOD_POST
-} HTTPMETHOD;
+	HTTP_ENCODING_IDENTITY,
+	HTTP_ENCODING_GZIP,
+	HTTP_ENCODING_BROTLI,
+	HTTP_ENCODING_COUNT
+} HTTPENCODING;
 
-// Request header parameters passed by the Web Browser
+// Request header parameters passed by the Web Browser. The text fields are views into 'buffer'
 typedef struct _http_req_header
 {
+	// The request as received: the header, then as much of the body as was read
 	char *buffer;
 	int buffer_len;
 	int data_start, data_read_len;
 
-	char *header_string;
 	HTTPMETHOD method;
-	char fetch_path[256];
-	int content_length;
-	char query_string[4][256];
-	int query_string_count;
+	// Path of the request target, and its query string, for http_next_query_parameter()
+	http_view path, query;
+	// Length of the body, or -1 if there is no Content-Length
+	long content_length;
+	// The client speaks HTTP/1.1, so it can take a chunked body
+	int http_1_1;
+	// An HTTP/1.1 request without "Connection: close", whose connection can take another request
+	int keep_alive;
+	// The body is sent with a Transfer-Encoding, which is not supported, so its end is not known
+	int transfer_encoding;
+	// Encodings from Accept-Encoding, a bit (1 << HTTPENCODING) for each
+	unsigned int accept_encoding;
+	// ETags of the copies the client has
+	http_view if_none_match;
+	// Last-Modified date of the copy the client has
+	http_view if_modified_since;
+	// The parsed header, for the other fields
+	const http_parser *parser;
 } http_request_header;
 
 // Header parameters to send back to the Web Browser as a response
@@ -28,19 +53,65 @@ typedef struct _http_resp_header
 {
 	unsigned int status_code;
 	char content_type[64];
+	// Length of the body, or -1 if it is not known when the header is written. Such a body is sent
+	// in chunks to HTTP/1.1 clients, otherwise closing the connection ends it
+	long content_length;
+	// Whether the connection is kept open for another request. Clear it before writing the header to close it
+	int keep_alive;
+	int http_1_1;
+	// Names of the trailer fields that a chunked body ends with, for the Trailer header, or NULL
+	const char *trailer;
+	// More header lines, added with http_add_header()
+	char headers[512];
+	int headers_len;
+	// Set by http_write_header
+	int header_sent, chunked;
+	// Body bytes and chunks written so far, without the chunk framing
+	long body_sent;
+	int chunks_sent;
+	// Socket of the response, for http_body_writer()
+	int sock_fd;
 } http_response_header;
 
+// A file built into the program, with compressed copies made at build time. A copy that was not made has a NULL body
+typedef struct
+{
+	const char *path;
+	const char *content_type;
+	// Seconds clients may use their copy without asking again, 0 to check the ETag every time
+	int max_age;
+	const unsigned char *body[HTTP_ENCODING_COUNT];
+	size_t length[HTTP_ENCODING_COUNT];
+	// Strong ETag of each copy, with the quotes
+	const char *etag[HTTP_ENCODING_COUNT];
+} http_static_asset;
+
 // Callback function to generate a response for each request
 typedef void (*http_resp_cb)(int sock_fd, http_request_header *req, http_response_header *res);
 
 // Public functions
 void http_write_header(int sock_fd, http_response_header *header);
+int http_add_header(http_response_header *res, const char *name, const char *value);
+int http_write_body(int sock_fd, http_response_header *res, const char *data, size_t length);
+void http_end_body(int sock_fd, http_response_header *res, const char *trailers);
+long http_body_writer(void *res, const char *data, size_t length);
+void http_respond_text(int sock_fd, http_response_header *res, const char *text);
 void http_respond(int sock_fd, http_resp_cb http_response_generate);
+int http_respond_request(int sock_fd, char *data, int length, void *request_state, int keep_alive, http_resp_cb http_response_generate);
+int http_request_length(const char *data, int length, void *request_state);
 int http_read_body(int sock_fd, http_request_header *req, char *buffer);
-void http_respond_file(int sock_fd, http_response_header *res, char *path, const char *mime_type);
+int http_path_is(const http_request_header *req, const char *path);
+int http_next_query_parameter(const http_request_header *req, int *position, http_view *name, http_view *value);
+void http_respond_file(int sock_fd, http_request_header *req, http_response_header *res, const char *path, const char *mime_type);
+void http_respond_document(int sock_fd, http_request_header *req, http_response_header *res, const char *root);
 void http_respond_status_nf(int sock_fd, http_response_header *res);
+const http_static_asset *http_find_asset(const http_static_asset *assets, int count, const char *path, int path_len);
+void http_respond_asset(int sock_fd, http_request_header *req, http_response_header *res, const http_static_asset *asset);
 
 // Private functions
+int _http_handle_request(int sock_fd, http_request_header *req, const http_parser *parser, int keep_alive, http_resp_cb http_response_generate);
 void _http_get_status(int status_code, char *out_status);
-void _http_parse_request_header(http_request_header *header);
-void _http_parse_query_parameters(char *tmp, http_request_header *header);
+unsigned int _http_parse_accept_encoding(const char *value, int length);
+int _http_etag_matches(const char *if_none_match, int length, const char *etag);
+int _http_open_cached(const char *path, struct stat *info);
+const char *_http_mime_type(const char *path);
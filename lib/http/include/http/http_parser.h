@@ -0,0 +1,79 @@
+#pragma once
+
+// Largest request header accepted by http_parser_execute()
+#define HTTP_MAX_HEADER_SIZE 65536
+
+// Which request method was used
+typedef enum
+{
+	METHOD_UNKNOWN,
+	METHOD_GET,
+	METHOD_POST
+} HTTPMETHOD;
+
+// Part of a request, as its offset and length in the buffer the request was received into. Offsets stay
+// valid when the buffer is grown or moved. A field that was not sent has a length of 0
+typedef struct
+{
+	int offset, length;
+} http_view;
+
+// Where the parser is in the header
+typedef enum
+{
+	HTTP_PARSE_METHOD,
+	HTTP_PARSE_PATH,
+	HTTP_PARSE_QUERY,
+	HTTP_PARSE_VERSION,
+	HTTP_PARSE_FIELD_START,
+	HTTP_PARSE_FIELD_NAME,
+	HTTP_PARSE_FIELD_VALUE,
+	HTTP_PARSE_HEADER_END,
+	HTTP_PARSE_DONE
+} HTTPPARSESTATE;
+
+// Parses a request header in the buffer it is received into, as more of it comes in. Each call goes on from
+// where the last one stopped, so every byte is looked at once. Nothing is copied: the fields are views into
+// the buffer. A zeroed parser is ready for a new request
+typedef struct
+{
+	/* Public */
+	HTTPMETHOD method;
+	// Path of the request target, and the query string after the '?', without it
+	http_view path, query;
+	// The client speaks HTTP/1.1, so it can take a chunked body
+	int http_1_1;
+	// An HTTP/1.1 request without "Connection: close", whose connection can take another request
+	int keep_alive;
+	// Length of the body, or -1 if there is no Content-Length
+	long content_length;
+	// The body is sent with a Transfer-Encoding, which is not supported, so its end is not known
+	int transfer_encoding;
+	// Values of the fields that the server looks at
+	http_view accept_encoding, if_none_match, if_modified_since;
+	// Where the header fields start, for http_parser_next_field(), and how many there are
+	int fields_start, field_count;
+	// Length of the header up to and including the blank line, once it is parsed
+	int header_length;
+
+	/* Private */
+	HTTPPARSESTATE state;
+	// Bytes of the buffer parsed so far
+	int position;
+	// Start of the part being parsed
+	int mark;
+	// Name of the field whose value is being parsed
+	http_view name;
+} http_parser;
+
+// Public functions
+int http_parser_execute(http_parser *parser, const char *data, int length);
+int http_parser_next_field(const http_parser *parser, const char *data, int *position, http_view *name, http_view *value);
+int http_parser_find_field(const http_parser *parser, const char *data, const char *name, http_view *value);
+int http_query_next(const char *data, http_view query, int *position, http_view *name, http_view *value);
+int http_view_equals(const char *data, http_view view, const char *text);
+
+// Private functions
+int _http_parser_field(http_parser *parser, const char *data, http_view name, http_view value);
+int _http_name_is(const char *name, const char *lower, int length);
+http_view _http_view_trim(const char *data, int start, int end);
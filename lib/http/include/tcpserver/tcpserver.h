@@ -1,9 +1,53 @@
 #pragma once
 
 #include <netinet/in.h>
+#include <sys/types.h>
+#include <time.h>
 
 struct _tcp_server;
+// Serves one client connection in the calling process. The handler owns the client socket and closes it.
+// A non-zero return means the connection could not be handled, and the server closes the socket instead
 typedef int (*tcpserver_handler)(int cli_sock, struct _tcp_server *tcpsv);
+// Serves a request that the server received into memory, along with the state request_length left. With
+// 'keep_alive', the connection may stay open for another request, which the handler asks for by returning 1.
+// Otherwise the server closes the connection
+typedef int (*tcpserver_request_handler)(int cli_sock, char *request, int request_len, void *request_state, int keep_alive, struct _tcp_server *tcpsv);
+// Finds the length of the request from the bytes received so far: 0 while it is not known yet, or -1 if the
+// request is invalid. 'state' is request_state_size bytes kept with the connection and zeroed for each request,
+// where the search can be resumed from, such as by parsing the header as it comes in
+typedef int (*tcpserver_request_length)(const char *data, int length, void *state);
+
+// How the server hands connections to the handler
+typedef enum
+{
+	// A new process is forked for every accepted connection
+	TCPSERVER_FORK_PER_CONNECTION,
+	// A fixed number of worker processes are forked at startup, and each of them accepts connections
+	// and runs the handler itself. The parent process only supervises them
+	TCPSERVER_PREFORK,
+	// Pre-forked workers that each run an epoll event loop. Connections are read without blocking, and
+	// request_handler is only called once the whole request is in, so slow clients don't hold up a worker
+	TCPSERVER_EPOLL,
+	// Pre-forked workers that each run thread_count threads. Every thread accepts connections and runs
+	// client_handler, so the handler must only use per-thread or per-request state
+	TCPSERVER_THREADS,
+	// Like TCPSERVER_EPOLL, but each worker waits on an io_uring instead: one multishot accept, and receives
+	// into buffers provided to the kernel. Falls back to epoll if the library was built without io_uring
+	// or the kernel does not support it
+	TCPSERVER_IO_URING
+} tcpserver_mode;
+
+// A pre-forked worker process
+typedef struct
+{
+	// 0 if the worker is not running
+	pid_t pid;
+	// Socket the worker accepts connections on
+	int sock;
+	time_t started;
+	// A worker that crashed right after starting is only replaced after this time
+	time_t restart_at;
+} tcpserver_worker;
 
 typedef struct _tcp_server
 {
@@ -12,6 +56,32 @@ typedef struct _tcp_server
 	unsigned int listen_port;
 	// Which function to call when a new client connects
 	tcpserver_handler client_handler;
+	// Used instead of client_handler if both are set, and always by the event loops. The server then reads
+	// each request whole and serves the requests of a connection one after another
+	tcpserver_request_handler request_handler;
+	tcpserver_request_length request_length;
+	// Size of the state request_length keeps for each connection, at least an int
+	int request_state_size;
+	tcpserver_mode mode;
+	// Number of worker processes in the pre-fork, event loop and io_uring modes
+	int worker_count;
+	// Threads of each worker process in the thread mode
+	int thread_count;
+	// A worker exits and is replaced after handling this many connections, 0 for no limit.
+	// Not used by the thread mode
+	int worker_max_requests;
+	// Give each worker its own listening socket with SO_REUSEPORT, so that the kernel spreads
+	// connections evenly between them instead of waking whichever worker accepts first
+	int reuse_port;
+	// Most processes serving connections at the same time in the fork per connection mode, 0 for no limit
+	int max_children;
+	// The event loops close connections that sent nothing for this many seconds, 0 to keep them
+	int idle_timeout;
+	// Most requests served on one connection, 0 for no limit
+	int max_connection_requests;
+	// Without an event loop, a process or thread waits this many seconds for the next request of a connection,
+	// 0 to close connections after one request. A pre-fork worker stops waiting when another connection comes in
+	int keep_alive_timeout;
 
 	/* Private */
 	// Listening socket file descriptor
@@ -21,6 +91,10 @@ typedef struct _tcp_server
 	// Addresses for listening socket and incoming connections
 	struct sockaddr_in servsock_addr, clisock_addr;
 	int cli_addr_len;
+	// Pre-forked workers
+	tcpserver_worker *workers;
+	// Running child processes of the fork per connection mode
+	int child_count;
 } tcp_server;
 
 // Public functions
@@ -8,6 +8,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
 
 // Linux file IO libraries
 #include <fcntl.h>
@@ -15,101 +18,224 @@
 
 // Linux Socket libraries
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 
 /* Public functions */
 
 // Simple HTTP response header
 void http_write_header(int sock_fd, http_response_header *header)
 {
-	char status_msg[128], buff[256];
+	char status_msg[128], framing[192], buff[1280];
 	_http_get_status(header->status_code, status_msg);
-	sprintf(buff, "HTTP/1.1 %d %s\r\n", header->status_code, status_msg);
-	fd_write_string(sock_fd, buff);
-	sprintf(buff, "Content-Type: %s\r\n", header->content_type);
+
+	// The end of the body has to be known for the connection to take another request
+	header->chunked = 0;
+	if (header->status_code == 304)
+		// Has no body
+		framing[0] = '\0';
+	else if (header->content_length >= 0)
+		snprintf(framing, sizeof(framing), "Content-Length: %ld\r\n", header->content_length);
+	else if (header->http_1_1)
+	{
+		if (header->trailer != NULL)
+			snprintf(framing, sizeof(framing), "Transfer-Encoding: chunked\r\nTrailer: %s\r\n", header->trailer);
+		else
+			strcpy(framing, "Transfer-Encoding: chunked\r\n");
+		header->chunked = 1;
+	}
+	else
+	{
+		// Only closing the connection ends the body
+		framing[0] = '\0';
+		header->keep_alive = 0;
+	}
+
+	// The whole header goes out in one write, so it is one packet instead of four
+	snprintf(buff, sizeof(buff), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nServer: C server\r\n%s%sConnection: %s\r\n\r\n",
+		header->status_code, status_msg, header->content_type, framing, header->headers, header->keep_alive ? "keep-alive" : "close");
 	fd_write_string(sock_fd, buff);
-	fd_write_string(sock_fd, "Server: C server\r\n");
-	fd_write_string(sock_fd, "\r\n");
+	header->header_sent = 1;
+}
+
+// Adds a header line to write with the response header. Returns 1 if there is no room left for it
+int http_add_header(http_response_header *res, const char *name, const char *value)
+{
+	int length = snprintf(res->headers + res->headers_len, sizeof(res->headers) - res->headers_len, "%s: %s\r\n", name, value);
+	if (length >= (int)sizeof(res->headers) - res->headers_len)
+	{
+		res->headers[res->headers_len] = '\0';
+		return 1;
+	}
+	res->headers_len += length;
+	return 0;
+}
+
+// Writes part of the response body, as a chunk if the body is chunked. Returns -1 if the client is gone
+int http_write_body(int sock_fd, http_response_header *res, const char *data, size_t length)
+{
+	if (length == 0)
+		return 0;
+	res->body_sent += length;
+	res->chunks_sent++;
+	if (res->chunked)
+	{
+		// The chunk goes out in one call, so that writers on other threads don't split it
+		char size_line[32];
+		struct iovec parts[3] = {
+			{size_line, (size_t)snprintf(size_line, sizeof(size_line), "%zx\r\n", length)},
+			{(void *)data, length},
+			{"\r\n", 2}};
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = parts;
+		message.msg_iovlen = 3;
+		size_t total = parts[0].iov_len + length + 2;
+		ssize_t sent = sendmsg(sock_fd, &message, MSG_NOSIGNAL);
+		if (sent == (ssize_t)total)
+			return 0;
+		if (sent < 0)
+			return -1;
+		// Rare partial send: write out the rest of the chunk in order
+		for (int i = 0; i < 3; i++)
+		{
+			size_t skip = MIN((size_t)sent, parts[i].iov_len);
+			sent -= skip;
+			for (size_t done = skip; done < parts[i].iov_len;)
+			{
+				ssize_t count = send(sock_fd, (char *)parts[i].iov_base + done, parts[i].iov_len - done, MSG_NOSIGNAL);
+				if (count <= 0)
+					return -1;
+				done += count;
+			}
+		}
+		return 0;
+	}
+
+	for (size_t done = 0; done < length;)
+	{
+		ssize_t count = send(sock_fd, data + done, length - done, MSG_NOSIGNAL);
+		if (count <= 0)
+			return -1;
+		done += count;
+	}
+	return 0;
+}
+
+// Ends a chunked body with the last, empty chunk, followed by the 'trailers' fields ("Name: value\r\n"
+// each, or NULL). Called again after the response callback, and does nothing for other bodies
+void http_end_body(int sock_fd, http_response_header *res, const char *trailers)
+{
+	if (!res->chunked)
+		return;
+	res->chunked = 0;
+	char buff[512];
+	int length = snprintf(buff, sizeof(buff), "0\r\n%s\r\n", trailers != NULL ? trailers : "");
+	if (length >= (int)sizeof(buff))
+		length = snprintf(buff, sizeof(buff), "0\r\n\r\n");
+	if (send(sock_fd, buff, length, MSG_NOSIGNAL) != length)
+		res->keep_alive = 0;
+}
+
+// Writer of the body of the response 'res', in the shape of the sink callbacks of other libraries
+long http_body_writer(void *res, const char *data, size_t length)
+{
+	http_response_header *response = (http_response_header *)res;
+	return http_write_body(response->sock_fd, response, data, length) == 0 ? (long)length : -1;
+}
+
+// Sends the header and a body of known length
+void http_respond_text(int sock_fd, http_response_header *res, const char *text)
+{
+	res->content_length = strlen(text);
+	http_write_header(sock_fd, res);
+	http_write_body(sock_fd, res, text, res->content_length);
 }
 
 // Read request header, and call a callback function to generate the response
 void http_respond(int sock_fd, http_resp_cb http_response_generate)
 {
 	http_request_header req_hdr;
-	http_response_header res_hdr;
-
-	char input_chunk_buffer[128];
-	int buffer_pos = 0, read_len;
+	http_parser parser;
+	memset(&parser, 0, sizeof(parser));
 
-	req_hdr.buffer_len = sizeof(input_chunk_buffer);
-	req_hdr.data_start = 0;
+	req_hdr.buffer_len = 4096;
 	req_hdr.data_read_len = 0;
-
 	req_hdr.buffer = (char *)malloc(req_hdr.buffer_len);
-	memset(req_hdr.buffer, 0, req_hdr.buffer_len);
-	req_hdr.header_string = NULL;
-	req_hdr.query_string_count = 0;
 
-	while (1)
+	// Receive straight into the buffer until the header has ended, parsing each part as it comes in
+	int header_len = 0;
+	while (header_len == 0 && req_hdr.buffer != NULL)
 	{
-		read_len = recv(sock_fd, input_chunk_buffer, sizeof(input_chunk_buffer), 0);
-		if (read_len <= 0)
+		if (req_hdr.data_read_len == req_hdr.buffer_len)
 		{
-			fprintf(stderr, "Socket unexpectedly closed while reading data\n");
-			break;
+			req_hdr.buffer_len *= 2;
+			char *buffer = (char *)realloc(req_hdr.buffer, req_hdr.buffer_len);
+			if (buffer == NULL)
+				break;
+			req_hdr.buffer = buffer;
 		}
 
-		req_hdr.data_read_len += read_len;
-		// Resize buffer if needed
-		if (req_hdr.buffer_len - buffer_pos < read_len)
-		{
-			req_hdr.buffer_len += read_len * 2;
-			req_hdr.buffer = (char *)realloc(req_hdr.buffer, req_hdr.buffer_len);
-		}
-
-		memcpy(req_hdr.buffer + buffer_pos, input_chunk_buffer, read_len);
-		buffer_pos += read_len;
-
-		// Check if end of header is reached
-		int is_header_end = 0;
-		if (req_hdr.data_read_len >= 4)
-		{
-			// Search from end the pattern of header end
-			for (int i = req_hdr.data_read_len; i >= 4; i--)
-			{
-				if (memcmp(req_hdr.buffer + i - 4, "\r\n\r\n", 4) == 0)
-				{
-					is_header_end = 1;
-					req_hdr.data_start = i;
-					break;
-				}
-			}
-		}
-		if (is_header_end)
+		int read_len = recv(sock_fd, req_hdr.buffer + req_hdr.data_read_len, req_hdr.buffer_len - req_hdr.data_read_len, 0);
+		if (read_len <= 0)
 		{
-			req_hdr.header_string = (char *)malloc(req_hdr.data_start + 1);
-			memcpy(req_hdr.header_string, req_hdr.buffer, req_hdr.data_start);
-			req_hdr.header_string[req_hdr.data_start] = '\0';
+			fprintf(stderr, "Socket unexpectedly closed while reading data\n");
 			break;
 		}
+		req_hdr.data_read_len += read_len;
+		header_len = http_parser_execute(&parser, req_hdr.buffer, req_hdr.data_read_len);
 	}
 
 	// At this point, req_hdr.buffer contains the HTTP header + partial content of the body, if sent.
-	// req_hdr.header_string is just the HTTP header.
+	// Anything the client sent after the body would be lost, so the connection ends with this request
+	if (header_len > 0)
+	{
+		req_hdr.data_start = header_len;
+		_http_handle_request(sock_fd, &req_hdr, &parser, 0, http_response_generate);
+	}
 
-	// Parse the header, and then free up the dynamic memory as it is not needed anymore
-	_http_parse_request_header(&req_hdr);
-	free(req_hdr.header_string);
+	free(req_hdr.buffer);
+	close(sock_fd);
+}
 
-	// Default header
-	res_hdr.status_code = 200;
-	strcpy(res_hdr.content_type, "text/plain");
+// Respond to a request that was already received into memory, such as by the event loop of the TCP server.
+// 'data' holds the header and as much of the body as was received. 'request_state' is the parser that
+// http_request_length() used on it, or NULL to parse it here. With 'keep_alive', the connection may stay
+// open if the client wants it to. Returns 1 if it does, then 'length' bytes have been used up.
+// Does not close the socket
+int http_respond_request(int sock_fd, char *data, int length, void *request_state, int keep_alive, http_resp_cb http_response_generate)
+{
+	http_request_header req_hdr;
+	http_parser header_parser;
+	const http_parser *parser = (const http_parser *)request_state;
+	if (parser == NULL || parser->state != HTTP_PARSE_DONE)
+	{
+		memset(&header_parser, 0, sizeof(header_parser));
+		if (http_parser_execute(&header_parser, data, length) <= 0)
+			return 0;
+		parser = &header_parser;
+	}
 
-	// Call the HTTP response generator
-	// TODO: Handle nullptr handler function with stub function
-	http_response_generate(sock_fd, &req_hdr, &res_hdr);
+	req_hdr.buffer = data;
+	req_hdr.buffer_len = length;
+	req_hdr.data_read_len = length;
+	req_hdr.data_start = parser->header_length;
+	return _http_handle_request(sock_fd, &req_hdr, parser, keep_alive, http_response_generate);
+}
 
-	free(req_hdr.buffer);
-	close(sock_fd);
+// Length of the whole request once its header is in, or 0 if the header has not ended yet. 'request_state' is an
+// http_parser, zeroed for each request, so the TCP server's request_state_size must be sizeof(http_parser). Parsing
+// goes on from where the previous call stopped. Returns -1 if the header is invalid or too large. A body over
+// HTTP_MAX_BUFFERED_BODY is left out of the length, so that the request is handled once its header is in and the
+// body can be refused
+int http_request_length(const char *data, int length, void *request_state)
+{
+	http_parser *parser = (http_parser *)request_state;
+	int header_len = http_parser_execute(parser, data, length);
+	if (header_len <= 0 || parser->content_length <= 0 || parser->content_length > HTTP_MAX_BUFFERED_BODY)
+		return header_len;
+	return header_len + (int)parser->content_length;
 }
 
 // Reads the http body into given buffer, upto "Content-Length" bytes
@@ -118,42 +244,106 @@ int http_read_body(int sock_fd, http_request_header *req, char *buffer)
 	int total_read = 0;
 	if (req->content_length > 0)
 	{
-		int data_extra_read = req->data_read_len - req->data_start;
+		// Only take the body of this request, in case the client already sent more
+		int data_extra_read = MIN(req->data_read_len - req->data_start, req->content_length);
 		memcpy(buffer, req->buffer + req->data_start, data_extra_read);
 		total_read += data_extra_read;
 
-		// If still more data is remaining, continue receiving
+		// If still more data is remaining, continue receiving until all of it is in
 		int remaining_bytes = req->content_length - data_extra_read;
 		if (remaining_bytes > 0)
-		{
 			printf("Reading more %d bytes\n", remaining_bytes);
-			total_read += recv(sock_fd, buffer + data_extra_read, remaining_bytes, 0);
+		while (total_read < req->content_length)
+		{
+			int read_len = recv(sock_fd, buffer + total_read, req->content_length - total_read, 0);
+			if (read_len <= 0)
+				return -1;
+			total_read += read_len;
 		}
 	}
 	return total_read;
 }
 
-// Generate response data by reading a file
-void http_respond_file(int sock_fd, http_response_header *res, char *path, const char *mime_type)
+// Whether the path of the request is exactly 'path'
+int http_path_is(const http_request_header *req, const char *path)
+{
+	return http_view_equals(req->buffer, req->path, path);
+}
+
+// Goes through the query parameters of the request, like http_query_next()
+int http_next_query_parameter(const http_request_header *req, int *position, http_view *name, http_view *value)
 {
-	int file_fd;
-	char buffer[4096];
-	int read_size;
+	return http_query_next(req->buffer, req->query, position, name, value);
+}
 
-	if ((file_fd = open(path, O_RDONLY)) < 0)
+// Generate response data by reading a file
+void http_respond_file(int sock_fd, http_request_header *req, http_response_header *res, const char *path, const char *mime_type)
+{
+	struct stat file_stat;
+	int file_fd = _http_open_cached(path, &file_stat);
+	if (file_fd < 0)
 	{
 		http_respond_status_nf(sock_fd, res);
 		return;
 	}
 
-	res->status_code = 200;
+	// Clients send back the date they were given, so it only has to be the same text
+	char last_modified[64];
+	struct tm modified;
+	gmtime_r(&file_stat.st_mtime, &modified);
+	strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT", &modified);
 	strcpy(res->content_type, mime_type);
+	http_add_header(res, "Last-Modified", last_modified);
+	if (http_view_equals(req->buffer, req->if_modified_since, last_modified))
+	{
+		res->status_code = 304;
+		http_write_header(sock_fd, res);
+		return;
+	}
+
+	res->status_code = 200;
+	res->content_length = file_stat.st_size;
 	http_write_header(sock_fd, res);
 
-	while ((read_size = read(file_fd, buffer, sizeof(buffer))) > 0)
-		send(sock_fd, buffer, read_size, 0);
+	// The kernel copies the file to the socket. The offset is passed in, so the shared descriptor has no position to keep
+	off_t offset = 0;
+	while (offset < file_stat.st_size)
+	{
+		ssize_t sent = sendfile(sock_fd, file_fd, &offset, file_stat.st_size - offset);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0)
+			break;
+	}
+	res->body_sent += offset;
+	// A file that shrank while it was sent, or a client that went away, leaves the body short
+	if (offset < file_stat.st_size)
+		res->keep_alive = 0;
+}
 
-	close(file_fd);
+// Serves the file at the request path under the folder 'root', or index.html for a path ending in a slash
+void http_respond_document(int sock_fd, http_request_header *req, http_response_header *res, const char *root)
+{
+	char path[512];
+	const char *request_path = req->buffer + req->path.offset;
+	int path_len = req->path.length;
+
+	// Nothing outside of the folder is served
+	int outside = request_path[0] != '/' || memchr(request_path, '\\', path_len) != NULL;
+	for (int i = 0; !outside && i + 3 <= path_len; i++)
+		outside = memcmp(request_path + i, "/..", 3) == 0;
+	if (outside)
+	{
+		http_respond_status_nf(sock_fd, res);
+		return;
+	}
+	int length = snprintf(path, sizeof(path), "%s%.*s%s", root, path_len, request_path, request_path[path_len - 1] == '/' ? "index.html" : "");
+	if (length >= (int)sizeof(path))
+	{
+		http_respond_status_nf(sock_fd, res);
+		return;
+	}
+	http_respond_file(sock_fd, req, res, path, _http_mime_type(path));
 }
 
 // Generate 404 response
@@ -161,22 +351,255 @@ void http_respond_status_nf(int sock_fd, http_response_header *res)
 {
 	res->status_code = 404;
 	strcpy(res->content_type, "text/plain");
+	http_respond_text(sock_fd, res, "Requested file was not found.");
+}
+
+// Finds the built-in file with the path of 'path_len' bytes, or returns NULL
+const http_static_asset *http_find_asset(const http_static_asset *assets, int count, const char *path, int path_len)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (strncmp(assets[i].path, path, path_len) == 0 && assets[i].path[path_len] == '\0')
+			return &assets[i];
+	}
+	return NULL;
+}
+
+// Sends a built-in file from memory, compressed if the client accepts one of its compressed copies,
+// or 304 Not Modified if the client already has the copy
+void http_respond_asset(int sock_fd, http_request_header *req, http_response_header *res, const http_static_asset *asset)
+{
+	// Smallest copy first
+	static const HTTPENCODING preference[] = {HTTP_ENCODING_BROTLI, HTTP_ENCODING_GZIP, HTTP_ENCODING_IDENTITY};
+	HTTPENCODING encoding = HTTP_ENCODING_IDENTITY;
+	int compressed = 0;
+	for (int i = 0; i < HTTP_ENCODING_COUNT; i++)
+	{
+		if (preference[i] != HTTP_ENCODING_IDENTITY && asset->body[preference[i]] != NULL)
+			compressed = 1;
+		if (asset->body[preference[i]] != NULL && (req->accept_encoding & (1 << preference[i])))
+		{
+			encoding = preference[i];
+			break;
+		}
+	}
+
+	char cache_control[64];
+	if (asset->max_age > 0)
+		snprintf(cache_control, sizeof(cache_control), "public, max-age=%d", asset->max_age);
+	else
+		strcpy(cache_control, "no-cache");
+
+	strcpy(res->content_type, asset->content_type);
+	http_add_header(res, "ETag", asset->etag[encoding]);
+	http_add_header(res, "Cache-Control", cache_control);
+	// Caches must not give a compressed copy to a client that did not ask for it
+	if (compressed)
+		http_add_header(res, "Vary", "Accept-Encoding");
+
+	if (_http_etag_matches(req->buffer + req->if_none_match.offset, req->if_none_match.length, asset->etag[encoding]))
+	{
+		res->status_code = 304;
+		http_write_header(sock_fd, res);
+		return;
+	}
+
+	res->status_code = 200;
+	if (encoding == HTTP_ENCODING_GZIP)
+		http_add_header(res, "Content-Encoding", "gzip");
+	else if (encoding == HTTP_ENCODING_BROTLI)
+		http_add_header(res, "Content-Encoding", "br");
+	res->content_length = asset->length[encoding];
 	http_write_header(sock_fd, res);
-	fd_write_string(sock_fd, "Requested file was not found.");
+	http_write_body(sock_fd, res, (const char *)asset->body[encoding], asset->length[encoding]);
 }
 
 /* Private functions */
 
-void _http_parse_query_parameters(char *tmp, http_request_header *header)
+// A file opened by http_respond_file(), along with its status when it was opened
+typedef struct
+{
+	char path[512];
+	int fd;
+	struct stat info;
+	unsigned long last_used;
+} http_cached_file;
+
+// Each thread keeps its own files, so that serving them takes no lock
+THREAD_LOCAL http_cached_file http_file_cache[HTTP_FILE_CACHE_SIZE];
+THREAD_LOCAL unsigned long http_file_cache_clock;
+
+// Opens a regular file, or finds it already open. The descriptor belongs to the cache and stays open. A file that
+// was changed or replaced since it was opened has another modification time, size or inode, and is opened again.
+// Returns -1 if the file can't be opened
+int _http_open_cached(const char *path, struct stat *info)
 {
-	char *path_line, *path_ctx = tmp;
-	// tmp gets cut off till the query string automatically by strtok_r()
-	if ((path_line = strtok_r(path_ctx, "?", &path_ctx)))
+	struct stat current;
+	if (strlen(path) >= sizeof(http_file_cache[0].path) || stat(path, &current) != 0 || !S_ISREG(current.st_mode))
+		return -1;
+
+	// Reuse the entry of the file, or else an unused one, or else the least recently used one
+	http_cached_file *entry = &http_file_cache[0];
+	for (int i = 0; i < HTTP_FILE_CACHE_SIZE; i++)
 	{
-		// Go through each query parameter
-		while ((path_line = strtok_r(path_ctx, "&", &path_ctx)))
-			strcpy(header->query_string[header->query_string_count++], path_line);
+		http_cached_file *candidate = &http_file_cache[i];
+		if (candidate->path[0] != '\0' && strcmp(candidate->path, path) == 0)
+		{
+			entry = candidate;
+			break;
+		}
+		if (entry->path[0] != '\0' && (candidate->path[0] == '\0' || candidate->last_used < entry->last_used))
+			entry = candidate;
+	}
+
+	entry->last_used = ++http_file_cache_clock;
+	if (entry->path[0] != '\0' && strcmp(entry->path, path) == 0 && entry->info.st_ino == current.st_ino &&
+		entry->info.st_dev == current.st_dev && entry->info.st_size == current.st_size &&
+		entry->info.st_mtim.tv_sec == current.st_mtim.tv_sec && entry->info.st_mtim.tv_nsec == current.st_mtim.tv_nsec)
+	{
+		*info = entry->info;
+		return entry->fd;
+	}
+
+	if (entry->path[0] != '\0')
+		close(entry->fd);
+	entry->path[0] = '\0';
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &entry->info) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	strcpy(entry->path, path);
+	entry->fd = fd;
+	*info = entry->info;
+	return fd;
+}
+
+// Content type from the extension of the file
+const char *_http_mime_type(const char *path)
+{
+	static const char *types[][2] = {
+		{".html", "text/html"},
+		{".htm", "text/html"},
+		{".css", "text/css"},
+		{".js", "text/javascript"},
+		{".json", "application/json"},
+		{".txt", "text/plain"},
+		{".bas", "text/plain"},
+		{".svg", "image/svg+xml"},
+		{".png", "image/png"},
+		{".jpg", "image/jpeg"},
+		{".gif", "image/gif"},
+		{".ico", "image/x-icon"},
+		{".wasm", "application/wasm"}};
+	const char *extension = strrchr(path, '.');
+	if (extension != NULL && strchr(extension, '/') == NULL)
+	{
+		for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+		{
+			if (strcasecmp(extension, types[i][0]) == 0)
+				return types[i][1];
+		}
 	}
+	return "application/octet-stream";
+}
+
+// Encodings listed in an Accept-Encoding value of 'length' bytes, leaving out those with "q=0"
+unsigned int _http_parse_accept_encoding(const char *value, int length)
+{
+	unsigned int accepted = 1 << HTTP_ENCODING_IDENTITY;
+	int i = 0;
+	while (i < length)
+	{
+		while (i < length && (value[i] == ' ' || value[i] == ','))
+			i++;
+		int name_start = i;
+		while (i < length && value[i] != ' ' && value[i] != ';' && value[i] != ',')
+			i++;
+		int name_len = i - name_start;
+
+		// Only a weight of exactly zero refuses the encoding
+		int refused = 0;
+		for (; i < length && value[i] != ','; i++)
+		{
+			if (value[i] == '=' && value[i - 1] == 'q')
+			{
+				refused = 1;
+				for (int digit = i + 1; digit < length && value[digit] != ',' && value[digit] != ' '; digit++)
+					refused &= value[digit] == '0' || value[digit] == '.';
+			}
+		}
+		if (!refused && name_len == 4 && strncasecmp(value + name_start, "gzip", 4) == 0)
+			accepted |= 1 << HTTP_ENCODING_GZIP;
+		else if (!refused && name_len == 2 && strncasecmp(value + name_start, "br", 2) == 0)
+			accepted |= 1 << HTTP_ENCODING_BROTLI;
+	}
+	return accepted;
+}
+
+// Whether an If-None-Match value of 'length' bytes lists the ETag, or is "*". Weak ETags also match, as they may be used here
+int _http_etag_matches(const char *if_none_match, int length, const char *etag)
+{
+	if (length == 0 || etag == NULL)
+		return 0;
+	if (length == 1 && if_none_match[0] == '*')
+		return 1;
+
+	// The quotes around each ETag keep one from matching part of another
+	int etag_len = (int)strlen(etag);
+	for (int i = 0; i + etag_len <= length; i++)
+	{
+		if (memcmp(if_none_match + i, etag, etag_len) == 0 &&
+			(i + etag_len == length || if_none_match[i + etag_len] == ',' || if_none_match[i + etag_len] == ' '))
+			return 1;
+	}
+	return 0;
+}
+
+// Call the callback function to generate the response to the request that 'parser' parsed.
+// Returns 1 if the connection can take another request
+int _http_handle_request(int sock_fd, http_request_header *req, const http_parser *parser, int keep_alive, http_resp_cb http_response_generate)
+{
+	http_response_header res_hdr;
+
+	// The fields stay where they are in the buffer
+	req->parser = parser;
+	req->method = parser->method;
+	req->path = parser->path;
+	req->query = parser->query;
+	req->content_length = parser->content_length;
+	req->http_1_1 = parser->http_1_1;
+	req->keep_alive = parser->keep_alive;
+	req->transfer_encoding = parser->transfer_encoding;
+	req->accept_encoding = _http_parse_accept_encoding(req->buffer + parser->accept_encoding.offset, parser->accept_encoding.length);
+	req->if_none_match = parser->if_none_match;
+	req->if_modified_since = parser->if_modified_since;
+
+	// Default header
+	res_hdr.status_code = 200;
+	strcpy(res_hdr.content_type, "text/plain");
+	res_hdr.content_length = -1;
+	res_hdr.http_1_1 = req->http_1_1;
+	res_hdr.trailer = NULL;
+	res_hdr.headers[0] = '\0';
+	res_hdr.headers_len = 0;
+	res_hdr.header_sent = res_hdr.chunked = 0;
+	res_hdr.body_sent = 0;
+	res_hdr.chunks_sent = 0;
+	res_hdr.sock_fd = sock_fd;
+	// The next request starts right after the body, so the body must be in memory and framed by its length
+	res_hdr.keep_alive = keep_alive && req->keep_alive && !req->transfer_encoding &&
+		MAX(req->content_length, 0) <= req->data_read_len - req->data_start;
+
+	// Call the HTTP response generator
+	// TODO: Handle nullptr handler function with stub function
+	http_response_generate(sock_fd, req, &res_hdr);
+	http_end_body(sock_fd, &res_hdr, NULL);
+
+	return res_hdr.header_sent && res_hdr.keep_alive;
 }
 
 // Convert status code to string
@@ -184,6 +607,11 @@ void _http_get_status(int status_code, char *out_status)
 {
 	switch (status_code)
 	{
+	// Redirection
+	case 304:
+		strcpy(out_status, "Not Modified");
+		break;
+
 	// Client-side errors
 	case 403:
 		strcpy(out_status, "Forbidden");
@@ -208,79 +636,3 @@ void _http_get_status(int status_code, char *out_status)
 		strcpy(out_status, "OK");
 	}
 }
-
-// Find tokens in the HTTP header string and set the corresponding header fields
-void _http_parse_request_header(http_request_header *header)
-{
-	// For each line in the header
-	char *line_token, *line_ctx = header->header_string;
-	int fname_start, fname_end;
-	int is_header_head = 1;
-
-	// Breaking in the Header line
-	char *hdr_ctx, *hdr_key, *hdr_value;
-
-	// Temporary buffer
-	char tmp[256];
-
-	// Assume default values
-	header->content_length = -1;
-	header->method = METHOD_UNKNOWN;
-
-	// First split string by \r\n lines
-	while ((line_token = strtok_r(line_ctx, "\r\n", &line_ctx)))
-	{
-		// printf("Header line: %s\n", line_token);
-
-		// If this is the first line, aka the method and URI
-		if (strlen(line_token) >= 1)
-		{
-			if (is_header_head)
-			{
-				is_header_head = 0;
-				if (strncmp(line_token, "GET", 3) == 0)
-				{
-					// If it is a GET request, find the URI and mark as "GET"
-					fname_start = 4;
-					fname_end = strlen(line_token) - 9; // size of " HTTP/1.1"
-					memcpy(tmp, line_token + fname_start, fname_end - fname_start);
-					tmp[fname_end - fname_start] = '\0';
-					_http_parse_query_parameters(tmp, header);
-					strcpy(header->fetch_path, tmp);
-					header->method = METHOD_GET;
-				}
-				else if (strncmp(line_token, "POST", 4) == 0)
-				{
-					// If it is a POST request, find the URI and mark as "POST"
-					fname_start = 5;
-					fname_end = strlen(line_token) - 9; // size of " HTTP/1.1"
-					memcpy(tmp, line_token + fname_start, fname_end - fname_start);
-					tmp[fname_end - fname_start] = '\0';
-					_http_parse_query_parameters(tmp, header);
-					strcpy(header->fetch_path, tmp);
-					header->method = METHOD_POST;
-				}
-			}
-			else
-			{
-				// Rest of the headers, like Host, Content-Length, etc.
-				hdr_ctx = line_token;
-				// Split the header by a colon to get key / value
-				hdr_key = strtok_r(hdr_ctx, ":", &hdr_ctx);
-				if (hdr_key == NULL)
-					continue;
-				hdr_value = strtok_r(hdr_ctx, ":", &hdr_ctx);
-				if (hdr_value != NULL)
-				{
-					// Remove one space character after colon
-					if (*hdr_value == ' ')
-						hdr_value++;
-				}
-
-				// Determine what header we got
-				if (strcasecmp(hdr_key, "Content-Length") == 0)
-					header->content_length = atoi(hdr_value);
-			}
-		}
-	}
-}
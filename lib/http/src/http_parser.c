@@ -0,0 +1,314 @@
+
+#include "http/http_parser.h"
+
+// Standard libraries
+#include <string.h>
+#include <strings.h>
+
+// Bytes that may be part of a method, a request target or a field name: anything printable but a space,
+// with 1 for those that end none of them, and 2 for '?' and ':', which end the path and the field name
+static const unsigned char http_token_chars[256] = {
+	['!'] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	[':'] = 2, 1, 1, 1, 1, 2,
+	['@'] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	['`'] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	[0x80] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	[0xa0] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	[0xc0] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	[0xe0] = 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+/* Public functions */
+
+// Parses the header in 'data', which holds the 'length' bytes received so far, going on from where the previous
+// call stopped. Returns the length of the header once it has ended, 0 while more of it is needed, or -1 if the
+// request is invalid or its header is larger than HTTP_MAX_HEADER_SIZE
+int http_parser_execute(http_parser *parser, const char *data, int length)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	const char *found;
+	if (parser->state == HTTP_PARSE_DONE)
+		return parser->header_length;
+	if (parser->position == 0)
+		parser->content_length = -1;
+
+	// Nothing past the largest header is looked at
+	int end = length < HTTP_MAX_HEADER_SIZE ? length : HTTP_MAX_HEADER_SIZE;
+	int i = parser->position;
+	while (i < end)
+	{
+		switch (parser->state)
+		{
+		case HTTP_PARSE_METHOD:
+			// Empty lines before the request line are allowed
+			if (i == parser->mark && (bytes[i] == '\r' || bytes[i] == '\n'))
+			{
+				parser->mark = ++i;
+				break;
+			}
+			while (i < end && http_token_chars[bytes[i]] != 0)
+				i++;
+			if (i == end)
+				break;
+			if (bytes[i] != ' ' || i == parser->mark)
+				return -1;
+			if (i - parser->mark == 3 && memcmp(data + parser->mark, "GET", 3) == 0)
+				parser->method = METHOD_GET;
+			else if (i - parser->mark == 4 && memcmp(data + parser->mark, "POST", 4) == 0)
+				parser->method = METHOD_POST;
+			parser->mark = ++i;
+			parser->state = HTTP_PARSE_PATH;
+			break;
+
+		case HTTP_PARSE_PATH:
+			while (i < end && (http_token_chars[bytes[i]] == 1 || bytes[i] == ':'))
+				i++;
+			if (i == end)
+				break;
+			if ((bytes[i] != ' ' && bytes[i] != '?') || i == parser->mark)
+				return -1;
+			parser->path.offset = parser->mark;
+			parser->path.length = i - parser->mark;
+			parser->query.offset = i + (bytes[i] == '?');
+			parser->state = bytes[i] == '?' ? HTTP_PARSE_QUERY : HTTP_PARSE_VERSION;
+			parser->mark = ++i;
+			break;
+
+		case HTTP_PARSE_QUERY:
+			while (i < end && http_token_chars[bytes[i]] != 0)
+				i++;
+			if (i == end)
+				break;
+			if (bytes[i] != ' ')
+				return -1;
+			parser->query.length = i - parser->mark;
+			parser->state = HTTP_PARSE_VERSION;
+			parser->mark = ++i;
+			break;
+
+		case HTTP_PARSE_VERSION:
+			found = (const char *)memchr(data + i, '\n', end - i);
+			if (found == NULL)
+			{
+				i = end;
+				break;
+			}
+			i = (int)(found - data);
+			{
+				http_view version = _http_view_trim(data, parser->mark, i);
+				if (version.length != 8 || memcmp(data + version.offset, "HTTP/1.", 7) != 0 ||
+					bytes[version.offset + 7] < '0' || bytes[version.offset + 7] > '9')
+					return -1;
+				// Connections of HTTP/1.1 clients stay open unless they ask otherwise
+				parser->http_1_1 = bytes[version.offset + 7] != '0';
+				parser->keep_alive = parser->http_1_1;
+			}
+			parser->fields_start = ++i;
+			parser->state = HTTP_PARSE_FIELD_START;
+			break;
+
+		case HTTP_PARSE_FIELD_START:
+			if (bytes[i] == '\n')
+				goto done;
+			if (bytes[i] == '\r')
+			{
+				parser->state = HTTP_PARSE_HEADER_END;
+				i++;
+				break;
+			}
+			// Values folded over several lines are not supported
+			if (bytes[i] == ' ' || bytes[i] == '\t')
+				return -1;
+			parser->mark = i;
+			parser->state = HTTP_PARSE_FIELD_NAME;
+			// Fall through, the name starts here
+
+		case HTTP_PARSE_FIELD_NAME:
+			while (i < end && (http_token_chars[bytes[i]] == 1 || bytes[i] == '?'))
+				i++;
+			if (i == end)
+				break;
+			if (bytes[i] != ':' || i == parser->mark)
+				return -1;
+			parser->name.offset = parser->mark;
+			parser->name.length = i - parser->mark;
+			parser->state = HTTP_PARSE_FIELD_VALUE;
+			parser->mark = ++i;
+			// Fall through
+
+		case HTTP_PARSE_FIELD_VALUE:
+			found = (const char *)memchr(data + i, '\n', end - i);
+			if (found == NULL)
+			{
+				i = end;
+				break;
+			}
+			i = (int)(found - data);
+			if (_http_parser_field(parser, data, parser->name, _http_view_trim(data, parser->mark, i)) != 0)
+				return -1;
+			parser->field_count++;
+			parser->state = HTTP_PARSE_FIELD_START;
+			i++;
+			break;
+
+		case HTTP_PARSE_HEADER_END:
+			if (bytes[i] != '\n')
+				return -1;
+			goto done;
+
+		case HTTP_PARSE_DONE:
+			break;
+		}
+	}
+
+	parser->position = i;
+	return length >= HTTP_MAX_HEADER_SIZE ? -1 : 0;
+
+done:
+	parser->header_length = parser->position = i + 1;
+	parser->state = HTTP_PARSE_DONE;
+	return parser->header_length;
+}
+
+// Goes through the fields of a parsed header. '*position' starts at 0 and is moved past each field.
+// Returns 1 with the next field, or 0 after the last one
+int http_parser_next_field(const http_parser *parser, const char *data, int *position, http_view *name, http_view *value)
+{
+	int start = *position > 0 ? *position : parser->fields_start;
+	if (parser->state != HTTP_PARSE_DONE || start >= parser->header_length || data[start] == '\r' || data[start] == '\n')
+		return 0;
+
+	// The parser made sure that every line up to the blank one is a field with a colon
+	const char *line_end = (const char *)memchr(data + start, '\n', parser->header_length - start);
+	const char *colon = (const char *)memchr(data + start, ':', line_end - (data + start));
+	name->offset = start;
+	name->length = (int)(colon - (data + start));
+	*value = _http_view_trim(data, (int)(colon - data) + 1, (int)(line_end - data));
+	*position = (int)(line_end - data) + 1;
+	return 1;
+}
+
+// Finds the first field of a parsed header with the given name, in any case. Returns 1 if there is one
+int http_parser_find_field(const http_parser *parser, const char *data, const char *name, http_view *value)
+{
+	int position = 0, name_len = (int)strlen(name);
+	http_view field;
+	while (http_parser_next_field(parser, data, &position, &field, value))
+	{
+		if (field.length == name_len && strncasecmp(data + field.offset, name, name_len) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+// Goes through the parameters of a query string, such as "flag&name=value". '*position' starts at 0 and is moved
+// past each parameter. A parameter without '=' has an empty value. Returns 1 with the next one, or 0 after the last
+int http_query_next(const char *data, http_view query, int *position, http_view *name, http_view *value)
+{
+	const char *start = data + query.offset, *end = start + query.length;
+	const char *item = start + *position;
+	// Empty parameters, as in "a&&b", are skipped
+	while (item < end && *item == '&')
+		item++;
+	if (item >= end)
+		return 0;
+
+	const char *item_end = (const char *)memchr(item, '&', end - item);
+	if (item_end == NULL)
+		item_end = end;
+	const char *equals = (const char *)memchr(item, '=', item_end - item);
+	name->offset = (int)(item - data);
+	name->length = (int)((equals != NULL ? equals : item_end) - item);
+	value->offset = equals != NULL ? (int)(equals + 1 - data) : (int)(item_end - data);
+	value->length = equals != NULL ? (int)(item_end - equals - 1) : 0;
+	*position = (int)(item_end - start);
+	return 1;
+}
+
+// Whether the view holds exactly the text
+int http_view_equals(const char *data, http_view view, const char *text)
+{
+	return (int)strlen(text) == view.length && memcmp(data + view.offset, text, view.length) == 0;
+}
+
+/* Private functions */
+
+// Takes in the fields that the parser keeps. Returns -1 if the field makes the request invalid
+int _http_parser_field(http_parser *parser, const char *data, http_view name, http_view value)
+{
+	const char *field = data + name.offset, *text = data + value.offset;
+	switch (name.length)
+	{
+	case 10:
+		if (_http_name_is(field, "connection", 10))
+		{
+			// A comma separated list, which may have "close" anywhere
+			for (int i = 0; i < value.length; i++)
+			{
+				int start = i;
+				while (i < value.length && text[i] != ',')
+					i++;
+				http_view token = _http_view_trim(data, value.offset + start, value.offset + i);
+				if (token.length == 5 && strncasecmp(data + token.offset, "close", 5) == 0)
+					parser->keep_alive = 0;
+			}
+		}
+		break;
+	case 13:
+		if (_http_name_is(field, "if-none-match", 13))
+			parser->if_none_match = value;
+		break;
+	case 14:
+		if (_http_name_is(field, "content-length", 14))
+		{
+			// Only plain digits: a length that another server along the way reads differently could hide a
+			// request in the body
+			long content_length = 0;
+			if (value.length == 0 || value.length > 15)
+				return -1;
+			for (int i = 0; i < value.length; i++)
+			{
+				if (text[i] < '0' || text[i] > '9')
+					return -1;
+				content_length = content_length * 10 + (text[i] - '0');
+			}
+			if (parser->content_length >= 0 && parser->content_length != content_length)
+				return -1;
+			parser->content_length = content_length;
+		}
+		break;
+	case 15:
+		if (_http_name_is(field, "accept-encoding", 15))
+			parser->accept_encoding = value;
+		break;
+	case 17:
+		if (_http_name_is(field, "transfer-encoding", 17))
+			parser->transfer_encoding = 1;
+		else if (_http_name_is(field, "if-modified-since", 17))
+			parser->if_modified_since = value;
+		break;
+	}
+	return 0;
+}
+
+// Whether a field name is 'lower', a lower case name of letters and dashes, in any case. Quicker than
+// strncasecmp(), which goes through the locale
+int _http_name_is(const char *name, const char *lower, int length)
+{
+	for (int i = 0; i < length; i++)
+	{
+		if ((name[i] | 0x20) != lower[i])
+			return 0;
+	}
+	return 1;
+}
+
+// View of data[start..end) without the white space around it, such as the '\r' of a line
+http_view _http_view_trim(const char *data, int start, int end)
+{
+	while (start < end && (data[start] == ' ' || data[start] == '\t'))
+		start++;
+	while (end > start && (data[end - 1] == ' ' || data[end - 1] == '\t' || data[end - 1] == '\r'))
+		end--;
+	http_view view = {start, end - start};
+	return view;
+}
@@ -1,10 +1,17 @@
+// For accept4()
+#define _GNU_SOURCE
 
 #include "tcpserver/tcpserver.h"
 
+#include <utility/utils.h>
+
 // Standard libraries
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
 
 // Linux file IO libraries
 #include <fcntl.h>
@@ -12,18 +19,92 @@
 
 // Linux Socket libraries
 #include <sys/socket.h>
+#include <netinet/tcp.h>
+
+// Linux process libraries
+#include <sys/wait.h>
+
+// Linux event notification
+#include <poll.h>
+#include <sys/epoll.h>
+
+#include <pthread.h>
+
+#ifdef TCPSERVER_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// Set by SIGINT or SIGTERM to stop the pre-fork supervisor
+volatile sig_atomic_t tcpserver_stopping = 0;
+
+// Opens a TCP socket with the options of the server
+int tcpserver_open_socket(tcp_server *tcpsv)
+{
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock == -1)
+	{
+		fprintf(stderr, "Failed to open listening socket\n");
+		return -1;
+	}
+
+	// Enable the SO_REUSEADDR option
+	int enable = 1;
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
+	{
+		fprintf(stderr, "Failed to set the SO_REUSEADDR socket option\n");
+		close(sock);
+		return -1;
+	}
+
+	// Every socket bound to the port needs SO_REUSEPORT, including the first one
+	if (tcpsv->mode != TCPSERVER_FORK_PER_CONNECTION && tcpsv->reuse_port && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)) < 0)
+	{
+		fprintf(stderr, "Failed to set the SO_REUSEPORT socket option\n");
+		close(sock);
+		return -1;
+	}
+
+	// Responses are often written in a few small parts, such as the header and the body. Accepted connections
+	// inherit TCP_NODELAY, so that a part isn't held back until the client acknowledges the one before
+	if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int)) < 0)
+		fprintf(stderr, "Failed to set the TCP_NODELAY socket option, continuing without it\n");
+
+	return sock;
+}
+
+// Binds the socket to the listening address and starts listening
+int tcpserver_bind_socket(tcp_server *tcpsv, int sock)
+{
+	// Bind listening socket to above IP/port
+	if (bind(sock, (struct sockaddr *)&(tcpsv->servsock_addr), sizeof(tcpsv->servsock_addr)) != 0)
+	{
+		fprintf(stderr, "Failed to bind to port %d. The port may be in use by another application.\n", tcpsv->listen_port);
+		return 1;
+	}
+
+	// Connections wait in the backlog while all workers are busy, so allow as many as the system does
+	if (listen(sock, SOMAXCONN) != 0)
+	{
+		fprintf(stderr, "Failed to make listening socket on port %d\n", tcpsv->listen_port);
+		return 1;
+	}
+
+	return 0;
+}
 
 // Creates a listening TCP socket object
 int tcpserver_create(tcp_server *tcpsv)
 {
+	tcpsv->workers = NULL;
+	tcpsv->child_count = 0;
+
 	// Create a new TCP socket
-	tcpsv->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+	tcpsv->listen_sock = tcpserver_open_socket(tcpsv);
 	tcpsv->cli_addr_len = sizeof(tcpsv->clisock_addr);
 	if (tcpsv->listen_sock == -1)
-	{
-		fprintf(stderr, "Failed to open listening socket\n");
 		return 1;
-	}
 
 	// Set the address to listen to, which is any ip address
 	memset(&(tcpsv->servsock_addr), 0, sizeof(tcpsv->servsock_addr));
@@ -31,57 +112,1218 @@ int tcpserver_create(tcp_server *tcpsv)
 	tcpsv->servsock_addr.sin_addr.s_addr = htonl(INADDR_ANY);
 	tcpsv->servsock_addr.sin_port = htons(tcpsv->listen_port);
 
-	// Enable the SO_REUSEADDR option
-	int enable = 1;
-	if (setsockopt(tcpsv->listen_sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
+	return 0;
+}
+
+/* CONNECTIONS */
+
+// A connection whose requests are read into memory before the request handler is called
+typedef struct _tcpserver_connection
+{
+	int sock;
+	char *buffer;
+	int length, capacity;
+	// Length of the whole request once the framing function knows it, otherwise 0
+	int request_len;
+	// State of request_length for the request, made on first use
+	void *frame_state;
+	time_t last_active;
+	// Requests served on the connection
+	int requests;
+	// io_uring: the receive was cancelled for being idle, and the connection is closed once it completes
+	int closing;
+	// Connections are kept in order of last activity, oldest first, so that idle ones are found at the front
+	struct _tcpserver_connection *prev, *next;
+} tcpserver_connection;
+
+// Calls request_length on what the connection received so far. Returns -1 if the request is invalid
+int tcpserver_connection_frame(tcp_server *tcpsv, tcpserver_connection *conn)
+{
+	if (conn->frame_state == NULL)
 	{
-		fprintf(stderr, "Failed to set the SO_REUSEADDR socket option\n");
-		return 1;
+		conn->frame_state = calloc(1, MAX(tcpsv->request_state_size, (int)sizeof(int)));
+		if (conn->frame_state == NULL)
+			return -1;
 	}
+	return tcpsv->request_length(conn->buffer, conn->length, conn->frame_state);
+}
+
+// Frees the buffers of the connection
+void tcpserver_connection_free(tcpserver_connection *conn)
+{
+	free(conn->buffer);
+	free(conn->frame_state);
+}
+
+// Reads until the whole request is in, or everything the socket has if it does not block. Returns 1 once
+// the request is in, -1 if the connection should be closed, or 0 to wait for more
+int tcpserver_connection_read(tcp_server *tcpsv, tcpserver_connection *conn)
+{
+	while (1)
+	{
+		if (conn->capacity - conn->length < 4096)
+		{
+			int capacity = conn->capacity == 0 ? 8192 : conn->capacity * 2;
+			char *buffer = (char *)realloc(conn->buffer, capacity);
+			if (buffer == NULL)
+				return -1;
+			conn->buffer = buffer;
+			conn->capacity = capacity;
+		}
+
+		ssize_t read_len = recv(conn->sock, conn->buffer + conn->length, conn->capacity - conn->length, 0);
+		if (read_len == 0)
+			return -1;
+		if (read_len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			// Edge-triggered: everything available was read
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+		conn->length += read_len;
+
+		if (conn->request_len == 0)
+		{
+			conn->request_len = tcpserver_connection_frame(tcpsv, conn);
+			if (conn->request_len < 0)
+				return -1;
+		}
+		if (conn->request_len > 0 && conn->length >= conn->request_len)
+			return 1;
+	}
+}
+
+// Drops the request that was served from the buffer, keeping anything the client sent after it.
+// Returns 1 if the next request is already in, -1 if it is invalid, or 0 to wait for more
+int tcpserver_connection_next(tcp_server *tcpsv, tcpserver_connection *conn)
+{
+	conn->length -= conn->request_len;
+	memmove(conn->buffer, conn->buffer + conn->request_len, conn->length);
+	conn->request_len = 0;
+	if (conn->frame_state != NULL)
+		memset(conn->frame_state, 0, MAX(tcpsv->request_state_size, (int)sizeof(int)));
+	if (conn->length == 0)
+		return 0;
+
+	conn->request_len = tcpserver_connection_frame(tcpsv, conn);
+	if (conn->request_len < 0)
+		return -1;
+	return conn->request_len > 0 && conn->length >= conn->request_len;
+}
 
+// Whether the connection may stay open after the request it is serving. 'served' counts the requests
+// of the worker, including this one
+int tcpserver_keep_alive(tcp_server *tcpsv, tcpserver_connection *conn, int served)
+{
+	if (tcpsv->max_connection_requests > 0 && conn->requests >= tcpsv->max_connection_requests)
+		return 0;
+	return tcpsv->worker_max_requests == 0 || served < tcpsv->worker_max_requests;
+}
+
+// Waits for the next request of an idle connection. Returns 1 once the client sent something, or 0 to
+// close the connection: after keep_alive_timeout, or when a connection waiting on 'listen_sock' (-1 for
+// none) was accepted into 'next_sock' instead, as nothing else is served meanwhile
+int tcpserver_wait_next_request(tcp_server *tcpsv, int cli_sock, int listen_sock, int *next_sock)
+{
+	time_t deadline = time(NULL) + tcpsv->keep_alive_timeout;
+	int timeout;
+	while ((timeout = (int)(deadline - time(NULL))) > 0)
+	{
+		struct pollfd fds[2] = {{cli_sock, POLLIN, 0}, {listen_sock, POLLIN, 0}};
+		int ready = poll(fds, 2, timeout * 1000);
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready <= 0)
+			return 0;
+		// Data or a hang-up, which the next read finds out
+		if (fds[0].revents != 0)
+			return 1;
+
+		// The listening socket does not block, so only one of the waiting workers gets the connection
+		*next_sock = accept4(listen_sock, NULL, NULL, SOCK_CLOEXEC);
+		if (*next_sock >= 0)
+			return 0;
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			listen_sock = -1;
+	}
 	return 0;
 }
 
-// Enables listening mode on the socket
-int tcpserver_start_listening(tcp_server *tcpsv)
+// Serves the requests of a connection on a blocking socket with request_handler, reading each one whole
+// like the event loops do. Returns a connection taken over from 'listen_sock' while this one was idle, or -1.
+// 'served' counts the requests of the worker for its limit, if not NULL
+int tcpserver_serve_connection(tcp_server *tcpsv, int cli_sock, int listen_sock, int *served)
 {
-	// Bind listening socket to above IP/port
-	if (bind(tcpsv->listen_sock, (struct sockaddr *)&(tcpsv->servsock_addr), sizeof(tcpsv->servsock_addr)) != 0)
+	tcpserver_connection conn;
+	memset(&conn, 0, sizeof(conn));
+	conn.sock = cli_sock;
+
+	int next_sock = -1, status = tcpserver_connection_read(tcpsv, &conn);
+	while (status == 1)
 	{
-		fprintf(stderr, "Failed to bind to port %d. The port may be in use by another application.\n", tcpsv->listen_port);
+		conn.requests++;
+		if (served != NULL)
+			(*served)++;
+		int keep_alive = tcpserver_keep_alive(tcpsv, &conn, served != NULL ? *served : 0);
+		if ((tcpsv->request_handler)(cli_sock, conn.buffer, conn.request_len, conn.frame_state, keep_alive, tcpsv) != 1 || !keep_alive)
+			break;
+
+		// Requests the client sent without waiting for the response are already in the buffer
+		status = tcpserver_connection_next(tcpsv, &conn);
+		if (status == 0 && tcpserver_wait_next_request(tcpsv, cli_sock, listen_sock, &next_sock))
+			status = tcpserver_connection_read(tcpsv, &conn);
+	}
+
+	close(cli_sock);
+	tcpserver_connection_free(&conn);
+	return next_sock;
+}
+
+// Accepts the next connection on the socket. Returns -1 if none was accepted
+int tcpserver_accept(tcp_server *tcpsv, int sock)
+{
+	tcpsv->cli_addr_len = sizeof(tcpsv->clisock_addr);
+	tcpsv->cli_sock = accept(sock, (struct sockaddr *)&(tcpsv->clisock_addr), (socklen_t *)&(tcpsv->cli_addr_len));
+	if (tcpsv->cli_sock < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		// The listening socket of a worker does not block. Wait for a connection to try again
+		struct pollfd fd = {sock, POLLIN, 0};
+		poll(&fd, 1, -1);
+	}
+	// A signal interrupting accept() is not an error
+	else if (tcpsv->cli_sock < 0 && errno != EINTR)
+		fprintf(stderr, "Connection to client was not accepted. Resuming...\n");
+	return tcpsv->cli_sock;
+}
+
+// Serves the accepted connection in this process, with request_handler if there is one. Returns a connection
+// taken over from 'listen_sock' to serve next, or -1. 'served' counts the requests, if not NULL
+int tcpserver_handle_client(tcp_server *tcpsv, int cli_sock, int listen_sock, int *served)
+{
+	if (tcpsv->request_handler != NULL && tcpsv->request_length != NULL)
+		return tcpserver_serve_connection(tcpsv, cli_sock, listen_sock, served);
+
+	// TODO: Handle nullptr handler function with stub function
+	if ((tcpsv->client_handler)(cli_sock, tcpsv) != 0)
+	{
+		fprintf(stderr, "Failed to handle TCP socket request\n");
+		close(cli_sock);
+	}
+	if (served != NULL)
+		(*served)++;
+	return -1;
+}
+
+void tcpserver_on_signal(int signo)
+{
+	// SIGCHLD and SIGALRM only have to wake up the supervisor
+	if (signo == SIGINT || signo == SIGTERM)
+		tcpserver_stopping = 1;
+}
+
+/* FORK PER CONNECTION */
+
+// Collects the exit status of finished children, so that they don't stay around as zombies
+void tcpserver_reap_children(tcp_server *tcpsv)
+{
+	while (waitpid(-1, NULL, WNOHANG) > 0)
+		tcpsv->child_count--;
+}
+
+int tcpserver_run_fork_per_connection(tcp_server *tcpsv)
+{
+	// Without SA_RESTART, a child exiting interrupts accept() so that it is reaped right away
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = tcpserver_on_signal;
+	action.sa_flags = SA_NOCLDSTOP;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+
+	while (1)
+	{
+		tcpserver_reap_children(tcpsv);
+
+		// Wait for a child to finish before taking more connections
+		if (tcpsv->max_children > 0 && tcpsv->child_count >= tcpsv->max_children)
+		{
+			if (waitpid(-1, NULL, 0) > 0)
+				tcpsv->child_count--;
+			continue;
+		}
+
+		int cli_sock = tcpserver_accept(tcpsv, tcpsv->listen_sock);
+		if (cli_sock < 0)
+			continue;
+
+		// Child process has a reference to the listening and client socket
+		// We need to close the client socket in the parent process
+		// and close the listening socket in the child process.
+		// After child process is done, exit promptly.
+		// See https://stackoverflow.com/a/6019241/12887350
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			fprintf(stderr, "Failed to fork a process for the connection\n");
+			close(cli_sock);
+		}
+		else if (pid == 0)
+		{
+			// Child process
+			signal(SIGCHLD, SIG_DFL);
+
+			// Close listening socket to decrement reference count
+			close(tcpsv->listen_sock);
+			tcpserver_handle_client(tcpsv, cli_sock, -1, NULL);
+
+			// Exit the child process
+			_exit(0);
+		}
+		else
+		{
+			// Close client socket to decrement reference count
+			close(cli_sock);
+			tcpsv->child_count++;
+		}
+	}
+
+	return 0;
+}
+
+/* EVENT LOOP */
+
+typedef struct
+{
+	int epoll_fd;
+	int listen_sock;
+	// Whether the listening socket is watched. It is not while out of file descriptors, or after the request limit
+	int accepting;
+	int connection_count;
+	// Set when accepting stopped for lack of file descriptors, with the connections open and the time then
+	int out_of_files, out_of_files_connections;
+	time_t out_of_files_since;
+	tcpserver_connection *oldest, *newest;
+} tcpserver_event_state;
+
+void tcpserver_connection_unlink(tcpserver_event_state *state, tcpserver_connection *conn)
+{
+	if (conn->prev != NULL)
+		conn->prev->next = conn->next;
+	else
+		state->oldest = conn->next;
+	if (conn->next != NULL)
+		conn->next->prev = conn->prev;
+	else
+		state->newest = conn->prev;
+	conn->prev = conn->next = NULL;
+}
+
+void tcpserver_connection_touch(tcpserver_event_state *state, tcpserver_connection *conn)
+{
+	if (state->newest != conn)
+	{
+		if (conn->prev != NULL || state->oldest == conn)
+			tcpserver_connection_unlink(state, conn);
+		conn->prev = state->newest;
+		if (state->newest != NULL)
+			state->newest->next = conn;
+		else
+			state->oldest = conn;
+		state->newest = conn;
+	}
+	conn->last_active = time(NULL);
+}
+
+void tcpserver_watch_listener(tcpserver_event_state *state, int enable)
+{
+	if (state->accepting == enable)
+		return;
+	if (enable)
+	{
+		// Only one of the workers sharing the socket is woken up for a new connection
+		struct epoll_event event = {.events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL};
+		epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->listen_sock, &event);
+	}
+	else
+		epoll_ctl(state->epoll_fd, EPOLL_CTL_DEL, state->listen_sock, NULL);
+	state->accepting = enable;
+}
+
+// Closes and frees the connection. Closing the socket also removes it from the epoll instance
+void tcpserver_connection_release(tcpserver_event_state *state, tcpserver_connection *conn)
+{
+	close(conn->sock);
+	tcpserver_connection_unlink(state, conn);
+	state->connection_count--;
+	tcpserver_connection_free(conn);
+	free(conn);
+}
+
+void tcpserver_accept_connections(tcp_server *tcpsv, tcpserver_event_state *state)
+{
+	while (1)
+	{
+		int cli_sock = accept4(state->listen_sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (cli_sock < 0)
+		{
+			if (errno == EMFILE || errno == ENFILE)
+			{
+				// Leave the connection in the backlog until a connection of this worker is closed
+				fprintf(stderr, "Out of file descriptors, pausing new connections\n");
+				tcpserver_watch_listener(state, 0);
+				state->out_of_files = 1;
+				state->out_of_files_connections = state->connection_count;
+				state->out_of_files_since = time(NULL);
+			}
+			// EAGAIN once the backlog is empty, or another worker took the connection
+			return;
+		}
+
+		tcpserver_connection *conn = (tcpserver_connection *)calloc(1, sizeof(tcpserver_connection));
+		struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.ptr = conn};
+		if (conn == NULL || epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, cli_sock, &event) != 0)
+		{
+			fprintf(stderr, "Failed to watch the client connection\n");
+			free(conn);
+			close(cli_sock);
+			continue;
+		}
+		conn->sock = cli_sock;
+		state->connection_count++;
+		tcpserver_connection_touch(state, conn);
+	}
+}
+
+// Hands the received request to the handler, on a blocking socket again as the handler writes the whole response,
+// followed by any further requests the client already sent. The connection goes back to epoll if it is kept open
+void tcpserver_dispatch(tcp_server *tcpsv, tcpserver_event_state *state, tcpserver_connection *conn, int *served)
+{
+	int cli_sock = conn->sock;
+	epoll_ctl(state->epoll_fd, EPOLL_CTL_DEL, cli_sock, NULL);
+	fcntl(cli_sock, F_SETFL, fcntl(cli_sock, F_GETFL) & ~O_NONBLOCK);
+
+	int status = 1;
+	while (status == 1)
+	{
+		conn->requests++;
+		(*served)++;
+		int keep_alive = tcpserver_keep_alive(tcpsv, conn, *served);
+		if ((tcpsv->request_handler)(cli_sock, conn->buffer, conn->request_len, conn->frame_state, keep_alive, tcpsv) != 1 || !keep_alive)
+		{
+			tcpserver_connection_release(state, conn);
+			return;
+		}
+		status = tcpserver_connection_next(tcpsv, conn);
+	}
+
+	// Adding the socket back reports anything that arrived while the handler ran
+	struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.ptr = conn};
+	fcntl(cli_sock, F_SETFL, fcntl(cli_sock, F_GETFL) | O_NONBLOCK);
+	if (status < 0 || epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, cli_sock, &event) != 0)
+	{
+		tcpserver_connection_release(state, conn);
+		return;
+	}
+	tcpserver_connection_touch(state, conn);
+}
+
+void tcpserver_close_idle(tcp_server *tcpsv, tcpserver_event_state *state)
+{
+	time_t oldest_allowed = time(NULL) - tcpsv->idle_timeout;
+	while (state->oldest != NULL && state->oldest->last_active < oldest_allowed)
+		tcpserver_connection_release(state, state->oldest);
+}
+
+// Closes the connections kept open that have not started another request, once the worker stops
+void tcpserver_close_kept(tcpserver_event_state *state)
+{
+	tcpserver_connection *conn = state->oldest;
+	while (conn != NULL)
+	{
+		tcpserver_connection *next = conn->next;
+		if (conn->requests > 0 && conn->length == 0)
+			tcpserver_connection_release(state, conn);
+		conn = next;
+	}
+}
+
+// Body of a worker in the event loop mode. Returns after the request limit, once the open connections are done
+void tcpserver_event_loop(tcp_server *tcpsv, int sock)
+{
+	struct epoll_event events[64];
+	tcpserver_event_state state;
+	memset(&state, 0, sizeof(state));
+	state.listen_sock = sock;
+	state.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (state.epoll_fd < 0)
+	{
+		fprintf(stderr, "Failed to create the epoll instance\n");
+		return;
+	}
+
+	// Several workers may accept on the socket, so it must not block the one that lost the race
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+	tcpserver_watch_listener(&state, 1);
+
+	int served = 0;
+	while (state.accepting || state.connection_count > 0)
+	{
+		// Wake up every second to close idle connections, or to try accepting again
+		int tick = tcpsv->idle_timeout > 0 || state.out_of_files;
+		int count = epoll_wait(state.epoll_fd, events, sizeof(events) / sizeof(events[0]), tick ? 1000 : -1);
+		for (int i = 0; i < count; i++)
+		{
+			tcpserver_connection *conn = (tcpserver_connection *)events[i].data.ptr;
+			if (conn == NULL)
+			{
+				tcpserver_accept_connections(tcpsv, &state);
+				continue;
+			}
+
+			int status = tcpserver_connection_read(tcpsv, conn);
+			if (status == 0 && (events[i].events & (EPOLLHUP | EPOLLERR)))
+				status = -1;
+			if (status < 0)
+			{
+				tcpserver_connection_release(&state, conn);
+				continue;
+			}
+			if (status == 0)
+			{
+				tcpserver_connection_touch(&state, conn);
+				continue;
+			}
+
+			tcpserver_dispatch(tcpsv, &state, conn, &served);
+			if (tcpsv->worker_max_requests > 0 && served >= tcpsv->worker_max_requests)
+				tcpserver_watch_listener(&state, 0);
+		}
+
+		// Connections are only freed once the batch is done, as later events of the batch may point to them
+		if (tcpsv->worker_max_requests > 0 && served >= tcpsv->worker_max_requests)
+			tcpserver_close_kept(&state);
+		if (tcpsv->idle_timeout > 0)
+			tcpserver_close_idle(tcpsv, &state);
+		// Out of file descriptors, the connection waiting in the backlog would wake the loop again right away.
+		// Try again once a connection of this worker was closed, or on the next tick, as other processes may
+		// have closed theirs
+		if (state.out_of_files && (state.connection_count < state.out_of_files_connections || time(NULL) > state.out_of_files_since))
+			state.out_of_files = 0;
+		// Resume accepting once a connection has been closed
+		if (!state.accepting && !state.out_of_files && (tcpsv->worker_max_requests == 0 || served < tcpsv->worker_max_requests))
+			tcpserver_watch_listener(&state, 1);
+	}
+
+	close(state.epoll_fd);
+}
+
+/* IO_URING */
+
+#ifdef TCPSERVER_HAVE_IO_URING
+
+// Receive buffers given to the kernel. A connection only holds one while its data is copied out
+#define TCPSERVER_URING_BUFFERS 64
+#define TCPSERVER_URING_BUFFER_SIZE 16384
+#define TCPSERVER_URING_BUFFER_GROUP 0
+#define TCPSERVER_URING_ENTRIES 256
+
+// user_data of the operations that don't belong to a connection. Connections use their address
+#define TCPSERVER_URING_ACCEPT 1
+#define TCPSERVER_URING_TICK 2
+#define TCPSERVER_URING_IGNORE 3
+
+// A ring set up with the raw system calls, as liburing may not be installed
+typedef struct
+{
+	int ring_fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned sq_entries;
+	// Submission queue tail including the entries the kernel has not been told about yet
+	unsigned sq_local_tail;
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size, sqes_size;
+
+	struct io_uring_buf_ring *buf_ring;
+	size_t buf_ring_size;
+	char *buffers;
+	unsigned short buf_tail;
+
+	// Wakes up the loop every second to close idle connections
+	struct __kernel_timespec tick;
+	// Whether the multishot accept is armed, and whether it should be
+	int accept_armed, accept_wanted;
+	tcpserver_event_state connections;
+} tcpserver_uring;
+
+void tcpserver_uring_free(tcpserver_uring *ring)
+{
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring != NULL)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	if (ring->buf_ring != NULL)
+		munmap(ring->buf_ring, ring->buf_ring_size);
+	free(ring->buffers);
+	if (ring->ring_fd >= 0)
+		close(ring->ring_fd);
+}
+
+// Gives the receive buffer back to the kernel
+void tcpserver_uring_provide_buffer(tcpserver_uring *ring, unsigned short bid)
+{
+	struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (TCPSERVER_URING_BUFFERS - 1)];
+	buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * TCPSERVER_URING_BUFFER_SIZE);
+	buf->len = TCPSERVER_URING_BUFFER_SIZE;
+	buf->bid = bid;
+	ring->buf_tail++;
+	__atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+// Returns 1 if the kernel has no io_uring, or one without provided buffer rings (added with multishot accept)
+int tcpserver_uring_setup(tcpserver_uring *ring)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	memset(ring, 0, sizeof(*ring));
+	ring->ring_fd = (int)syscall(__NR_io_uring_setup, TCPSERVER_URING_ENTRIES, &params);
+	if (ring->ring_fd < 0)
+		return 1;
+
+	// Map the submission and completion rings, which are one mapping on newer kernels
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->sq_ring_size = ring->cq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED)
+	{
+		ring->sq_ring = NULL;
+		tcpserver_uring_free(ring);
+		return 1;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ring = ring->sq_ring;
+	else if ((ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+	{
+		ring->cq_ring = NULL;
+		tcpserver_uring_free(ring);
+		return 1;
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+	{
+		ring->sqes = NULL;
+		tcpserver_uring_free(ring);
 		return 1;
 	}
 
-	// Listen for incoming connections with 10 connection backlogs
-	if (listen(tcpsv->listen_sock, 10) != 0)
+	char *sq = (char *)ring->sq_ring, *cq = (char *)ring->cq_ring;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	ring->sq_entries = params.sq_entries;
+	ring->sq_local_tail = *ring->sq_tail;
+
+	// The buffer ring has to start on a page, which mmap() gives
+	ring->buf_ring_size = TCPSERVER_URING_BUFFERS * sizeof(struct io_uring_buf);
+	ring->buf_ring = (struct io_uring_buf_ring *)mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ring->buffers = (char *)malloc((size_t)TCPSERVER_URING_BUFFERS * TCPSERVER_URING_BUFFER_SIZE);
+	if (ring->buf_ring == MAP_FAILED || ring->buffers == NULL)
 	{
-		fprintf(stderr, "Failed to make listening socket on port %d\n", tcpsv->listen_port);
+		if (ring->buf_ring == MAP_FAILED)
+			ring->buf_ring = NULL;
+		tcpserver_uring_free(ring);
 		return 1;
 	}
 
-	printf("Started listening on port %d...\n", tcpsv->listen_port);
-	while (1)
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+	reg.ring_entries = TCPSERVER_URING_BUFFERS;
+	reg.bgid = TCPSERVER_URING_BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+	{
+		tcpserver_uring_free(ring);
+		return 1;
+	}
+	for (unsigned short bid = 0; bid < TCPSERVER_URING_BUFFERS; bid++)
+		tcpserver_uring_provide_buffer(ring, bid);
+
+	ring->connections.epoll_fd = -1;
+	ring->tick.tv_sec = 1;
+	return 0;
+}
+
+// Tells the kernel about the new submissions, and waits for a completion if 'wait' is set
+int tcpserver_uring_submit(tcpserver_uring *ring, int wait)
+{
+	__atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+	unsigned pending = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	return (int)syscall(__NR_io_uring_enter, ring->ring_fd, pending, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+// Next free submission entry, cleared. Submits the queue first if it is full
+struct io_uring_sqe *tcpserver_uring_sqe(tcpserver_uring *ring, uint64_t user_data)
+{
+	if (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+		tcpserver_uring_submit(ring, 0);
+	unsigned index = ring->sq_local_tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = user_data;
+	ring->sq_array[index] = index;
+	ring->sq_local_tail++;
+	return sqe;
+}
+
+// One accept that keeps producing a completion for every new connection
+void tcpserver_uring_arm_accept(tcpserver_uring *ring)
+{
+	struct io_uring_sqe *sqe = tcpserver_uring_sqe(ring, TCPSERVER_URING_ACCEPT);
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = ring->connections.listen_sock;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_CLOEXEC;
+	ring->accept_armed = 1;
+}
+
+// A single receive into a buffer that the kernel picks when data arrives. It is not multishot: an armed
+// receive holds a reference to the socket, which would keep it open after the handler closes it
+void tcpserver_uring_arm_recv(tcpserver_uring *ring, tcpserver_connection *conn)
+{
+	struct io_uring_sqe *sqe = tcpserver_uring_sqe(ring, (uint64_t)(uintptr_t)conn);
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = conn->sock;
+	sqe->len = TCPSERVER_URING_BUFFER_SIZE;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = TCPSERVER_URING_BUFFER_GROUP;
+}
+
+void tcpserver_uring_cancel(tcpserver_uring *ring, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe = tcpserver_uring_sqe(ring, TCPSERVER_URING_IGNORE);
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr = user_data;
+}
+
+void tcpserver_uring_arm_tick(tcpserver_uring *ring)
+{
+	struct io_uring_sqe *sqe = tcpserver_uring_sqe(ring, TCPSERVER_URING_TICK);
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->addr = (uint64_t)(uintptr_t)&ring->tick;
+	sqe->len = 1;
+}
+
+// Closes the connection through the ring and frees it. Its receive must have completed
+void tcpserver_uring_drop(tcpserver_uring *ring, tcpserver_connection *conn)
+{
+	struct io_uring_sqe *sqe = tcpserver_uring_sqe(ring, TCPSERVER_URING_IGNORE);
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = conn->sock;
+	// Connections being closed for being idle were already taken off the list
+	if (!conn->closing)
+		tcpserver_connection_unlink(&ring->connections, conn);
+	ring->connections.connection_count--;
+	tcpserver_connection_free(conn);
+	free(conn);
+}
+
+// Appends received data to the connection buffer. Returns 1 if it could not grow
+int tcpserver_connection_append(tcpserver_connection *conn, const char *data, int length)
+{
+	if (conn->capacity - conn->length < length)
+	{
+		int capacity = MAX(conn->capacity * 2, conn->length + length);
+		char *buffer = (char *)realloc(conn->buffer, capacity);
+		if (buffer == NULL)
+			return 1;
+		conn->buffer = buffer;
+		conn->capacity = capacity;
+	}
+	memcpy(conn->buffer + conn->length, data, length);
+	conn->length += length;
+	return 0;
+}
+
+// Handles the completion of a receive, serving the requests that are complete. 'served' counts them
+void tcpserver_uring_received(tcp_server *tcpsv, tcpserver_uring *ring, tcpserver_connection *conn, struct io_uring_cqe *cqe, int *served)
+{
+	int failed = cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS);
+	if (cqe->flags & IORING_CQE_F_BUFFER)
+	{
+		unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+		if (cqe->res > 0 && !conn->closing)
+			failed = tcpserver_connection_append(conn, ring->buffers + (size_t)bid * TCPSERVER_URING_BUFFER_SIZE, cqe->res) != 0;
+		tcpserver_uring_provide_buffer(ring, bid);
+	}
+
+	if (failed || conn->closing)
+	{
+		tcpserver_uring_drop(ring, conn);
+		return;
+	}
+
+	int status = 0;
+	if (cqe->res > 0 && conn->request_len == 0)
+		conn->request_len = tcpserver_connection_frame(tcpsv, conn);
+	if (conn->request_len > 0 && conn->length >= conn->request_len)
+		status = 1;
+	else if (conn->request_len < 0)
+		status = -1;
+
+	// Nothing is pending on the socket, and it was accepted as a blocking one, so the handler can use it as is.
+	// Requests the client sent without waiting for the response are served right after
+	while (status == 1)
+	{
+		conn->requests++;
+		(*served)++;
+		int keep_alive = tcpserver_keep_alive(tcpsv, conn, *served);
+		if ((tcpsv->request_handler)(conn->sock, conn->buffer, conn->request_len, conn->frame_state, keep_alive, tcpsv) != 1 || !keep_alive)
+			status = -1;
+		else
+			status = tcpserver_connection_next(tcpsv, conn);
+	}
+
+	if (status < 0)
+	{
+		tcpserver_uring_drop(ring, conn);
+		return;
+	}
+	// Out of buffers (-ENOBUFS), the request is not complete yet, or the connection waits for the next one
+	tcpserver_connection_touch(&ring->connections, conn);
+	tcpserver_uring_arm_recv(ring, conn);
+}
+
+// Cancels the receives of connections that sent nothing for too long. They are closed once the receive completes
+void tcpserver_uring_close_idle(tcp_server *tcpsv, tcpserver_uring *ring)
+{
+	time_t oldest_allowed = time(NULL) - tcpsv->idle_timeout;
+	tcpserver_event_state *connections = &ring->connections;
+	while (connections->oldest != NULL && connections->oldest->last_active < oldest_allowed)
+	{
+		tcpserver_connection *conn = connections->oldest;
+		tcpserver_connection_unlink(connections, conn);
+		conn->closing = 1;
+		tcpserver_uring_cancel(ring, (uint64_t)(uintptr_t)conn);
+	}
+}
+
+// Closes the connections kept open that have not started another request, once the worker stops
+void tcpserver_uring_close_kept(tcpserver_uring *ring)
+{
+	tcpserver_connection *conn = ring->connections.oldest;
+	while (conn != NULL)
+	{
+		tcpserver_connection *next = conn->next;
+		if (conn->requests > 0 && conn->length == 0)
+		{
+			tcpserver_connection_unlink(&ring->connections, conn);
+			conn->closing = 1;
+			tcpserver_uring_cancel(ring, (uint64_t)(uintptr_t)conn);
+		}
+		conn = next;
+	}
+}
+
+// Body of a worker in the io_uring mode, like tcpserver_event_loop(). Returns 1 if io_uring can't be used
+int tcpserver_uring_loop(tcp_server *tcpsv, int sock)
+{
+	tcpserver_uring ring;
+	if (tcpserver_uring_setup(&ring) != 0)
+		return 1;
+	ring.connections.listen_sock = sock;
+	ring.accept_wanted = 1;
+	tcpserver_uring_arm_accept(&ring);
+	if (tcpsv->idle_timeout > 0)
+		tcpserver_uring_arm_tick(&ring);
+
+	int served = 0, out_of_files = 0;
+	while (ring.accept_armed || ring.connections.connection_count > 0)
+	{
+		// One system call submits everything queued and waits for the next completion
+		if (tcpserver_uring_submit(&ring, 1) < 0 && errno != EINTR)
+		{
+			fprintf(stderr, "Failed to wait for io_uring completions\n");
+			break;
+		}
+
+		unsigned head = *ring.cq_head, tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++)
+		{
+			struct io_uring_cqe cqe = ring.cqes[head & *ring.cq_mask];
+			// Free the entry before handling it, as a handler may take long
+			__atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+
+			if (cqe.user_data == TCPSERVER_URING_ACCEPT)
+			{
+				if (!(cqe.flags & IORING_CQE_F_MORE))
+					ring.accept_armed = 0;
+				if (cqe.res < 0)
+				{
+					if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+					{
+						fprintf(stderr, "Out of file descriptors, pausing new connections\n");
+						out_of_files = 1;
+					}
+					continue;
+				}
+
+				tcpserver_connection *conn = (tcpserver_connection *)calloc(1, sizeof(tcpserver_connection));
+				if (conn == NULL)
+				{
+					close(cqe.res);
+					continue;
+				}
+				conn->sock = cqe.res;
+				ring.connections.connection_count++;
+				tcpserver_connection_touch(&ring.connections, conn);
+				tcpserver_uring_arm_recv(&ring, conn);
+			}
+			else if (cqe.user_data == TCPSERVER_URING_TICK)
+			{
+				tcpserver_uring_close_idle(tcpsv, &ring);
+				out_of_files = 0;
+				tcpserver_uring_arm_tick(&ring);
+			}
+			else if (cqe.user_data != TCPSERVER_URING_IGNORE)
+			{
+				int connections = ring.connections.connection_count;
+				tcpserver_uring_received(tcpsv, &ring, (tcpserver_connection *)(uintptr_t)cqe.user_data, &cqe, &served);
+				if (tcpsv->worker_max_requests > 0 && served >= tcpsv->worker_max_requests && ring.accept_wanted)
+				{
+					ring.accept_wanted = 0;
+					tcpserver_uring_cancel(&ring, TCPSERVER_URING_ACCEPT);
+					tcpserver_uring_close_kept(&ring);
+				}
+				if (ring.connections.connection_count < connections)
+					out_of_files = 0;
+			}
+		}
+
+		// Accept again once the accept stopped, unless there are no file descriptors for new connections
+		if (!ring.accept_armed && ring.accept_wanted && !out_of_files)
+			tcpserver_uring_arm_accept(&ring);
+	}
+
+	tcpserver_uring_free(&ring);
+	return 0;
+}
+
+#endif
+
+/* THREADS */
+
+typedef struct
+{
+	tcp_server *tcpsv;
+	int sock;
+	// Requests served by all threads, for the limit of the worker, and threads still taking connections.
+	// Both are updated atomically
+	int served, running;
+} tcpserver_thread_args;
+
+// Body of each thread of a worker in the thread mode. Once the threads have served the request limit
+// between them, each one stops after the connection it is serving, and the last one ends the worker
+void *tcpserver_thread_main(void *arg)
+{
+	tcpserver_thread_args *args = (tcpserver_thread_args *)arg;
+	int max_requests = args->tcpsv->worker_max_requests;
+	struct pollfd listen_fd = {args->sock, POLLIN, 0};
+	while (max_requests == 0 || __atomic_load_n(&args->served, __ATOMIC_ACQUIRE) < max_requests)
 	{
-		tcpsv->cli_sock = accept(tcpsv->listen_sock, (struct sockaddr *)&(tcpsv->clisock_addr), &(tcpsv->cli_addr_len));
-		if (tcpsv->cli_sock < 0)
+		// Waiting in poll() rather than accept() lets an idle thread see that the limit was reached by the others
+		if (poll(&listen_fd, 1, max_requests > 0 ? 1000 : -1) <= 0)
+			continue;
+		// The client address fields of the server are not used, as all threads would share them
+		int cli_sock = accept(args->sock, NULL, NULL);
+		if (cli_sock < 0)
 		{
-			fprintf(stderr, "Connection to client was not accepted. Resuming...\n");
+			// Another thread or worker may have taken the connection first
+			if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+				fprintf(stderr, "Connection to client was not accepted. Resuming...\n");
 			continue;
 		}
+		// Other threads take new connections, so a kept connection is not given up for them
+		int served = 0;
+		tcpserver_handle_client(args->tcpsv, cli_sock, -1, &served);
+		__atomic_add_fetch(&args->served, served, __ATOMIC_ACQ_REL);
+	}
+
+	// The parent process starts a new worker once this one is done
+	if (__atomic_sub_fetch(&args->running, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		fflush(stdout);
+		_exit(0);
+	}
+	pthread_exit(NULL);
+}
 
-		// TODO: Handle nullptr handler function with stub function
-		if ((tcpsv->client_handler)(tcpsv->cli_sock, tcpsv) != 0)
+// Body of a worker in the thread mode. The calling thread is one of the threads, so this does not return
+void tcpserver_thread_pool(tcp_server *tcpsv, int sock)
+{
+	// Not on the stack, as this thread may end before the others
+	static tcpserver_thread_args args;
+	args.tcpsv = tcpsv;
+	args.sock = sock;
+	args.served = 0;
+	args.running = 1;
+	pthread_t thread;
+	int started = 1;
+
+	// Several threads wait for the same connection, and only one of them gets it
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+	for (; started < tcpsv->thread_count; started++)
+	{
+		__atomic_add_fetch(&args.running, 1, __ATOMIC_ACQ_REL);
+		if (pthread_create(&thread, NULL, tcpserver_thread_main, &args) != 0)
 		{
-			fprintf(stderr, "Failed to handle TCP socket request\n");
-			close(tcpsv->cli_sock);
+			__atomic_sub_fetch(&args.running, 1, __ATOMIC_ACQ_REL);
+			fprintf(stderr, "Failed to start thread %d of the worker, continuing with %d\n", started, started);
+			break;
 		}
+		pthread_detach(thread);
+	}
+	tcpserver_thread_main(&args);
+}
+
+/* PRE-FORK */
+
+// Body of a worker process: accept and handle connections until the request limit is reached
+void tcpserver_worker_loop(tcp_server *tcpsv, int index)
+{
+	int sock = tcpsv->workers[index].sock;
+
+	// Only keep the socket of this worker open
+	for (int i = 0; i < tcpsv->worker_count; i++)
+	{
+		if (tcpsv->workers[i].sock != sock)
+			close(tcpsv->workers[i].sock);
 	}
 
+	if (tcpsv->mode == TCPSERVER_EPOLL)
+	{
+		tcpserver_event_loop(tcpsv, sock);
+		return;
+	}
+	if (tcpsv->mode == TCPSERVER_THREADS)
+	{
+		tcpserver_thread_pool(tcpsv, sock);
+		return;
+	}
+	if (tcpsv->mode == TCPSERVER_IO_URING)
+	{
+#ifdef TCPSERVER_HAVE_IO_URING
+		if (tcpserver_uring_loop(tcpsv, sock) == 0)
+			return;
+#endif
+		fprintf(stderr, "io_uring is not available, worker %d uses epoll instead\n", index);
+		tcpserver_event_loop(tcpsv, sock);
+		return;
+	}
+
+	// A worker waiting for the next request of a kept connection takes a new connection over instead,
+	// which must not block if another worker got it first
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+	int served = 0, cli_sock = -1;
+	while (tcpsv->worker_max_requests == 0 || served < tcpsv->worker_max_requests)
+	{
+		if (cli_sock < 0 && (cli_sock = tcpserver_accept(tcpsv, sock)) < 0)
+			continue;
+		cli_sock = tcpserver_handle_client(tcpsv, cli_sock, sock, &served);
+	}
+	if (cli_sock >= 0)
+		close(cli_sock);
+}
+
+int tcpserver_spawn_worker(tcp_server *tcpsv, int index, const sigset_t *worker_mask)
+{
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		fprintf(stderr, "Failed to fork worker %d\n", index);
+		return 1;
+	}
+	if (pid == 0)
+	{
+		// Workers handle signals the default way
+		signal(SIGCHLD, SIG_DFL);
+		signal(SIGALRM, SIG_DFL);
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		// A client closing its connection early makes writes to it fail instead of ending the worker,
+		// which would also drop the other connections of an event loop or thread mode worker
+		signal(SIGPIPE, SIG_IGN);
+		sigprocmask(SIG_SETMASK, worker_mask, NULL);
+
+		tcpserver_worker_loop(tcpsv, index);
+
+		// Server log lines may still be in the stdio buffer
+		fflush(stdout);
+		_exit(0);
+	}
+
+	tcpsv->workers[index].pid = pid;
+	tcpsv->workers[index].started = time(NULL);
 	return 0;
 }
 
+// Collects the exit status of finished workers. Workers that crashed within a second of starting
+// are held back for a second, so that a worker failing on startup doesn't keep the supervisor forking
+void tcpserver_reap_workers(tcp_server *tcpsv)
+{
+	pid_t pid;
+	int status;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+	{
+		for (int i = 0; i < tcpsv->worker_count; i++)
+		{
+			tcpserver_worker *worker = &tcpsv->workers[i];
+			if (worker->pid != pid)
+				continue;
+
+			worker->pid = 0;
+			int crashed = WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+			if (crashed && !tcpserver_stopping)
+			{
+				if (WIFSIGNALED(status))
+					fprintf(stderr, "Worker %d (pid %d) was stopped by signal %d, starting a new one\n", i, (int)pid, WTERMSIG(status));
+				else
+					fprintf(stderr, "Worker %d (pid %d) exited with status %d, starting a new one\n", i, (int)pid, WEXITSTATUS(status));
+				if (time(NULL) - worker->started < 1)
+					worker->restart_at = time(NULL) + 1;
+			}
+			break;
+		}
+	}
+}
+
+// Forks every worker that is not running. Returns 1 if some have to be started later
+int tcpserver_spawn_missing_workers(tcp_server *tcpsv, const sigset_t *worker_mask)
+{
+	int pending = 0;
+	time_t now = time(NULL);
+	for (int i = 0; i < tcpsv->worker_count; i++)
+	{
+		if (tcpsv->workers[i].pid != 0)
+			continue;
+		if (tcpsv->workers[i].restart_at > now || tcpserver_spawn_worker(tcpsv, i, worker_mask) != 0)
+			pending = 1;
+	}
+	return pending;
+}
+
+int tcpserver_run_prefork(tcp_server *tcpsv)
+{
+	if (tcpsv->worker_count < 1)
+		tcpsv->worker_count = 1;
+
+	tcpsv->workers = (tcpserver_worker *)calloc(tcpsv->worker_count, sizeof(tcpserver_worker));
+	if (tcpsv->workers == NULL)
+	{
+		fprintf(stderr, "Failed to allocate the worker table\n");
+		return 1;
+	}
+
+	// The first worker uses the socket that is already listening. With SO_REUSEPORT, every other worker
+	// gets one of its own. A replaced worker takes over the socket, so connections waiting on it are kept
+	for (int i = 0; i < tcpsv->worker_count; i++)
+	{
+		tcpsv->workers[i].sock = tcpsv->listen_sock;
+		if (i > 0 && tcpsv->reuse_port)
+		{
+			int sock = tcpserver_open_socket(tcpsv);
+			if (sock == -1 || tcpserver_bind_socket(tcpsv, sock) != 0)
+			{
+				if (sock != -1)
+					close(sock);
+				tcpsv->worker_count = i;
+				return 1;
+			}
+			tcpsv->workers[i].sock = sock;
+		}
+	}
+
+	// The supervisor only wakes up for these signals, which stay blocked outside of sigsuspend()
+	sigset_t supervisor_mask, worker_mask;
+	sigemptyset(&supervisor_mask);
+	sigaddset(&supervisor_mask, SIGCHLD);
+	sigaddset(&supervisor_mask, SIGALRM);
+	sigaddset(&supervisor_mask, SIGINT);
+	sigaddset(&supervisor_mask, SIGTERM);
+	sigprocmask(SIG_BLOCK, &supervisor_mask, &worker_mask);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = tcpserver_on_signal;
+	action.sa_flags = SA_NOCLDSTOP;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+	sigaction(SIGALRM, &action, NULL);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	printf("Started %d worker processes\n", tcpsv->worker_count);
+	fflush(stdout);
+
+	while (!tcpserver_stopping)
+	{
+		// Check again in a second for workers that could not be started
+		if (tcpserver_spawn_missing_workers(tcpsv, &worker_mask))
+			alarm(1);
+		sigsuspend(&worker_mask);
+		tcpserver_reap_workers(tcpsv);
+	}
+
+	// Stop the workers, and wait for all of them to exit
+	for (int i = 0; i < tcpsv->worker_count; i++)
+	{
+		if (tcpsv->workers[i].pid != 0)
+			kill(tcpsv->workers[i].pid, SIGTERM);
+	}
+	while (waitpid(-1, NULL, 0) > 0)
+		;
+
+	sigprocmask(SIG_SETMASK, &worker_mask, NULL);
+	return 0;
+}
+
+// Enables listening mode on the socket, and serves connections until the server is stopped
+int tcpserver_start_listening(tcp_server *tcpsv)
+{
+	if (tcpserver_bind_socket(tcpsv, tcpsv->listen_sock) != 0)
+		return 1;
+
+	printf("Started listening on port %d...\n", tcpsv->listen_port);
+	if (tcpsv->mode != TCPSERVER_FORK_PER_CONNECTION)
+		return tcpserver_run_prefork(tcpsv);
+	return tcpserver_run_fork_per_connection(tcpsv);
+}
+
 // Destroy the listening socket
 void tcpserver_close(tcp_server *tcpsv)
 {
+	if (tcpsv->workers != NULL)
+	{
+		for (int i = 0; i < tcpsv->worker_count; i++)
+		{
+			if (tcpsv->workers[i].sock != tcpsv->listen_sock)
+				close(tcpsv->workers[i].sock);
+		}
+		free(tcpsv->workers);
+		tcpsv->workers = NULL;
+	}
 	close(tcpsv->listen_sock);
 }
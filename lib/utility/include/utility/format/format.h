@@ -0,0 +1,26 @@
+#pragma once
+
+/* Number formatting, without going through printf */
+
+// Enough for any value written by the functions below, with the null-terminator
+#define FORMAT_BUFFER_SIZE 48
+
+/**
+ * Write the decimal representation of `value` to `buffer`, like "%d".
+ * Returns the number of characters written, not counting the null-terminator.
+ */
+int format_int(int value, char *buffer);
+
+/**
+ * Write the shortest decimal representation of `value` that reads back as the same float,
+ * such as "0.1" or "2.5". Whole numbers keep one decimal place ("3.0"), and values below 1e-5
+ * or from 1e16 up use exponent notation ("1.5e+20"). "inf", "-inf" and "nan" are written as such.
+ * Returns the number of characters written, not counting the null-terminator.
+ */
+int format_float_shortest(float value, char *buffer);
+
+/**
+ * Write `value` with six decimal places, the same as "%f".
+ * Returns the number of characters written, not counting the null-terminator.
+ */
+int format_float_fixed(float value, char *buffer);
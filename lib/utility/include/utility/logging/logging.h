@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 
 // Log level mask
 #define LOGTYPE_DEBUG (1 << 0)
@@ -8,6 +9,22 @@
 #define LOGTYPE_ERROR (1 << 3)
 #define LOGMASK_ALL 0xffff
 
+/**
+ * Logger settings. Each thread has its own, starting with every message printed to stdout,
+ * so that threads serving different requests can log to different places.
+ */
+typedef struct
+{
+	unsigned int mask;
+	// File descriptor the messages are written to, or -1 for stdout
+	int fd;
+	void (*flush_hook)(void *context);
+	void *flush_context;
+	// Function the messages are given to instead, if set
+	long (*writer)(void *context, const char *text, size_t length);
+	void *writer_context;
+} LogState;
+
 /**
  * Set logger mask.
  * 
@@ -20,3 +37,26 @@ void set_log_mask(unsigned int mask);
 
 // printf modified to allow only selected messages
 void lprintf(const char *tag, unsigned int level_mask, const char *format, ...);
+
+/**
+ * Set a function called before each printed message, such as one writing out
+ * program output buffered elsewhere, so that messages stay in order with it.
+ * Pass NULL to remove it.
+*/
+void set_log_flush_hook(void (*hook)(void *context), void *context);
+
+/**
+ * Write the messages of this thread to the file descriptor `fd` instead of stdout.
+ * Pass -1 to go back to stdout.
+*/
+void set_log_output(int fd);
+
+/**
+ * Give the messages of this thread to `writer`, each in one call, instead of writing them out.
+ * Pass NULL to go back to the file descriptor or stdout.
+*/
+void set_log_writer(long (*writer)(void *context, const char *text, size_t length), void *context);
+
+// Settings of this thread, such as to give a helper thread the same ones
+LogState get_log_state();
+void set_log_state(LogState state);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Key/value cache living in an anonymous shared memory segment.
+ *
+ * The segment is created once by the parent process, and every process
+ * fork()-ed after that sees the same cache. Values are copied in and out
+ * as plain bytes, so they must not contain pointers.
+ * The least recently used entries are evicted when the size cap is reached.
+ */
+
+struct _shm_cache;
+typedef struct _shm_cache shm_cache;
+
+// Usage counters of the cache
+typedef struct
+{
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long insertions;
+	unsigned long long evictions;
+	int entry_count;
+	size_t bytes_used;
+	size_t size_cap;
+} shm_cache_stats;
+
+/**
+ * Create a cache that can hold up to `size_cap` bytes of keys and values in
+ * at most `max_entries` entries. Returns NULL on failure.
+ */
+shm_cache *shm_cache_create(size_t size_cap, int max_entries);
+void shm_cache_destroy(shm_cache *cache);
+
+/**
+ * Look up the value stored for the given key. On a hit, a copy of the value is
+ * allocated with malloc() and stored in `value`, which must be freed by the caller.
+ * Returns 1 on a hit, 0 on a miss.
+ */
+int shm_cache_get(shm_cache *cache, const void *key, size_t key_len, void **value, size_t *value_len);
+
+/**
+ * Store a value for the given key, evicting old entries if needed.
+ * Returns 0 if the value was stored (or was already present), non-zero otherwise.
+ */
+int shm_cache_put(shm_cache *cache, const void *key, size_t key_len, const void *value, size_t value_len);
+
+void shm_cache_get_stats(shm_cache *cache, shm_cache_stats *stats);
@@ -1,15 +1,26 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 // Utility functions
 
 void print_level_space(int level);
 int string_is_float(char *str);
+uint64_t hash_fnv1a(const void *data, size_t length);
 
 #ifdef _MSC_VER
 #define strncasecmp _strnicmp
 #define strcasecmp _stricmp
 #endif
 
+// Storage class of variables that each thread has its own copy of
+#if defined(_MSC_VER) && !defined(__clang__)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
 #ifndef MAX
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #endif
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "utility/format/format.h"
+
+// Two-digit groups "00" to "99", so that digits are written two at a time
+const char FORMAT_DIGIT_PAIRS[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Powers of 10 that are exact as a double
+const double FORMAT_POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Writes the digits of 'value' with no terminator. Returns the number of digits
+int format_digits(uint64_t value, char *buffer)
+{
+	char digits[20];
+	char *ptr = digits + sizeof(digits);
+
+	while (value >= 100)
+	{
+		unsigned int pair = (unsigned int)(value % 100) * 2;
+		value /= 100;
+		*--ptr = FORMAT_DIGIT_PAIRS[pair + 1];
+		*--ptr = FORMAT_DIGIT_PAIRS[pair];
+	}
+	if (value >= 10)
+	{
+		*--ptr = FORMAT_DIGIT_PAIRS[value * 2 + 1];
+		*--ptr = FORMAT_DIGIT_PAIRS[value * 2];
+	}
+	else
+		*--ptr = (char)('0' + value);
+
+	int length = (int)(digits + sizeof(digits) - ptr);
+	memcpy(buffer, ptr, length);
+	return length;
+}
+
+int format_int(int value, char *buffer)
+{
+	int length = 0;
+	// Negate as unsigned so that INT_MIN works too
+	uint64_t magnitude = value < 0 ? (uint64_t)(-(int64_t)value) : (uint64_t)value;
+	if (value < 0)
+		buffer[length++] = '-';
+	length += format_digits(magnitude, buffer + length);
+	buffer[length] = '\0';
+	return length;
+}
+
+double format_pow10(int exponent)
+{
+	double result = 1;
+	while (exponent > 22)
+	{
+		result *= FORMAT_POW10[22];
+		exponent -= 22;
+	}
+	return result * FORMAT_POW10[exponent];
+}
+
+// value * 10^exponent, with a single rounding while the power of 10 is exact
+double format_scale(double value, int exponent)
+{
+	return exponent >= 0 ? value * format_pow10(exponent) : value / format_pow10(-exponent);
+}
+
+// Non-finite values and zero, which need no digits. Returns the length, or -1 for other values
+int format_float_special(float value, char *buffer)
+{
+	const char *text = NULL;
+	if (isnan(value))
+		text = "nan";
+	else if (isinf(value))
+		text = value < 0 ? "-inf" : "inf";
+	else if (value == 0)
+		text = signbit(value) ? "-0.0" : "0.0";
+	if (text == NULL)
+		return -1;
+	strcpy(buffer, text);
+	return (int)strlen(text);
+}
+
+// Digits of 'magnitude' rounded to 'scale' decimal places that read back as 'target', or 0 if none do
+uint64_t format_round_trip_digits(double magnitude, float target, int scale)
+{
+	double scaled = format_scale(magnitude, scale);
+	uint64_t nearest = (uint64_t)(scaled + 0.5);
+	// The rounding interval of a power of 2 is lopsided, so the nearest decimal
+	// may fall outside it when a neighbour does not
+	uint64_t candidates[3] = {nearest, scaled > nearest ? nearest + 1 : nearest - 1, scaled > nearest ? nearest - 1 : nearest + 1};
+
+	for (int i = 0; i < 3; i++)
+		if (candidates[i] != 0 && (float)format_scale((double)candidates[i], -scale) == target)
+			return candidates[i];
+	return 0;
+}
+
+int format_float_shortest(float value, char *buffer)
+{
+	int length = format_float_special(value, buffer);
+	if (length >= 0)
+		return length;
+
+	length = 0;
+	if (value < 0)
+		buffer[length++] = '-';
+
+	// A float is exact as a double, which has enough precision left to find and check
+	// each candidate decimal, so the digits are found with plain floating point
+	double magnitude = fabs((double)value);
+	float target = fabsf(value);
+
+	// Decimal exponent from the binary one (78913 / 2^18 is just above log10(2)), off by at most one
+	int binary_exponent;
+	frexp(magnitude, &binary_exponent);
+	int exponent = ((binary_exponent - 1) * 78913) >> 18;
+	double normalized = format_scale(magnitude, -exponent);
+	if (normalized >= 10)
+		exponent++;
+	else if (normalized < 1)
+		exponent--;
+
+	// Shortest number of significant digits that reads back as the same float. 9 always does,
+	// and if some number of digits does then any more does too, so search for the fewest
+	uint64_t digits = 0;
+	int precision = 9, low = 1, high = 9;
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		uint64_t found = format_round_trip_digits(magnitude, target, middle - 1 - exponent);
+		if (found != 0)
+		{
+			digits = found;
+			precision = middle;
+			high = middle - 1;
+		}
+		else
+			low = middle + 1;
+	}
+	if (digits == 0)
+		digits = (uint64_t)(format_scale(magnitude, 8 - exponent) + 0.5);
+
+	// Rounding up may carry into one more digit, such as 9.99 to 10.0
+	if (digits >= (uint64_t)FORMAT_POW10[precision])
+	{
+		digits /= 10;
+		exponent++;
+	}
+	// Trailing zeros are not significant
+	while (precision > 1 && digits % 10 == 0)
+	{
+		digits /= 10;
+		precision--;
+	}
+
+	char text[20];
+	int digit_count = format_digits(digits, text);
+
+	if (exponent < -5 || exponent >= 16)
+	{
+		// Exponent notation: d.ddde+XX
+		buffer[length++] = text[0];
+		if (digit_count > 1)
+		{
+			buffer[length++] = '.';
+			memcpy(buffer + length, text + 1, digit_count - 1);
+			length += digit_count - 1;
+		}
+		buffer[length++] = 'e';
+		buffer[length++] = exponent < 0 ? '-' : '+';
+		int exponent_magnitude = exponent < 0 ? -exponent : exponent;
+		if (exponent_magnitude < 10)
+			buffer[length++] = '0';
+		length += format_digits(exponent_magnitude, buffer + length);
+	}
+	else if (exponent >= 0)
+	{
+		// Integer part, padded with zeros if the digits end before the decimal point
+		int int_digits = exponent + 1;
+		for (int i = 0; i < int_digits; i++)
+			buffer[length++] = i < digit_count ? text[i] : '0';
+		buffer[length++] = '.';
+		if (digit_count > int_digits)
+		{
+			memcpy(buffer + length, text + int_digits, digit_count - int_digits);
+			length += digit_count - int_digits;
+		}
+		else
+			buffer[length++] = '0';
+	}
+	else
+	{
+		// Below 1: 0.000ddd
+		buffer[length++] = '0';
+		buffer[length++] = '.';
+		for (int i = -1; i > exponent; i--)
+			buffer[length++] = '0';
+		memcpy(buffer + length, text, digit_count);
+		length += digit_count;
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+int format_float_fixed(float value, char *buffer)
+{
+	// A float times 10^6 needs at most 44 bits, so this is exact, and rounding it to the nearest
+	// integer (ties to even, as printf does) gives the same digits as "%f"
+	double scaled = (double)value * 1e6;
+	if (!isfinite(value) || fabs(scaled) >= 9e18)
+		return snprintf(buffer, FORMAT_BUFFER_SIZE, "%f", value);
+
+	uint64_t micros = (uint64_t)nearbyint(fabs(scaled));
+	int length = 0;
+	if (signbit(value))
+		buffer[length++] = '-';
+	length += format_digits(micros / 1000000, buffer + length);
+	buffer[length++] = '.';
+
+	// Six decimal places, zero padded
+	unsigned int fraction = (unsigned int)(micros % 1000000);
+	for (int i = 5; i >= 0; i -= 2)
+	{
+		unsigned int pair = (fraction / (unsigned int)FORMAT_POW10[i - 1]) % 100 * 2;
+		buffer[length++] = FORMAT_DIGIT_PAIRS[pair];
+		buffer[length++] = FORMAT_DIGIT_PAIRS[pair + 1];
+	}
+	buffer[length] = '\0';
+	return length;
+}
@@ -1,13 +1,78 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 
 #include "utility/logging/logging.h"
+#include "utility/utils.h"
 
-unsigned int log_print_mask = -1;
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Each thread has its own settings, so that threads serving different requests don't share them
+THREAD_LOCAL LogState log_state = {(unsigned int)-1, -1, NULL, NULL, NULL, NULL};
 
 void set_log_mask(unsigned int mask)
 {
-	log_print_mask = mask;
+	log_state.mask = mask;
+}
+
+void set_log_flush_hook(void (*hook)(void *context), void *context)
+{
+	log_state.flush_hook = hook;
+	log_state.flush_context = context;
+}
+
+void set_log_output(int fd)
+{
+	log_state.fd = fd;
+}
+
+void set_log_writer(long (*writer)(void *context, const char *text, size_t length), void *context)
+{
+	log_state.writer = writer;
+	log_state.writer_context = context;
+}
+
+LogState get_log_state()
+{
+	return log_state;
+}
+
+void set_log_state(LogState state)
+{
+	log_state = state;
+}
+
+// Writes the message to the writer or file descriptor of the thread in one call, so that it is not split up
+void log_write_message(const char *tag, const char *format, va_list args)
+{
+	char message[1024], *text = message;
+	int prefix = snprintf(message, sizeof(message), "(%s) ", tag);
+	va_list copy;
+	va_copy(copy, args);
+	int length = prefix + vsnprintf(message + prefix, sizeof(message) - prefix, format, copy);
+	va_end(copy);
+	if (length >= (int)sizeof(message) && (text = (char *)malloc(length + 1)) != NULL)
+	{
+		snprintf(text, length + 1, "(%s) ", tag);
+		vsnprintf(text + prefix, length + 1 - prefix, format, args);
+	}
+	if (text == NULL)
+	{
+		text = message;
+		length = sizeof(message) - 1;
+	}
+	if (log_state.writer != NULL)
+		log_state.writer(log_state.writer_context, text, length);
+#ifdef __linux__
+	else if (write(log_state.fd, text, length) < 0)
+	{
+		// Nowhere else to report it
+	}
+#endif
+	if (text != message)
+		free(text);
 }
 
 void lprintf(const char *tag, unsigned int level_mask, const char *format, ...)
@@ -15,11 +80,22 @@ void lprintf(const char *tag, unsigned int level_mask, const char *format, ...)
 	// Infinite arguments
 	va_list args;
 	va_start(args, format);
-	if ((log_print_mask & level_mask) != 0)
+	if ((log_state.mask & level_mask) != 0)
 	{
-		printf("(%s) ", tag);
-		// printf, but with variable arguments list
-		vprintf(format, args);
+		if (log_state.flush_hook != NULL)
+			log_state.flush_hook(log_state.flush_context);
+#ifdef __linux__
+		if (log_state.writer != NULL || log_state.fd >= 0)
+#else
+		if (log_state.writer != NULL)
+#endif
+			log_write_message(tag, format, args);
+		else
+		{
+			printf("(%s) ", tag);
+			// printf, but with variable arguments list
+			vprintf(format, args);
+		}
 	}
 	va_end(args);
 }
@@ -0,0 +1,263 @@
+#include "utility/shm_cache/shm_cache.h"
+#include "utility/utils.h"
+
+#ifdef __linux__
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+// One cached key/value pair. The key bytes are stored in the arena followed by the value bytes
+typedef struct
+{
+	uint64_t hash;
+	size_t key_len;
+	size_t value_len;
+	// Offset of the key in the arena
+	size_t offset;
+	// Value of the use clock when the entry was last read or written
+	unsigned long long last_used;
+} shm_cache_entry;
+
+// Layout of the shared memory segment: this header, the entry table, then the data arena
+struct _shm_cache
+{
+	pthread_mutex_t lock;
+	size_t mapping_size;
+	size_t arena_size;
+	// End of the last allocated block in the arena
+	size_t arena_tail;
+	// Bytes occupied by live entries
+	size_t bytes_used;
+	int max_entries;
+	int entry_count;
+	unsigned long long use_clock;
+	unsigned long long hits, misses, insertions, evictions;
+};
+
+shm_cache_entry *shm_cache_entries(shm_cache *cache)
+{
+	return (shm_cache_entry *)(cache + 1);
+}
+
+unsigned char *shm_cache_arena(shm_cache *cache)
+{
+	return (unsigned char *)(shm_cache_entries(cache) + cache->max_entries);
+}
+
+shm_cache *shm_cache_create(size_t size_cap, int max_entries)
+{
+	if (max_entries <= 0)
+		return NULL;
+
+	size_t mapping_size = sizeof(shm_cache) + sizeof(shm_cache_entry) * max_entries + size_cap;
+
+	// Anonymous shared mapping, inherited by any child process created after this point
+	void *mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map %zu bytes of shared memory for the cache\n", mapping_size);
+		return NULL;
+	}
+
+	shm_cache *cache = (shm_cache *)mapping;
+	memset(cache, 0, sizeof(shm_cache));
+	cache->mapping_size = mapping_size;
+	cache->arena_size = size_cap;
+	cache->max_entries = max_entries;
+
+	// The lock is shared by all processes using the mapping. It is robust, so that a process that dies
+	// holding it does not leave the others waiting for good
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	if (pthread_mutex_init(&cache->lock, &attr) != 0)
+	{
+		fprintf(stderr, "Failed to create the shared cache lock\n");
+		pthread_mutexattr_destroy(&attr);
+		munmap(mapping, mapping_size);
+		return NULL;
+	}
+	pthread_mutexattr_destroy(&attr);
+
+	return cache;
+}
+
+void shm_cache_destroy(shm_cache *cache)
+{
+	if (cache == NULL)
+		return;
+	pthread_mutex_destroy(&cache->lock);
+	munmap(cache, cache->mapping_size);
+}
+
+// Takes the lock. If its owner died holding it, the index may be half updated, so the entries are dropped
+// before the lock is made usable again. Returns 1 if the lock can't be taken
+int shm_cache_lock(shm_cache *cache)
+{
+	int status = pthread_mutex_lock(&cache->lock);
+	if (status == EOWNERDEAD)
+	{
+		fprintf(stderr, "A process died holding the cache lock, clearing the cache\n");
+		cache->entry_count = 0;
+		cache->arena_tail = 0;
+		cache->bytes_used = 0;
+		pthread_mutex_consistent(&cache->lock);
+		return 0;
+	}
+	return status != 0;
+}
+
+// Returns the index of the entry with the given key, or -1. Must be called with the lock held
+int shm_cache_find(shm_cache *cache, uint64_t hash, const void *key, size_t key_len)
+{
+	shm_cache_entry *entries = shm_cache_entries(cache);
+	unsigned char *arena = shm_cache_arena(cache);
+	for (int i = 0; i < cache->entry_count; i++)
+	{
+		if (entries[i].hash == hash && entries[i].key_len == key_len && memcmp(arena + entries[i].offset, key, key_len) == 0)
+			return i;
+	}
+	return -1;
+}
+
+// Removes the least recently used entry. Must be called with the lock held
+void shm_cache_evict_lru(shm_cache *cache)
+{
+	shm_cache_entry *entries = shm_cache_entries(cache);
+	int lru = 0;
+	for (int i = 1; i < cache->entry_count; i++)
+		if (entries[i].last_used < entries[lru].last_used)
+			lru = i;
+
+	cache->bytes_used -= entries[lru].key_len + entries[lru].value_len;
+	// Keep the table dense by moving the last entry into the hole
+	entries[lru] = entries[--cache->entry_count];
+	cache->evictions++;
+}
+
+// Moves all live blocks to the beginning of the arena. Must be called with the lock held
+void shm_cache_compact(shm_cache *cache)
+{
+	shm_cache_entry *entries = shm_cache_entries(cache);
+	unsigned char *arena = shm_cache_arena(cache);
+
+	// Sort entries by their position in the arena (insertion sort, the table is small)
+	for (int i = 1; i < cache->entry_count; i++)
+	{
+		shm_cache_entry entry = entries[i];
+		int j = i - 1;
+		while (j >= 0 && entries[j].offset > entry.offset)
+		{
+			entries[j + 1] = entries[j];
+			j--;
+		}
+		entries[j + 1] = entry;
+	}
+
+	// Slide each block down over the gaps left by evicted entries
+	size_t tail = 0;
+	for (int i = 0; i < cache->entry_count; i++)
+	{
+		size_t block_len = entries[i].key_len + entries[i].value_len;
+		if (entries[i].offset != tail)
+			memmove(arena + tail, arena + entries[i].offset, block_len);
+		entries[i].offset = tail;
+		tail += block_len;
+	}
+	cache->arena_tail = tail;
+}
+
+int shm_cache_get(shm_cache *cache, const void *key, size_t key_len, void **value, size_t *value_len)
+{
+	int found = 0;
+	uint64_t hash = hash_fnv1a(key, key_len);
+
+	if (shm_cache_lock(cache) != 0)
+		return 0;
+	int idx = shm_cache_find(cache, hash, key, key_len);
+	if (idx >= 0)
+	{
+		shm_cache_entry *entry = &shm_cache_entries(cache)[idx];
+		*value = malloc(entry->value_len > 0 ? entry->value_len : 1);
+		if (*value != NULL)
+		{
+			memcpy(*value, shm_cache_arena(cache) + entry->offset + entry->key_len, entry->value_len);
+			*value_len = entry->value_len;
+			entry->last_used = ++cache->use_clock;
+			found = 1;
+		}
+	}
+	if (found)
+		cache->hits++;
+	else
+		cache->misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+int shm_cache_put(shm_cache *cache, const void *key, size_t key_len, const void *value, size_t value_len)
+{
+	size_t block_len = key_len + value_len;
+	uint64_t hash = hash_fnv1a(key, key_len);
+
+	// Never let a single entry take over the whole cache
+	if (block_len > cache->arena_size / 2)
+		return 1;
+
+	if (shm_cache_lock(cache) != 0)
+		return 1;
+
+	// Another process may have published the same key in the meantime
+	if (shm_cache_find(cache, hash, key, key_len) >= 0)
+	{
+		pthread_mutex_unlock(&cache->lock);
+		return 0;
+	}
+
+	// Make room for the entry
+	while (cache->entry_count > 0 && (cache->entry_count >= cache->max_entries || cache->bytes_used + block_len > cache->arena_size))
+		shm_cache_evict_lru(cache);
+	if (cache->arena_tail + block_len > cache->arena_size)
+		shm_cache_compact(cache);
+
+	shm_cache_entry *entry = &shm_cache_entries(cache)[cache->entry_count++];
+	unsigned char *arena = shm_cache_arena(cache);
+	entry->hash = hash;
+	entry->key_len = key_len;
+	entry->value_len = value_len;
+	entry->offset = cache->arena_tail;
+	entry->last_used = ++cache->use_clock;
+	memcpy(arena + entry->offset, key, key_len);
+	memcpy(arena + entry->offset + key_len, value, value_len);
+	cache->arena_tail += block_len;
+	cache->bytes_used += block_len;
+	cache->insertions++;
+
+	pthread_mutex_unlock(&cache->lock);
+	return 0;
+}
+
+void shm_cache_get_stats(shm_cache *cache, shm_cache_stats *stats)
+{
+	if (shm_cache_lock(cache) != 0)
+	{
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->insertions = cache->insertions;
+	stats->evictions = cache->evictions;
+	stats->entry_count = cache->entry_count;
+	stats->bytes_used = cache->bytes_used;
+	stats->size_cap = cache->arena_size;
+	pthread_mutex_unlock(&cache->lock);
+}
+#endif
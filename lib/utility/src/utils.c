@@ -1,6 +1,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "utility/utils.h"
+
 // Prints 'level' number of "tab" characters
 void print_level_space(int level)
 {
@@ -15,3 +17,16 @@ int string_is_float(char *str)
 			return 1;
 	return 0;
 }
+
+// 64-bit FNV-1a hash of a block of memory
+uint64_t hash_fnv1a(const void *data, size_t length)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,142 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+#include <basic/basic_array_kernels.h>
+
+#include "bench_common.h"
+
+// Benchmark of the bulk array builtins: each kernel on every instruction set this CPU supports,
+// then the builtins against the same work written as a BASIC loop
+
+#define KERNEL_LENGTH (1 << 24)
+#define KERNEL_REPEATS 10
+
+#define PROGRAM_LENGTH "1000000"
+
+// Prints the bandwidth of each kernel, counting every byte read and written
+void bench_kernels(const BASICArrayKernels *kernels, int *ints, int *ints2, float *flts, float *flts2)
+{
+	const double mib = KERNEL_LENGTH * sizeof(int) / (1024.0 * 1024.0);
+	volatile float sink_flt = 0;
+	volatile int sink_int = 0;
+	float fill_value = 1.0f;
+	double start, elapsed[9] = {0};
+
+	for (int r = 0; r < KERNEL_REPEATS; r++)
+	{
+		start = bench_now();
+		sink_int += kernels->sum_int(ints, KERNEL_LENGTH);
+		elapsed[0] += bench_now() - start;
+		start = bench_now();
+		sink_flt += kernels->sum_flt(flts, KERNEL_LENGTH);
+		elapsed[1] += bench_now() - start;
+		start = bench_now();
+		sink_int += kernels->dot_int(ints, ints2, KERNEL_LENGTH);
+		elapsed[2] += bench_now() - start;
+		start = bench_now();
+		sink_flt += kernels->dot_flt(flts, flts2, KERNEL_LENGTH);
+		elapsed[3] += bench_now() - start;
+		start = bench_now();
+		kernels->scale_flt(flts2, 1.0f, KERNEL_LENGTH);
+		elapsed[4] += bench_now() - start;
+		start = bench_now();
+		kernels->add_int(ints2, ints, KERNEL_LENGTH);
+		elapsed[5] += bench_now() - start;
+		start = bench_now();
+		kernels->fill(flts2, &fill_value, KERNEL_LENGTH);
+		elapsed[6] += bench_now() - start;
+		start = bench_now();
+		sink_int += kernels->max_int(ints, KERNEL_LENGTH);
+		elapsed[7] += bench_now() - start;
+		start = bench_now();
+		sink_flt += kernels->min_flt(flts, KERNEL_LENGTH);
+		elapsed[8] += bench_now() - start;
+	}
+
+	// Arrays read and written by each kernel, in the order above
+	const int arrays_touched[] = {1, 1, 2, 2, 2, 3, 1, 1, 1};
+	const char *names[] = {"sum int", "sum float", "dot int", "dot float", "scale float", "add int", "fill", "max int", "min float"};
+	for (int i = 0; i < 9; i++)
+		printf("  %-12s %8.3f ms %8.2f GiB/s\n", names[i], elapsed[i] * 1e3 / KERNEL_REPEATS, arrays_touched[i] * mib * KERNEL_REPEATS / elapsed[i] / 1024.0);
+	(void)sink_flt;
+	(void)sink_int;
+}
+
+// Runs the setup program, then returns the time taken by the timed program in the same runtime
+double bench_program_after_setup(const char *setup_source, const char *source)
+{
+	BASICProgram *setup = bench_parse(setup_source), *program = bench_parse(source);
+	BASICRuntime *runtime = basic_create_runtime(program);
+	basic_execute(runtime, setup->program_sequence);
+
+	double start = bench_now();
+	basic_execute(runtime, program->program_sequence);
+	double elapsed = bench_now() - start;
+
+	basic_free_runtime(runtime);
+	basic_destroy_program(setup);
+	basic_destroy_program(program);
+	return elapsed;
+}
+
+#define SETUP "n = " PROGRAM_LENGTH " - 1\ndim a(n)\ndim b(n)\nfill(a, 3)\nfill(b, 2)\n"
+#define LOOP(body) "i = 0\nwhile i < n + 1 then\n" body "\ni = i + 1\nend\n"
+
+int main(int argc, char *argv[])
+{
+	struct
+	{
+		const char *name, *loop, *builtin;
+	} programs[] = {
+		{"sum", "s = 0\n" LOOP("s = s + a(i)"), "s = sum(a)\n"},
+		{"dot", "s = 0\n" LOOP("s = s + a(i) * b(i)"), "s = dot(a, b)\n"},
+		{"scale", LOOP("a(i) = a(i) * 5"), "scale(a, 5)\n"},
+		{"add", LOOP("a(i) = a(i) + b(i)"), "add(a, b)\n"},
+		{"fill", LOOP("a(i) = 7"), "fill(a, 7)\n"},
+		{"max", "m = a(0)\n" LOOP("m = max(m, a(i))"), "m = max(a)\n"},
+	};
+
+	set_log_mask(0);
+
+	int *ints = (int *)malloc(sizeof(int) * KERNEL_LENGTH), *ints2 = (int *)malloc(sizeof(int) * KERNEL_LENGTH);
+	float *flts = (float *)malloc(sizeof(float) * KERNEL_LENGTH), *flts2 = (float *)malloc(sizeof(float) * KERNEL_LENGTH);
+	if (ints == NULL || ints2 == NULL || flts == NULL || flts2 == NULL)
+	{
+		fprintf(stderr, "Not enough memory for the kernel arrays\n");
+		return 1;
+	}
+	for (int i = 0; i < KERNEL_LENGTH; i++)
+	{
+		ints[i] = ints2[i] = i % 1000;
+		flts[i] = flts2[i] = (float)(i % 1000) * 0.5f;
+	}
+
+	printf("Kernels on %d elements (%d MiB per array), best is %s\n", KERNEL_LENGTH, (int)(KERNEL_LENGTH * sizeof(int) >> 20), basic_array_kernel_name(basic_array_kernels()->level));
+	for (int level = ARRAY_KERNELS_SCALAR; level <= ARRAY_KERNELS_AVX2; level++)
+	{
+		const BASICArrayKernels *kernels = basic_array_kernels_for((BASICArrayKernelLevel)level);
+		if (kernels == NULL)
+			continue;
+		printf("%s:\n", basic_array_kernel_name((BASICArrayKernelLevel)level));
+		bench_kernels(kernels, ints, ints2, flts, flts2);
+	}
+	free(ints);
+	free(ints2);
+	free(flts);
+	free(flts2);
+
+	printf("\nBASIC programs on %s elements:\n", PROGRAM_LENGTH);
+	printf("  %-6s %12s %12s\n", "", "loop", "builtin");
+	for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++)
+	{
+		double loop = bench_program_after_setup(SETUP, programs[i].loop), builtin = bench_program_after_setup(SETUP, programs[i].builtin);
+		printf("  %-6s %9.3f ms %9.3f ms\n", programs[i].name, loop * 1e3, builtin * 1e3);
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "bench_common.h"
+
+// Standard libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+double bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void bench_report(const char *name, size_t operations, const char *unit, double elapsed)
+{
+	printf("  %-30s %8.1f ms %7.1f ns/%s\n", name, elapsed * 1e3, elapsed * 1e9 / operations, unit);
+}
+
+BASICProgram *bench_parse(const char *source)
+{
+	BASICProgram *program = basic_create_program();
+	program->program_source = (char *)source;
+	if (basic_tokenize(program) != 0 || basic_parse_to_ast(program) != 0)
+	{
+		fprintf(stderr, "Failed to parse the benchmark program\n");
+		exit(1);
+	}
+	return program;
+}
+
+double bench_program(const char *source, double expected)
+{
+	BASICProgram *program = bench_parse(source);
+	BASICRuntime *runtime = basic_create_runtime(program);
+	double start = bench_now();
+	basic_execute(runtime, program->program_sequence);
+	double elapsed = bench_now() - start;
+
+	// Integers and floats that the programs add up exactly
+	BASICVariable *result = basic_find_variable(runtime, "s");
+	double value = 0;
+	if (result != NULL && result->value.token_type == DTYPE_NUM)
+		value = result->value.token.literal.num;
+	else if (result != NULL && result->value.token_type == DTYPE_FLT)
+		value = result->value.token.literal.flt;
+	if (runtime->halt || result == NULL || value != expected)
+	{
+		fprintf(stderr, "The benchmark program ended with s = %.17g instead of %.17g:\n%s", value, expected, source);
+		exit(1);
+	}
+
+	basic_free_runtime(runtime);
+	basic_destroy_program(program);
+	return elapsed;
+}
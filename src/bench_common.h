@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <basic/basic.h>
+
+// Helpers shared by the benchmark executables
+
+// Seconds on a monotonic clock
+double bench_now();
+// Prints the time of a case, and of each of its 'operations', named by 'unit', such as "iteration"
+void bench_report(const char *name, size_t operations, const char *unit, double elapsed);
+// Parses a program, exiting if it has an error
+BASICProgram *bench_parse(const char *source);
+// Runs a program in a new runtime, returning the run time. Exits if the program does not end with 'expected' in
+// its variable s, as a broken fast path would still be timed
+double bench_program(const char *source, double expected);
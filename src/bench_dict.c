@@ -0,0 +1,121 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+#include <data_structures/hashmap.h>
+#include <data_structures/interner.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of dictionaries: the hash map and the string interner on their own, then a lookup
+// table in BASIC written with DICT against a linear search through two arrays, which add up the same values
+
+#define MAP_KEYS 1000000
+#define STRING_LOOKUPS 1000000
+#define STRING_KEYS 100000
+
+void bench_hashmap()
+{
+	HashMap map;
+	hashmap_init(&map, sizeof(int), NULL);
+	volatile long found = 0;
+
+	printf("Hash map, %d integer keys:\n", MAP_KEYS);
+	double start = bench_now();
+	for (int i = 0; i < MAP_KEYS; i++)
+		*(int *)hashmap_insert(&map, (uint64_t)i * 7919, hashmap_hash_u64((uint64_t)i * 7919), NULL) = i;
+	bench_report("insert", MAP_KEYS, "op", bench_now() - start);
+
+	start = bench_now();
+	for (int i = 0; i < MAP_KEYS; i++)
+		found += *(int *)hashmap_find(&map, (uint64_t)i * 7919, hashmap_hash_u64((uint64_t)i * 7919));
+	bench_report("find, present", MAP_KEYS, "op", bench_now() - start);
+
+	start = bench_now();
+	for (int i = 0; i < MAP_KEYS; i++)
+		found += hashmap_find(&map, (uint64_t)i * 7919 + 1, hashmap_hash_u64((uint64_t)i * 7919 + 1)) != NULL;
+	bench_report("find, missing", MAP_KEYS, "op", bench_now() - start);
+
+	start = bench_now();
+	for (int i = 0; i < MAP_KEYS; i++)
+		found += hashmap_remove(&map, (uint64_t)i * 7919, hashmap_hash_u64((uint64_t)i * 7919));
+	bench_report("remove", MAP_KEYS, "op", bench_now() - start);
+
+	hashmap_free(&map);
+	(void)found;
+}
+
+void bench_interner()
+{
+	StringInterner interner;
+	interner_init(&interner);
+	char key[32];
+	volatile long ids = 0;
+
+	printf("String interner, %d lookups of %d strings:\n", STRING_LOOKUPS, STRING_KEYS);
+	double start = bench_now();
+	for (int i = 0; i < STRING_LOOKUPS; i++)
+	{
+		snprintf(key, sizeof(key), "key_%d", (i * 31) % STRING_KEYS);
+		ids += interner_intern(&interner, key);
+	}
+	bench_report("intern", STRING_LOOKUPS, "op", bench_now() - start);
+
+	interner_free(&interner);
+	(void)ids;
+}
+
+// A table of 1000 numbers, looked up 10000 times
+const char *BENCH_DICT =
+	"d = dict()\n"
+	"i = 0\n"
+	"while i < 1000 then\n"
+	"    d(i * 7) = i\n"
+	"    i = i + 1\n"
+	"end\n"
+	"s = 0\n"
+	"j = 0\n"
+	"while j < 10000 then\n"
+	"    s = s + d((j % 1000) * 7)\n"
+	"    j = j + 1\n"
+	"end\n";
+
+const char *BENCH_SCAN =
+	"dim keys(999)\n"
+	"dim values(999)\n"
+	"i = 0\n"
+	"while i < 1000 then\n"
+	"    keys(i) = i * 7\n"
+	"    values(i) = i\n"
+	"    i = i + 1\n"
+	"end\n"
+	"s = 0\n"
+	"j = 0\n"
+	"while j < 10000 then\n"
+	"    k = (j % 1000) * 7\n"
+	"    i = 0\n"
+	"    while keys(i) < k then\n"
+	"        i = i + 1\n"
+	"    end\n"
+	"    s = s + values(i)\n"
+	"    j = j + 1\n"
+	"end\n";
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	bench_hashmap();
+	bench_interner();
+
+	printf("BASIC, 10000 lookups in a table of 1000 entries:\n");
+	// Each of the numbers 0 to 999 is found 10 times
+	bench_report("DICT", 10000, "lookup", bench_program(BENCH_DICT, 10 * 499500));
+	bench_report("linear search of an array", 10000, "lookup", bench_program(BENCH_SCAN, 10 * 499500));
+	return 0;
+}
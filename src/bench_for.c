@@ -0,0 +1,69 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of FOR loops against the WHILE loops they replace, adding up i % 7 for i up to 1000000,
+// with global variables and with the local variables of a function
+
+#define ITERATIONS 1000000
+
+const char *BENCH_WHILE =
+	"s = 0\n"
+	"i = 1\n"
+	"while i < 1000001 then\n"
+	"    s = s + i % 7\n"
+	"    i = i + 1\n"
+	"end\n";
+
+const char *BENCH_FOR =
+	"s = 0\n"
+	"for i = 1 to 1000000\n"
+	"    s = s + i % 7\n"
+	"next\n";
+
+const char *BENCH_WHILE_LOCAL =
+	"function total(n)\n"
+	"    s = 0\n"
+	"    i = 1\n"
+	"    while i < n + 1 then\n"
+	"        s = s + i % 7\n"
+	"        i = i + 1\n"
+	"    end\n"
+	"    return s\n"
+	"end\n"
+	"s = total(1000000)\n";
+
+const char *BENCH_FOR_LOCAL =
+	"function total(n)\n"
+	"    s = 0\n"
+	"    for i = 1 to n\n"
+	"        s = s + i % 7\n"
+	"    next\n"
+	"    return s\n"
+	"end\n"
+	"s = total(1000000)\n";
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	// What every program adds up
+	long expected = 0;
+	for (int i = 1; i <= ITERATIONS; i++)
+		expected += i % 7;
+
+	printf("BASIC, %d iterations:\n", ITERATIONS);
+	bench_report("WHILE, globals", ITERATIONS, "iteration", bench_program(BENCH_WHILE, expected));
+	bench_report("FOR, globals", ITERATIONS, "iteration", bench_program(BENCH_FOR, expected));
+	bench_report("WHILE, locals", ITERATIONS, "iteration", bench_program(BENCH_WHILE_LOCAL, expected));
+	bench_report("FOR, locals", ITERATIONS, "iteration", bench_program(BENCH_FOR_LOCAL, expected));
+	return 0;
+}
@@ -0,0 +1,90 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/format/format.h>
+
+#include "bench_common.h"
+
+// Microbenchmark of the number formatting routines against sprintf
+
+#define VALUE_COUNT 4096
+#define REPEAT_COUNT 500
+
+int main(int argc, char *argv[])
+{
+	int ints[VALUE_COUNT];
+	float floats[VALUE_COUNT];
+	char buffer[FORMAT_BUFFER_SIZE];
+	// Sum of lengths, so that the calls can't be optimized away
+	size_t checksum = 0;
+
+	srand(1);
+	for (int i = 0; i < VALUE_COUNT; i++)
+	{
+		// Mostly small counters, with some large and negative values
+		ints[i] = (i % 4 == 0) ? rand() - RAND_MAX / 2 : rand() % 10000;
+		// Values like the ones programs compute: short decimals and ratios
+		floats[i] = (i % 2 == 0) ? (rand() % 100000) / 100.0f : (float)rand() / (float)(rand() % 1000 + 1);
+	}
+
+	struct
+	{
+		const char *name;
+		int kind;
+	} cases[] = {
+		{"sprintf(\"%d\")", 0},
+		{"format_int", 1},
+		{"sprintf(\"%f\")", 2},
+		{"format_float_fixed", 3},
+		{"format_float_shortest", 4},
+	};
+
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+	{
+		double start = bench_now();
+		for (int r = 0; r < REPEAT_COUNT; r++)
+		{
+			for (int i = 0; i < VALUE_COUNT; i++)
+			{
+				switch (cases[c].kind)
+				{
+				case 0:
+					checksum += sprintf(buffer, "%d", ints[i]);
+					break;
+				case 1:
+					checksum += format_int(ints[i], buffer);
+					break;
+				case 2:
+					checksum += sprintf(buffer, "%f", floats[i]);
+					break;
+				case 3:
+					checksum += format_float_fixed(floats[i], buffer);
+					break;
+				default:
+					checksum += format_float_shortest(floats[i], buffer);
+				}
+			}
+		}
+		double elapsed = bench_now() - start;
+		printf("%-24s %8.1f ns per value\n", cases[c].name, elapsed * 1e9 / ((double)VALUE_COUNT * REPEAT_COUNT));
+	}
+
+	// Check the outputs against sprintf while here
+	int mismatches = 0;
+	for (int i = 0; i < VALUE_COUNT; i++)
+	{
+		char expected[FORMAT_BUFFER_SIZE];
+		sprintf(expected, "%d", ints[i]);
+		format_int(ints[i], buffer);
+		mismatches += strcmp(buffer, expected) != 0;
+		sprintf(expected, "%f", floats[i]);
+		format_float_fixed(floats[i], buffer);
+		mismatches += strcmp(buffer, expected) != 0;
+		format_float_shortest(floats[i], buffer);
+		mismatches += strtof(buffer, NULL) != floats[i];
+	}
+	printf("Mismatches: %d (checksum %zu)\n", mismatches, checksum);
+	return mismatches != 0;
+}
@@ -0,0 +1,64 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of calls to user-defined functions: a recursive fib(30), and the cost of a single call, from
+// a loop that calls a function that returns its argument against the same loop without the call
+
+// fib(30) makes this many calls
+#define FIB_CALLS 2692537
+#define LOOP_CALLS 1000000
+
+const char *BENCH_FIB =
+	"function fib(n)\n"
+	"    if n < 2 then\n"
+	"        return n\n"
+	"    end\n"
+	"    return fib(n - 1) + fib(n - 2)\n"
+	"end\n"
+	"s = fib(30)\n";
+
+// Both loops run in a function, so that their variables are local slots like those of the called function
+const char *BENCH_CALLS =
+	"function identity(x)\n"
+	"    return x\n"
+	"end\n"
+	"function loop(count)\n"
+	"    i = 0\n"
+	"    while i < count then\n"
+	"        i = identity(i) + 1\n"
+	"    end\n"
+	"    return i\n"
+	"end\n"
+	"s = loop(1000000)\n";
+
+const char *BENCH_NO_CALLS =
+	"function loop(count)\n"
+	"    i = 0\n"
+	"    while i < count then\n"
+	"        i = i + 1\n"
+	"    end\n"
+	"    return i\n"
+	"end\n"
+	"s = loop(1000000)\n";
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	printf("BASIC, user-defined functions:\n");
+	bench_report("recursive fib(30)", FIB_CALLS, "call", bench_program(BENCH_FIB, 832040));
+	double calls = bench_program(BENCH_CALLS, LOOP_CALLS), no_calls = bench_program(BENCH_NO_CALLS, LOOP_CALLS);
+	bench_report("loop calling identity(i)", LOOP_CALLS, "call", calls);
+	bench_report("same loop without the call", LOOP_CALLS, "call", no_calls);
+	bench_report("cost of one call", LOOP_CALLS, "call", calls - no_calls);
+	return 0;
+}
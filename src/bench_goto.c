@@ -0,0 +1,76 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of GOTO: a loop written with GOTO against the same WHILE loop, then the GOTO loop with
+// thousands of numbered statements between its jumps, which takes as long if jumps don't search for their line
+
+#define ITERATIONS 1000000
+#define FILLER_LINES 5000
+
+const char *BENCH_WHILE =
+	"s = 0\n"
+	"i = 0\n"
+	"while i < 1000000 then\n"
+	"    i = i + 1\n"
+	"    s = s + i % 7\n"
+	"end\n";
+
+const char *BENCH_GOTO =
+	"s = 0\n"
+	"i = 0\n"
+	"10 i = i + 1\n"
+	"s = s + i % 7\n"
+	"if i < 1000000 then\n"
+	"    goto 10\n"
+	"end\n";
+
+// Jumps over the filler lines to a GOTO at the end of the program, which jumps back to the top
+char *bench_goto_far()
+{
+	size_t capacity = 256 + FILLER_LINES * 32, length = 0;
+	char *source = (char *)malloc(capacity);
+	if (source == NULL)
+		exit(1);
+	length += snprintf(source + length, capacity - length,
+					   "s = 0\n"
+					   "i = 0\n"
+					   "10 i = i + 1\n"
+					   "s = s + i % 7\n"
+					   "if i = 1000000 then\n"
+					   "    goto 30\n"
+					   "end\n"
+					   "goto 20\n");
+	for (int i = 0; i < FILLER_LINES; i++)
+		length += snprintf(source + length, capacity - length, "%d s = s + 1\n", 100 + i);
+	snprintf(source + length, capacity - length,
+			 "20 goto 10\n"
+			 "30 s = s + 0\n");
+	return source;
+}
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	// What every program adds up. The filler lines are jumped over
+	long expected = 0;
+	for (int i = 1; i <= ITERATIONS; i++)
+		expected += i % 7;
+
+	printf("BASIC, %d iterations:\n", ITERATIONS);
+	bench_report("WHILE", ITERATIONS, "iteration", bench_program(BENCH_WHILE, expected));
+	bench_report("GOTO", ITERATIONS, "iteration", bench_program(BENCH_GOTO, expected));
+	char *far = bench_goto_far();
+	bench_report("GOTO over 5000 lines, 2 jumps", ITERATIONS, "iteration", bench_program(far, expected));
+	free(far);
+	return 0;
+}
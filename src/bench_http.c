@@ -0,0 +1,225 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+// Linux libraries
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <tcpserver/tcpserver.h>
+#include <http/http.h>
+
+#include "bench_common.h"
+
+// Benchmark of the server modes: each one serves a fixed response from a forked server process,
+// while client threads make one request per connection to it, then many requests on kept connections
+
+#define BENCH_PORT 1112
+#define CLIENT_THREADS 8
+#define REQUESTS_PER_THREAD 2000
+#define SERVER_THREADS 16
+// Requests sent on each kept-alive connection
+#define KEEP_ALIVE_REQUESTS 100
+
+const char *BENCH_REQUEST = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+const char *BENCH_KEEP_ALIVE_REQUEST = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+void bench_generate_response(int sock_fd, http_request_header *req, http_response_header *res)
+{
+	http_respond_text(sock_fd, res, "ok");
+}
+
+int bench_serve_client(int cli_sock, tcp_server *tcpsv)
+{
+	http_respond(cli_sock, bench_generate_response);
+	return 0;
+}
+
+int bench_serve_request(int cli_sock, char *request, int request_len, void *request_state, int keep_alive, tcp_server *tcpsv)
+{
+	return http_respond_request(cli_sock, request, request_len, request_state, keep_alive, bench_generate_response);
+}
+
+// Connects to the benchmark server. Returns -1 if it failed
+int bench_connect()
+{
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(BENCH_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+// Makes one request on a new connection. Returns 1 if it failed
+int bench_request()
+{
+	int sock = bench_connect();
+	if (sock < 0)
+		return 1;
+	if (send(sock, BENCH_REQUEST, strlen(BENCH_REQUEST), 0) < 0)
+	{
+		close(sock);
+		return 1;
+	}
+	char response[1024];
+	int received = 0, read_len;
+	while ((read_len = recv(sock, response + received, sizeof(response) - 1 - received, 0)) > 0)
+		received += read_len;
+	close(sock);
+	response[received] = 0;
+	return strncmp(response, "HTTP/1.1 200", 12) != 0 || received < 2 || strcmp(response + received - 2, "ok") != 0;
+}
+
+// Makes KEEP_ALIVE_REQUESTS requests one after another, reusing the connection. Returns the number that failed
+int bench_keep_alive_requests()
+{
+	int sock = -1, failed = 0, reused = 0;
+	char response[1024];
+	for (int i = 0; i < KEEP_ALIVE_REQUESTS; i++)
+	{
+		if (sock < 0 && (sock = bench_connect()) < 0)
+			return failed + KEEP_ALIVE_REQUESTS - i;
+
+		// The response has a Content-Length, so it ends with the "ok" body
+		int received = 0, read_len = 0;
+		if (send(sock, BENCH_KEEP_ALIVE_REQUEST, strlen(BENCH_KEEP_ALIVE_REQUEST), MSG_NOSIGNAL) >= 0)
+		{
+			while ((received < 2 || strncmp(response + received - 2, "ok", 2) != 0) &&
+				   (read_len = recv(sock, response + received, sizeof(response) - 1 - received, 0)) > 0)
+				received += read_len;
+		}
+		if (received == 0 && reused)
+		{
+			// The server may close an idle connection, so like other clients, try again on a new one
+			close(sock);
+			sock = -1;
+			reused = 0;
+			i--;
+			continue;
+		}
+		if (read_len <= 0)
+		{
+			close(sock);
+			return failed + KEEP_ALIVE_REQUESTS - i;
+		}
+		failed += strncmp(response, "HTTP/1.1 200", 12) != 0;
+		reused = 1;
+	}
+	close(sock);
+	return failed;
+}
+
+// Forks a server in the given mode, and waits until it accepts connections
+pid_t bench_start_server(tcpserver_mode mode)
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		if (freopen("/dev/null", "w", stdout) == NULL)
+			_exit(1);
+		tcp_server sock_sv;
+		memset(&sock_sv, 0, sizeof(sock_sv));
+		sock_sv.listen_port = BENCH_PORT;
+		sock_sv.client_handler = bench_serve_client;
+		sock_sv.request_handler = bench_serve_request;
+		sock_sv.request_length = http_request_length;
+		sock_sv.request_state_size = sizeof(http_parser);
+		sock_sv.mode = mode;
+		sock_sv.worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		sock_sv.thread_count = SERVER_THREADS;
+		sock_sv.keep_alive_timeout = 5;
+		if (tcpserver_create(&sock_sv) != 0)
+			_exit(1);
+		tcpserver_start_listening(&sock_sv);
+		tcpserver_close(&sock_sv);
+		_exit(0);
+	}
+
+	for (int attempt = 0; attempt < 200; attempt++)
+	{
+		if (bench_request() == 0)
+			return pid;
+		usleep(10000);
+	}
+	fprintf(stderr, "The server did not start\n");
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return -1;
+}
+
+// Makes REQUESTS_PER_THREAD requests. Returns the number of failed requests
+void *bench_client(void *arg)
+{
+	long failed = 0;
+	int keep_alive = *(int *)arg;
+	if (keep_alive)
+	{
+		for (int i = 0; i < REQUESTS_PER_THREAD; i += KEEP_ALIVE_REQUESTS)
+			failed += bench_keep_alive_requests();
+	}
+	else
+	{
+		for (int i = 0; i < REQUESTS_PER_THREAD; i++)
+			failed += bench_request();
+	}
+	return (void *)failed;
+}
+
+void bench_mode(const char *name, tcpserver_mode mode, int keep_alive)
+{
+	pid_t server = bench_start_server(mode);
+	if (server < 0)
+		return;
+
+	pthread_t threads[CLIENT_THREADS];
+	double start = bench_now();
+	for (int i = 0; i < CLIENT_THREADS; i++)
+		pthread_create(&threads[i], NULL, bench_client, &keep_alive);
+	long failed = 0;
+	for (int i = 0; i < CLIENT_THREADS; i++)
+	{
+		void *thread_failed;
+		pthread_join(threads[i], &thread_failed);
+		failed += (long)thread_failed;
+	}
+	double elapsed = bench_now() - start;
+
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+
+	int requests = CLIENT_THREADS * REQUESTS_PER_THREAD;
+	printf("  %-26s %8.0f req/s %7.1f us/req  %ld failed\n", name, requests / elapsed, elapsed * 1e6 / requests, failed);
+}
+
+int main(int argc, char *argv[])
+{
+	printf("%d clients, %d requests each, one connection per request:\n", CLIENT_THREADS, REQUESTS_PER_THREAD);
+	bench_mode("fork per connection", TCPSERVER_FORK_PER_CONNECTION, 0);
+	bench_mode("pre-fork", TCPSERVER_PREFORK, 0);
+	bench_mode("epoll", TCPSERVER_EPOLL, 0);
+	bench_mode("io_uring", TCPSERVER_IO_URING, 0);
+	bench_mode("threads", TCPSERVER_THREADS, 0);
+
+	printf("%d clients, %d requests each, %d requests per kept-alive connection:\n", CLIENT_THREADS, REQUESTS_PER_THREAD, KEEP_ALIVE_REQUESTS);
+	bench_mode("fork per connection", TCPSERVER_FORK_PER_CONNECTION, 1);
+	bench_mode("pre-fork", TCPSERVER_PREFORK, 1);
+	bench_mode("epoll", TCPSERVER_EPOLL, 1);
+	bench_mode("io_uring", TCPSERVER_IO_URING, 1);
+	bench_mode("threads", TCPSERVER_THREADS, 1);
+	return 0;
+}
@@ -0,0 +1,163 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <http/http_parser.h>
+
+#include "bench_common.h"
+
+// Microbenchmark of the request header parser: requests parsed whole, as the event loops usually get them,
+// and fed in small pieces, as they come in from a slow client
+
+#define REPEAT_COUNT 1000000
+// Bytes given to the parser at a time in the split cases
+#define PIECE_SIZE 64
+
+const char *REQUEST_SHORT = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+const char *REQUEST_EXECUTE =
+	"POST /execute?seed=7&fixed_floats HTTP/1.1\r\n"
+	"Host: localhost:1111\r\n"
+	"Content-Type: text/plain\r\n"
+	"Content-Length: 24\r\n"
+	"\r\n";
+const char *REQUEST_BROWSER =
+	"GET /codemirror.js HTTP/1.1\r\n"
+	"Host: localhost:1111\r\n"
+	"Connection: keep-alive\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+	"sec-ch-ua-platform: \"Linux\"\r\n"
+	"Accept: */*\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: no-cors\r\n"
+	"Sec-Fetch-Dest: script\r\n"
+	"Referer: http://localhost:1111/\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: en-US,en;q=0.9\r\n"
+	"If-None-Match: \"3f2a9c1e5b7d8a0c4e6f-gzip\"\r\n"
+	"\r\n";
+// Lines may end with a bare LF, and empty lines may come before the request line
+const char *REQUEST_BARE_LF = "\r\nGET /?a=1 HTTP/1.0\nHost: localhost\nConnection: close\n\n";
+
+// Requests that must be rejected, whole or in pieces
+const char *REQUESTS_MALFORMED[] = {
+	"POST /execute HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n",
+	"POST /execute HTTP/1.1\r\nContent-Length: 5x\r\n\r\n",
+	"GET / HTTP/1.1\r\nUser-Agent: a\r\n b\r\n\r\n",
+	"GET / HTTP/1.1\r\nHost: localhost\r\n\tfolded\r\n\r\n",
+	" / HTTP/1.1\r\n\r\n",
+	"GET  HTTP/1.1\r\n\r\n",
+	"GET / HTTP/1.1\r\nHost localhost\r\n\r\n",
+	"GET / HTTP/1.1\r\nBad Name: value\r\n\r\n",
+	"GET / HTTP/2.0\r\n\r\n",
+	"GET / HTTP/1.1x\r\n\r\n",
+	"GET / FTP/1.1\r\n\r\n"};
+
+// Parses the request REPEAT_COUNT times, giving the parser 'piece' more bytes on each call, or all of them if 0
+void bench_case(const char *name, const char *request, int piece)
+{
+	int length = (int)strlen(request);
+	// Sum of the results, so that the parsing can't be optimized away
+	long checksum = 0;
+	http_parser parser;
+
+	double start = bench_now();
+	for (int r = 0; r < REPEAT_COUNT; r++)
+	{
+		memset(&parser, 0, sizeof(parser));
+		int header_len = 0;
+		if (piece == 0)
+			header_len = http_parser_execute(&parser, request, length);
+		for (int received = piece; header_len == 0 && piece > 0; received += piece)
+			header_len = http_parser_execute(&parser, request, received < length ? received : length);
+		checksum += header_len + parser.field_count + parser.path.length;
+	}
+	double elapsed = bench_now() - start;
+
+	if (checksum != (long)REPEAT_COUNT * (length + parser.field_count + parser.path.length))
+		printf("%s: the request was not parsed\n", name);
+	printf("%-28s %4d bytes %3d fields %8.1f ns per request\n", name, length, parser.field_count, elapsed * 1e9 / REPEAT_COUNT);
+}
+
+// Whether two parsers got the same results
+int parsers_match(const http_parser *a, const http_parser *b)
+{
+	return a->method == b->method && a->path.offset == b->path.offset && a->path.length == b->path.length &&
+		   a->query.offset == b->query.offset && a->query.length == b->query.length && a->http_1_1 == b->http_1_1 &&
+		   a->keep_alive == b->keep_alive && a->content_length == b->content_length &&
+		   a->transfer_encoding == b->transfer_encoding && a->accept_encoding.offset == b->accept_encoding.offset &&
+		   a->accept_encoding.length == b->accept_encoding.length && a->if_none_match.offset == b->if_none_match.offset &&
+		   a->if_none_match.length == b->if_none_match.length && a->fields_start == b->fields_start &&
+		   a->field_count == b->field_count && a->header_length == b->header_length;
+}
+
+// Parses the request fed in pieces of every size from 1 byte up. Returns the number of piece sizes whose result
+// differs from parsing it whole, which is 'expected'
+int check_pieces(const char *name, const char *request, int expected)
+{
+	int length = (int)strlen(request), mismatches = 0;
+	http_parser whole, split;
+	memset(&whole, 0, sizeof(whole));
+	int whole_result = http_parser_execute(&whole, request, length);
+	if (whole_result != expected)
+	{
+		printf("%s: parsed whole, got %d instead of %d\n", name, whole_result, expected);
+		mismatches++;
+	}
+
+	for (int piece = 1; piece <= length; piece++)
+	{
+		memset(&split, 0, sizeof(split));
+		int result = 0;
+		for (int received = piece; result == 0 && received < length + piece; received += piece)
+			result = http_parser_execute(&split, request, received < length ? received : length);
+		if (result != whole_result || (result > 0 && !parsers_match(&whole, &split)))
+		{
+			printf("%s: parsed in %d byte pieces, got %d instead of %d\n", name, piece, result, whole_result);
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+	// Check the parser before timing it: any way the header is split must give the same result,
+	// and malformed headers must be rejected however they come in
+	int mismatches = 0;
+	mismatches += check_pieces("short GET", REQUEST_SHORT, (int)strlen(REQUEST_SHORT));
+	mismatches += check_pieces("POST /execute", REQUEST_EXECUTE, (int)strlen(REQUEST_EXECUTE));
+	mismatches += check_pieces("browser GET", REQUEST_BROWSER, (int)strlen(REQUEST_BROWSER));
+	mismatches += check_pieces("bare LF", REQUEST_BARE_LF, (int)strlen(REQUEST_BARE_LF));
+	for (size_t i = 0; i < sizeof(REQUESTS_MALFORMED) / sizeof(REQUESTS_MALFORMED[0]); i++)
+	{
+		char name[32];
+		sprintf(name, "malformed request %zu", i + 1);
+		mismatches += check_pieces(name, REQUESTS_MALFORMED[i], -1);
+	}
+	printf("Mismatches: %d\n", mismatches);
+
+
+	bench_case("short GET", REQUEST_SHORT, 0);
+	bench_case("POST /execute", REQUEST_EXECUTE, 0);
+	bench_case("browser GET", REQUEST_BROWSER, 0);
+	bench_case("browser GET, 64 byte pieces", REQUEST_BROWSER, PIECE_SIZE);
+
+	// Walking the fields and the query string takes views too
+	http_parser parser;
+	memset(&parser, 0, sizeof(parser));
+	http_parser_execute(&parser, REQUEST_EXECUTE, (int)strlen(REQUEST_EXECUTE));
+	int position = 0;
+	http_view name, value;
+	printf("query of POST /execute:");
+	while (http_query_next(REQUEST_EXECUTE, parser.query, &position, &name, &value))
+		printf(" [%.*s = %.*s]", name.length, REQUEST_EXECUTE + name.offset, value.length, REQUEST_EXECUTE + value.offset);
+	printf("\nfields:");
+	position = 0;
+	while (http_parser_next_field(&parser, REQUEST_EXECUTE, &position, &name, &value))
+		printf(" [%.*s: %.*s]", name.length, REQUEST_EXECUTE + name.offset, value.length, REQUEST_EXECUTE + value.offset);
+	printf("\n");
+	return mismatches != 0;
+}
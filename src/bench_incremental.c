@@ -0,0 +1,189 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of the incremental front end: one-character edits in a large program,
+// compared against lexing and parsing the whole program again
+
+#define PROGRAM_LINES 5000
+#define EDIT_COUNT 2000
+
+// Builds a program with a mix of assignments, calls and nested blocks
+char *bench_build_program(int lines)
+{
+	size_t capacity = (size_t)lines * 64, length = 0;
+	char *source = (char *)malloc(capacity);
+	int line = 0;
+	while (line < lines)
+	{
+		switch (line % 10)
+		{
+		case 0:
+			length += sprintf(source + length, "x%d = %d * (y + 3)\n", line, line);
+			break;
+		case 1:
+			length += sprintf(source + length, "if x%d > 10 then\n", line - 1);
+			break;
+		case 2:
+			length += sprintf(source + length, "    print(\"value\", x%d)\n", line - 2);
+			break;
+		case 3:
+			length += sprintf(source + length, "else\n");
+			break;
+		case 4:
+			length += sprintf(source + length, "    y = max(y, %d)\n", line);
+			break;
+		case 5:
+			length += sprintf(source + length, "end\n");
+			break;
+		case 6:
+			length += sprintf(source + length, "while y < %d then\n", line);
+			break;
+		case 7:
+			length += sprintf(source + length, "    y = y + 1\n");
+			break;
+		case 8:
+			length += sprintf(source + length, "end\n");
+			break;
+		default:
+			length += sprintf(source + length, "print(y)\n");
+		}
+		line++;
+	}
+	source[length] = '\0';
+	return source;
+}
+
+int bench_compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Structural comparison of two node lists
+int bench_ast_equal(ASTNode *a, ASTNode *b)
+{
+	while (a != NULL && b != NULL)
+	{
+		if (a->type != b->type)
+			return 0;
+		switch (a->type)
+		{
+		case AST_IMMEDIATE:
+		{
+			StringLiteral sa, sb;
+			if (a->data.token_type != b->data.token_type)
+				return 0;
+			ast_data_as_string(a->data, sa);
+			ast_data_as_string(b->data, sb);
+			if (strcmp(sa, sb) != 0)
+				return 0;
+			break;
+		}
+		case AST_VARIABLE:
+		case AST_FUNC_CALL:
+		case AST_KEYWORD:
+			if (strcmp(a->data.token.kw, b->data.token.kw) != 0)
+				return 0;
+			break;
+		case AST_OPERATION:
+			if (a->data.token.op != b->data.token.op)
+				return 0;
+			break;
+		default:
+			break;
+		}
+		if (!bench_ast_equal(a->child, b->child))
+			return 0;
+		a = a->next;
+		b = b->next;
+	}
+	return a == NULL && b == NULL;
+}
+
+// Full lex and parse of the current source, for comparison. Returns 1 if the results agree
+int bench_check_against_full_parse(BASICIncrementalProgram *inc, int incremental_errors)
+{
+	BASICProgram *full = basic_create_program();
+	full->program_source = inc->source;
+	int full_error = basic_tokenize(full) != 0 || basic_parse_to_ast(full) != 0;
+	int agree;
+	if (full_error)
+		agree = incremental_errors > 0;
+	else
+		agree = incremental_errors == 0 && bench_ast_equal(full->program_sequence->child, inc->program->program_sequence->child);
+	basic_destroy_program(full);
+	return agree;
+}
+
+int main(int argc, char *argv[])
+{
+	const char edit_chars[] = "x1 (\n";
+	int mismatches = 0;
+
+	set_log_mask(0);
+	srand(1);
+
+	char *source = bench_build_program(PROGRAM_LINES);
+	size_t source_length = strlen(source);
+	printf("Program: %d lines, %zu bytes\n", PROGRAM_LINES, source_length);
+
+	double start = bench_now();
+	BASICProgram *full = basic_create_program();
+	full->program_source = source;
+	basic_tokenize(full);
+	basic_parse_to_ast(full);
+	double full_time = bench_now() - start;
+	basic_destroy_program(full);
+	printf("Full lex + parse:          %10.3f ms\n", full_time * 1e3);
+
+	start = bench_now();
+	BASICIncrementalProgram *inc = basic_incremental_create(source, source_length);
+	printf("Incremental initial build: %10.3f ms\n", (bench_now() - start) * 1e3);
+
+	// Type a character somewhere and delete it again, like a user fixing a typo
+	double edit_time = 0, worst_edit = 0;
+	double *edit_times = (double *)malloc(sizeof(double) * EDIT_COUNT * 2);
+	for (int i = 0; i < EDIT_COUNT; i++)
+	{
+		size_t offset = (size_t)rand() % inc->source_length;
+		char c = edit_chars[rand() % (sizeof(edit_chars) - 1)];
+
+		start = bench_now();
+		int errors = basic_incremental_edit(inc, offset, 0, &c, 1);
+		double elapsed = bench_now() - start;
+		edit_time += elapsed;
+		edit_times[i * 2] = elapsed;
+		worst_edit = elapsed > worst_edit ? elapsed : worst_edit;
+		if (i % 100 == 0 && !bench_check_against_full_parse(inc, errors))
+			mismatches++;
+
+		start = bench_now();
+		errors = basic_incremental_edit(inc, offset, 1, "", 0);
+		elapsed = bench_now() - start;
+		edit_time += elapsed;
+		edit_times[i * 2 + 1] = elapsed;
+		worst_edit = elapsed > worst_edit ? elapsed : worst_edit;
+		if (i % 100 == 0 && !bench_check_against_full_parse(inc, errors))
+			mismatches++;
+	}
+	qsort(edit_times, EDIT_COUNT * 2, sizeof(double), bench_compare_double);
+	printf("Incremental edit (mean):   %10.3f us\n", edit_time / (EDIT_COUNT * 2) * 1e6);
+	printf("Incremental edit (median): %10.3f us\n", edit_times[EDIT_COUNT] * 1e6);
+	printf("Incremental edit (p99):    %10.3f us\n", edit_times[EDIT_COUNT * 2 * 99 / 100] * 1e6);
+	printf("Incremental edit (worst):  %10.3f us\n", worst_edit * 1e6);
+	printf("Mismatches against full parse: %d\n", mismatches);
+
+	free(edit_times);
+	basic_incremental_destroy(inc);
+	free(source);
+	return mismatches != 0;
+}
@@ -0,0 +1,76 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of lazily parsed block bodies: a large program where most branches never run,
+// timed from receiving the source until the program can start running
+
+#define BRANCH_COUNT 500
+#define BRANCH_LINES 40
+#define REPEAT_COUNT 10
+
+// Builds a program made of IF blocks with big bodies, of which only the first one is taken
+char *bench_build_program()
+{
+	size_t capacity = (size_t)BRANCH_COUNT * (BRANCH_LINES + 4) * 48, length = 0;
+	char *source = (char *)malloc(capacity);
+	length += sprintf(source + length, "mode = 0\n");
+	for (int branch = 0; branch < BRANCH_COUNT; branch++)
+	{
+		length += sprintf(source + length, "if mode = %d then\n", branch);
+		for (int line = 0; line < BRANCH_LINES; line++)
+		{
+			if (line % 8 == 0)
+				length += sprintf(source + length, "    while y < %d then\n        y = y + 1\n    end\n", line);
+			else
+				length += sprintf(source + length, "    x%d = max(x, %d) * (y + %d)\n", line, line, branch);
+		}
+		length += sprintf(source + length, "end\n");
+	}
+	source[length] = '\0';
+	return source;
+}
+
+// Time to lex and parse the program, plus validation of the deferred bodies if asked. Only lexes if 'parse' is 0
+double bench_compile(char *source, int parse, int lazy, int validate)
+{
+	double total = 0;
+	for (int i = 0; i < REPEAT_COUNT; i++)
+	{
+		BASICProgram *program = basic_create_program();
+		program->program_source = source;
+		program->program_tokens.lazy_bodies = lazy;
+
+		double start = bench_now();
+		if (basic_tokenize(program) != 0 || (parse && basic_parse_to_ast(program) != 0) || (validate && basic_parse_validate(program) != 0))
+			fprintf(stderr, "Failed to parse the benchmark program\n");
+		total += bench_now() - start;
+
+		basic_destroy_program(program);
+	}
+	return total / REPEAT_COUNT;
+}
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	char *source = bench_build_program();
+	printf("Program: %d branches of %d lines, %zu bytes\n", BRANCH_COUNT, BRANCH_LINES, strlen(source));
+
+	printf("Lexing only:              %10.3f ms\n", bench_compile(source, 0, 0, 0) * 1e3);
+	printf("Eager parse:              %10.3f ms\n", bench_compile(source, 1, 0, 0) * 1e3);
+	printf("Lazy parse:               %10.3f ms\n", bench_compile(source, 1, 1, 0) * 1e3);
+	printf("Lazy parse + validation:  %10.3f ms\n", bench_compile(source, 1, 1, 1) * 1e3);
+
+	free(source);
+	return 0;
+}
@@ -0,0 +1,82 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of the program output flush policies: write calls and time for a program
+// printing 10000 lines, with the output going to /dev/null
+
+#define PRINT_COUNT 10000
+
+const char *BENCH_PROGRAM =
+	"i = 0\n"
+	"while i < 10000 then\n"
+	"    print(\"line\", i, i * 3)\n"
+	"    i = i + 1\n"
+	"end\n";
+
+// Runs the program with the given policy, printing to output_fd. Returns the number of write calls made
+unsigned long bench_run(BASICProgram *program, int output_fd, SystemFlushPolicy policy, size_t flush_size, unsigned long long flush_interval_us, double *elapsed)
+{
+	BASICRuntime *runtime = basic_create_runtime(program);
+	system_output_set_sink(runtime->output, system_sink_fd(output_fd));
+	system_output_set_policy(runtime->output, policy, flush_size, flush_interval_us);
+
+	double start = bench_now();
+	basic_execute(runtime, program->program_sequence);
+	system_output_flush(runtime->output);
+	*elapsed = bench_now() - start;
+
+	unsigned long write_calls = runtime->output->write_calls;
+	basic_free_runtime(runtime);
+	return write_calls;
+}
+
+int main(int argc, char *argv[])
+{
+	struct
+	{
+		const char *name;
+		SystemFlushPolicy policy;
+		size_t flush_size;
+		unsigned long long flush_interval_us;
+	} cases[] = {
+		{"line (previous behaviour)", SYSTEM_FLUSH_LINE, SYSTEM_OUTPUT_BUFFER_SIZE, 0},
+		{"size, 4 KiB", SYSTEM_FLUSH_SIZE, 4096, 0},
+		{"size, 16 KiB", SYSTEM_FLUSH_SIZE, 16384, 0},
+		{"interval, 50 ms", SYSTEM_FLUSH_INTERVAL, 16384, 50000},
+		{"exit", SYSTEM_FLUSH_EXIT, SYSTEM_OUTPUT_BUFFER_SIZE, 0},
+	};
+
+	set_log_mask(0);
+
+	BASICProgram *program = basic_create_program();
+	program->program_source = (char *)BENCH_PROGRAM;
+	if (basic_tokenize(program) != 0 || basic_parse_to_ast(program) != 0)
+	{
+		fprintf(stderr, "Failed to parse the benchmark program\n");
+		return 1;
+	}
+
+	int null_fd = open("/dev/null", O_WRONLY);
+	printf("%d prints per run\n", PRINT_COUNT);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		double elapsed;
+		unsigned long write_calls = bench_run(program, null_fd, cases[i].policy, cases[i].flush_size, cases[i].flush_interval_us, &elapsed);
+		printf("%-26s %6lu write calls %10.3f ms\n", cases[i].name, write_calls, elapsed * 1e3);
+	}
+
+	close(null_fd);
+	basic_destroy_program(program);
+	return 0;
+}
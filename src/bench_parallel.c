@@ -0,0 +1,154 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of the parallel front end: lex and parse a large program with an increasing
+// number of threads, and check that the result matches the serial lexer and parser
+
+#define BLOCK_COUNT 2000
+#define BLOCK_LINES 20
+#define REPEAT_COUNT 5
+
+// Builds a program of top-level IF/ELSE blocks with nested loops, calls and strings
+char *bench_build_program()
+{
+	size_t capacity = (size_t)BLOCK_COUNT * (BLOCK_LINES * 2 + 8) * 48, length = 0;
+	char *source = (char *)malloc(capacity);
+	for (int block = 0; block < BLOCK_COUNT; block++)
+	{
+		length += sprintf(source + length, "x = %d * (y - 3)\nif x > %d then\n", block, block / 2);
+		for (int line = 0; line < BLOCK_LINES; line++)
+		{
+			if (line % 5 == 0)
+				length += sprintf(source + length, "    while y < %d then\n        y = y + 1\n    end\n", line);
+			else
+				length += sprintf(source + length, "    x%d = max(x, %d) * (y + %d)\n", line, line, block);
+		}
+		length += sprintf(source + length, "else\n");
+		for (int line = 0; line < BLOCK_LINES; line++)
+			length += sprintf(source + length, "    print(\"block %d, line %d\", x)\n", block, line);
+		length += sprintf(source + length, "end\n");
+	}
+	source[length] = '\0';
+	return source;
+}
+
+// Structural comparison of two node lists
+int bench_ast_equal(ASTNode *a, ASTNode *b)
+{
+	while (a != NULL && b != NULL)
+	{
+		if (a->type != b->type)
+			return 0;
+		switch (a->type)
+		{
+		case AST_IMMEDIATE:
+		{
+			StringLiteral sa, sb;
+			if (a->data.token_type != b->data.token_type)
+				return 0;
+			ast_data_as_string(a->data, sa);
+			ast_data_as_string(b->data, sb);
+			if (strcmp(sa, sb) != 0)
+				return 0;
+			break;
+		}
+		case AST_VARIABLE:
+		case AST_FUNC_CALL:
+		case AST_KEYWORD:
+			if (strcmp(a->data.token.kw, b->data.token.kw) != 0)
+				return 0;
+			break;
+		case AST_OPERATION:
+			if (a->data.token.op != b->data.token.op)
+				return 0;
+			break;
+		default:
+			break;
+		}
+		if (!bench_ast_equal(a->child, b->child))
+			return 0;
+		a = a->next;
+		b = b->next;
+	}
+	return a == NULL && b == NULL;
+}
+
+// Token lists agree if every token has the same type, text and position
+int bench_tokens_equal(BASICTokenParseList *a, BASICTokenParseList *b)
+{
+	if (a->tokens_length != b->tokens_length)
+		return 0;
+	for (int i = 0; i < a->tokens_length; i++)
+	{
+		if (a->tokens[i].token_type != b->tokens[i].token_type || a->tokens[i].token_at != b->tokens[i].token_at || strcmp(a->tokens[i].token, b->tokens[i].token) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+// Best time out of a few runs. A thread count of 0 uses the serial lexer and parser
+double bench_compile(char *source, int thread_count, BASICProgram *reference, int *mismatch)
+{
+	double best = 0;
+	for (int i = 0; i < REPEAT_COUNT; i++)
+	{
+		BASICProgram *program = basic_create_program();
+		program->program_source = source;
+
+		double start = bench_now();
+		int failed;
+		if (thread_count == 0)
+			failed = basic_tokenize(program) != 0 || basic_parse_to_ast(program) != 0;
+		else
+			failed = basic_parallel_compile(program, thread_count) != 0;
+		double elapsed = bench_now() - start;
+		best = (i == 0 || elapsed < best) ? elapsed : best;
+
+		if (failed)
+			fprintf(stderr, "Failed to parse the benchmark program\n");
+		if (reference != NULL && i == 0 && (failed || !bench_tokens_equal(&program->program_tokens, &reference->program_tokens) || !bench_ast_equal(program->program_sequence->child, reference->program_sequence->child)))
+			*mismatch = 1;
+		basic_destroy_program(program);
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	const int thread_counts[] = {1, 2, 4, 8};
+	int mismatches = 0;
+
+	set_log_mask(0);
+
+	char *source = bench_build_program();
+	printf("Program: %zu bytes\n", strlen(source));
+
+	BASICProgram *reference = basic_create_program();
+	reference->program_source = source;
+	basic_tokenize(reference);
+	basic_parse_to_ast(reference);
+
+	double serial_time = bench_compile(source, 0, NULL, NULL);
+	printf("Serial lex + parse:      %10.3f ms\n", serial_time * 1e3);
+	for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+	{
+		int mismatch = 0;
+		double elapsed = bench_compile(source, thread_counts[i], reference, &mismatch);
+		printf("Parallel, %d thread(s):   %10.3f ms (%.2fx)%s\n", thread_counts[i], elapsed * 1e3, serial_time / elapsed, mismatch ? " MISMATCH" : "");
+		mismatches += mismatch;
+	}
+	printf("Mismatches against serial parse: %d\n", mismatches);
+
+	basic_destroy_program(reference);
+	free(source);
+	return mismatches != 0;
+}
@@ -0,0 +1,65 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <basic_system_interface/system.h>
+
+#include "bench_common.h"
+
+// Benchmark of the runtime random number generator against the C library rand()
+
+#define VALUE_COUNT (1 << 20)
+#define REPEAT_COUNT 20
+
+int main(int argc, char *argv[])
+{
+	int *ints = (int *)malloc(sizeof(int) * VALUE_COUNT);
+	float *floats = (float *)malloc(sizeof(float) * VALUE_COUNT);
+	SystemRandom random;
+	double start, total = (double)VALUE_COUNT * REPEAT_COUNT;
+	// Sum of the values, so that the calls can't be optimized away
+	double checksum = 0;
+
+	srand(1);
+	start = bench_now();
+	for (int r = 0; r < REPEAT_COUNT; r++)
+		for (int i = 0; i < VALUE_COUNT; i++)
+			ints[i] = rand();
+	printf("rand()                  %6.2f ns per value\n", (bench_now() - start) * 1e9 / total);
+	checksum += ints[VALUE_COUNT - 1];
+
+	system_random_seed(&random, 1);
+	start = bench_now();
+	for (int r = 0; r < REPEAT_COUNT; r++)
+		for (int i = 0; i < VALUE_COUNT; i++)
+			ints[i] = system_random_int(&random);
+	printf("system_random_int       %6.2f ns per value\n", (bench_now() - start) * 1e9 / total);
+	checksum += ints[VALUE_COUNT - 1];
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT_COUNT; r++)
+		system_random_fill_int(&random, ints, VALUE_COUNT);
+	printf("system_random_fill_int  %6.2f ns per value\n", (bench_now() - start) * 1e9 / total);
+	checksum += ints[VALUE_COUNT - 1];
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT_COUNT; r++)
+		system_random_fill_float(&random, floats, VALUE_COUNT);
+	printf("system_random_fill_float%6.2f ns per value\n", (bench_now() - start) * 1e9 / total);
+	checksum += floats[VALUE_COUNT - 1];
+
+	// The same seed must give the same sequence, one at a time or in bulk
+	SystemRandom a, b;
+	system_random_seed(&a, 42);
+	system_random_seed(&b, 42);
+	system_random_fill_float(&b, floats, 1000);
+	int mismatches = 0;
+	for (int i = 0; i < 1000; i++)
+		mismatches += system_random_float(&a) != floats[i];
+	printf("Mismatches between single and bulk: %d (checksum %g)\n", mismatches, checksum);
+
+	free(ints);
+	free(floats);
+	return mismatches != 0;
+}
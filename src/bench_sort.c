@@ -0,0 +1,144 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+#include <basic/basic_array_sort.h>
+
+#include "bench_common.h"
+
+// Benchmark of SORT: the radix sorts on 10M random numbers and the boxed sorts on 1M mixed
+// values, each against qsort on the same data
+
+#define NUMBER_LENGTH 10000000
+#define BOXED_LENGTH 1000000
+
+int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+int compare_flt(const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+	return (x > y) - (x < y);
+}
+
+int compare_boxed(const void *a, const void *b)
+{
+	return basic_sort_compare((const ASTNodeData *)a, (const ASTNodeData *)b);
+}
+
+void bench_sort_report(const char *name, size_t length, double elapsed, int sorted)
+{
+	printf("%-22s %9.1f ms %8.1f M elements/s%s\n", name, elapsed * 1e3, length / elapsed / 1e6, sorted ? "" : "  NOT SORTED");
+}
+
+// Runs SORT on a copy of the array, and checks the result with the qsort result
+void bench_array(const char *name, BASICArray *array, const void *original, const void *expected, size_t element_size, int stable)
+{
+	memcpy(array->data.ints, original, element_size * array->length);
+	double start = bench_now();
+	basic_array_sort(array, 0, stable);
+	double elapsed = bench_now() - start;
+
+	int sorted = 1;
+	for (size_t i = 0; i < array->length && sorted; i++)
+	{
+		ASTNodeData value = basic_array_get(array, i);
+		if (array->storage == ARRAY_STORAGE_BOXED)
+			sorted = basic_sort_compare(&value, (const ASTNodeData *)expected + i) == 0;
+		else
+			sorted = memcmp(&value.token.literal, (const char *)expected + i * element_size, element_size) == 0;
+	}
+	bench_sort_report(name, array->length, elapsed, sorted);
+}
+
+int main(int argc, char *argv[])
+{
+	int bounds[1] = {NUMBER_LENGTH - 1};
+	BASICArray *array = basic_array_create(bounds, 1);
+	int *ints = (int *)malloc(sizeof(int) * NUMBER_LENGTH), *ints_sorted = (int *)malloc(sizeof(int) * NUMBER_LENGTH);
+	float *flts = (float *)malloc(sizeof(float) * NUMBER_LENGTH), *flts_sorted = (float *)malloc(sizeof(float) * NUMBER_LENGTH);
+	if (array == NULL || ints == NULL || ints_sorted == NULL || flts == NULL || flts_sorted == NULL)
+	{
+		fprintf(stderr, "Not enough memory for the benchmark arrays\n");
+		return 1;
+	}
+	basic_array_retain(array);
+
+	srand(1);
+	for (size_t i = 0; i < NUMBER_LENGTH; i++)
+	{
+		ints[i] = (int)(((unsigned int)rand() << 16) ^ (unsigned int)rand());
+		flts[i] = ((float)rand() / RAND_MAX - 0.5f) * 2e6f;
+	}
+
+	printf("%d numbers:\n", NUMBER_LENGTH);
+	double start;
+	memcpy(ints_sorted, ints, sizeof(int) * NUMBER_LENGTH);
+	start = bench_now();
+	qsort(ints_sorted, NUMBER_LENGTH, sizeof(int), compare_int);
+	bench_sort_report("qsort int", NUMBER_LENGTH, bench_now() - start, 1);
+	bench_array("SORT int (radix)", array, ints, ints_sorted, sizeof(int), 0);
+
+	memcpy(flts_sorted, flts, sizeof(float) * NUMBER_LENGTH);
+	start = bench_now();
+	qsort(flts_sorted, NUMBER_LENGTH, sizeof(float), compare_flt);
+	bench_sort_report("qsort float", NUMBER_LENGTH, bench_now() - start, 1);
+	basic_array_to_float(array);
+	bench_array("SORT float (radix)", array, flts, flts_sorted, sizeof(float), 0);
+	basic_array_release(array);
+
+	free(ints);
+	free(ints_sorted);
+	free(flts);
+	free(flts_sorted);
+
+	// Boxed arrays: a mix of integers, floats and short strings
+	bounds[0] = BOXED_LENGTH - 1;
+	array = basic_array_create(bounds, 1);
+	ASTNodeData *boxed = (ASTNodeData *)malloc(sizeof(ASTNodeData) * BOXED_LENGTH);
+	ASTNodeData *boxed_sorted = (ASTNodeData *)malloc(sizeof(ASTNodeData) * BOXED_LENGTH);
+	if (array == NULL || boxed == NULL || boxed_sorted == NULL)
+	{
+		fprintf(stderr, "Not enough memory for the benchmark arrays\n");
+		return 1;
+	}
+	basic_array_retain(array);
+	for (size_t i = 0; i < BOXED_LENGTH; i++)
+	{
+		switch (i % 3)
+		{
+		case 0:
+			boxed[i].token_type = DTYPE_NUM;
+			boxed[i].token.literal.num = rand() % 100000;
+			break;
+		case 1:
+			boxed[i].token_type = DTYPE_FLT;
+			boxed[i].token.literal.flt = (float)rand() / RAND_MAX * 100000.0f;
+			break;
+		default:
+			boxed[i].token_type = DTYPE_STR;
+			snprintf(boxed[i].token.literal.str, sizeof(StringLiteral), "item%d", rand() % 100000);
+		}
+	}
+
+	printf("\n%d boxed values:\n", BOXED_LENGTH);
+	memcpy(boxed_sorted, boxed, sizeof(ASTNodeData) * BOXED_LENGTH);
+	start = bench_now();
+	qsort(boxed_sorted, BOXED_LENGTH, sizeof(ASTNodeData), compare_boxed);
+	bench_sort_report("qsort boxed", BOXED_LENGTH, bench_now() - start, 1);
+	// Only the first element is set, so that the array switches to boxed storage
+	basic_array_set(array, 0, boxed[2]);
+	bench_array("SORT boxed (introsort)", array, boxed, boxed_sorted, sizeof(ASTNodeData), 0);
+	bench_array("SORT boxed (stable)", array, boxed, boxed_sorted, sizeof(ASTNodeData), 1);
+
+	basic_array_release(array);
+	free(boxed);
+	free(boxed_sorted);
+	return 0;
+}
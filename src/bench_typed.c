@@ -0,0 +1,96 @@
+// Standard libraries
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utility/logging/logging.h>
+
+#include <basic/ast.h>
+#include <basic/basic.h>
+
+#include "bench_common.h"
+
+// Benchmark of variables with type suffixes against the same loops without them: an integer
+// loop with globals and with the locals of a function, and a float loop. Each program leaves its result in s
+
+#define ITERATIONS 1000000
+
+const char *BENCH_UNTYPED =
+	"s = 0\n"
+	"i = 0\n"
+	"while i < 1000000 then\n"
+	"    i = i + 1\n"
+	"    s = s + (i % 7) * 3\n"
+	"end\n";
+
+const char *BENCH_TYPED =
+	"s% = 0\n"
+	"i% = 0\n"
+	"while i% < 1000000 then\n"
+	"    i% = i% + 1\n"
+	"    s% = s% + (i% % 7) * 3\n"
+	"end\n"
+	"s = s%\n";
+
+const char *BENCH_UNTYPED_LOCAL =
+	"function total(n)\n"
+	"    s = 0\n"
+	"    i = 0\n"
+	"    while i < n then\n"
+	"        i = i + 1\n"
+	"        s = s + (i % 7) * 3\n"
+	"    end\n"
+	"    return s\n"
+	"end\n"
+	"s = total(1000000)\n";
+
+const char *BENCH_TYPED_LOCAL =
+	"function total(n%)\n"
+	"    s% = 0\n"
+	"    i% = 0\n"
+	"    while i% < n% then\n"
+	"        i% = i% + 1\n"
+	"        s% = s% + (i% % 7) * 3\n"
+	"    end\n"
+	"    return s%\n"
+	"end\n"
+	"s = total(1000000)\n";
+
+const char *BENCH_UNTYPED_FLOAT =
+	"s = 0.0\n"
+	"v = 1.0\n"
+	"i = 0\n"
+	"while i < 1000000 then\n"
+	"    i = i + 1\n"
+	"    s = s + v * 0.5 - 0.25\n"
+	"end\n";
+
+const char *BENCH_TYPED_FLOAT =
+	"x! = 0\n"
+	"v! = 1\n"
+	"i% = 0\n"
+	"while i% < 1000000 then\n"
+	"    i% = i% + 1\n"
+	"    x! = x! + v! * 0.5 - 0.25\n"
+	"end\n"
+	"s = x!\n";
+
+int main(int argc, char *argv[])
+{
+	set_log_mask(0);
+
+	// What the integer programs add up. The float ones add 0.25 each time, which floats hold exactly
+	long expected = 0;
+	for (int i = 1; i <= ITERATIONS; i++)
+		expected += (i % 7) * 3;
+	double expected_float = ITERATIONS * 0.25;
+
+	printf("BASIC, %d iterations:\n", ITERATIONS);
+	bench_report("integers, globals", ITERATIONS, "iteration", bench_program(BENCH_UNTYPED, expected));
+	bench_report("integers %, globals", ITERATIONS, "iteration", bench_program(BENCH_TYPED, expected));
+	bench_report("integers, locals", ITERATIONS, "iteration", bench_program(BENCH_UNTYPED_LOCAL, expected));
+	bench_report("integers %, locals", ITERATIONS, "iteration", bench_program(BENCH_TYPED_LOCAL, expected));
+	bench_report("floats", ITERATIONS, "iteration", bench_program(BENCH_UNTYPED_FLOAT, expected_float));
+	bench_report("floats !", ITERATIONS, "iteration", bench_program(BENCH_TYPED_FLOAT, expected_float));
+	return 0;
+}
@@ -18,11 +18,13 @@ https://en.cppreference.com/w/c/language/operator_precedence
 */
 
 #include <utility/utils.h>
-#include <utility/platform/platform.h>
 #include <utility/logging/logging.h>
+#include <utility/shm_cache/shm_cache.h>
 #include <tcpserver/tcpserver.h>
 #include <http/http.h>
 
+#include "static_assets.h"
+
 #include <basic/ast.h>
 #include <basic/basic.h>
 
@@ -32,7 +34,7 @@ https://en.cppreference.com/w/c/language/operator_precedence
 #include <ctype.h>
 #include <time.h>
 
-// Linux libraries for fork() call
+// Linux libraries for sysconf() call
 #include <sys/types.h>
 #include <unistd.h>
 // For open(), write() and constants
@@ -42,55 +44,178 @@ https://en.cppreference.com/w/c/language/operator_precedence
 // Comment to print output to console only
 #define OUTPUT_CLIENT_REDIRECT
 
+// Program output sent to the client is buffered up to this size, and written out while the program runs
+// once this much time passed since the last write
+const size_t OUTPUT_BUFFER_SIZE = 16384;
+const unsigned long long OUTPUT_FLUSH_INTERVAL_US = 50000;
+
 // Which TCP Port to start listening on
 const int LISTEN_PORT = 1111;
 
+// Worker processes are forked at startup and each one serves requests, so no fork happens while a request
+// waits. Set SERVER_MODE to TCPSERVER_EPOLL for workers that read many connections at once without blocking,
+// to TCPSERVER_IO_URING for the same with io_uring (epoll is used where it is missing), to TCPSERVER_THREADS for workers that serve requests on several threads, or to TCPSERVER_FORK_PER_CONNECTION
+// to fork a process for every connection instead
+const tcpserver_mode SERVER_MODE = TCPSERVER_PREFORK;
+// Number of worker processes, 0 for one per CPU core
+const int SERVER_WORKERS = 0;
+// Threads of each worker process in the TCPSERVER_THREADS mode
+const int SERVER_THREADS = 16;
+// Each worker is replaced by a fresh process after serving this many requests, 0 to keep workers forever
+const int WORKER_MAX_REQUESTS = 1000;
+// Give each worker its own listening socket with SO_REUSEPORT
+const int WORKER_REUSE_PORT = 0;
+// Most connections served at the same time when forking a process for every connection, 0 for no limit
+const int MAX_CONNECTION_PROCESSES = 64;
+// Connections that send nothing for this many seconds are closed by the TCPSERVER_EPOLL workers
+const int CONNECTION_IDLE_TIMEOUT = 30;
+// Most requests served on one kept-alive connection before it is closed, 0 for no limit
+const int MAX_CONNECTION_REQUESTS = 100;
+// Seconds a pre-fork worker or thread waits for the next request on a kept-alive connection, 0 to close after each request
+const int KEEP_ALIVE_TIMEOUT = 5;
+
+// Folder whose files are served for any other path, such as "/srv/www", or NULL to serve none. Files are sent
+// with sendfile() and kept open between requests
+const char *DOCUMENT_ROOT = NULL;
+
+// Size cap and maximum number of entries of the compiled program cache. Set size to 0 to disable the cache
+const size_t PROGRAM_CACHE_SIZE = 32 * 1048576;
+const int PROGRAM_CACHE_ENTRIES = 256;
+
+// Compiled programs shared between all workers. Created by the parent process before any worker is forked
+shm_cache *program_cache = NULL;
+
 /* APPLICATION FUNCTIONS */
 
-void program_parse_and_run(char *buffer)
+// Load the compiled program from the cache if the same source was seen before. Returns 1 if it was found
+int program_load_cached(BASICProgram *program, char *buffer)
+{
+	size_t flat_size;
+	void *flat;
+
+	if (program_cache == NULL || !shm_cache_get(program_cache, buffer, strlen(buffer), &flat, &flat_size))
+		return 0;
+
+	int load_error = basic_program_load_flat(program, flat, flat_size);
+	free(flat);
+	if (load_error != 0)
+		return 0;
+
+	lprintf("RUN", LOGTYPE_MESSAGE, "Loaded compiled program from cache\n");
+	return 1;
+}
+
+// Publish the compiled program for the other workers
+void program_publish(BASICProgram *program, char *buffer)
+{
+	size_t flat_size;
+	void *flat;
+
+	if (program_cache != NULL && (flat = basic_program_flatten(program, &flat_size)) != NULL)
+	{
+		shm_cache_put(program_cache, buffer, strlen(buffer), flat, flat_size);
+		free(flat);
+	}
+}
+
+// Lex and parse the program source. With 'lazy', IF/WHILE bodies are only parsed when they first run,
+// unless 'validate' is set to check the whole program before it starts
+int program_compile(BASICProgram *program, int lazy, int validate)
+{
+	lprintf("RUN", LOGTYPE_MESSAGE, "Lexing and parsing BASIC program\n");
+	program->program_tokens.lazy_bodies = lazy;
+	// Large programs are split across all cores
+	if (basic_parallel_compile(program, 0) != 0)
+	{
+		lprintf("RUN", LOGTYPE_ERROR, "Failed to parse the program\n");
+		return 1;
+	}
+
+	if (lazy && validate && basic_parse_validate(program) != 0)
+		return 1;
+
+	return 0;
+}
+
+// Log writer that puts the messages in a program's output buffer, so that they are sent along with the output
+long program_output_log_writer(void *output, const char *text, size_t length)
+{
+	SystemOutput *program_output = (SystemOutput *)output;
+	if (length > 0 && text[length - 1] == '\n')
+	{
+		system_output_write(program_output, text, length - 1);
+		system_output_end_line(program_output);
+	}
+	else
+		system_output_write(program_output, text, length);
+	return program_output->failed ? -1 : (long)length;
+}
+
+// The program output is written to 'output', which the runtime takes over.
+// With 'use_seed', the random numbers come from 'seed' instead of the system, to reproduce a run
+// Returns the exit status of the program: 0 if it ran to the end, 1 if it could not be parsed or stopped with an error
+int program_parse_and_run(char *buffer, SystemSink output, int use_cache, int lazy, int validate, int use_seed, unsigned long long seed)
 {
 	BASICProgram *program;
 	BASICRuntime *runtime;
+	int status = 1;
 
 	program = basic_create_program();
 	if (program == NULL)
 	{
 		lprintf("RUN", LOGTYPE_ERROR, "Failed to initialize basic program\n");
-		return;
+		return status;
 	}
 
 	// Source code bind
 	program->program_source = buffer;
 
-	lprintf("RUN", LOGTYPE_MESSAGE, "Lexing BASIC program\n");
-	if (basic_tokenize(program) == 0)
+	int loaded = use_cache && program_load_cached(program, buffer);
+	if (loaded || program_compile(program, lazy, validate) == 0)
 	{
-		lprintf("RUN", LOGTYPE_MESSAGE, "Parsing to AST\n");
-		if (basic_parse_to_ast(program) == 0)
+		// Deferred bodies would all have to be parsed to publish the program, so do that after the run
+		int publish_after_run = use_cache && !loaded && lazy && !validate;
+		if (use_cache && !loaded && !publish_after_run)
+			program_publish(program, buffer);
+
+		lprintf("RUN", LOGTYPE_MESSAGE, "Preparing runtime\n");
+		runtime = basic_create_runtime(program);
+		if (runtime == NULL)
 		{
-			lprintf("RUN", LOGTYPE_MESSAGE, "Preparing runtime\n");
-			runtime = basic_create_runtime(program);
-			if (runtime == NULL)
-			{
-				lprintf("RUN", LOGTYPE_ERROR, "Failed to create a BASIC runtime object\n");
-			}
-			else
+			lprintf("RUN", LOGTYPE_ERROR, "Failed to create a BASIC runtime object\n");
+		}
+		else
+		{
+			// Batch the output sent to the client, but still stream it while long programs run
+			system_output_set_sink(runtime->output, output);
+			system_output_set_policy(runtime->output, SYSTEM_FLUSH_INTERVAL, OUTPUT_BUFFER_SIZE, OUTPUT_FLUSH_INTERVAL_US);
+			if (use_seed)
+				system_random_seed(&runtime->random, seed);
+
+			// Log messages of the run go into the same buffer as the output, instead of writing it out before each one
+			LogState log_state = get_log_state();
+			set_log_flush_hook(NULL, NULL);
+			set_log_writer(program_output_log_writer, runtime->output);
+
+			// Execute the BASIC program from first instruction in the sequence
+			lprintf("RUN", LOGTYPE_MESSAGE, "Running BASIC program\n");
+			basic_execute(runtime, program->program_sequence);
+			lprintf("RUN", LOGTYPE_MESSAGE, "Program finished executing\n");
+			status = runtime->halt ? 1 : 0;
+			set_log_writer(log_state.writer, log_state.writer_context);
+			if (publish_after_run && !runtime->halt)
 			{
-				// Execute the BASIC program from first instruction in the sequence
-				lprintf("RUN", LOGTYPE_MESSAGE, "Running BASIC program\n");
-				basic_execute(runtime, program->program_sequence);
-				lprintf("RUN", LOGTYPE_MESSAGE, "Program finished executing\n");
+				// Syntax errors in bodies that never ran are not part of this run's output
+				set_log_mask(0);
+				program_publish(program, buffer);
 			}
+			basic_free_runtime(runtime);
 		}
 	}
-	else
-	{
-		lprintf("RUN", LOGTYPE_ERROR, "Failed to parse the program\n");
-	}
 
 	// Cleanup
-	basic_free_runtime(runtime);
 	basic_destroy_program(program);
+	return status;
 }
 
 // Prepares a buffer to store incoming program source code
@@ -100,8 +225,7 @@ void alloc_read_http_program(int sock_fd, http_request_header *req, http_respons
 	{
 		// Unsupported method, only POST will be processed
 		res->status_code = 405;
-		http_write_header(sock_fd, res);
-		fd_write_string(sock_fd, "Method not supported.\nThis URI only supports POST method.");
+		http_respond_text(sock_fd, res, "Method not supported.\nThis URI only supports POST method.");
 		return;
 	}
 
@@ -109,14 +233,17 @@ void alloc_read_http_program(int sock_fd, http_request_header *req, http_respons
 	{
 		// Need to send content length header to read data
 		res->status_code = 411;
+		res->content_length = 0;
 		http_write_header(sock_fd, res);
 		return;
 	}
 
 	if (req->content_length > (10 * 1048576))
 	{
-		// Limit size to 10MB
+		// Limit size to 10MB. The body is not read, so the connection can't take another request
 		res->status_code = 403;
+		res->content_length = 0;
+		res->keep_alive = 0;
 		http_write_header(sock_fd, res);
 		return;
 	}
@@ -129,8 +256,8 @@ void alloc_read_http_program(int sock_fd, http_request_header *req, http_respons
 	{
 		// Failed to allocate space
 		res->status_code = 500;
-		http_write_header(sock_fd, res);
-		fd_write_string(sock_fd, "Failed to allocate buffer to save program");
+		res->keep_alive = 0;
+		http_respond_text(sock_fd, res, "Failed to allocate buffer to save program");
 		return;
 	}
 
@@ -138,8 +265,8 @@ void alloc_read_http_program(int sock_fd, http_request_header *req, http_respons
 	if (http_read_body(sock_fd, req, *buffer) < 0)
 	{
 		res->status_code = 500;
-		http_write_header(sock_fd, res);
-		fd_write_string(sock_fd, "Failed to read the program from client request");
+		res->keep_alive = 0;
+		http_respond_text(sock_fd, res, "Failed to read the program from client request");
 		free(*buffer);
 		*buffer = NULL;
 		return;
@@ -149,21 +276,37 @@ void alloc_read_http_program(int sock_fd, http_request_header *req, http_respons
 // Route for POST "/execute"
 void run_basic_program(int sock_fd, http_request_header *req, http_response_header *res)
 {
-	int show_parser_log = 0, show_runner_log = 0;
+	int show_parser_log = 0, show_runner_log = 0, validate = 0, use_seed = 0;
+	unsigned long long seed = 0;
 	char *buffer = NULL;
 	alloc_read_http_program(sock_fd, req, res, &buffer);
 	if (buffer == NULL)
 		return;
 
+	// A worker serves many requests, so undo the flags of the previous one
+	ast_set_float_format(AST_FLOAT_SHORTEST);
+
 	// Check if any flags were passed
-	for (int i = 0; i < req->query_string_count; i++)
+	int position = 0;
+	http_view name, value;
+	while (http_next_query_parameter(req, &position, &name, &value))
 	{
-		char *query = req->query_string[i];
-		printf("[HTTP] > Query flag get: %s\n", query);
-		if (strcmp(query, "show_parser_log") == 0)
+		printf("[HTTP] > Query flag get: %.*s\n", value.offset + value.length - name.offset, req->buffer + name.offset);
+		if (http_view_equals(req->buffer, name, "show_parser_log"))
 			show_parser_log = 1;
-		if (strcmp(query, "show_runner_log") == 0)
+		if (http_view_equals(req->buffer, name, "show_runner_log"))
 			show_runner_log = 1;
+		if (http_view_equals(req->buffer, name, "validate"))
+			validate = 1;
+		// Print floats with six decimal places, like earlier versions
+		if (http_view_equals(req->buffer, name, "fixed_floats"))
+			ast_set_float_format(AST_FLOAT_FIXED);
+		// Fixed random seed, as "seed=<number>". The number ends at the '&' or space after it
+		if (http_view_equals(req->buffer, name, "seed"))
+		{
+			use_seed = 1;
+			seed = strtoull(req->buffer + value.offset, NULL, 10);
+		}
 	}
 
 	/* Debugging */
@@ -184,65 +327,142 @@ void run_basic_program(int sock_fd, http_request_header *req, http_response_head
 
 	set_log_mask(log_print_mask);
 
-	// Put out OK header
+	// Put out OK header. The length of the output is not known, so it is sent in chunks, which end with
+	// trailer fields telling how the program went
 	res->status_code = 200;
+	res->trailer = "X-Exit-Status, X-Run-Time-Ms, X-Output-Bytes, X-Output-Chunks";
 	http_write_header(sock_fd, res);
 
 	printf("[HTTP] Beginning executing the program\n");
 
-	// Redirect all output from this point onwards to the client
+	// Send the program output and log messages of this thread to the client. Nothing process-wide
+	// is redirected, so other threads keep serving their own requests
 #ifdef OUTPUT_CLIENT_REDIRECT
-	int copy_stdout = stdout2fd_set(sock_fd);
+	SystemSink output = system_sink_callback(http_body_writer, res);
+	set_log_writer(http_body_writer, res);
+#else
+	SystemSink output = system_sink_file(stdout);
 #endif
-	// Now, anything written to stdout will be sent to the client
 
 	// Run the basic program. Any output produced is sent directly to the client
-	program_parse_and_run(buffer);
-
-	// Write out any remaining stream data
-	fflush(stdout);
+	// Parser logs are only produced by a real parse, so skip the cache when they are requested.
+	// Block bodies are parsed when they first run, except when the parser log should show the whole program
+	unsigned long long started_us = system_time_us();
+	int status = program_parse_and_run(buffer, output, !show_parser_log, !show_parser_log, validate, use_seed, seed);
+	unsigned long long run_time_us = system_time_us() - started_us;
 
 	// Free all memory buffers
 	free(buffer);
 
-	// Restore stdout back to normal
-#ifdef OUTPUT_CLIENT_REDIRECT
-	stdout2fd_reset(copy_stdout);
-#endif
+	set_log_writer(NULL, NULL);
+
+	char trailers[256];
+	snprintf(trailers, sizeof(trailers), "X-Exit-Status: %d\r\nX-Run-Time-Ms: %llu.%03llu\r\nX-Output-Bytes: %ld\r\nX-Output-Chunks: %d\r\n",
+		status, run_time_us / 1000, run_time_us % 1000, res->body_sent, res->chunks_sent);
+	http_end_body(sock_fd, res, trailers);
 	printf("[HTTP] Done executing the program\n");
 }
 
+// Route for POST "/check"
+// Reports syntax errors of the program as "line:column: message" lines, without running it
+void check_basic_program(int sock_fd, http_request_header *req, http_response_header *res)
+{
+	BASICDiagnostic diagnostics[64];
+	const int max_diagnostics = sizeof(diagnostics) / sizeof(diagnostics[0]);
+	char buff[256];
+	char *buffer = NULL;
+
+	alloc_read_http_program(sock_fd, req, res, &buffer);
+	if (buffer == NULL)
+		return;
+
+	// The parser errors are sent as diagnostics instead
+	set_log_mask(0);
+
+	BASICIncrementalProgram *inc = basic_incremental_create(buffer, strlen(buffer));
+	free(buffer);
+	if (inc == NULL)
+	{
+		res->status_code = 500;
+		http_respond_text(sock_fd, res, "Failed to check the program");
+		return;
+	}
+
+	// The lines are put together first, to be sent with their length
+	int count = basic_incremental_get_diagnostics(inc, diagnostics, max_diagnostics);
+	char *report = (char *)malloc(MIN(count, max_diagnostics) * sizeof(buff) + 1);
+	size_t report_len = 0;
+	if (report != NULL)
+	{
+		report[0] = '\0';
+		for (int i = 0; i < MIN(count, max_diagnostics); i++)
+			report_len += snprintf(report + report_len, sizeof(buff), "%d:%d: %s\n", diagnostics[i].line, diagnostics[i].column, diagnostics[i].message);
+		http_respond_text(sock_fd, res, report);
+		free(report);
+	}
+	else
+	{
+		res->status_code = 500;
+		http_respond_text(sock_fd, res, "Failed to check the program");
+	}
+	basic_incremental_destroy(inc);
+}
+
+// Route for GET "/cache_stats"
+void show_cache_stats(int sock_fd, http_request_header *req, http_response_header *res)
+{
+	char buff[512];
+	shm_cache_stats stats;
+
+	if (program_cache == NULL)
+	{
+		http_respond_text(sock_fd, res, "Program cache is disabled\n");
+		return;
+	}
+
+	shm_cache_get_stats(program_cache, &stats);
+	sprintf(buff, "hits: %llu\nmisses: %llu\ninsertions: %llu\nevictions: %llu\nentries: %d\nbytes_used: %zu\nsize_cap: %zu\n",
+		stats.hits, stats.misses, stats.insertions, stats.evictions, stats.entry_count, stats.bytes_used, stats.size_cap);
+	http_respond_text(sock_fd, res, buff);
+}
+
 // This function is of type http_resp_cb
 // Respond to client requests based on URI
 void generate_response(int sock_fd, http_request_header *req, http_response_header *res)
 {
 	const char path_execute[] = "/execute";
 	int arg1_int;
+	const http_static_asset *asset;
 
-	if (strcmp(req->fetch_path, "/") == 0)
+	if (http_path_is(req, "/"))
 	{
 		// Landing page
-		http_respond_file(sock_fd, res, "static/index.html", "text/html");
+		http_respond_asset(sock_fd, req, res, http_find_asset(STATIC_ASSETS, STATIC_ASSET_COUNT, "/index.html", strlen("/index.html")));
 	}
-	else if (strcmp(req->fetch_path, "/codemirror.js") == 0)
+	else if ((asset = http_find_asset(STATIC_ASSETS, STATIC_ASSET_COUNT, req->buffer + req->path.offset, req->path.length)) != NULL)
 	{
-		// CodeMirror main JS
-		http_respond_file(sock_fd, res, "static/codemirror.js", "text/javascript");
+		// The page's scripts and styles: CodeMirror and its BASIC syntax module
+		http_respond_asset(sock_fd, req, res, asset);
 	}
-	else if (strcmp(req->fetch_path, "/codemirror.css") == 0)
+	else if (http_path_is(req, path_execute))
 	{
-		// CodeMirror main css
-		http_respond_file(sock_fd, res, "static/codemirror.css", "text/css");
+		// Execute given BASIC program
+		run_basic_program(sock_fd, req, res);
 	}
-	else if (strcmp(req->fetch_path, "/basic.js") == 0)
+	else if (http_path_is(req, "/check"))
 	{
-		// CodeMirror BASIC syntax module
-		http_respond_file(sock_fd, res, "static/basic.js", "text/javascript");
+		// Syntax check of the given BASIC program
+		check_basic_program(sock_fd, req, res);
 	}
-	else if (strcmp(req->fetch_path, path_execute) == 0)
+	else if (http_path_is(req, "/cache_stats"))
 	{
-		// Execute given BASIC program
-		run_basic_program(sock_fd, req, res);
+		// Compiled program cache counters
+		show_cache_stats(sock_fd, req, res);
+	}
+	else if (DOCUMENT_ROOT != NULL && req->method == METHOD_GET)
+	{
+		// Files of the document root, or a 404 if there is no such file
+		http_respond_document(sock_fd, req, res, DOCUMENT_ROOT);
 	}
 	else
 	{
@@ -252,46 +472,20 @@ void generate_response(int sock_fd, http_request_header *req, http_response_head
 }
 
 // This function is of type tcpserver_handler
-// Spawn a process to handle the HTTP request
-int spawn_http_worker(int cli_sock, tcp_server *tcpsv)
+// Serve the HTTP request in this process, which is a worker or a process forked for the connection
+int serve_http_client(int cli_sock, tcp_server *tcpsv)
 {
-	// Child process has a reference to the listening and client socket
-	// We need to close the client socket in the parent process
-	// and close the listening socket in the child process.
-	// After child process is done, exit promptly.
-	// See https://stackoverflow.com/a/6019241/12887350
-
-	int pid = fork();
-	if (pid < 0)
-		return pid;
-	else if (pid == 0)
-	{
-		// Child process
-
-		// Give the child a new RNG seed
-		srand(time(0));
-
-		// Close listening socket to decrement reference count
-		close(tcpsv->listen_sock);
-
-		// Handle the client request
-		http_respond(cli_sock, generate_response);
-
-		// Exit the child process
-		_exit(0);
-	}
-	else
-	{
-		// Parent process
-
-		// Close client socket to decrement reference count
-		close(cli_sock);
-		return 0;
-	}
-
+	http_respond(cli_sock, generate_response);
 	return 0;
 }
 
+// This function is of type tcpserver_request_handler
+// Serve an HTTP request that the event loop has already received
+int serve_http_request(int cli_sock, char *request, int request_len, void *request_state, int keep_alive, tcp_server *tcpsv)
+{
+	return http_respond_request(cli_sock, request, request_len, request_state, keep_alive, generate_response);
+}
+
 /* MAIN PROGRAM ENTRY POINT */
 
 int main(int argc, char *argv[])
@@ -299,20 +493,38 @@ int main(int argc, char *argv[])
 	// TCP server object to listen to the specified port
 	tcp_server sock_sv;
 	sock_sv.listen_port = LISTEN_PORT;
-	sock_sv.client_handler = spawn_http_worker;
-
-	// Initialize an new seed based on current time
-	srand(time(0));
+	sock_sv.client_handler = serve_http_client;
+	sock_sv.request_handler = serve_http_request;
+	sock_sv.request_length = http_request_length;
+	sock_sv.request_state_size = sizeof(http_parser);
+	sock_sv.mode = SERVER_MODE;
+	sock_sv.worker_count = SERVER_WORKERS > 0 ? SERVER_WORKERS : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	sock_sv.thread_count = SERVER_THREADS;
+	sock_sv.worker_max_requests = WORKER_MAX_REQUESTS;
+	sock_sv.reuse_port = WORKER_REUSE_PORT;
+	sock_sv.max_children = MAX_CONNECTION_PROCESSES;
+	sock_sv.idle_timeout = CONNECTION_IDLE_TIMEOUT;
+	sock_sv.max_connection_requests = MAX_CONNECTION_REQUESTS;
+	sock_sv.keep_alive_timeout = KEEP_ALIVE_TIMEOUT;
+
+	// Create the program cache before forking any worker so that all of them share it
+	if (PROGRAM_CACHE_SIZE > 0)
+	{
+		program_cache = shm_cache_create(PROGRAM_CACHE_SIZE, PROGRAM_CACHE_ENTRIES);
+		if (program_cache == NULL)
+			fprintf(stderr, "Failed to create the program cache, continuing without it\n");
+	}
 
 	/* Main application code is here! */
 	if (tcpserver_create(&sock_sv) != 0)
 		return 1;
 
-	// Start the TCP server, waiting for new clients to connect
+	// Start the TCP server, waiting for new clients to connect. Returns once the workers are stopped
 	if (tcpserver_start_listening(&sock_sv) != 0)
 		return 1;
 
 	tcpserver_close(&sock_sv);
+	shm_cache_destroy(program_cache);
 
 	return 0;
 }
@@ -14,12 +14,7 @@ void interpret_basic_program(BASICProgram *program)
 	StringLiteral buffer;
 	BASICRuntime *runtime;
 
-	if (basic_tokenize(program) != 0)
-	{
-		return;
-	}
-
-	if (basic_parse_to_ast(program))
+	if (basic_parallel_compile(program, 0) != 0)
 	{
 		return;
 	}